@@ -0,0 +1,327 @@
+// Copyright (C) 2026 Piers Finlayson <piers@piers.rocks>
+//
+// MIT License
+
+// apio - Runtime RP2350 PIO Assembler and Disassembler
+//
+// Host benchmark suite, measuring the cost of apio's own assembler,
+// disassembler and emulation paths.  Built with APIO_EMULATION, so runs on
+// any host - see bench/README.md.
+//
+// Each benchmark is run for at least the minimum time, several times, and
+// the fastest run is reported as one JSON object per line on stdout.
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// The disassembler is only built when logging is enabled.  Benchmarks must
+// not be skewed by output, so log lines are discarded.
+static void bench_log(const char *fmt, ...) {
+    (void)fmt;
+}
+#define APIO_LOG_ENABLE bench_log
+#define APIO_LOG_IMPL   1
+#define APIO_EMU_IMPL   1
+#include <apio.h>
+
+// Defaults, overridable on the command line
+#define BENCH_DEFAULT_MIN_MS    200
+#define BENCH_DEFAULT_REPEATS   3
+
+// Words decoded per iteration of the decoder benchmark
+#define BENCH_DECODE_BATCH      256
+
+typedef struct {
+    const char *name;
+    const char *unit;           // What a single operation is
+    uint32_t ops_per_iter;
+    void (*fn)(uint32_t iters);
+} bench_t;
+
+// Accumulates results, so the compiler cannot discard benchmarked work
+static volatile uint32_t bench_sink;
+
+// Forces the emulated state to be re-read and written each iteration, so
+// the compiler cannot hoist or merge work across iterations
+#define BENCH_BARRIER()     __asm__ volatile("" ::: "memory")
+
+static uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+//
+// Benchmarks
+//
+
+// Instruction and start offset for bench_add_instr(), read at run time so the
+// compiler cannot precompute the words written.  The offset stays 0, so each
+// iteration adds APIO_MAX_PIO_INSTRS instructions.
+static volatile uint16_t bench_instr = APIO_JMP(0);
+static volatile uint8_t bench_offset;
+
+// Instructions assembled through APIO_ADD_INSTR(), each iteration's words
+// differing from the last
+static void bench_add_instr(uint32_t iters) {
+    APIO_ASM_INIT();
+    uint32_t sum = 0;
+    for (uint32_t ii = 0; ii < iters; ii++) {
+        BENCH_BARRIER();
+        uint16_t instr = bench_instr;
+        uint8_t offset = bench_offset;
+        APIO_SET_BLOCK_FROM(0, offset);
+        for (int jj = offset; jj < APIO_MAX_PIO_INSTRS; jj++) {
+            APIO_ADD_INSTR((uint16_t)(instr | ((jj + ii) & 0x1F)));
+        }
+        sum += _apio_emulated_pio.instr[0][ii % APIO_MAX_PIO_INSTRS];
+    }
+    bench_sink += sum;
+}
+
+// A complete build of all 12 SMs, from APIO_ASM_INIT() to enabling them
+static void bench_config_12sm(uint32_t iters) {
+    for (uint32_t ii = 0; ii < iters; ii++) {
+        BENCH_BARRIER();
+        APIO_ASM_INIT();
+        for (uint8_t blk = 0; blk < APIO_MAX_PIO_BLOCKS; blk++) {
+            APIO_SET_BLOCK_VAR(blk);
+            APIO_GPIOBASE_0();
+            for (uint8_t sm = 0; sm < APIO_MAX_SMS_PER_BLOCK; sm++) {
+                APIO_SET_SM_VAR(sm);
+                APIO_ADD_INSTR(APIO_PULL_BLOCK);
+                APIO_WRAP_BOTTOM();
+                APIO_ADD_INSTR(APIO_OUT_PINS(8));
+                APIO_ADD_INSTR(APIO_ADD_DELAY(APIO_SET_PINS(1), 3));
+                APIO_ADD_INSTR(APIO_MOV_X_OSR);
+                APIO_ADD_INSTR(APIO_JMP_X_DEC(APIO_START_LABEL() + 4));
+                APIO_ADD_INSTR(APIO_IN_PINS(8));
+                APIO_ADD_INSTR(APIO_PUSH_BLOCK);
+                APIO_WRAP_TOP();
+                APIO_ADD_INSTR(APIO_SET_PINS(0));
+                APIO_SM_CLKDIV_SET(2, 0);
+                APIO_SM_EXECCTRL_SET(0);
+                APIO_SM_SHIFTCTRL_SET(APIO_OUT_SHIFTDIR_R | APIO_IN_SHIFTDIR_L);
+                APIO_SM_PINCTRL_SET(
+                    APIO_OUT_BASE(sm * 8) |
+                    APIO_OUT_COUNT(8) |
+                    APIO_SET_BASE(sm * 8) |
+                    APIO_SET_COUNT(1) |
+                    APIO_IN_BASE(sm * 8)
+                );
+                APIO_SM_JMP_TO_START();
+            }
+            APIO_END_BLOCK();
+            APIO_ENABLE_SMS(blk, 0xF);
+        }
+    }
+    bench_sink += _apio_emulated_pio.pio_sm_reg[2][3].pinctrl;
+}
+
+// Decoding instruction words, cycling through the whole instruction space
+static void bench_decoder(uint32_t iters) {
+    static uint16_t word;
+    char out[64];
+    uint32_t sum = 0;
+    for (uint32_t ii = 0; ii < iters; ii++) {
+        BENCH_BARRIER();
+        for (int jj = 0; jj < BENCH_DECODE_BATCH; jj++) {
+            apio_instruction_decoder(word++, out, 0);
+            sum += (uint8_t)out[0];
+        }
+    }
+    bench_sink += sum;
+}
+
+// APIO_ASM_INIT()'s reset of the emulated state
+static void bench_asm_init(uint32_t iters) {
+    for (uint32_t ii = 0; ii < iters; ii++) {
+        BENCH_BARRIER();
+        APIO_ASM_INIT();
+    }
+    bench_sink += _apio_emulated_pio.pios_enabled;
+}
+
+// APIO_RESET_BLOCK_VAR(), for comparison with bench_asm_init()
+static void bench_reset_block(uint32_t iters) {
+    APIO_ASM_INIT();
+    for (uint32_t ii = 0; ii < iters; ii++) {
+        BENCH_BARRIER();
+        APIO_RESET_BLOCK_VAR(ii % APIO_MAX_PIO_BLOCKS);
+    }
+    bench_sink += _apio_emulated_pio.offset[0];
+}
+
+// Writes through APIO_TXF, a FIFO's depth at a time.  The emulated FIFO is
+// emptied between batches, as an emulator would.
+static void bench_txf(uint32_t iters) {
+    APIO_ASM_INIT();
+    APIO_SET_BLOCK(0);
+    APIO_SET_SM(0);
+    for (uint32_t ii = 0; ii < iters; ii++) {
+        BENCH_BARRIER();
+        for (int jj = 0; jj < APIO_MAX_FIFO_DEPTH; jj++) {
+            APIO_TXF = ii;
+        }
+        _apio_emulated_pio.tx_fifo_count[0][0] = 0;
+    }
+    bench_sink += _apio_emulated_pio.tx_fifos[0][0][0];
+}
+
+// Reads through APIO_RXF, a FIFO's depth at a time
+static void bench_rxf(uint32_t iters) {
+    APIO_ASM_INIT();
+    APIO_SET_BLOCK(0);
+    APIO_SET_SM(0);
+    uint32_t sum = 0;
+    for (uint32_t ii = 0; ii < iters; ii++) {
+        BENCH_BARRIER();
+        for (int jj = 0; jj < APIO_MAX_FIFO_DEPTH; jj++) {
+            sum += APIO_RXF;
+        }
+        _apio_emulated_pio.rx_fifo_count[0][0] = 0;
+    }
+    bench_sink += sum;
+}
+
+// Instructions queued through APIO_SM_EXEC_INSTR(), a queue's capacity at a
+// time
+static void bench_exec_instr(uint32_t iters) {
+    APIO_ASM_INIT();
+    APIO_SET_BLOCK(0);
+    APIO_SET_SM(0);
+    for (uint32_t ii = 0; ii < iters; ii++) {
+        BENCH_BARRIER();
+        for (int jj = 0; jj < APIO_EMU_MAX_PRE_INSTRS; jj++) {
+            APIO_SM_EXEC_INSTR(APIO_SET_PINS(jj & 0x1F));
+        }
+        _apio_emulated_pio.pre_instr_count[0][0] = 0;
+    }
+    bench_sink += _apio_emulated_pio.pre_instr[0][0][0];
+}
+
+static const bench_t benches[] = {
+    {"add_instr",   "instr",    APIO_MAX_PIO_INSTRS,    bench_add_instr},
+    {"config_12sm", "config",   1,                      bench_config_12sm},
+    {"decoder",     "instr",    BENCH_DECODE_BATCH,     bench_decoder},
+    {"asm_init",    "init",     1,                      bench_asm_init},
+    {"reset_block", "reset",    1,                      bench_reset_block},
+    {"txf",         "write",    APIO_MAX_FIFO_DEPTH,    bench_txf},
+    {"rxf",         "read",     APIO_MAX_FIFO_DEPTH,    bench_rxf},
+    {"exec_instr",  "instr",    APIO_EMU_MAX_PRE_INSTRS, bench_exec_instr},
+};
+#define BENCH_COUNT (sizeof(benches) / sizeof(benches[0]))
+
+//
+// Harness
+//
+
+// Returns the number of iterations needed to run for at least min_ns
+static uint32_t bench_calibrate(const bench_t *bench, uint64_t min_ns) {
+    uint32_t iters = 1;
+    while (1) {
+        uint64_t start = bench_now_ns();
+        bench->fn(iters);
+        uint64_t elapsed = bench_now_ns() - start;
+        if (elapsed >= min_ns) {
+            return iters;
+        }
+        if (iters >= (UINT32_MAX / 2)) {
+            return iters;
+        }
+        // Aim straight for the target once the timing is meaningful
+        if (elapsed > (min_ns / 100)) {
+            uint64_t target = ((uint64_t)iters * min_ns * 11) / (elapsed * 10);
+            return (target > UINT32_MAX) ? UINT32_MAX : (uint32_t)target;
+        }
+        iters *= 2;
+    }
+}
+
+static void bench_run(const bench_t *bench, uint64_t min_ns, int repeats) {
+    uint32_t iters = bench_calibrate(bench, min_ns);
+    uint64_t best = UINT64_MAX;
+    for (int ii = 0; ii < repeats; ii++) {
+        uint64_t start = bench_now_ns();
+        bench->fn(iters);
+        uint64_t elapsed = bench_now_ns() - start;
+        if (elapsed < best) {
+            best = elapsed;
+        }
+    }
+
+    double ops = (double)iters * bench->ops_per_iter;
+    double ns_per_op = (double)best / ops;
+    printf("{\"name\":\"%s\",\"unit\":\"%s\",\"ops\":%.0f,\"ns\":%llu,"
+           "\"ns_per_op\":%.3f,\"ops_per_sec\":%.0f}\n",
+           bench->name,
+           bench->unit,
+           ops,
+           (unsigned long long)best,
+           ns_per_op,
+           1e9 / ns_per_op);
+    fflush(stdout);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-t MIN_MS] [-r REPEATS] [-l] [NAME...]\n", prog);
+    fprintf(stderr, "  -t MIN_MS   Minimum time per run (default %d)\n", BENCH_DEFAULT_MIN_MS);
+    fprintf(stderr, "  -r REPEATS  Runs per benchmark, fastest reported (default %d)\n", BENCH_DEFAULT_REPEATS);
+    fprintf(stderr, "  -l          List benchmarks\n");
+    fprintf(stderr, "  NAME        Run only the named benchmarks\n");
+}
+
+int main(int argc, char **argv) {
+    uint64_t min_ms = BENCH_DEFAULT_MIN_MS;
+    int repeats = BENCH_DEFAULT_REPEATS;
+    int first_name = argc;
+
+    for (int ii = 1; ii < argc; ii++) {
+        if (!strcmp(argv[ii], "-t") && (ii + 1 < argc)) {
+            min_ms = strtoull(argv[++ii], NULL, 10);
+        } else if (!strcmp(argv[ii], "-r") && (ii + 1 < argc)) {
+            repeats = atoi(argv[++ii]);
+        } else if (!strcmp(argv[ii], "-l")) {
+            for (size_t jj = 0; jj < BENCH_COUNT; jj++) {
+                printf("%s\n", benches[jj].name);
+            }
+            return 0;
+        } else if (argv[ii][0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            first_name = ii;
+            break;
+        }
+    }
+    if (repeats < 1) {
+        repeats = 1;
+    }
+
+    for (int ii = first_name; ii < argc; ii++) {
+        size_t jj;
+        for (jj = 0; jj < BENCH_COUNT; jj++) {
+            if (!strcmp(argv[ii], benches[jj].name)) {
+                break;
+            }
+        }
+        if (jj == BENCH_COUNT) {
+            fprintf(stderr, "Unknown benchmark: %s\n", argv[ii]);
+            return 1;
+        }
+    }
+
+    for (size_t ii = 0; ii < BENCH_COUNT; ii++) {
+        int selected = (first_name == argc);
+        for (int jj = first_name; !selected && (jj < argc); jj++) {
+            selected = !strcmp(argv[jj], benches[ii].name);
+        }
+        if (selected) {
+            bench_run(&benches[ii], min_ms * 1000000ULL, repeats);
+        }
+    }
+    return 0;
+}
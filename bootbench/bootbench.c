@@ -0,0 +1,434 @@
+// Copyright (C) 2026 Piers Finlayson <piers@piers.rocks>
+//
+// MIT License
+
+// apio - Runtime RP2350 PIO Assembler and Disassembler
+//
+// Boot-time and code-size comparison of three ways of building the same set
+// of PIO programs - see bootbench/README.md:
+//
+// - runtime - apio macros, with arguments read at runtime from boot
+//   configuration
+// - constants - the same apio macros, with compile-time constant arguments
+// - static - precomputed instruction and register arrays, as pioasm would
+//   produce, loaded through apio
+//
+// On the RP2350, each variant is built into its own image, selected with
+// BOOTBENCH_VARIANT, and reports over RTT the cycles from reset to SM enable,
+// measured with the DWT cycle counter, and the stack it used.  Flash bytes
+// are reported by the Makefile's bootbench target.
+//
+// In emulation, all three variants are built into one host binary, timed
+// with an emulated cycle counter derived from the host's monotonic clock,
+// and checked to produce identical PIO state.
+
+#include <stdint.h>
+
+#if !defined(APIO_EMULATION)
+#include <SEGGER_RTT.h>
+#define BOOTBENCH_LOG(...)  SEGGER_RTT_printf(0, __VA_ARGS__)
+#else // APIO_EMULATION
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#define BOOTBENCH_LOG(...)  printf(__VA_ARGS__)
+#define APIO_EMU_IMPL   1
+#endif // !APIO_EMULATION
+
+#include <apio.h>
+
+#if defined(APIO_EMULATION)
+#include <apio_emu.h>
+#endif // APIO_EMULATION
+
+// Variants
+#define BOOTBENCH_RUNTIME       1
+#define BOOTBENCH_CONSTANTS     2
+#define BOOTBENCH_STATIC        3
+
+#if !defined(APIO_EMULATION) && !defined(BOOTBENCH_VARIANT)
+#error "Define BOOTBENCH_VARIANT as BOOTBENCH_RUNTIME, BOOTBENCH_CONSTANTS or BOOTBENCH_STATIC"
+#endif // !APIO_EMULATION && !BOOTBENCH_VARIANT
+
+// System clock the emulated cycle counter runs at.  The RP2350 boots from
+// its ring oscillator, so target cycle counts are in system clock cycles
+// whatever the frequency.
+#if !defined(BOOTBENCH_SYS_CLK_HZ)
+#define BOOTBENCH_SYS_CLK_HZ    150000000
+#endif // !BOOTBENCH_SYS_CLK_HZ
+
+// Host runs per variant, the fastest is reported
+#define BOOTBENCH_HOST_RUNS     10000
+
+// Stack painted below main()'s frame to measure the build's stack use
+#define BOOTBENCH_STACK_PAINT   1024
+#define BOOTBENCH_STACK_PATTERN 0xDEADBEEF
+
+// The same boot configuration, as compile-time constants
+#define BOOTBENCH_TOGGLE_PIN    0
+#define BOOTBENCH_TOGGLE_DELAY  30
+#define BOOTBENCH_TX_PIN        1
+#define BOOTBENCH_TX_CLKDIV     1302
+#define BOOTBENCH_COUNT_PIN     2
+
+//
+// Cycle counter
+//
+
+#if !defined(APIO_EMULATION)
+// DWT cycle counter, started by the reset handler in vector.c
+#define BOOTBENCH_DWT_CYCCNT    (*(volatile uint32_t *)0xE0001004)
+#define BOOTBENCH_CYCLES()      BOOTBENCH_DWT_CYCCNT
+#else // APIO_EMULATION
+static uint32_t bootbench_cycles(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t ns = ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+    return (uint32_t)((ns * (BOOTBENCH_SYS_CLK_HZ / 1000000)) / 1000);
+}
+#define BOOTBENCH_CYCLES()      bootbench_cycles()
+#endif // !APIO_EMULATION
+
+//
+// Programs
+//
+// SM0 toggles a pin, SM1 shifts bytes out of a pin, and SM2 counts falling
+// edges on a pin, all in PIO block 0.
+//
+
+#if defined(APIO_EMULATION) || (BOOTBENCH_VARIANT != BOOTBENCH_STATIC)
+// Builds and enables the programs with apio's macros.  Always inlined, so
+// constant arguments are folded by the compiler.
+static inline __attribute__((always_inline)) void bootbench_apio(
+    uint8_t toggle_pin,
+    uint8_t toggle_delay,
+    uint8_t tx_pin,
+    uint16_t tx_clkdiv,
+    uint8_t count_pin
+) {
+    APIO_ENABLE_GPIOS();
+    APIO_ENABLE_PIOS();
+    APIO_GPIO_INPUT_OUTPUT(toggle_pin, 0);
+    APIO_GPIO_INPUT_OUTPUT(tx_pin, 0);
+    APIO_GPIO_INPUT_ONLY(count_pin);
+
+    APIO_ASM_INIT();
+    APIO_CLEAR_ALL_IRQS();
+    APIO_SET_BLOCK(0);
+
+    // SM0 - toggle
+    APIO_SET_SM(0);
+    APIO_ADD_INSTR(APIO_SET_PIN_DIRS(1));
+    APIO_WRAP_BOTTOM();
+    APIO_ADD_INSTR(APIO_ADD_DELAY(APIO_SET_PINS(1), toggle_delay));
+    APIO_WRAP_TOP();
+    APIO_ADD_INSTR(APIO_ADD_DELAY(APIO_SET_PINS(0), toggle_delay));
+    APIO_SM_CLKDIV_SET(15000, 0);
+    APIO_SM_EXECCTRL_SET(0);
+    APIO_SM_SHIFTCTRL_SET(0);
+    APIO_SM_PINCTRL_SET(APIO_SET_BASE(toggle_pin) | APIO_SET_COUNT(1));
+    APIO_SM_JMP_TO_START();
+
+    // SM1 - serial transmit, LSB first
+    APIO_SET_SM(1);
+    APIO_ADD_INSTR(APIO_PULL_BLOCK);
+    APIO_ADD_INSTR(APIO_SET_X(7));
+    APIO_LABEL_NEW(tx_bit);
+    APIO_ADD_INSTR(APIO_OUT_PINS(1));
+    APIO_WRAP_TOP();
+    APIO_ADD_INSTR(APIO_JMP_X_DEC(APIO_LABEL(tx_bit)));
+    APIO_SM_CLKDIV_SET(tx_clkdiv, 0);
+    APIO_SM_EXECCTRL_SET(0);
+    APIO_SM_SHIFTCTRL_SET(APIO_OUT_SHIFTDIR_R);
+    APIO_SM_PINCTRL_SET(
+        APIO_OUT_BASE(tx_pin) |
+        APIO_OUT_COUNT(1) |
+        APIO_SET_BASE(tx_pin) |
+        APIO_SET_COUNT(1)
+    );
+    APIO_SM_EXEC_INSTR(APIO_SET_PIN_DIRS(1));
+    APIO_SM_JMP_TO_START();
+
+    // SM2 - falling edge counter, counting down from 0xFFFFFFFF in X
+    APIO_SET_SM(2);
+    APIO_LABEL_NEW(count_edge);
+    APIO_ADD_INSTR(APIO_WAIT_PIN_HIGH(0));
+    APIO_ADD_INSTR(APIO_WAIT_PIN_LOW(0));
+    APIO_WRAP_TOP();
+    APIO_ADD_INSTR(APIO_JMP_X_DEC(APIO_LABEL(count_edge)));
+    APIO_SM_CLKDIV_SET(1, 0);
+    APIO_SM_EXECCTRL_SET(0);
+    APIO_SM_SHIFTCTRL_SET(0);
+    APIO_SM_PINCTRL_SET(APIO_IN_BASE(count_pin));
+    APIO_SM_EXEC_INSTR(APIO_MOV_SRC_INVERT(APIO_MOV_X_NULL));
+    APIO_SM_JMP_TO_START();
+
+    APIO_END_BLOCK();
+    APIO_ENABLE_SMS(0, 0x7);
+}
+#endif // APIO_EMULATION || BOOTBENCH_VARIANT != BOOTBENCH_STATIC
+
+#if defined(APIO_EMULATION) || (BOOTBENCH_VARIANT == BOOTBENCH_RUNTIME)
+// Boot configuration, volatile so it is read at runtime as if loaded from
+// flash or OTP
+typedef struct {
+    uint8_t toggle_pin;
+    uint8_t toggle_delay;
+    uint8_t tx_pin;
+    uint16_t tx_clkdiv;
+    uint8_t count_pin;
+} bootbench_config_t;
+
+static volatile const bootbench_config_t bootbench_config = {
+    .toggle_pin = BOOTBENCH_TOGGLE_PIN,
+    .toggle_delay = BOOTBENCH_TOGGLE_DELAY,
+    .tx_pin = BOOTBENCH_TX_PIN,
+    .tx_clkdiv = BOOTBENCH_TX_CLKDIV,
+    .count_pin = BOOTBENCH_COUNT_PIN,
+};
+
+static __attribute__((noinline)) void bootbench_build_runtime(void) {
+    bootbench_apio(
+        bootbench_config.toggle_pin,
+        bootbench_config.toggle_delay,
+        bootbench_config.tx_pin,
+        bootbench_config.tx_clkdiv,
+        bootbench_config.count_pin
+    );
+}
+#endif // APIO_EMULATION || BOOTBENCH_VARIANT == BOOTBENCH_RUNTIME
+
+#if defined(APIO_EMULATION) || (BOOTBENCH_VARIANT == BOOTBENCH_CONSTANTS)
+static __attribute__((noinline)) void bootbench_build_constants(void) {
+    bootbench_apio(
+        BOOTBENCH_TOGGLE_PIN,
+        BOOTBENCH_TOGGLE_DELAY,
+        BOOTBENCH_TX_PIN,
+        BOOTBENCH_TX_CLKDIV,
+        BOOTBENCH_COUNT_PIN
+    );
+}
+#endif // APIO_EMULATION || BOOTBENCH_VARIANT == BOOTBENCH_CONSTANTS
+
+#if defined(APIO_EMULATION) || (BOOTBENCH_VARIANT == BOOTBENCH_STATIC)
+// A precomputed program and its SM configuration.  Offsets are relative to
+// the program's first instruction, and JMP targets are absolute, so the
+// programs must be loaded in order from instruction 0.
+typedef struct {
+    const uint16_t *instr;
+    uint8_t len;
+    uint8_t start;
+    uint8_t wrap_bottom;
+    uint8_t wrap_top;
+    uint16_t clkdiv_int;
+    uint8_t clkdiv_frac;
+    uint8_t num_exec;
+    uint32_t execctrl;      // Excluding wrap, which apio adds
+    uint32_t shiftctrl;
+    uint32_t pinctrl;
+    uint16_t exec[2];       // Executed before the JMP to start
+} bootbench_program_t;
+
+static const uint16_t bootbench_toggle_instr[] = {
+    0xE081,     // set pindirs, 1
+    0xFE01,     // set pins, 1 [30]
+    0xFE00,     // set pins, 0 [30]
+};
+
+static const uint16_t bootbench_tx_instr[] = {
+    0x80A0,     // pull block
+    0xE027,     // set x, 7
+    0x6001,     // out pins, 1
+    0x0045,     // jmp x--, 5
+};
+
+static const uint16_t bootbench_count_instr[] = {
+    0x20A0,     // wait 1 pin 0
+    0x2020,     // wait 0 pin 0
+    0x0047,     // jmp x--, 7
+};
+
+static const bootbench_program_t bootbench_programs[] = {
+    {
+        .instr = bootbench_toggle_instr, .len = 3,
+        .start = 0, .wrap_bottom = 1, .wrap_top = 2,
+        .clkdiv_int = 15000, .clkdiv_frac = 0,
+        .execctrl = 0x00000000, .shiftctrl = 0x00000000, .pinctrl = 0x04000000,
+        .num_exec = 0,
+    },
+    {
+        .instr = bootbench_tx_instr, .len = 4,
+        .start = 0, .wrap_bottom = 0, .wrap_top = 3,
+        .clkdiv_int = 1302, .clkdiv_frac = 0,
+        .execctrl = 0x00000000, .shiftctrl = 0x00080000, .pinctrl = 0x04100021,
+        .num_exec = 1, .exec = { 0xE081 },      // set pindirs, 1
+    },
+    {
+        .instr = bootbench_count_instr, .len = 3,
+        .start = 0, .wrap_bottom = 0, .wrap_top = 2,
+        .clkdiv_int = 1, .clkdiv_frac = 0,
+        .execctrl = 0x00000000, .shiftctrl = 0x00000000, .pinctrl = 0x00010000,
+        .num_exec = 1, .exec = { 0xA02B },      // mov x, ~null
+    },
+};
+
+static __attribute__((noinline)) void bootbench_build_static(void) {
+    APIO_ENABLE_GPIOS();
+    APIO_ENABLE_PIOS();
+    APIO_GPIO_INPUT_OUTPUT(BOOTBENCH_TOGGLE_PIN, 0);
+    APIO_GPIO_INPUT_OUTPUT(BOOTBENCH_TX_PIN, 0);
+    APIO_GPIO_INPUT_ONLY(BOOTBENCH_COUNT_PIN);
+
+    APIO_ASM_INIT();
+    APIO_CLEAR_ALL_IRQS();
+    APIO_SET_BLOCK(0);
+
+    for (uint8_t sm = 0; sm < sizeof(bootbench_programs) / sizeof(bootbench_programs[0]); sm++) {
+        const bootbench_program_t *prog = &bootbench_programs[sm];
+        APIO_SET_SM_VAR(sm);
+        for (uint8_t ii = 0; ii < prog->len; ii++) {
+            if (ii == prog->start) {
+                APIO_START();
+            }
+            if (ii == prog->wrap_bottom) {
+                APIO_WRAP_BOTTOM();
+            }
+            if (ii == prog->wrap_top) {
+                APIO_WRAP_TOP();
+            }
+            if (ii == prog->len - 1) {
+                APIO_END();
+            }
+            APIO_ADD_INSTR(prog->instr[ii]);
+        }
+        APIO_SM_CLKDIV_SET(prog->clkdiv_int, prog->clkdiv_frac);
+        APIO_SM_EXECCTRL_SET(prog->execctrl);
+        APIO_SM_SHIFTCTRL_SET(prog->shiftctrl);
+        APIO_SM_PINCTRL_SET(prog->pinctrl);
+        for (uint8_t ii = 0; ii < prog->num_exec; ii++) {
+            APIO_SM_EXEC_INSTR(prog->exec[ii]);
+        }
+        APIO_SM_JMP_TO_START();
+    }
+
+    APIO_END_BLOCK();
+    APIO_ENABLE_SMS(0, 0x7);
+}
+#endif // APIO_EMULATION || BOOTBENCH_VARIANT == BOOTBENCH_STATIC
+
+//
+// Main
+//
+
+#if !defined(APIO_EMULATION)
+
+#if BOOTBENCH_VARIANT == BOOTBENCH_RUNTIME
+#define BOOTBENCH_NAME      "runtime"
+#define BOOTBENCH_BUILD()   bootbench_build_runtime()
+#elif BOOTBENCH_VARIANT == BOOTBENCH_CONSTANTS
+#define BOOTBENCH_NAME      "constants"
+#define BOOTBENCH_BUILD()   bootbench_build_constants()
+#elif BOOTBENCH_VARIANT == BOOTBENCH_STATIC
+#define BOOTBENCH_NAME      "static"
+#define BOOTBENCH_BUILD()   bootbench_build_static()
+#else
+#error "Unknown BOOTBENCH_VARIANT"
+#endif // BOOTBENCH_VARIANT
+
+int main() {
+    // Reset handler to main(), including .data and .bss initialization
+    uint32_t reset_to_main = BOOTBENCH_CYCLES();
+
+    // Paint the stack below this frame, so the build's use can be found.
+    // Nothing is called while painting, so this frame is untouched.
+    uint32_t *sp;
+    __asm__ volatile("mov %0, sp" : "=r"(sp));
+    volatile uint32_t *paint = sp - (BOOTBENCH_STACK_PAINT / sizeof(uint32_t));
+    for (volatile uint32_t *ptr = paint; ptr < sp; ptr++) {
+        *ptr = BOOTBENCH_STACK_PATTERN;
+    }
+
+    uint32_t build_start = BOOTBENCH_CYCLES();
+    BOOTBENCH_BUILD();
+    uint32_t build = BOOTBENCH_CYCLES() - build_start;
+
+    volatile uint32_t *low = paint;
+    while ((low < sp) && (*low == BOOTBENCH_STACK_PATTERN)) {
+        low++;
+    }
+    uint32_t stack = (uint32_t)((uintptr_t)sp - (uintptr_t)low);
+
+    APIO_ENABLE_JTAG();
+    BOOTBENCH_LOG(
+        "{\"variant\":\"%s\",\"reset_to_enable\":%u,\"build\":%u,\"stack_bytes\":%u}\n",
+        BOOTBENCH_NAME,
+        reset_to_main + build,
+        build,
+        stack
+    );
+
+    while (1) {
+        APIO_ASM_WFI();
+    }
+}
+
+#else // APIO_EMULATION
+
+typedef struct {
+    const char *name;
+    void (*build)(void);
+} bootbench_variant_t;
+
+static const bootbench_variant_t bootbench_variants[] = {
+    { "runtime", bootbench_build_runtime },
+    { "constants", bootbench_build_constants },
+    { "static", bootbench_build_static },
+};
+
+int main(void) {
+    static apio_emu_snapshot_t reference, snap;
+    apio_emu_diff_t diff;
+    int failed = 0;
+
+    for (size_t ii = 0; ii < sizeof(bootbench_variants) / sizeof(bootbench_variants[0]); ii++) {
+        const bootbench_variant_t *variant = &bootbench_variants[ii];
+
+        // The first run is cold, as on the target
+        uint32_t cold = 0;
+        uint32_t best = UINT32_MAX;
+        for (int run = 0; run < BOOTBENCH_HOST_RUNS; run++) {
+            uint32_t start = BOOTBENCH_CYCLES();
+            variant->build();
+            uint32_t cycles = BOOTBENCH_CYCLES() - start;
+            if (run == 0) {
+                cold = cycles;
+            }
+            if (cycles < best) {
+                best = cycles;
+            }
+        }
+
+        // Every variant must build the same PIO state
+        if (ii == 0) {
+            apio_emu_snapshot(&reference);
+        } else {
+            apio_emu_snapshot(&snap);
+            if (apio_emu_diff(&reference, &snap, &diff)) {
+                fprintf(stderr, "%s: PIO state differs from %s\n", variant->name, bootbench_variants[0].name);
+                failed = 1;
+            }
+        }
+
+        BOOTBENCH_LOG(
+            "{\"variant\":\"%s\",\"sys_clk_hz\":%u,\"cold\":%u,\"build\":%u}\n",
+            variant->name,
+            BOOTBENCH_SYS_CLK_HZ,
+            cold,
+            best
+        );
+    }
+
+    return failed;
+}
+
+#endif // !APIO_EMULATION
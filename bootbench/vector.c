@@ -0,0 +1,54 @@
+// Copyright (C) 2026 Piers Finlayson <piers@piers.rocks>
+//
+// MIT License
+
+// apio - Runtime RP2350 PIO Assembler and Disassembler
+//
+// Reset vector for the boot-time benchmark.  As example/vector.c, but starts
+// the DWT cycle counter before anything else, so main() can read the cycles
+// since reset.
+
+// Cortex-M33 debug registers
+#define BOOTBENCH_DEMCR         (*(volatile unsigned long *)0xE000EDFC)
+#define BOOTBENCH_DEMCR_TRCENA  (1 << 24)
+#define BOOTBENCH_DWT_CTRL      (*(volatile unsigned long *)0xE0001000)
+#define BOOTBENCH_DWT_CYCCNTENA (1 << 0)
+#define BOOTBENCH_DWT_CYCCNT    (*(volatile unsigned long *)0xE0001004)
+
+// Forward declaration _reset and main
+extern void _reset(void);
+extern int main(void);
+
+// Linker addresses
+extern unsigned long _stack_top;
+extern unsigned long _data_start, _data_end, _data_load;
+extern unsigned long _bss_start, _bss_end;
+
+// Vector table - must be placed at the start of flash
+__attribute__ ((section(".vectors"), used))
+void (* const g_pfnVectors[])(void) = {
+    (void (*)(void))&_stack_top,
+    _reset,
+};
+
+void _reset(void) {
+    // Start counting cycles
+    BOOTBENCH_DEMCR |= BOOTBENCH_DEMCR_TRCENA;
+    BOOTBENCH_DWT_CYCCNT = 0;
+    BOOTBENCH_DWT_CTRL |= BOOTBENCH_DWT_CYCCNTENA;
+
+    // Copy .data from flash to SRAM
+    unsigned long *src = &_data_load;
+    unsigned long *dst = &_data_start;
+    while (dst < &_data_end) {
+        *dst++ = *src++;
+    }
+
+    // Zero .bss
+    dst = &_bss_start;
+    while (dst < &_bss_end) {
+        *dst++ = 0;
+    }
+
+    main();
+}
@@ -0,0 +1,1599 @@
+// Copyright (C) 2026 Piers Finlayson <piers@piers.rocks>
+//
+// MIT License
+
+// apio - Runtime RP2350 PIO Assembler and Disassembler
+//
+// Host functional checks for the program generators, monitors and
+// emulation.  Built with APIO_EMULATION, so runs on any host - see
+// check/README.md.
+//
+// Each check builds programs through apio's macros, runs them in the
+// built-in interpreter, apio_sim, with synthetic pin input where needed, and
+// checks what they did against what was asked of them - the samples
+// captured, words output, edges timestamped or state recorded.  Failures are
+// reported, and the exit status is non-zero if any check fails.
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The last message logged, for checks of what's logged
+static char check_log_buf[256];
+
+static void check_log(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(check_log_buf, sizeof(check_log_buf), fmt, args);
+    va_end(args);
+}
+
+// The operation log recorded since the oplog check last emptied it, until
+// full
+static uint8_t check_oplog_buf[1024];
+static size_t check_oplog_len;
+
+static void check_oplog_write(const uint8_t *data, size_t len) {
+    if (check_oplog_len + len <= sizeof(check_oplog_buf)) {
+        memcpy(check_oplog_buf + check_oplog_len, data, len);
+        check_oplog_len += len;
+    }
+}
+
+#define APIO_LOG_ENABLE(...)            check_log(__VA_ARGS__)
+#define APIO_OPLOG                      1
+#define APIO_OPLOG_WRITE(DATA, LEN)     check_oplog_write(DATA, LEN)
+
+#define APIO_LOG_IMPL   1
+#define APIO_EMU_IMPL   1
+#define APIO_LA_IMPL    1
+#define APIO_MON_IMPL   1
+#define APIO_WAVE_IMPL  1
+#define APIO_BUS_IMPL   1
+#define APIO_EDGE_IMPL  1
+#define APIO_SERIAL_IMPL 1
+#define APIO_ROM_IMPL   1
+#define APIO_TRI_IMPL   1
+#define APIO_LAT_IMPL   1
+#include <apio.h>
+#include <apio_sim.h>
+#include <apio_emu.h>
+#include <apio_oplog.h>
+#include <apio_la.h>
+#include <apio_mon.h>
+#include <apio_wave.h>
+#include <apio_bus.h>
+#include <apio_edge.h>
+#include <apio_serial.h>
+#include <apio_rom.h>
+#include <apio_tri.h>
+#include <apio_lat.h>
+#include <apio_vcd.h>
+
+// System clock used throughout
+#define CHECK_SYSCLK_HZ         150000000
+
+static uint32_t check_failures;
+
+static void check_fail(const char *fmt, ...) {
+    va_list args;
+    check_failures++;
+    va_start(args, fmt);
+    printf("FAIL: ");
+    vprintf(fmt, args);
+    printf("\n");
+    va_end(args);
+}
+
+// Mask of the bottom BITS bits, 1-32
+static uint32_t check_mask(uint8_t bits) {
+    return (bits >= 32) ? 0xFFFFFFFF : ((1u << bits) - 1);
+}
+
+//
+// Logic analyser
+//
+
+static uint32_t check_la_buf[APIO_MAX_SMS_PER_BLOCK][64];
+
+// Four interleaved SMs, triggered by a pin, capture a counter on the other
+// pins with no gaps or drops
+static void check_la(void) {
+    static apio_la_t la;
+    const apio_la_cfg_t cfg = {
+        .num_sms = 4, .first_sm = 0, .pin_base = 0, .pin_count = 16, .interval = 1,
+        .trigger = APIO_LA_TRIG_PIN_HIGH, .trigger_arg = 15,
+        .buf = { check_la_buf[0], check_la_buf[1], check_la_buf[2], check_la_buf[3] }, .words = 16,
+    };
+    memset(check_la_buf, 0, sizeof(check_la_buf));
+    if (apio_la_init(&la, &cfg) != APIO_LA_OK) {
+        check_fail("la: init");
+        return;
+    }
+    APIO_ASM_INIT();
+    APIO_SET_BLOCK(0);
+    APIO_LA_ADD(&la);
+    APIO_END_BLOCK();
+    apio_la_arm(&la);
+
+    // Pins 0-14 count system clock cycles, pin 15 is the trigger
+    apio_sim_t sim;
+    apio_sim_init(&sim, 0);
+    uint32_t cycle = 0;
+    while (!apio_la_poll_sim(&la, &sim) && (cycle < 100000)) {
+        for (uint32_t ii = 0; ii < 8; ii++) {
+            if (cycle == 100) {
+                sim.gpio_in |= 1u << 15;
+            }
+            apio_sim_run(&sim, 1);
+            cycle++;
+            sim.gpio_in = (sim.gpio_in & (1u << 15)) | (cycle & 0x7FFF);
+        }
+    }
+
+    uint32_t samples = apio_la_samples(&la);
+    uint32_t first = apio_la_sample(&la, 0) & 0x7FFF;
+    uint32_t dropped = 0;
+    for (uint8_t ii = 0; ii < cfg.num_sms; ii++) {
+        dropped += la.dropped[ii];
+    }
+    if (!la.done || dropped || (samples != 4 * 16 * 2)) {
+        check_fail("la: done %u, %u samples, %u dropped", la.done, samples, dropped);
+    }
+    if ((first < 100) || (first > 108)) {
+        check_fail("la: first sample %u, trigger at 100", first);
+    }
+    for (uint32_t ii = 1; ii < samples; ii++) {
+        uint32_t sample = apio_la_sample(&la, ii) & 0x7FFF;
+        if (sample != ((first + ii) & 0x7FFF)) {
+            check_fail("la: sample %u is %u, want %u", ii, sample, (first + ii) & 0x7FFF);
+            break;
+        }
+    }
+}
+
+//
+// Handoff
+//
+
+// Checks that exactly BLOCK has been marked dirty since the last handoff
+static void check_handoff_dirty(const char *what, uint8_t block) {
+    uint8_t dirty = apio_emu_handoff();
+    if (dirty != (1u << block)) {
+        check_fail("handoff: %s marked 0x%x dirty, want 0x%x", what, dirty, 1u << block);
+    }
+}
+
+// Every write to a block's emulated state after a handoff marks that block,
+// and only that block, dirty for the next
+static void check_handoff(void) {
+    APIO_ASM_INIT();
+    APIO_SET_BLOCK(1);
+    APIO_SET_SM(0);
+    APIO_ADD_INSTR(APIO_NOP);
+    APIO_SM_JMP_TO_START();
+    APIO_END_BLOCK();
+    APIO_ENABLE_SMS(1, 1);
+    apio_sim_t sim;
+    apio_sim_init(&sim, 1);
+    apio_emu_handoff();
+
+    APIO_ADD_INSTR(APIO_NOP);
+    check_handoff_dirty("APIO_ADD_INSTR()", 1);
+    APIO_START();
+    check_handoff_dirty("APIO_START()", 1);
+    APIO_WRAP_BOTTOM();
+    check_handoff_dirty("APIO_WRAP_BOTTOM()", 1);
+    APIO_WRAP_TOP();
+    check_handoff_dirty("APIO_WRAP_TOP()", 1);
+    APIO_SM_CLKDIV_SET(2, 0);
+    check_handoff_dirty("APIO_SM_CLKDIV_SET()", 1);
+    APIO_SM_EXECCTRL_SET(0);
+    check_handoff_dirty("APIO_SM_EXECCTRL_SET()", 1);
+    APIO_SM_SHIFTCTRL_SET(APIO_FJOIN_TX);
+    check_handoff_dirty("APIO_SM_SHIFTCTRL_SET()", 1);
+    APIO_SM_PINCTRL_SET(APIO_OUT_BASE(0));
+    check_handoff_dirty("APIO_SM_PINCTRL_SET()", 1);
+    APIO_TXF_PUT(1);
+    check_handoff_dirty("APIO_TXF_PUT()", 1);
+    uint32_t __attribute__((unused)) word = APIO_RXF;
+    check_handoff_dirty("APIO_RXF", 1);
+    APIO_END_BLOCK();
+    check_handoff_dirty("APIO_END_BLOCK()", 1);
+    APIO_GPIOBASE_16();
+    check_handoff_dirty("APIO_GPIOBASE_16()", 1);
+    APIO_SET_SM(1);
+    check_handoff_dirty("APIO_SET_SM()", 1);
+    apio_sim_run(&sim, 1);
+    check_handoff_dirty("apio_sim_run()", 1);
+}
+
+//
+// PC-sampling profiler
+//
+
+// An SM blocked on a PULL, fed a word every 50 samples, is sampled mostly
+// stalled on its TX FIFO at the PULL
+static void check_profiler(void) {
+    APIO_ASM_INIT();
+    APIO_SET_BLOCK(0);
+    APIO_SET_SM(0);
+    APIO_ADD_INSTR(APIO_PULL_BLOCK);
+    APIO_ADD_INSTR(APIO_OUT_PINS(8));
+    APIO_WRAP_TOP();
+    APIO_ADD_INSTR(APIO_ADD_DELAY(APIO_NOP, 3));
+    APIO_SM_CLKDIV_SET(1, 0);
+    APIO_SM_EXECCTRL_SET(0);
+    APIO_SM_SHIFTCTRL_SET(0);
+    APIO_SM_PINCTRL_SET(APIO_OUT_BASE(0) | APIO_OUT_COUNT(8));
+    APIO_SM_JMP_TO_START();
+    APIO_END_BLOCK();
+    APIO_ENABLE_SMS(0, 1);
+
+    apio_sim_t sim;
+    apio_sim_init(&sim, 0);
+    static apio_prof_t prof;
+    apio_prof_start(&prof, APIO_MON_SM(0, 0), 1000);
+    uint32_t samples = 0;
+    while (apio_prof_sample(&prof)) {
+        if ((samples++ % 50) == 0) {
+            apio_sim_tx_put(&sim, 0, samples);
+        }
+        apio_sim_run(&sim, 1);
+    }
+
+    const apio_prof_sm_t *hist = &prof.sm[0][0];
+    if (!apio_prof_done(&prof) || (prof.samples != 1000)) {
+        check_fail("profiler: %u samples, want 1000", prof.samples);
+    }
+    // Each word takes 6 cycles - the PULL, OUT and NOP with its 3 delay cycles
+    // - so around 44 of every 50 samples find the SM FIFO stalled at the PULL
+    if ((hist->stalled[0] < 20 * 43) || (hist->stalled[0] > 20 * 44) || hist->stalled[1] || hist->stalled[2]) {
+        check_fail("profiler: %u of %u samples stalled at the PULL, %u elsewhere",
+                   hist->stalled[0], hist->hits[0], hist->stalled[1] + hist->stalled[2]);
+    }
+    if (!hist->hits[1] || !hist->hits[2]) {
+        check_fail("profiler: OUT and NOP not sampled");
+    }
+}
+
+//
+// Stalled-SM watchdog
+//
+
+// An SM stuck on a WAIT for a pin that never rises is found and restarted
+// at its start, ahead of the WAIT, with its FIFOs cleared, as it runs -
+// repeatedly, for as long as it stays stuck - and runs on once the pin rises
+static void check_watchdog(void) {
+    static apio_wdog_t wdog;
+    apio_wdog_init(&wdog, 1000, 5000, 1);
+
+    APIO_ASM_INIT();
+    APIO_SET_BLOCK(0);
+    APIO_SET_SM(1);
+    APIO_ADD_INSTR(APIO_NOP);
+    APIO_ADD_INSTR(APIO_NOP);
+    APIO_SET_SM(2);
+    APIO_ADD_INSTR(APIO_NOP);
+    APIO_WRAP_BOTTOM();
+    APIO_ADD_INSTR(APIO_WAIT_PIN_HIGH(0));
+    APIO_WRAP_TOP();
+    APIO_ADD_INSTR(APIO_NOP);
+    APIO_SM_CLKDIV_SET(1, 0);
+    APIO_SM_EXECCTRL_SET(0);
+    APIO_SM_SHIFTCTRL_SET(0);
+    APIO_SM_PINCTRL_SET(APIO_IN_BASE(0));
+    APIO_SM_JMP_TO_START();
+    APIO_WDOG_WATCH(&wdog);
+    APIO_END_BLOCK();
+    APIO_ENABLE_SMS(0, 1 << 2);
+
+    apio_sim_t sim;
+    apio_sim_init(&sim, 0);
+    wdog.sim[0] = &sim;
+    apio_sim_tx_put(&sim, 2, 0x12345678);
+    uint32_t found = 0;
+    uint32_t polls = 0;
+    while (!found && (polls < 100)) {
+        apio_sim_run(&sim, 50);
+        found = apio_wdog_poll(&wdog);
+        polls++;
+    }
+
+    const volatile pio_sm_reg_t *reg = APIO0_SM_REG(2);
+    const apio_wdog_sm_t *state = &wdog.sm[0][2];
+    if ((found != APIO_MON_SM(0, 2)) || (state->stuck_count != 1) || (state->recoveries != 1)) {
+        check_fail("watchdog: found 0x%x after %u polls, stuck %u, recovered %u",
+                   found, polls, state->stuck_count, state->recoveries);
+    }
+    if ((reg->addr != 2) || state->exec_stalled) {
+        check_fail("watchdog: restarted SM ADDR 0x%02x, EXEC_STALLED %u, want 0x02 and 0",
+                   reg->addr, state->exec_stalled);
+    }
+    if ((sim.sm[2].pc != 2) || sim.sm[2].tx.level || (sim.sm[2].stall != APIO_SIM_STALL_NONE)) {
+        check_fail("watchdog: running SM at 0x%02x, TX level %u, want 0x02 and empty",
+                   sim.sm[2].pc, sim.sm[2].tx.level);
+    }
+
+    // It sticks again, and is restarted each time, without the restarts
+    // being queued for an emulator
+    polls = 0;
+    while ((state->recoveries < 2 * APIO_EMU_MAX_PRE_INSTRS) && (polls < 1000 * APIO_EMU_MAX_PRE_INSTRS)) {
+        apio_sim_run(&sim, 50);
+        apio_wdog_poll(&wdog);
+        polls++;
+    }
+    if ((state->recoveries != 2 * APIO_EMU_MAX_PRE_INSTRS) || (state->stuck_count != state->recoveries) ||
+        _apio_emulated_pio.pre_instr_overflow[0][2]) {
+        check_fail("watchdog: stuck %u, recovered %u after %u more polls, %u exec overflows",
+                   state->stuck_count, state->recoveries, polls,
+                   _apio_emulated_pio.pre_instr_overflow[0][2]);
+    }
+
+    // Once the pin rises, the restarted SM runs on past the WAIT
+    uint64_t instrs = sim.sm[2].stats.instrs;
+    sim.gpio_in |= 1;
+    apio_sim_run(&sim, 4);
+    if ((sim.sm[2].stats.instrs - instrs) != 4) {
+        check_fail("watchdog: restarted SM ran %llu instructions in 4 cycles after the pin rose",
+                   (unsigned long long)(sim.sm[2].stats.instrs - instrs));
+    }
+}
+
+//
+// Waveform compiler
+//
+
+// Compiled waveforms reproduce each segment's level and duration, within
+// tolerance, in the interpreter
+static void check_wave_run(const char *name, const apio_wave_cfg_t *cfg, uint8_t pin_base) {
+    static apio_wave_t wave;
+    int rc = apio_wave_compile(cfg, &wave);
+    if (rc != APIO_WAVE_OK) {
+        check_fail("wave %s: compile returned %d", name, rc);
+        return;
+    }
+
+    APIO_ASM_INIT();
+    for (uint8_t pin = 0; pin < cfg->pin_count; pin++) {
+        APIO_GPIO_OUTPUT(pin_base + pin, 0);
+    }
+    APIO_SET_BLOCK(0);
+    APIO_SET_SM(0);
+    APIO_ADD_INSTR(APIO_NOP);   // Offset the program, so its JMPs are relocated
+    APIO_SET_SM(1);
+    APIO_WAVE_ADD(&wave, pin_base);
+    APIO_END_BLOCK();
+    APIO_ENABLE_SMS(0, 1 << 1);
+
+    apio_sim_t sim;
+    apio_sim_init(&sim, 0);
+    uint32_t mask = (1u << cfg->pin_count) - 1;
+    uint32_t prev = 0xFFFFFFFF;
+    uint32_t run = 0;
+    uint32_t periods = 0;
+    int seg = -1;
+    for (uint32_t cycle = 0; (cycle < 4000000) && (periods < 3); cycle++) {
+        apio_sim_run(&sim, 1);
+        uint32_t levels = (apio_sim_pin_levels(&sim) >> pin_base) & mask;
+        if ((seg < 0) && (levels != (cfg->segs[0].levels & mask))) {
+            continue;
+        }
+        if (levels != prev) {
+            if (seg >= 0) {
+                int64_t err_ns = ((int64_t)run * 1000000000LL / cfg->sysclk_hz) - cfg->segs[seg].ns;
+                if ((err_ns > (int64_t)cfg->tolerance_ns + 1) || (-err_ns > (int64_t)cfg->tolerance_ns + 1)) {
+                    check_fail("wave %s: segment %d lasted %u cycles, want %uns", name, seg, run, cfg->segs[seg].ns);
+                }
+            }
+            if (++seg == cfg->num_segs) {
+                seg = 0;
+                periods++;
+            }
+            if ((cfg->segs[seg].levels & mask) != levels) {
+                check_fail("wave %s: segment %d level 0x%x, want 0x%x", name, seg, levels, cfg->segs[seg].levels);
+            }
+            prev = levels;
+            run = 0;
+        }
+        run++;
+    }
+    if (periods < 3) {
+        check_fail("wave %s: %u periods, want 3", name, periods);
+    }
+}
+
+static void check_wave(void) {
+    // Adjacent segments must differ in level to be measurable
+    static const apio_wave_seg_t pulses[] = { {0b01, 1000}, {0b10, 250}, {0b00, 18750} };
+    static const apio_wave_seg_t ws2812[] = { {1, 400}, {0, 850} };
+    static const apio_wave_seg_t nested[] = { {1, 7}, {0, 200000}, {1, 33}, {0, 1000} };
+    const apio_wave_cfg_t cfgs[] = {
+        { .segs = pulses, .num_segs = 3, .pin_count = 2, .repeat = 1, .sysclk_hz = CHECK_SYSCLK_HZ, .tolerance_ns = 10 },
+        { .segs = ws2812, .num_segs = 2, .pin_count = 1, .repeat = 1, .sysclk_hz = CHECK_SYSCLK_HZ, .tolerance_ns = 4 },
+        { .segs = nested, .num_segs = 4, .pin_count = 1, .repeat = 1, .sysclk_hz = CHECK_SYSCLK_HZ, .tolerance_ns = 4 },
+    };
+    check_wave_run("pulses", &cfgs[0], 4);
+    check_wave_run("ws2812", &cfgs[1], 0);
+    check_wave_run("nested", &cfgs[2], 2);
+}
+
+// An RLE capture of sparse changes decodes to the same timeline, to within
+// its resolution
+static void check_la_rle(void) {
+    static const struct {
+        uint32_t at;        // System clock cycle
+        uint32_t levels;
+    } changes[] = {
+        {0, 0x1}, {40, 0x3}, {100, 0x2}, {1000, 0x0}, {1030, 0x4}, {50000, 0x5}, {50100, 0x1}, {60000, 0x0},
+    };
+    const uint32_t num_changes = sizeof(changes) / sizeof(changes[0]);
+    static apio_la_t la;
+    const apio_la_cfg_t cfg = {
+        .num_sms = 1, .first_sm = 2, .pin_base = 4, .pin_count = 3, .interval = 1,
+        .trigger = APIO_LA_TRIG_NONE, .buf = { check_la_buf[0] }, .words = 14, .mode = APIO_LA_MODE_RLE,
+    };
+    if (apio_la_init(&la, &cfg) != APIO_LA_OK) {
+        check_fail("la-rle: init");
+        return;
+    }
+    APIO_ASM_INIT();
+    APIO_SET_BLOCK(0);
+    APIO_LA_ADD(&la);
+    APIO_END_BLOCK();
+    apio_la_arm(&la);
+
+    apio_sim_t sim;
+    apio_sim_init(&sim, 0);
+    uint32_t next = 0;
+    for (uint32_t cycle = 0; cycle < 70000; cycle++) {
+        if ((next < num_changes) && (changes[next].at == cycle)) {
+            sim.gpio_in = (uint64_t)changes[next++].levels << cfg.pin_base;
+        }
+        apio_sim_run(&sim, 1);
+        if (((cycle % 16) == 0) && apio_la_poll_sim(&la, &sim)) {
+            break;
+        }
+    }
+    apio_la_poll_sim(&la, &sim);
+
+    // The final segment is only pushed at the next change, so there is one
+    // fewer segment than changes
+    apio_la_seg_t segs[8];
+    uint32_t num = apio_la_rle_decode(&la, segs, 8);
+    if ((num != num_changes - 1) || la.stalled) {
+        check_fail("la-rle: %u segments, want %u, stalled 0x%x", num, num_changes - 1, la.stalled);
+        return;
+    }
+
+    // The capture starts shortly after cycle 0, so align on the first
+    // segment's end
+    int64_t offset = (int64_t)changes[1].at - (int64_t)(segs[0].start + segs[0].cycles);
+    if ((offset < -APIO_LA_RLE_LOOP_CYCLES) || (offset > 10)) {
+        check_fail("la-rle: capture started %lld cycles in", (long long)offset);
+    }
+    for (uint32_t ii = 0; ii < num; ii++) {
+        int64_t end = (int64_t)(segs[ii].start + segs[ii].cycles) + offset;
+        int64_t err = end - (int64_t)changes[ii + 1].at;
+        if ((segs[ii].state != changes[ii].levels) ||
+            (err < -APIO_LA_RLE_LOOP_CYCLES) || (err >= APIO_LA_RLE_LOOP_CYCLES)) {
+            check_fail("la-rle: segment %u state 0x%x ending at %lld, want 0x%x ending at %u",
+                       ii, segs[ii].state, (long long)end, changes[ii].levels, changes[ii + 1].at);
+        }
+    }
+}
+
+//
+// Parallel bus
+//
+
+// Eight 32-bit bus words are output at one per clock with no mismatches
+static void check_bus(void) {
+    static uint32_t buf[8];
+    for (uint32_t ii = 0; ii < 8; ii++) {
+        buf[ii] = 0x9E3779B9u * (ii + 1);
+    }
+    static apio_bus_t bus;
+    const apio_bus_cfg_t cfg = {
+        .width = 32, .pin_base = 0, .strobe = APIO_BUS_STROBE_NONE,
+        .sysclk_hz = CHECK_SYSCLK_HZ, .buf = buf, .words = 8,
+    };
+    int rc = apio_bus_init(&bus, &cfg);
+    if (rc != APIO_BUS_OK) {
+        check_fail("bus: init returned %d", rc);
+        return;
+    }
+    APIO_ASM_INIT();
+    for (uint8_t pin = 0; pin < 32; pin++) {
+        APIO_GPIO_OUTPUT(pin, 0);
+    }
+    APIO_SET_BLOCK(0);
+    APIO_SET_SM(1);
+    APIO_BUS_ADD(&bus);
+    APIO_END_BLOCK();
+    apio_bus_start(&bus);
+
+    apio_sim_t sim;
+    apio_sim_init(&sim, 0);
+    uint32_t out = apio_bus_run_sim(&bus, &sim, 10000);
+    if ((out != 8) || bus.errors) {
+        check_fail("bus: %u words output, want 8, %u errors", out, bus.errors);
+    }
+    if (bus.rate_hz != CHECK_SYSCLK_HZ) {
+        check_fail("bus: rate %u, want %u", bus.rate_hz, CHECK_SYSCLK_HZ);
+    }
+}
+
+//
+// Edge timestamping
+//
+
+// Rising edges of a square wave with a 20 cycle period are timestamped 20
+// cycles apart
+static void check_edge(void) {
+    static uint32_t buf[64];
+    static uint64_t ts[64];
+    static apio_edge_t edge;
+    const apio_edge_cfg_t cfg = {
+        .mode = APIO_EDGE_MODE_RISING, .pin = 4, .clkdiv = 1, .sysclk_hz = CHECK_SYSCLK_HZ,
+        .buf = buf, .words = 64,
+    };
+    if (apio_edge_init(&edge, &cfg) != APIO_EDGE_OK) {
+        check_fail("edge: init");
+        return;
+    }
+    APIO_ASM_INIT();
+    APIO_SET_BLOCK(0);
+    APIO_SET_SM(0);
+    APIO_EDGE_ADD(&edge);
+    APIO_END_BLOCK();
+    apio_edge_start(&edge);
+
+    apio_sim_t sim;
+    apio_sim_init(&sim, 0);
+    for (uint32_t cycle = 0; (apio_edge_poll_sim(&edge, &sim) < cfg.words) && (cycle < 100000); cycle++) {
+        // High for 10 cycles, low for 10
+        if (((cycle + 3) % 20) < 10) {
+            sim.gpio_in |= 1u << cfg.pin;
+        } else {
+            sim.gpio_in &= ~(1u << cfg.pin);
+        }
+        apio_sim_run(&sim, 1);
+    }
+
+    uint32_t num = apio_edge_timestamps(&edge, ts, 64);
+    if ((num != cfg.words) || edge.stalled) {
+        check_fail("edge: %u timestamps, want %u, stalled %u", num, cfg.words, edge.stalled);
+    }
+    for (uint32_t ii = 1; ii < num; ii++) {
+        if ((ts[ii] - ts[ii - 1]) != 20) {
+            check_fail("edge: period %u is %llu cycles, want 20", ii, (unsigned long long)(ts[ii] - ts[ii - 1]));
+            break;
+        }
+    }
+}
+
+//
+// Serial protocols
+//
+
+static const uint32_t check_serial_vals[] = {
+    0x8001, 0x7FFE, 0x1234, 0xFEDC, 0xFFFFFFFF, 0x00000000, 0xA5A5A5A5, 0x5A5A5A5A,
+};
+#define CHECK_SERIAL_VALS   (sizeof(check_serial_vals) / sizeof(check_serial_vals[0]))
+
+// UART TX on a pin looped back to UART RX receives each frame, and the
+// shortest run on the pin is one bit at the achieved rate
+static void check_uart_run(uint8_t bits, uint8_t order, uint8_t stop_bits, uint32_t rate_hz) {
+    static apio_serial_t tx, rx;
+    apio_serial_cfg_t cfg = {
+        .protocol = APIO_SERIAL_UART_TX, .bits = bits, .order = order, .stop_bits = stop_bits,
+        .pin_data = 3, .sysclk_hz = CHECK_SYSCLK_HZ, .rate_hz = rate_hz,
+    };
+    int rc = apio_serial_init(&tx, &cfg);
+    cfg.protocol = APIO_SERIAL_UART_RX;
+    if ((rc != APIO_SERIAL_OK) || (apio_serial_init(&rx, &cfg) != APIO_SERIAL_OK)) {
+        check_fail("uart %u bits: init", bits);
+        return;
+    }
+    APIO_ASM_INIT();
+    APIO_GPIO_OUTPUT(3, 0);
+    APIO_SET_BLOCK(0);
+    APIO_SET_SM(0);
+    APIO_SERIAL_ADD(&tx);
+    APIO_SET_SM(1);
+    APIO_SERIAL_ADD(&rx);
+    APIO_END_BLOCK();
+    APIO_ENABLE_SMS(0, 0x3);
+
+    apio_sim_t sim;
+    apio_sim_init(&sim, 0);
+    if (!((apio_sim_pin_levels(&sim) >> 3) & 1)) {
+        check_fail("uart %u bits: TX not idle high", bits);
+    }
+    for (uint32_t ii = 0; ii < 6; ii++) {
+        apio_sim_tx_put(&sim, 0, apio_serial_tx_word(&tx, check_serial_vals[ii]));
+    }
+    uint32_t got = 0;
+    uint32_t level = 1;
+    uint32_t last_edge = 0;
+    uint32_t min_run = 0xFFFFFFFF;
+    for (uint32_t cycle = 1; (cycle < 1000000) && (got < 6); cycle++) {
+        apio_sim_step(&sim);
+        uint32_t now = (apio_sim_pin_levels(&sim) >> 3) & 1;
+        if (now != level) {
+            if (last_edge && ((cycle - last_edge) < min_run)) {
+                min_run = cycle - last_edge;
+            }
+            last_edge = cycle;
+            level = now;
+        }
+        uint32_t word;
+        if (sim.sm[1].rx.level && apio_sim_rx_get(&sim, 1, &word)) {
+            uint32_t value = apio_serial_rx_value(&rx, word);
+            uint32_t want = check_serial_vals[got] & check_mask(bits);
+            if (value != want) {
+                check_fail("uart %u bits: frame %u received 0x%x, want 0x%x", bits, got, value, want);
+            }
+            got++;
+        }
+    }
+    uint32_t bit = (uint32_t)((((uint64_t)CHECK_SYSCLK_HZ * 256 / tx.rate_hz) + 128) / 256);
+    if ((got != 6) || (min_run + 1 < bit) || (min_run > bit + 1)) {
+        check_fail("uart %u bits: %u frames received, shortest run %u cycles, want 6 and %u",
+                   bits, got, min_run, bit);
+    }
+}
+
+static void check_uart(void) {
+    check_uart_run(8, APIO_SERIAL_LSB_FIRST, 1, 1000000);
+    check_uart_run(8, APIO_SERIAL_LSB_FIRST, 2, 115200);
+    check_uart_run(7, APIO_SERIAL_MSB_FIRST, 1, 3000000);
+    check_uart_run(32, APIO_SERIAL_LSB_FIRST, 1, CHECK_SYSCLK_HZ / 8);
+}
+
+// SPI with MISO looped back to MOSI receives each frame, and MOSI sampled on
+// SCK's sampling edge for the mode decodes to the same frames, with SCK
+// idling at CPOL
+static void check_spi_run(uint8_t bits, uint8_t order, uint8_t cpol, uint8_t cpha, uint32_t rate_hz) {
+    static apio_serial_t spi;
+    const apio_serial_cfg_t cfg = {
+        .protocol = APIO_SERIAL_SPI, .bits = bits, .order = order, .cpol = cpol, .cpha = cpha,
+        .pin_data = 7, .pin_in = 7, .pin_clk = 6, .sysclk_hz = CHECK_SYSCLK_HZ, .rate_hz = rate_hz,
+    };
+    if (apio_serial_init(&spi, &cfg) != APIO_SERIAL_OK) {
+        check_fail("spi mode %u: init", (cpol << 1) | cpha);
+        return;
+    }
+    APIO_ASM_INIT();
+    APIO_GPIO_OUTPUT(6, 1);
+    APIO_GPIO_OUTPUT(7, 1);
+    APIO_SET_BLOCK(1);
+    APIO_SET_SM(2);
+    APIO_SERIAL_ADD(&spi);
+    APIO_END_BLOCK();
+    APIO_ENABLE_SMS(1, 1 << 2);
+
+    apio_sim_t sim;
+    apio_sim_init(&sim, 1);
+    uint32_t mask = check_mask(bits);
+    uint32_t sck = (apio_sim_pin_levels(&sim) >> 6) & 1;
+    if (sck != cpol) {
+        check_fail("spi mode %u: SCK idles %u", (cpol << 1) | cpha, sck);
+    }
+    uint32_t sent = 0;
+    uint32_t got = 0;
+    uint32_t sampled = 0;
+    uint32_t shift = 0;
+    uint32_t shifted = 0;
+    for (uint32_t cycle = 0; (cycle < 100000) && (got < 4); cycle++) {
+        if ((sent < 4) && (sent <= got)) {
+            apio_sim_tx_put(&sim, 2, apio_serial_tx_word(&spi, check_serial_vals[sent++]));
+        }
+        apio_sim_step(&sim);
+        uint32_t levels = apio_sim_pin_levels(&sim);
+        uint32_t now = (levels >> 6) & 1;
+        if (now != sck) {
+            // CPHA 0 samples on the leading edge, CPHA 1 the trailing
+            if ((sck == cpol) == !cpha) {
+                uint32_t bit = (levels >> 7) & 1;
+                shift = (order == APIO_SERIAL_MSB_FIRST) ? ((shift << 1) | bit) : ((shift >> 1) | (bit << 31));
+                if (++shifted == bits) {
+                    if ((order == APIO_SERIAL_LSB_FIRST) && (bits < 32)) {
+                        shift >>= 32 - bits;
+                    }
+                    if ((sampled < 4) && ((shift & mask) != (check_serial_vals[sampled] & mask))) {
+                        check_fail("spi mode %u: frame %u sampled 0x%x on MOSI, want 0x%x",
+                                   (cpol << 1) | cpha, sampled, shift & mask, check_serial_vals[sampled] & mask);
+                    }
+                    sampled++;
+                    shift = 0;
+                    shifted = 0;
+                }
+            }
+            sck = now;
+        }
+        uint32_t word;
+        if (sim.sm[2].rx.level && apio_sim_rx_get(&sim, 2, &word)) {
+            uint32_t value = apio_serial_rx_value(&spi, word) & mask;
+            if (value != (check_serial_vals[got] & mask)) {
+                check_fail("spi mode %u: frame %u received 0x%x, want 0x%x",
+                           (cpol << 1) | cpha, got, value, check_serial_vals[got] & mask);
+            }
+            got++;
+        }
+    }
+
+    // Stalled on autopull, with SCK idle
+    apio_sim_run(&sim, 1024);
+    sck = (apio_sim_pin_levels(&sim) >> 6) & 1;
+    if ((got != 4) || (sampled != 4) || (sck != cpol)) {
+        check_fail("spi mode %u: %u frames received, %u sampled, SCK idles %u",
+                   (cpol << 1) | cpha, got, sampled, sck);
+    }
+}
+
+static void check_spi(void) {
+    for (uint8_t mode = 0; mode < 4; mode++) {
+        check_spi_run(8, APIO_SERIAL_MSB_FIRST, mode >> 1, mode & 1, 0);
+        check_spi_run(13, APIO_SERIAL_LSB_FIRST, mode >> 1, mode & 1, 10000000);
+    }
+    check_spi_run(32, APIO_SERIAL_MSB_FIRST, 0, 0, 1000000);
+}
+
+// I2S decoded from data sampled on BCLK's rising edges - each LRCLK change
+// followed, one BCLK later, by the next channel's sample, MSB first - gives
+// back the samples written, alternating left and right, with LRCLK only
+// changing while BCLK is low
+static void check_i2s_run(uint8_t bits, uint32_t rate_hz) {
+    static apio_serial_t i2s;
+    static uint8_t lrclk[4096];
+    static uint8_t data[4096];
+    const apio_serial_cfg_t cfg = {
+        .protocol = APIO_SERIAL_I2S, .bits = bits, .order = APIO_SERIAL_MSB_FIRST,
+        .pin_data = 10, .pin_clk = 11, .sysclk_hz = CHECK_SYSCLK_HZ, .rate_hz = rate_hz,
+    };
+    if (apio_serial_init(&i2s, &cfg) != APIO_SERIAL_OK) {
+        check_fail("i2s %u bits: init", bits);
+        return;
+    }
+    APIO_ASM_INIT();
+    APIO_GPIO_OUTPUT(10, 0);
+    APIO_GPIO_OUTPUT(11, 0);
+    APIO_GPIO_OUTPUT(12, 0);
+    APIO_SET_BLOCK(0);
+    APIO_SET_SM(3);
+    APIO_SERIAL_ADD(&i2s);
+    APIO_END_BLOCK();
+    APIO_ENABLE_SMS(0, 1 << 3);
+
+    apio_sim_t sim;
+    apio_sim_init(&sim, 0);
+    uint32_t levels = apio_sim_pin_levels(&sim);
+    if ((levels >> 11) & 0x3) {
+        check_fail("i2s %u bits: BCLK and LRCLK not low at start", bits);
+    }
+
+    // Seeded with LRCLK high, as before the exec'd start, so its first fall
+    // is seen
+    uint32_t edges = 1;
+    uint32_t fed = 0;
+    uint32_t bclk = 0;
+    uint32_t lr = (levels >> 12) & 1;
+    lrclk[0] = 1;
+    for (uint32_t cycle = 0; (cycle < 200000) && (edges < sizeof(data)); cycle++) {
+        while ((fed < CHECK_SERIAL_VALS) && (sim.sm[3].tx.level < sim.sm[3].tx.depth)) {
+            apio_sim_tx_put(&sim, 3, apio_serial_tx_word(&i2s, check_serial_vals[fed++]));
+        }
+        apio_sim_step(&sim);
+        levels = apio_sim_pin_levels(&sim);
+        uint32_t now = (levels >> 11) & 1;
+        if ((((levels >> 12) & 1) != lr) && now) {
+            check_fail("i2s %u bits: LRCLK changed with BCLK high", bits);
+        }
+        lr = (levels >> 12) & 1;
+        if (now && !bclk) {
+            lrclk[edges] = (uint8_t)lr;
+            data[edges] = (levels >> 10) & 1;
+            edges++;
+        }
+        bclk = now;
+        if ((fed == CHECK_SERIAL_VALS) && !sim.sm[3].tx.level && (edges > bits * (CHECK_SERIAL_VALS + 2u))) {
+            break;
+        }
+    }
+
+    uint32_t words = 0;
+    for (uint32_t ii = 1; ((ii + bits) < edges) && (words < CHECK_SERIAL_VALS - 1); ii++) {
+        if (lrclk[ii] == lrclk[ii - 1]) {
+            continue;
+        }
+        uint32_t value = 0;
+        for (uint32_t jj = 0; jj < bits; jj++) {
+            value = (value << 1) | data[ii + 1 + jj];
+        }
+        uint32_t want = check_serial_vals[words] & check_mask(bits);
+        if ((lrclk[ii + 1] != (words & 1)) || (value != want)) {
+            check_fail("i2s %u bits: sample %u 0x%x on LRCLK %u, want 0x%x on %u",
+                       bits, words, value, lrclk[ii + 1], want, words & 1);
+        }
+        words++;
+    }
+    if (words != CHECK_SERIAL_VALS - 1) {
+        check_fail("i2s %u bits: %u samples decoded, want %u", bits, words, (uint32_t)CHECK_SERIAL_VALS - 1);
+    }
+}
+
+static void check_i2s(void) {
+    check_i2s_run(16, 0);
+    check_i2s_run(24, 0);
+    check_i2s_run(32, 3072000);
+}
+
+//
+// ROM emulation
+//
+
+static uint8_t check_rom_table[1 << 10];
+
+// Each address presented with CS and OE active is answered with its table
+// entry within the reported worst-case latency, less the input synchronisers
+// the interpreter doesn't model, and the data pins float within the reported
+// CS/OE latency once OE is deasserted
+static void check_rom(void) {
+    for (uint32_t ii = 0; ii < sizeof(check_rom_table); ii++) {
+        check_rom_table[ii] = (uint8_t)((ii * 0x9D) ^ (ii >> 3));
+    }
+    static apio_rom_t rom;
+    const apio_rom_cfg_t cfg = {
+        .addr_base = 0, .addr_count = 10,
+        .data_base = 16, .data_width = 8,
+        .cs_pin = 24, .cs_active = APIO_ROM_ACTIVE_LOW,
+        .oe_pin = 25, .oe_active = APIO_ROM_ACTIVE_LOW,
+        .first_sm = 0, .dma_addr = 0, .dma_data = 1,
+        .table = check_rom_table,
+    };
+    int rc = apio_rom_init(&rom, &cfg);
+    if (rc != APIO_ROM_OK) {
+        check_fail("rom: init returned %d", rc);
+        return;
+    }
+    APIO_ASM_INIT();
+    for (uint8_t pin = 16; pin < 24; pin++) {
+        APIO_GPIO_OUTPUT(pin, 0);
+    }
+    APIO_SET_BLOCK(0);
+    APIO_ROM_ADD(&rom);
+    APIO_END_BLOCK();
+    apio_rom_start(&rom);
+
+    apio_sim_t sim;
+    apio_sim_init(&sim, 0);
+    uint32_t bound = rom.lat.total - rom.lat.sync;
+    uint32_t seed = 1;
+    uint32_t addr = 0;
+    for (uint32_t ii = 0; ii < 256; ii++) {
+        // Vary the address and the phase of the change against the address
+        // SM's sampling loop
+        seed = (seed * 1103515245) + 12345;
+        addr = (addr + 1 + ((seed >> 16) & 0x1FF)) & 0x3FF;
+        sim.gpio_in = addr;
+        apio_rom_run_sim(&rom, &sim, bound + ((seed >> 8) & 7));
+        uint32_t data = (apio_sim_pin_levels(&sim) >> 16) & 0xFF;
+        if (data != check_rom_table[addr]) {
+            check_fail("rom: address 0x%03x read 0x%02x, want 0x%02x", addr, data, check_rom_table[addr]);
+            break;
+        }
+    }
+    if ((rom.lookups < 250) || (rom.max_latency > bound) || (rom.max_latency + rom.lat.sample < bound)) {
+        check_fail("rom: %u lookups, worst measured latency %u cycles, reported %u less %u sync",
+                   rom.lookups, rom.max_latency, rom.lat.total, rom.lat.sync);
+    }
+
+    // OE deasserted, with the data pins pulled to a pattern
+    sim.gpio_in = addr | (1u << 25) | (0x5Au << 16);
+    apio_rom_run_sim(&rom, &sim, rom.lat.oe - rom.lat.sync);
+    uint32_t data = (apio_sim_pin_levels(&sim) >> 16) & 0xFF;
+    if (data != 0x5A) {
+        check_fail("rom: data pins read 0x%02x %u cycles after OE deasserted, want floating", data, rom.lat.oe);
+    }
+}
+
+//
+// Tri-state
+//
+
+// Each method's pins are driven while OE is active and float otherwise,
+// following each OE change within, and in the worst case exactly, the
+// reported cycles, and holding until the next
+static void check_tri_run(uint8_t pin_base, uint8_t count, uint8_t oe_active, uint8_t method, uint8_t want_method) {
+    static apio_tri_t tri;
+    const apio_tri_cfg_t cfg = {
+        .pin_base = pin_base, .count = count, .oe_pin = 20, .oe_active = oe_active, .method = method,
+    };
+    int rc = apio_tri_init(&tri, &cfg);
+    if ((rc != APIO_TRI_OK) || (tri.method != want_method)) {
+        check_fail("tri %u pins: init returned %d, method %u, want %u", count, rc, tri.method, want_method);
+        return;
+    }
+    APIO_ASM_INIT();
+    for (uint8_t pin = pin_base; pin < pin_base + count; pin++) {
+        APIO_GPIO_OUTPUT(pin, 0);
+    }
+    APIO_SET_BLOCK(0);
+    APIO_SET_SM(2);
+    APIO_TRI_ADD(&tri);
+    APIO_END_BLOCK();
+    APIO_ENABLE_SMS(0, 1 << 2);
+
+    apio_sim_t sim;
+    apio_sim_init(&sim, 0);
+    uint32_t mask = check_mask(count) << pin_base;
+    uint32_t oe = 1u << cfg.oe_pin;
+    sim.gpio_in = oe_active ? 0 : oe;
+    apio_sim_run(&sim, 4);
+    if (sim.pindirs & mask) {
+        check_fail("tri %u pins: driven with OE inactive at start", count);
+    }
+    uint32_t worst = 0;
+    uint32_t active = 0;
+    for (uint32_t ii = 0; ii < 64; ii++) {
+        active = !active;
+        sim.gpio_in = (active == oe_active) ? oe : 0;
+        uint32_t want = active ? mask : 0;
+        uint32_t cycles = 1;
+        for (apio_sim_step(&sim); ((sim.pindirs & mask) != want) && (cycles < 16); cycles++) {
+            apio_sim_step(&sim);
+        }
+        if (cycles > worst) {
+            worst = cycles;
+        }
+        for (uint32_t hold = 0; hold < (ii % 5); hold++) {
+            apio_sim_step(&sim);
+            if ((sim.pindirs & mask) != want) {
+                check_fail("tri %u pins: directions 0x%08x changed with OE steady", count, sim.pindirs & mask);
+                return;
+            }
+        }
+    }
+    if (worst != tri.cycles) {
+        check_fail("tri %u pins: worst case %u cycles, reported %u", count, worst, tri.cycles);
+    }
+}
+
+static void check_tri(void) {
+    check_tri_run(4, 1, APIO_TRI_ACTIVE_LOW, APIO_TRI_METHOD_AUTO, APIO_TRI_METHOD_MOV_PINS);
+    check_tri_run(0, 4, APIO_TRI_ACTIVE_LOW, APIO_TRI_METHOD_AUTO, APIO_TRI_METHOD_SIDESET);
+    check_tri_run(2, 16, APIO_TRI_ACTIVE_HIGH, APIO_TRI_METHOD_AUTO, APIO_TRI_METHOD_MOV);
+    check_tri_run(3, 3, APIO_TRI_ACTIVE_HIGH, APIO_TRI_METHOD_MOV, APIO_TRI_METHOD_MOV);
+}
+
+//
+// Latency measurement
+//
+
+// An edge response measured by a measurement SM in the interpreter matches
+// apio_lat_model_edge(), without the synchroniser the interpreter doesn't
+// model, to within the measurement's 2 cycle resolution.  The model scales
+// with the SM's clock divider, an integer part of 0 being 65536.
+static void check_lat(void) {
+    APIO_ASM_INIT();
+    APIO_GPIO_OUTPUT(1, 0);
+    APIO_SET_BLOCK(0);
+    // SM 0 - the response under test, driving pin 1 after a rising edge on
+    // pin 0
+    APIO_SET_SM(0);
+    APIO_ADD_INSTR(APIO_SET_PIN_DIRS(1));
+    APIO_WRAP_BOTTOM();
+    APIO_LABEL_NEW(wait);
+    APIO_ADD_INSTR(APIO_WAIT_GPIO_HIGH(0));
+    APIO_ADD_INSTR(APIO_ADD_DELAY(APIO_NOP, 3));
+    APIO_LABEL_NEW(drive);
+    APIO_ADD_INSTR(APIO_SET_PINS(1));
+    APIO_ADD_INSTR(APIO_WAIT_GPIO_LOW(0));
+    APIO_WRAP_TOP();
+    APIO_ADD_INSTR(APIO_SET_PINS(0));
+    APIO_SM_CLKDIV_SET(1, 0);
+    APIO_SM_EXECCTRL_SET(0);
+    APIO_SM_SHIFTCTRL_SET(0);
+    APIO_SM_PINCTRL_SET(APIO_SET_BASE(1) | APIO_SET_COUNT(1));
+    APIO_SM_JMP_TO_START();
+    // SM 1 - the measurement
+    APIO_SET_SM(1);
+    APIO_LAT_EDGE_SM(0, 1);
+    APIO_END_BLOCK();
+    APIO_ENABLE_SMS(0, 0x3);
+
+    uint8_t wait = APIO_LABEL(wait);
+    uint8_t drive = APIO_LABEL(drive);
+    uint32_t model = apio_lat_model_edge(0, 0, wait, drive, 1);
+    uint32_t synced = apio_lat_model_edge(0, 0, wait, drive, 0);
+    if ((model != 6) || (synced != model + APIO_LAT_SYNC_CYCLES)) {
+        check_fail("lat: modelled %u cycles, %u with the synchroniser, want 6 and %u",
+                   model, synced, 6 + APIO_LAT_SYNC_CYCLES);
+    }
+
+    static apio_lat_t lat;
+    apio_lat_init(&lat, APIO_LAT_EDGE);
+    apio_sim_t sim;
+    apio_sim_init(&sim, 0);
+    for (uint32_t ii = 0; ii < 50; ii++) {
+        apio_sim_run(&sim, 20 + (ii % 3));
+        sim.gpio_in |= 1;
+        apio_sim_run(&sim, 30);
+        sim.gpio_in &= ~1ull;
+        apio_lat_collect_sim(&lat, &sim, 1);
+    }
+    apio_lat_report_t report;
+    apio_lat_report(&lat, &report);
+    if ((report.count != 50) || (report.min + 2 < model) || (report.max > model + 2)) {
+        check_fail("lat: %u measured, %u-%u cycles, modelled %u", report.count, report.min, report.max, model);
+    }
+
+    pio_sm_reg_t *reg = &_apio_emulated_pio.pio_sm_reg[0][0];
+    reg->clkdiv = APIO_CLKDIV(2, 128);
+    model = apio_lat_model_edge(0, 0, wait, drive, 1);
+    if (model != 15) {
+        check_fail("lat: modelled %u cycles at CLKDIV 2.5, want 15", model);
+    }
+    reg->clkdiv = APIO_CLKDIV(0, 0);
+    model = apio_lat_model_edge(0, 0, wait, drive, 1);
+    if (model != 6 * 65536) {
+        check_fail("lat: modelled %u cycles at CLKDIV 65536, want %u", model, 6 * 65536);
+    }
+}
+
+//
+// FDEBUG telemetry
+//
+
+// Compares the FDEBUG counters for every SM with those wanted for block 0's
+// SMs 0-2, the rest being 0.
+static void check_fdebug_counts(const apio_fdebug_t *fdebug, uint32_t polls, const apio_fdebug_sm_t want[3]) {
+    if (fdebug->polls != polls) {
+        check_fail("fdebug: %u polls, want %u", fdebug->polls, polls);
+    }
+    for (uint8_t block = 0; block < APIO_MAX_PIO_BLOCKS; block++) {
+        for (uint8_t sm = 0; sm < APIO_MAX_SMS_PER_BLOCK; sm++) {
+            const apio_fdebug_sm_t zero = {0};
+            const apio_fdebug_sm_t *wanted = ((block == 0) && (sm < 3)) ? &want[sm] : &zero;
+            const apio_fdebug_sm_t *got = &fdebug->sm[block][sm];
+            if (memcmp(got, wanted, sizeof(*got))) {
+                check_fail("fdebug: poll %u PIO%u:%u counted %u/%u/%u/%u, want %u/%u/%u/%u",
+                           polls, block, sm,
+                           got->tx_stall, got->tx_over, got->rx_under, got->rx_stall,
+                           wanted->tx_stall, wanted->tx_over, wanted->rx_under, wanted->rx_stall);
+            }
+        }
+    }
+}
+
+// SM 0 stalls pulling from an empty TX FIFO and SM 1 pushing to a full RX
+// FIFO, while the host overflows disabled SM 2's TX FIFO and underruns its RX
+// FIFO.  Each poll counts the flags set since the previous one, once each.
+static void check_fdebug(void) {
+    APIO_ASM_INIT();
+    APIO_SET_BLOCK(0);
+    APIO_SET_SM(0);
+    APIO_WRAP_BOTTOM();
+    APIO_ADD_INSTR(APIO_PULL_BLOCK);
+    APIO_WRAP_TOP();
+    APIO_ADD_INSTR(APIO_OUT_NULL(32));
+    APIO_SM_CLKDIV_SET(1, 0);
+    APIO_SM_EXECCTRL_SET(0);
+    APIO_SM_SHIFTCTRL_SET(0);
+    APIO_SM_PINCTRL_SET(0);
+    APIO_SM_JMP_TO_START();
+    APIO_SET_SM(1);
+    APIO_WRAP_BOTTOM();
+    APIO_ADD_INSTR(APIO_IN_NULL(32));
+    APIO_WRAP_TOP();
+    APIO_ADD_INSTR(APIO_PUSH_BLOCK);
+    APIO_SM_CLKDIV_SET(1, 0);
+    APIO_SM_EXECCTRL_SET(0);
+    APIO_SM_SHIFTCTRL_SET(0);
+    APIO_SM_PINCTRL_SET(0);
+    APIO_SM_JMP_TO_START();
+    APIO_END_BLOCK();
+    APIO_ENABLE_SMS(0, 0x3);
+
+    apio_sim_t sim;
+    apio_sim_init(&sim, 0);
+    static apio_fdebug_t fdebug;
+    apio_fdebug_reset(&fdebug);
+    apio_fdebug_sm_t want[3] = {0};
+
+    apio_sim_run(&sim, 64);
+    apio_fdebug_poll(&fdebug);
+    want[0].tx_stall++;
+    want[1].rx_stall++;
+    check_fdebug_counts(&fdebug, 1, want);
+
+    // Nothing ran, so only the host's errors are new
+    for (uint32_t ii = 0; ii < APIO_MAX_FIFO_DEPTH; ii++) {
+        if (!apio_sim_tx_put(&sim, 2, ii)) {
+            check_fail("fdebug: TX FIFO full after %u words", ii);
+        }
+    }
+    uint32_t word;
+    if (apio_sim_tx_put(&sim, 2, 0) || apio_sim_rx_get(&sim, 2, &word)) {
+        check_fail("fdebug: overflow or underrun succeeded");
+    }
+    apio_fdebug_poll(&fdebug);
+    want[2].tx_over++;
+    want[2].rx_under++;
+    check_fdebug_counts(&fdebug, 2, want);
+
+    apio_fdebug_poll(&fdebug);
+    check_fdebug_counts(&fdebug, 3, want);
+
+    // Feed SM 0 and drain SM 1, and both stall again
+    apio_sim_tx_put(&sim, 0, 1);
+    apio_sim_tx_put(&sim, 0, 2);
+    while (sim.sm[1].rx.level) {
+        apio_sim_rx_get(&sim, 1, &word);
+    }
+    apio_sim_run(&sim, 64);
+    if (sim.sm[0].tx.level || (sim.sm[1].rx.level != APIO_MAX_FIFO_DEPTH)) {
+        check_fail("fdebug: TX level %u, RX level %u", sim.sm[0].tx.level, sim.sm[1].rx.level);
+    }
+    apio_fdebug_poll(&fdebug);
+    want[0].tx_stall++;
+    want[1].rx_stall++;
+    check_fdebug_counts(&fdebug, 4, want);
+
+    apio_fdebug_reset(&fdebug);
+    memset(want, 0, sizeof(want));
+    apio_fdebug_poll(&fdebug);
+    check_fdebug_counts(&fdebug, 1, want);
+}
+
+//
+// FIFO level histograms
+//
+
+// Disabled SM 0 holds 3 then 4 words in its TX FIFO, SM 1 fills its RX FIFO
+// and stalls, and disabled SM 2 holds 8 words in its joined TX FIFO.  The
+// histograms and reports match those levels, and unsampled SM 3, holding 4
+// words, records nothing.
+static void check_flevel(void) {
+    APIO_ASM_INIT();
+    APIO_SET_BLOCK(0);
+    APIO_SET_SM(0);
+    APIO_WRAP_BOTTOM();
+    APIO_ADD_INSTR(APIO_PULL_BLOCK);
+    APIO_WRAP_TOP();
+    APIO_ADD_INSTR(APIO_OUT_NULL(32));
+    APIO_SM_CLKDIV_SET(1, 0);
+    APIO_SM_EXECCTRL_SET(0);
+    APIO_SM_SHIFTCTRL_SET(0);
+    APIO_SM_PINCTRL_SET(0);
+    APIO_SM_JMP_TO_START();
+    APIO_SET_SM(1);
+    APIO_WRAP_BOTTOM();
+    APIO_ADD_INSTR(APIO_IN_NULL(32));
+    APIO_WRAP_TOP();
+    APIO_ADD_INSTR(APIO_PUSH_BLOCK);
+    APIO_SM_CLKDIV_SET(1, 0);
+    APIO_SM_EXECCTRL_SET(0);
+    APIO_SM_SHIFTCTRL_SET(0);
+    APIO_SM_PINCTRL_SET(0);
+    APIO_SM_JMP_TO_START();
+    APIO_SET_SM(2);
+    APIO_WRAP_BOTTOM();
+    APIO_ADD_INSTR(APIO_PULL_BLOCK);
+    APIO_WRAP_TOP();
+    APIO_ADD_INSTR(APIO_OUT_NULL(32));
+    APIO_SM_CLKDIV_SET(1, 0);
+    APIO_SM_EXECCTRL_SET(0);
+    APIO_SM_SHIFTCTRL_SET(APIO_FJOIN_TX);
+    APIO_SM_PINCTRL_SET(0);
+    APIO_SM_JMP_TO_START();
+    APIO_END_BLOCK();
+    APIO_ENABLE_SMS(0, 1 << 1);
+
+    apio_sim_t sim;
+    apio_sim_init(&sim, 0);
+    for (uint32_t ii = 0; ii < APIO_MAX_FIFO_DEPTH * 2; ii++) {
+        if (ii < 3) {
+            apio_sim_tx_put(&sim, 0, ii);
+        }
+        if (ii < APIO_MAX_FIFO_DEPTH) {
+            apio_sim_tx_put(&sim, 3, ii);
+        }
+        apio_sim_tx_put(&sim, 2, ii);
+    }
+    apio_sim_run(&sim, 16);
+
+    static apio_flevel_t flevel;
+    apio_flevel_start(&flevel, APIO_MON_SM(0, 0) | APIO_MON_SM(0, 1) | APIO_MON_SM(0, 2), 10);
+    for (uint32_t ii = 0; ii < 40; ii++) {
+        if (ii == 10) {
+            apio_sim_tx_put(&sim, 0, ii);
+        }
+        apio_sim_run(&sim, 8);
+        apio_flevel_sample(&flevel);
+    }
+
+    const apio_flevel_sm_t *hist = flevel.sm[0];
+    if ((flevel.samples != 40) || (hist[0].tx[3] != 10) || (hist[0].tx[4] != 30) ||
+        (hist[0].rx[0] != 40) || (hist[1].rx[4] != 40) || (hist[2].tx[8] != 40)) {
+        check_fail("flevel: %u samples, SM 0 TX %u at 3 and %u at 4, RX %u at 0, "
+                   "SM 1 RX %u at 4, SM 2 TX %u at 8",
+                   flevel.samples, hist[0].tx[3], hist[0].tx[4], hist[0].rx[0],
+                   hist[1].rx[4], hist[2].tx[8]);
+    }
+    if ((hist[0].tx_depth != 4) || (hist[0].rx_depth != 4) ||
+        (hist[2].tx_depth != 8) || (hist[2].rx_depth != 0)) {
+        check_fail("flevel: SM 0 depths %u/%u, SM 2 depths %u/%u, want 4/4 and 8/0",
+                   hist[0].tx_depth, hist[0].rx_depth, hist[2].tx_depth, hist[2].rx_depth);
+    }
+    for (uint32_t bin = 0; bin < APIO_FLEVEL_BINS; bin++) {
+        if (hist[3].tx[bin] || hist[3].rx[bin]) {
+            check_fail("flevel: unsampled SM 3 has samples at level %u", bin);
+        }
+    }
+
+    apio_flevel_report_t report;
+    apio_flevel_report(&flevel, 0, 0, &report);
+    if ((report.tx_empty_us != 0) || (report.tx_full_us != 300) || (report.tx_mean_x100 != 375) ||
+        (report.rx_empty_us != 400) || (report.rx_full_us != 0) || (report.rx_mean_x100 != 0)) {
+        check_fail("flevel: SM 0 TX %llu/%llu/%u RX %llu/%llu/%u, want 0/300/375 400/0/0",
+                   (unsigned long long)report.tx_empty_us, (unsigned long long)report.tx_full_us,
+                   report.tx_mean_x100,
+                   (unsigned long long)report.rx_empty_us, (unsigned long long)report.rx_full_us,
+                   report.rx_mean_x100);
+    }
+    apio_flevel_report(&flevel, 0, 1, &report);
+    if ((report.rx_full_us != 400) || (report.rx_mean_x100 != 400) || (report.tx_empty_us != 400)) {
+        check_fail("flevel: SM 1 RX full %lluus mean %u, TX empty %lluus, want 400, 400 and 400",
+                   (unsigned long long)report.rx_full_us, report.rx_mean_x100,
+                   (unsigned long long)report.tx_empty_us);
+    }
+    apio_flevel_report(&flevel, 0, 2, &report);
+    if ((report.tx_full_us != 400) || (report.tx_mean_x100 != 800) ||
+        (report.rx_empty_us != 0) || (report.rx_full_us != 0)) {
+        check_fail("flevel: SM 2 TX full %lluus mean %u, RX %llu/%lluus, want 400, 800 and 0/0",
+                   (unsigned long long)report.tx_full_us, report.tx_mean_x100,
+                   (unsigned long long)report.rx_empty_us, (unsigned long long)report.rx_full_us);
+    }
+}
+
+//
+// Operation log
+//
+
+// Scratch file for the oplog check
+#if !defined(CHECK_OPLOG_FILE)
+#define CHECK_OPLOG_FILE        "check.oplog"
+#endif
+
+// A configuration using each kind of recorded operation, differing with
+// DELAY
+static void check_oplog_build(uint8_t delay) {
+    APIO_GPIO_INIT();
+    APIO_ENABLE_PIOS();
+    APIO_GPIO_INPUT_OUTPUT(3, 1);
+    APIO_GPIO_INPUT_OUTPUT(4, 1);
+    APIO_GPIO_INPUT_ONLY(4);
+    APIO_GPIO_PULL_UP(5);
+    APIO_ASM_INIT();
+    APIO_CLEAR_ALL_IRQS();
+    APIO_SET_BLOCK(1);
+    APIO_GPIOBASE_16();
+    APIO_SET_SM(2);
+    APIO_ADD_INSTR(APIO_SET_PIN_DIRS(1));
+    APIO_WRAP_BOTTOM();
+    APIO_ADD_INSTR(APIO_ADD_DELAY(APIO_SET_PINS(1), delay));
+    APIO_WRAP_TOP();
+    APIO_ADD_INSTR(APIO_SET_PINS(0));
+    APIO_SM_CLKDIV_SET(100, delay);
+    APIO_SM_EXECCTRL_SET(0);
+    APIO_SM_SHIFTCTRL_SET(0);
+    APIO_SM_PINCTRL_SET(APIO_SET_BASE(3) | APIO_SET_COUNT(1));
+    APIO_TXF_PUT(0xDEAD0000 | delay);
+    APIO_SM_JMP_TO_START();
+    APIO_END_BLOCK();
+    APIO_ENABLE_SMS(1, 1 << 2);
+    APIO_ASM_CONTINUE();
+    APIO_SET_BLOCK_FROM(1, 3);
+    APIO_SET_SM(3);
+    APIO_START();
+    APIO_ADD_INSTR(APIO_JMP(0));
+    APIO_END();
+    APIO_END_BLOCK_FROM(3);
+    APIO_ENABLE_SM(1, 1 << 3);
+}
+
+// A recorded configuration replays, from memory and from a file, to the same
+// emulated state.  A bad record fails the replay, logged with its index.
+static void check_oplog(void) {
+    check_oplog_len = 0;
+    check_oplog_build(7);
+    size_t len = check_oplog_len;
+    static uint8_t log[sizeof(check_oplog_buf)];
+    memcpy(log, check_oplog_buf, len);
+    static apio_emu_snapshot_t recorded, replayed;
+    apio_emu_snapshot(&recorded);
+    if ((len < 32 * APIO_OPLOG_RECORD_SIZE) || (len >= sizeof(check_oplog_buf))) {
+        check_fail("oplog: recorded %u bytes", (unsigned)len);
+        return;
+    }
+
+    apio_emu_diff_t diff;
+    check_oplog_build(3);
+    apio_emu_snapshot(&replayed);
+    if (!apio_emu_diff(&recorded, &replayed, &diff)) {
+        check_fail("oplog: configurations don't differ");
+    }
+    check_oplog_len = 0;
+    int count = apio_oplog_replay(log, len);
+    apio_emu_snapshot(&replayed);
+    if ((count != (int)(len / APIO_OPLOG_RECORD_SIZE)) || apio_emu_diff(&recorded, &replayed, &diff)) {
+        check_fail("oplog: replayed %d of %u records, blocks 0x%x differ",
+                   count, (unsigned)(len / APIO_OPLOG_RECORD_SIZE), diff.blocks);
+    }
+    if (check_oplog_len) {
+        check_fail("oplog: replay recorded %u bytes", (unsigned)check_oplog_len);
+    }
+
+    check_oplog_build(3);
+    FILE *file = fopen(CHECK_OPLOG_FILE, "wb");
+    if (!file || (fwrite(log, 1, len, file) != len) || fclose(file)) {
+        check_fail("oplog: writing %s", CHECK_OPLOG_FILE);
+        return;
+    }
+    count = apio_oplog_replay_file(CHECK_OPLOG_FILE);
+    apio_emu_snapshot(&replayed);
+    if ((count != (int)(len / APIO_OPLOG_RECORD_SIZE)) || apio_emu_diff(&recorded, &replayed, &diff)) {
+        check_fail("oplog: replayed %d of %u records from a file, blocks 0x%x differ",
+                   count, (unsigned)(len / APIO_OPLOG_RECORD_SIZE), diff.blocks);
+    }
+
+    // Record 2 is an unknown operation
+    log[2 * APIO_OPLOG_RECORD_SIZE] = 0xFF;
+    int rc = apio_oplog_replay(log, len);
+    if ((rc != APIO_OPLOG_ERR_OP) || !strstr(check_log_buf, "record 2 ")) {
+        check_fail("oplog: bad record returned %d, logged \"%s\"", rc, check_log_buf);
+    }
+    file = fopen(CHECK_OPLOG_FILE, "wb");
+    if (!file || (fwrite(log, 1, len, file) != len) || fclose(file)) {
+        check_fail("oplog: writing %s", CHECK_OPLOG_FILE);
+        return;
+    }
+    check_log_buf[0] = '\0';
+    rc = apio_oplog_replay_file(CHECK_OPLOG_FILE);
+    if ((rc != APIO_OPLOG_ERR_OP) || !strstr(check_log_buf, "record 2 ")) {
+        check_fail("oplog: bad record in a file returned %d, logged \"%s\"", rc, check_log_buf);
+    }
+    remove(CHECK_OPLOG_FILE);
+}
+
+//
+// VCD capture
+//
+
+// Scratch file for the vcd check
+#if !defined(CHECK_VCD_FILE)
+#define CHECK_VCD_FILE          "check.vcd"
+#endif
+
+// An SM toggling pins 16 and 18 every 32000 cycles is recorded with the
+// header expected, and each change timestamped with its exact cycle count
+// in ps at 150MHz, from a start cycle high enough that cycles * 10^12 would
+// overflow
+static void check_vcd(void) {
+    APIO_ASM_INIT();
+    APIO_GPIO_OUTPUT(16, 1);
+    APIO_GPIO_OUTPUT(18, 1);
+    APIO_SET_BLOCK(1);
+    APIO_GPIOBASE_16();
+    APIO_SET_SM(0);
+    APIO_ADD_INSTR(APIO_SET_PIN_DIRS(5));
+    APIO_WRAP_BOTTOM();
+    APIO_ADD_INSTR(APIO_ADD_DELAY(APIO_SET_PINS(5), 31));
+    APIO_WRAP_TOP();
+    APIO_ADD_INSTR(APIO_ADD_DELAY(APIO_SET_PINS(0), 31));
+    APIO_SM_CLKDIV_SET(1000, 0);
+    APIO_SM_EXECCTRL_SET(0);
+    APIO_SM_SHIFTCTRL_SET(0);
+    APIO_SM_PINCTRL_SET(APIO_SET_BASE(0) | APIO_SET_COUNT(3));
+    APIO_SM_JMP_TO_START();
+    APIO_END_BLOCK();
+    APIO_ENABLE_SMS(1, 1 << 0);
+
+    apio_sim_t sim;
+    apio_sim_init(&sim, 1);
+    const uint64_t start = 3ull << 38;
+    sim.cycles = start;
+    static apio_vcd_t vcd;
+    if (!apio_vcd_open(&vcd, CHECK_VCD_FILE, &sim, 0x5, CHECK_SYSCLK_HZ)) {
+        check_fail("vcd: opening %s", CHECK_VCD_FILE);
+        return;
+    }
+    apio_vcd_run(&vcd, &sim, 100 * 32000);
+    if (!apio_vcd_close(&vcd)) {
+        check_fail("vcd: writing %s", CHECK_VCD_FILE);
+    }
+
+    static char text[16384];
+    FILE *file = fopen(CHECK_VCD_FILE, "rb");
+    size_t len = file ? fread(text, 1, sizeof(text) - 1, file) : 0;
+    if (file) {
+        fclose(file);
+    }
+    remove(CHECK_VCD_FILE);
+    text[len] = '\0';
+
+    char header[1024];
+    int pos = snprintf(header, sizeof(header),
+                       "$version apio $end\n$timescale 1ps $end\n$scope module pio1 $end\n"
+                       "$var wire 1 ! gpio16 $end\n$var wire 1 # gpio18 $end\n");
+    for (int sm = 0; sm < APIO_MAX_SMS_PER_BLOCK; sm++) {
+        pos += snprintf(header + pos, sizeof(header) - pos,
+                        "$var reg 4 %c sm%d_tx_level $end\n$var reg 4 %c sm%d_rx_level $end\n",
+                        'A' + sm, sm, 'E' + sm, sm);
+    }
+    snprintf(header + pos, sizeof(header) - pos,
+             "$var wire 8 I irq $end\n$upscope $end\n$enddefinitions $end\n");
+    if (strncmp(text, header, strlen(header))) {
+        check_fail("vcd: header differs:\n%.*s", (int)strlen(header), text);
+        return;
+    }
+
+    // 150MHz is 20000/3 ps per cycle, and start a multiple of 3 cycles
+    const uint64_t start_ps = (start / 3) * 20000;
+    uint64_t ps = 0;
+    uint64_t last = 0;
+    uint32_t changes = 0;
+    for (const char *line = text + strlen(header); *line; ) {
+        if (line[0] == '#') {
+            ps = strtoull(line + 1, NULL, 10);
+            if ((ps < start_ps) || (!changes && (ps != start_ps))) {
+                check_fail("vcd: timestamp %llu, starting at %llu",
+                           (unsigned long long)ps, (unsigned long long)start_ps);
+                return;
+            }
+        } else if (((line[0] == '0') || (line[0] == '1')) && (line[1] == '!')) {
+            // The cycle count this timestamp rounds down from
+            uint64_t cycle = (((ps - start_ps) * 3) + 19999) / 20000;
+            if ((cycle * 20000) / 3 != ps - start_ps) {
+                check_fail("vcd: timestamp %llu isn't a whole cycle", (unsigned long long)ps);
+            } else if ((changes > 1) && (cycle - last != 32000)) {
+                check_fail("vcd: change %u %llu cycles after the last, want 32000",
+                           changes, (unsigned long long)(cycle - last));
+            }
+            last = cycle;
+            changes++;
+        }
+        const char *next = strchr(line, '\n');
+        line = next ? next + 1 : "";
+    }
+    if (changes < 100) {
+        check_fail("vcd: %u changes of gpio16, want at least 100", changes);
+    }
+}
+
+//
+// Snapshot, restore and diff
+//
+
+// Runs block 0 for a while from the current emulated state, returning its
+// pin levels, and its SM 0's PC in PC
+static uint32_t check_snapshot_run(uint8_t *pc) {
+    apio_sim_t sim;
+    apio_sim_init(&sim, 0);
+    apio_sim_run(&sim, 1234);
+    *pc = sim.sm[0].pc;
+    return apio_sim_pin_levels(&sim);
+}
+
+// Changes made to block 1 after a snapshot are reported by apio_emu_diff(),
+// and nothing in block 0.  Restoring the snapshot undoes them, marks every
+// block dirty, and lets a run be repeated from the same state.
+static void check_snapshot(void) {
+    APIO_ASM_INIT();
+    APIO_GPIO_OUTPUT(0, 0);
+    APIO_SET_BLOCK(0);
+    APIO_SET_SM(0);
+    APIO_ADD_INSTR(APIO_SET_PIN_DIRS(1));
+    APIO_WRAP_BOTTOM();
+    APIO_ADD_INSTR(APIO_ADD_DELAY(APIO_SET_PINS(1), 7));
+    APIO_WRAP_TOP();
+    APIO_ADD_INSTR(APIO_ADD_DELAY(APIO_SET_PINS(0), 12));
+    APIO_SM_CLKDIV_SET(1, 0);
+    APIO_SM_EXECCTRL_SET(0);
+    APIO_SM_SHIFTCTRL_SET(0);
+    APIO_SM_PINCTRL_SET(APIO_SET_BASE(0) | APIO_SET_COUNT(1));
+    APIO_SM_JMP_TO_START();
+    APIO_END_BLOCK();
+    APIO_ENABLE_SMS(0, 1 << 0);
+
+    static apio_emu_snapshot_t base, now;
+    apio_emu_snapshot(&base);
+
+    APIO_GPIO_OUTPUT(5, 1);
+    APIO_SET_BLOCK(1);
+    APIO_SET_SM(2);
+    APIO_ADD_INSTR(APIO_NOP);
+    APIO_SM_CLKDIV_SET(4, 0);
+    APIO_TXF_PUT(0x1234);
+    APIO_END_BLOCK();
+    apio_emu_snapshot(&now);
+
+    apio_emu_diff_t diff;
+    if (!apio_emu_diff(&base, &now, &diff) || (diff.blocks != (1u << 1)) ||
+        (diff.sms[0] | diff.sms[2]) || (diff.sms[1] != (1u << 2)) ||
+        (diff.instr[0] | diff.instr[2]) || (diff.instr[1] != 0x1) ||
+        (diff.block_fields[0] | diff.block_fields[2]) ||
+        !(diff.block_fields[1] & APIO_EMU_DIFF_BLOCK_OFFSET) ||
+        !(diff.sm_regs[1][2] & APIO_EMU_DIFF_REG_CLKDIV) ||
+        !(diff.sm_fields[1][2] & APIO_EMU_DIFF_SM_TX_FIFO) ||
+        (diff.gpios != (1ull << 5))) {
+        check_fail("snapshot: diff blocks 0x%x, block 1 SMs 0x%x, instrs 0x%x, fields 0x%x, "
+                   "SM 2 regs 0x%x fields 0x%x, GPIOs 0x%llx",
+                   diff.blocks, diff.sms[1], diff.instr[1], diff.block_fields[1],
+                   diff.sm_regs[1][2], diff.sm_fields[1][2], (unsigned long long)diff.gpios);
+    }
+
+    (void)apio_emu_handoff();
+    apio_emu_restore(&base);
+    uint8_t dirty = apio_emu_handoff();
+    apio_emu_snapshot(&now);
+    if (apio_emu_diff(&base, &now, &diff) || (dirty != APIO_EMU_ALL_BLOCKS)) {
+        check_fail("snapshot: restored blocks 0x%x differ, 0x%x dirty", diff.blocks, dirty);
+    }
+
+    uint8_t pc, again_pc;
+    uint32_t levels = check_snapshot_run(&pc);
+    apio_emu_snapshot(&now);
+    if (!apio_emu_diff(&base, &now, &diff)) {
+        check_fail("snapshot: run didn't change the emulated state");
+    }
+    apio_emu_restore(&base);
+    uint32_t again = check_snapshot_run(&again_pc);
+    if ((again != levels) || (again_pc != pc)) {
+        check_fail("snapshot: rerun gave pins 0x%x PC %u, first 0x%x PC %u", again, again_pc, levels, pc);
+    }
+}
+
+//
+// Main
+//
+
+int main(void) {
+    static const struct {
+        const char *name;
+        void (*fn)(void);
+    } checks[] = {
+        { "la", check_la },
+        { "handoff", check_handoff },
+        { "profiler", check_profiler },
+        { "watchdog", check_watchdog },
+        { "wave", check_wave },
+        { "la-rle", check_la_rle },
+        { "bus", check_bus },
+        { "edge", check_edge },
+        { "uart", check_uart },
+        { "spi", check_spi },
+        { "i2s", check_i2s },
+        { "rom", check_rom },
+        { "tri", check_tri },
+        { "lat", check_lat },
+        { "fdebug", check_fdebug },
+        { "flevel", check_flevel },
+        { "oplog", check_oplog },
+        { "vcd", check_vcd },
+        { "snapshot", check_snapshot },
+    };
+    for (size_t ii = 0; ii < sizeof(checks) / sizeof(checks[0]); ii++) {
+        uint32_t before = check_failures;
+        checks[ii].fn();
+        printf("%-12s %u failures\n", checks[ii].name, check_failures - before);
+    }
+
+    printf("%s\n", check_failures ? "FAILED" : "passed");
+    return check_failures ? 1 : 0;
+}
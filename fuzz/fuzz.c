@@ -0,0 +1,572 @@
+// Copyright (C) 2026 Piers Finlayson <piers@piers.rocks>
+//
+// MIT License
+
+// apio - Runtime RP2350 PIO Assembler and Disassembler
+//
+// Host round-trip fuzz harness for the instruction and register encoders,
+// program layout tracking and the disassembler.  Built with APIO_EMULATION,
+// so runs on any host - see fuzz/README.md.
+//
+// Random instructions, register values and programs are generated through
+// apio's macros, and the result is checked against the inputs - decoded
+// instructions by exact comparison of apio_instruction_decoder()'s text.
+// The decoder is then run over every instruction word, checking it never
+// exceeds its 64 byte output contract.  Best built with sanitizers, which
+// the Makefile's fuzz target does by default.
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// The disassembler is only built when logging is enabled.  Its log lines are
+// not needed here, so are discarded.
+static void fuzz_log(const char *fmt, ...) {
+    (void)fmt;
+}
+#define APIO_LOG_ENABLE fuzz_log
+#define APIO_LOG_IMPL   1
+#define APIO_EMU_IMPL   1
+#include <apio.h>
+
+// Defaults, overridable on the command line
+#define FUZZ_DEFAULT_ITERS      1000000
+#define FUZZ_DEFAULT_SEED       1
+
+// apio_instruction_decoder()'s output contract
+#define FUZZ_DECODE_LEN         64
+
+// Failures reported before further reports are suppressed
+#define FUZZ_MAX_REPORTS        20
+
+// Canary filling the decoder's output buffer beyond the contract
+#define FUZZ_CANARY             0xA5
+
+static uint64_t fuzz_state;
+static uint64_t fuzz_seed;
+static uint32_t fuzz_failures;
+
+//
+// Helpers
+//
+
+// xorshift64*
+static uint32_t fuzz_rand(void) {
+    fuzz_state ^= fuzz_state >> 12;
+    fuzz_state ^= fuzz_state << 25;
+    fuzz_state ^= fuzz_state >> 27;
+    return (uint32_t)((fuzz_state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+// Random value in [MIN, MAX]
+static uint32_t fuzz_range(uint32_t min, uint32_t max) {
+    return min + (fuzz_rand() % (max - min + 1));
+}
+
+static void fuzz_fail(const char *fmt, ...) {
+    if (fuzz_failures++ < FUZZ_MAX_REPORTS) {
+        va_list args;
+        va_start(args, fmt);
+        printf("FAIL (seed %llu): ", (unsigned long long)fuzz_seed);
+        vprintf(fmt, args);
+        printf("\n");
+        va_end(args);
+    } else if (fuzz_failures == FUZZ_MAX_REPORTS + 1) {
+        printf("Further failures suppressed\n");
+    }
+}
+
+// Decodes into a buffer of exactly the contracted size, so the sanitizers
+// catch any overrun
+static void fuzz_decode(uint16_t instr, char *out, uint8_t start_offset) {
+    char *buf = malloc(FUZZ_DECODE_LEN);
+    if (!buf) {
+        fprintf(stderr, "Out of memory\n");
+        exit(2);
+    }
+    apio_instruction_decoder(instr, buf, start_offset);
+    memcpy(out, buf, FUZZ_DECODE_LEN);
+    free(buf);
+}
+
+//
+// Instruction encoders
+//
+
+typedef struct {
+    const char *name;           // Encoding macro
+    uint16_t (*encode)(uint32_t arg);
+    uint32_t min;               // Argument range
+    uint32_t max;
+    int jmp;                    // Argument is an address, relative to start
+    const char *fmt;            // Expected disassembly, %u is the argument
+} fuzz_encoder_t;
+
+// Encoders taking an argument - MACRO, MIN, MAX, JMP, FMT
+#define FUZZ_ARG_ENCODERS(X)                                        \
+    X(APIO_IN_PINS, 1, 32, 0, "in pins, %u")                        \
+    X(APIO_IN_X, 1, 32, 0, "in x, %u")                              \
+    X(APIO_IN_Y, 1, 32, 0, "in y, %u")                              \
+    X(APIO_IN_NULL, 1, 32, 0, "in null, %u")                        \
+    X(APIO_IN_ISR, 1, 32, 0, "in isr, %u")                          \
+    X(APIO_IN_OSR, 1, 32, 0, "in osr, %u")                          \
+    X(APIO_OUT_PINS, 1, 32, 0, "out pins, %u")                      \
+    X(APIO_OUT_X, 1, 32, 0, "out x, %u")                            \
+    X(APIO_OUT_Y, 1, 32, 0, "out y, %u")                            \
+    X(APIO_OUT_NULL, 1, 32, 0, "out null, %u")                      \
+    X(APIO_OUT_PINDIRS, 1, 32, 0, "out pindirs, %u")                \
+    X(APIO_OUT_PC, 1, 32, 0, "out pc, %u")                          \
+    X(APIO_OUT_ISR, 1, 32, 0, "out isr, %u")                        \
+    X(APIO_OUT_EXEC, 1, 32, 0, "out exec, %u")                      \
+    X(APIO_SET_PINS, 0, 31, 0, "set pins, %u")                      \
+    X(APIO_SET_X, 0, 31, 0, "set x, %u")                            \
+    X(APIO_SET_Y, 0, 31, 0, "set y, %u")                            \
+    X(APIO_SET_PIN_DIRS, 0, 31, 0, "set pindirs, %u")               \
+    X(APIO_JMP, 0, 31, 1, "jmp %u")                                 \
+    X(APIO_JMP_NOT_X, 0, 31, 1, "jmp !x, %u")                       \
+    X(APIO_JMP_X_DEC, 0, 31, 1, "jmp x--, %u")                      \
+    X(APIO_JMP_NOT_Y, 0, 31, 1, "jmp !y, %u")                       \
+    X(APIO_JMP_Y_DEC, 0, 31, 1, "jmp y--, %u")                      \
+    X(APIO_JMP_X_NOT_Y, 0, 31, 1, "jmp x!=y, %u")                   \
+    X(APIO_JMP_PIN, 0, 31, 1, "jmp pin, %u")                        \
+    X(APIO_JMP_NOT_OSRE, 0, 31, 1, "jmp !osre, %u")                 \
+    X(APIO_IRQ_SET, 0, 7, 0, "irq %u")                              \
+    X(APIO_IRQ_SET_PREV, 0, 7, 0, "irq prev %u")                    \
+    X(APIO_IRQ_SET_NEXT, 0, 7, 0, "irq next %u")                    \
+    X(APIO_IRQ_SET_REL, 0, 7, 0, "irq %u rel")                      \
+    X(APIO_IRQ_SET_WAIT, 0, 7, 0, "irq wait %u")                    \
+    X(APIO_IRQ_SET_WAIT_PREV, 0, 7, 0, "irq prev wait %u")          \
+    X(APIO_IRQ_SET_WAIT_NEXT, 0, 7, 0, "irq next wait %u")          \
+    X(APIO_IRQ_SET_WAIT_REL, 0, 7, 0, "irq wait %u rel")            \
+    X(APIO_IRQ_CLEAR, 0, 7, 0, "irq clear %u")                      \
+    X(APIO_IRQ_CLEAR_PREV, 0, 7, 0, "irq prev clear %u")            \
+    X(APIO_IRQ_CLEAR_NEXT, 0, 7, 0, "irq next clear %u")            \
+    X(APIO_IRQ_CLEAR_REL, 0, 7, 0, "irq clear %u rel")              \
+    X(APIO_WAIT_GPIO_HIGH, 0, 31, 0, "wait 1 gpio %u")              \
+    X(APIO_WAIT_GPIO_LOW, 0, 31, 0, "wait 0 gpio %u")               \
+    X(APIO_WAIT_PIN_HIGH, 0, 31, 0, "wait 1 pin %u")                \
+    X(APIO_WAIT_PIN_LOW, 0, 31, 0, "wait 0 pin %u")                 \
+    X(APIO_WAIT_IRQ_HIGH, 0, 7, 0, "wait 1 irq %u")                 \
+    X(APIO_WAIT_IRQ_HIGH_PREV, 0, 7, 0, "wait 1 irq prev %u")       \
+    X(APIO_WAIT_IRQ_HIGH_NEXT, 0, 7, 0, "wait 1 irq next %u")       \
+    X(APIO_WAIT_IRQ_HIGH_REL, 0, 7, 0, "wait 1 irq %u rel")         \
+    X(APIO_WAIT_IRQ_LOW, 0, 7, 0, "wait 0 irq %u")                  \
+    X(APIO_WAIT_IRQ_LOW_PREV, 0, 7, 0, "wait 0 irq prev %u")        \
+    X(APIO_WAIT_IRQ_LOW_NEXT, 0, 7, 0, "wait 0 irq next %u")        \
+    X(APIO_WAIT_IRQ_LOW_REL, 0, 7, 0, "wait 0 irq %u rel")
+
+// Encoders without an argument - MACRO, TEXT
+#define FUZZ_FIXED_ENCODERS(X)                                      \
+    X(APIO_PULL_BLOCK, "pull block")                                \
+    X(APIO_PULL_NOBLOCK, "pull noblock")                            \
+    X(APIO_PULL_IFEMPTY_BLOCK, "pull ifempty block")                \
+    X(APIO_PULL_IFEMPTY_NOBLOCK, "pull ifempty noblock")            \
+    X(APIO_PUSH_BLOCK, "push block")                                \
+    X(APIO_PUSH_NOBLOCK, "push noblock")                            \
+    X(APIO_PUSH_IFFULL_BLOCK, "push iffull block")                  \
+    X(APIO_PUSH_IFFULL_NOBLOCK, "push iffull noblock")              \
+    X(APIO_WAIT_JMP_PIN_HIGH(), "wait 1 jmppin 0")                  \
+    X(APIO_WAIT_JMP_PIN_LOW(), "wait 0 jmppin 0")                   \
+    X(APIO_MOV_PINDIRS_NOT_NULL, "mov pindirs, ~null")              \
+    X(APIO_NOP, "nop")
+
+// MOV encoders - DEST, SRC, DEST_TEXT, SRC_TEXT.  F rather than X, as X is
+// itself a source and destination.  The source operation is fuzzed
+// separately, using APIO_MOV_SRC_INVERT() and APIO_MOV_SRC_REVERSE().
+#define FUZZ_MOV_SRCS(F, DEST, DEST_TEXT)                           \
+    F(DEST, PINS, DEST_TEXT, "pins")                                \
+    F(DEST, X, DEST_TEXT, "x")                                      \
+    F(DEST, Y, DEST_TEXT, "y")                                      \
+    F(DEST, NULL, DEST_TEXT, "null")                                \
+    F(DEST, STATUS, DEST_TEXT, "status")                            \
+    F(DEST, ISR, DEST_TEXT, "isr")                                  \
+    F(DEST, OSR, DEST_TEXT, "osr")
+
+#define FUZZ_MOV_ENCODERS(F)                                        \
+    FUZZ_MOV_SRCS(F, PINS, "pins")                                  \
+    FUZZ_MOV_SRCS(F, X, "x")                                        \
+    FUZZ_MOV_SRCS(F, Y, "y")                                        \
+    FUZZ_MOV_SRCS(F, PINDIRS, "pindirs")                            \
+    FUZZ_MOV_SRCS(F, EXEC, "exec")                                  \
+    FUZZ_MOV_SRCS(F, PC, "pc")                                      \
+    FUZZ_MOV_SRCS(F, ISR, "isr")                                    \
+    FUZZ_MOV_SRCS(F, OSR, "osr")
+
+#define FUZZ_ARG_FN(MACRO, MIN, MAX, JMP, FMT)                      \
+    static uint16_t fuzz_enc_##MACRO(uint32_t arg) { return MACRO(arg); }
+FUZZ_ARG_ENCODERS(FUZZ_ARG_FN)
+
+#define FUZZ_ARG_ENTRY(MACRO, MIN, MAX, JMP, FMT)                   \
+    { #MACRO, fuzz_enc_##MACRO, MIN, MAX, JMP, FMT },
+static const fuzz_encoder_t fuzz_arg_encoders[] = {
+    FUZZ_ARG_ENCODERS(FUZZ_ARG_ENTRY)
+};
+#define FUZZ_NUM_ARG_ENCODERS (sizeof(fuzz_arg_encoders) / sizeof(fuzz_arg_encoders[0]))
+
+typedef struct {
+    const char *name;
+    uint16_t instr;
+    const char *text;
+    int mov;                    // Source operation may be added
+} fuzz_fixed_t;
+
+#define FUZZ_FIXED_ENTRY(MACRO, TEXT)   { #MACRO, MACRO, TEXT, 0 },
+#define FUZZ_MOV_ENTRY(DEST, SRC, DEST_TEXT, SRC_TEXT)              \
+    { "APIO_MOV_" #DEST "_" #SRC, APIO_MOV_##DEST##_##SRC, "mov " DEST_TEXT ", " SRC_TEXT, 1 },
+static const fuzz_fixed_t fuzz_fixed_encoders[] = {
+    FUZZ_FIXED_ENCODERS(FUZZ_FIXED_ENTRY)
+    FUZZ_MOV_ENCODERS(FUZZ_MOV_ENTRY)
+};
+#define FUZZ_NUM_FIXED_ENCODERS (sizeof(fuzz_fixed_encoders) / sizeof(fuzz_fixed_encoders[0]))
+
+// Generates a random instruction through the encoders, along with its
+// expected disassembly relative to START_OFFSET
+static uint16_t fuzz_gen_instr(char *expected, uint8_t start_offset, const char **name) {
+    uint32_t pick = fuzz_range(0, FUZZ_NUM_ARG_ENCODERS + FUZZ_NUM_FIXED_ENCODERS - 1);
+    uint16_t instr;
+    int len;
+
+    if (pick < FUZZ_NUM_ARG_ENCODERS) {
+        const fuzz_encoder_t *enc = &fuzz_arg_encoders[pick];
+        uint32_t min = enc->jmp ? start_offset : enc->min;
+        uint32_t arg = fuzz_range(min, enc->max);
+        instr = enc->encode(arg);
+        len = snprintf(expected, FUZZ_DECODE_LEN, enc->fmt, enc->jmp ? arg - start_offset : arg);
+        *name = enc->name;
+    } else {
+        const fuzz_fixed_t *enc = &fuzz_fixed_encoders[pick - FUZZ_NUM_ARG_ENCODERS];
+        instr = enc->instr;
+        *name = enc->name;
+        if (enc->mov) {
+            // Splice the source operation in before the source
+            const char *src = strrchr(enc->text, ' ') + 1;
+            const char *op = "";
+            switch (fuzz_range(0, 2)) {
+                case 1:
+                    instr = APIO_MOV_SRC_INVERT(instr);
+                    op = "~";
+                    break;
+                case 2:
+                    instr = APIO_MOV_SRC_REVERSE(instr);
+                    op = "::";
+                    break;
+                default:
+                    break;
+            }
+            if (instr == APIO_NOP) {
+                // mov y, y is APIO_NOP, and is disassembled as such
+                len = snprintf(expected, FUZZ_DECODE_LEN, "nop");
+            } else {
+                len = snprintf(expected, FUZZ_DECODE_LEN, "%.*s%s%s",
+                               (int)(src - enc->text), enc->text, op, src);
+            }
+        } else {
+            len = snprintf(expected, FUZZ_DECODE_LEN, "%s", enc->text);
+        }
+    }
+
+    uint32_t delay = fuzz_range(0, 31);
+    if (delay) {
+        instr = APIO_ADD_DELAY(instr, delay);
+        snprintf(expected + len, FUZZ_DECODE_LEN - len, " [%u]", delay);
+    }
+    return instr;
+}
+
+static void fuzz_instructions(uint32_t iters) {
+    char expected[FUZZ_DECODE_LEN];
+    char actual[FUZZ_DECODE_LEN];
+    for (uint32_t ii = 0; ii < iters; ii++) {
+        const char *name;
+        uint8_t start_offset = (uint8_t)fuzz_range(0, 31);
+        uint16_t instr = fuzz_gen_instr(expected, start_offset, &name);
+        fuzz_decode(instr, actual, start_offset);
+        if (strcmp(expected, actual)) {
+            fuzz_fail("%s: 0x%04X start %u decoded as \"%s\", expected \"%s\"",
+                      name, instr, start_offset, actual, expected);
+        }
+    }
+}
+
+//
+// Register encoders
+//
+
+#define FUZZ_CHECK_FIELD(REG, NAME, ACTUAL, EXPECTED)                       \
+    do {                                                                    \
+        if ((uint32_t)(ACTUAL) != (uint32_t)(EXPECTED)) {                   \
+            fuzz_fail("%s 0x%08X: %s is %u, expected %u", REG, reg, NAME,   \
+                      (uint32_t)(ACTUAL), (uint32_t)(EXPECTED));            \
+        }                                                                   \
+    } while (0)
+
+static void fuzz_registers(uint32_t iters) {
+    for (uint32_t ii = 0; ii < iters; ii++) {
+        uint32_t reg;
+
+        // CLKDIV
+        uint32_t div_int = fuzz_range(0, 0xFFFF);
+        uint32_t div_frac = fuzz_range(0, 0xFF);
+        reg = APIO_CLKDIV(div_int, div_frac);
+        FUZZ_CHECK_FIELD("CLKDIV", "INT", APIO_CLKDIV_INT_FROM_REG(reg), div_int);
+        FUZZ_CHECK_FIELD("CLKDIV", "FRAC", APIO_CLKDIV_FRAC_FROM_REG(reg), div_frac);
+
+        // EXECCTRL
+        uint32_t wrap_bottom = fuzz_range(0, 31);
+        uint32_t wrap_top = fuzz_range(0, 31);
+        uint32_t jmp_pin = fuzz_range(0, 31);
+        uint32_t status_sel = fuzz_range(0, 2);
+        uint32_t status_n = fuzz_range(0, 31);
+        reg = APIO_WRAP_BOTTOM_AS_REG(wrap_bottom) |
+              APIO_WRAP_TOP_AS_REG(wrap_top) |
+              APIO_EXECCTRL_JMP_PIN(jmp_pin) |
+              (status_sel << 5) |
+              APIO_STATUS_N(status_n);
+        FUZZ_CHECK_FIELD("EXECCTRL", "WRAP_BOTTOM", APIO_WRAP_BOTTOM_FROM_REG(reg), wrap_bottom);
+        FUZZ_CHECK_FIELD("EXECCTRL", "WRAP_TOP", APIO_WRAP_TOP_FROM_REG(reg), wrap_top);
+        FUZZ_CHECK_FIELD("EXECCTRL", "JMP_PIN", APIO_EXECCTRL_JMP_PIN_FROM_REG(reg), jmp_pin);
+        FUZZ_CHECK_FIELD("EXECCTRL", "STATUS_SEL", APIO_EXECCTRL_STATUS_SEL_FROM_REG(reg), status_sel);
+        FUZZ_CHECK_FIELD("EXECCTRL", "STATUS_N", APIO_EXECCTRL_STATUS_N_FROM_REG(reg), status_n);
+        FUZZ_CHECK_FIELD("EXECCTRL", "SIDE_EN", APIO_EXECCTRL_SIDE_EN_FROM_REG(reg), 0);
+        FUZZ_CHECK_FIELD("EXECCTRL", "OUT_EN_SEL", APIO_EXECCTRL_OUT_EN_SEL_FROM_REG(reg), 0);
+
+        // SHIFTCTRL - thresholds and counts of 32 encode as 0
+        uint32_t in_count = fuzz_range(1, 32);
+        uint32_t push_thresh = fuzz_range(1, 32);
+        uint32_t pull_thresh = fuzz_range(1, 32);
+        uint32_t flags = fuzz_rand() & (APIO_AUTOPUSH | APIO_AUTOPULL |
+                                        APIO_IN_SHIFTDIR_R | APIO_OUT_SHIFTDIR_R);
+        reg = APIO_IN_COUNT(in_count) |
+              APIO_PUSH_THRESH(push_thresh) |
+              APIO_PULL_THRESH(pull_thresh) |
+              flags;
+        FUZZ_CHECK_FIELD("SHIFTCTRL", "IN_COUNT", APIO_THRESH32(APIO_IN_COUNT_FROM_REG(reg)), in_count);
+        FUZZ_CHECK_FIELD("SHIFTCTRL", "PUSH_THRESH", APIO_THRESH32(APIO_PUSH_THRESH_FROM_REG(reg)), push_thresh);
+        FUZZ_CHECK_FIELD("SHIFTCTRL", "PULL_THRESH", APIO_THRESH32(APIO_PULL_THRESH_FROM_REG(reg)), pull_thresh);
+        FUZZ_CHECK_FIELD("SHIFTCTRL", "flags", reg & 0x000F0000, flags);
+        FUZZ_CHECK_FIELD("SHIFTCTRL", "FJOIN_TX", APIO_SHIFTCTRL_FJOIN_TX_FROM_REG(reg), 0);
+        FUZZ_CHECK_FIELD("SHIFTCTRL", "FJOIN_RX", APIO_SHIFTCTRL_FJOIN_RX_FROM_REG(reg), 0);
+
+        // PINCTRL
+        uint32_t out_base = fuzz_range(0, 31);
+        uint32_t set_base = fuzz_range(0, 31);
+        uint32_t side_set_base = fuzz_range(0, 31);
+        uint32_t in_base = fuzz_range(0, 31);
+        uint32_t out_count = fuzz_range(0, 32);
+        uint32_t set_count = fuzz_range(0, 5);
+        uint32_t side_set_count = fuzz_range(0, 5);
+        reg = APIO_OUT_BASE(out_base) |
+              APIO_SET_BASE(set_base) |
+              APIO_SIDE_SET_BASE(side_set_base) |
+              APIO_IN_BASE(in_base) |
+              APIO_OUT_COUNT(out_count) |
+              APIO_SET_COUNT(set_count) |
+              APIO_SIDE_SET_COUNT(side_set_count);
+        FUZZ_CHECK_FIELD("PINCTRL", "OUT_BASE", APIO_OUT_BASE_FROM_REG(reg), out_base);
+        FUZZ_CHECK_FIELD("PINCTRL", "SET_BASE", APIO_SET_BASE_FROM_REG(reg), set_base);
+        FUZZ_CHECK_FIELD("PINCTRL", "SIDE_SET_BASE", APIO_SIDE_SET_BASE_FROM_REG(reg), side_set_base);
+        FUZZ_CHECK_FIELD("PINCTRL", "IN_BASE", APIO_IN_BASE_FROM_REG(reg), in_base);
+        FUZZ_CHECK_FIELD("PINCTRL", "OUT_COUNT", APIO_OUT_COUNT_FROM_REG(reg), out_count);
+        FUZZ_CHECK_FIELD("PINCTRL", "SET_COUNT", APIO_SET_COUNT_FROM_REG(reg), set_count);
+        FUZZ_CHECK_FIELD("PINCTRL", "SIDE_SET_COUNT", APIO_SIDE_SET_COUNT_FROM_REG(reg), side_set_count);
+    }
+}
+
+//
+// Program layouts
+//
+
+// Builds random programs for random SMs across all blocks, then checks the
+// tracked offsets, EXECCTRL's wrap fields, instruction memory and the
+// queued JMP to each program's start
+static void fuzz_layouts(uint32_t iters) {
+    uint16_t expected[APIO_MAX_PIO_INSTRS];
+    char expected_text[FUZZ_DECODE_LEN];
+    char actual_text[FUZZ_DECODE_LEN];
+
+    for (uint32_t ii = 0; ii < iters; ii++) {
+        APIO_ASM_INIT();
+        for (uint8_t blk = 0; blk < APIO_MAX_PIO_BLOCKS; blk++) {
+            APIO_SET_BLOCK_VAR(blk);
+            uint8_t num_sms = (uint8_t)fuzz_range(0, APIO_MAX_SMS_PER_BLOCK);
+            uint8_t first_sm = (uint8_t)fuzz_range(0, APIO_MAX_SMS_PER_BLOCK - num_sms);
+
+            for (uint8_t sm = first_sm; sm < first_sm + num_sms; sm++) {
+                uint8_t first = APIO_INSTR_COUNT();
+                uint8_t space = (uint8_t)(APIO_MAX_PIO_INSTRS - first);
+                if (!space) {
+                    break;
+                }
+                uint8_t len = (uint8_t)fuzz_range(1, space < 12 ? space : 12);
+                uint8_t start = (uint8_t)fuzz_range(0, len - 1);
+                uint8_t wrap_bottom = (uint8_t)fuzz_range(0, len - 1);
+                uint8_t wrap_top = (uint8_t)fuzz_range(wrap_bottom, len - 1);
+                uint32_t execctrl = APIO_EXECCTRL_JMP_PIN(fuzz_range(0, 31)) |
+                                    APIO_STATUS_N(fuzz_range(0, 31));
+
+                APIO_SET_SM_VAR(sm);
+                for (uint8_t jj = 0; jj < len; jj++) {
+                    const char *name;
+                    if (jj == start) {
+                        APIO_START();
+                    }
+                    if (jj == wrap_bottom) {
+                        APIO_WRAP_BOTTOM();
+                    }
+                    if (jj == wrap_top) {
+                        APIO_WRAP_TOP();
+                    }
+                    if ((jj == len - 1) && (wrap_top != len - 1)) {
+                        APIO_END();
+                    }
+                    expected[first + jj] = fuzz_gen_instr(expected_text, first, &name);
+                    APIO_ADD_INSTR(expected[first + jj]);
+                }
+                APIO_SM_EXECCTRL_SET(execctrl);
+                APIO_SM_JMP_TO_START();
+
+                uint32_t reg = _apio_sm_reg_ptr(blk, sm)->execctrl;
+                if ((_apio_emulated_pio.first_instr[blk][sm] != first) ||
+                    (_apio_emulated_pio.start[blk][sm] != first + start) ||
+                    (_apio_emulated_pio.wrap_bottom[blk][sm] != first + wrap_bottom) ||
+                    (_apio_emulated_pio.wrap_top[blk][sm] != first + wrap_top) ||
+                    (_apio_emulated_pio.end[blk][sm] != first + len - 1)) {
+                    fuzz_fail("PIO%u:%u layout first %u start %u wrap %u-%u end %u, "
+                              "expected %u %u %u-%u %u",
+                              blk, sm,
+                              _apio_emulated_pio.first_instr[blk][sm],
+                              _apio_emulated_pio.start[blk][sm],
+                              _apio_emulated_pio.wrap_bottom[blk][sm],
+                              _apio_emulated_pio.wrap_top[blk][sm],
+                              _apio_emulated_pio.end[blk][sm],
+                              first, first + start, first + wrap_bottom,
+                              first + wrap_top, first + len - 1);
+                }
+                if ((APIO_WRAP_BOTTOM_FROM_REG(reg) != first + wrap_bottom) ||
+                    (APIO_WRAP_TOP_FROM_REG(reg) != first + wrap_top) ||
+                    ((reg & ~(APIO_WRAP_BOTTOM_AS_REG(0x1F) | APIO_WRAP_TOP_AS_REG(0x1F))) != execctrl)) {
+                    fuzz_fail("PIO%u:%u EXECCTRL 0x%08X, expected wrap %u-%u and 0x%08X",
+                              blk, sm, reg, first + wrap_bottom, first + wrap_top, execctrl);
+                }
+
+                uint16_t count = _apio_emulated_pio.pre_instr_count[blk][sm];
+                uint16_t jmp = count ? _apio_emulated_pio.pre_instr[blk][sm][count - 1] : 0xFFFF;
+                fuzz_decode(jmp, actual_text, first);
+                snprintf(expected_text, sizeof(expected_text), "jmp %u", start);
+                if (strcmp(actual_text, expected_text)) {
+                    fuzz_fail("PIO%u:%u start JMP 0x%04X decoded as \"%s\", expected \"%s\"",
+                              blk, sm, jmp, actual_text, expected_text);
+                }
+            }
+
+            APIO_END_BLOCK();
+            for (uint8_t jj = 0; jj < APIO_INSTR_COUNT(); jj++) {
+                if (_apio_emulated_pio.instr[blk][jj] != expected[jj]) {
+                    fuzz_fail("PIO%u instruction %u is 0x%04X, expected 0x%04X",
+                              blk, jj, _apio_emulated_pio.instr[blk][jj], expected[jj]);
+                }
+            }
+        }
+    }
+}
+
+//
+// Decoder robustness
+//
+
+// Decodes every instruction word at every start offset, checking the output
+// is printable, terminated within the contract, and that nothing is written
+// beyond it
+static void fuzz_decoder(void) {
+    char buf[FUZZ_DECODE_LEN * 2];
+    for (uint32_t instr = 0; instr <= 0xFFFF; instr++) {
+        for (uint8_t start = 0; start < APIO_MAX_PIO_INSTRS; start++) {
+            memset(buf, FUZZ_CANARY, sizeof(buf));
+            if (start == 0) {
+                // Also through an exactly sized heap buffer, for the sanitizers
+                fuzz_decode((uint16_t)instr, buf, start);
+                memset(buf + FUZZ_DECODE_LEN, FUZZ_CANARY, FUZZ_DECODE_LEN);
+            } else {
+                apio_instruction_decoder((uint16_t)instr, buf, start);
+            }
+
+            size_t len = strnlen(buf, FUZZ_DECODE_LEN);
+            if (len == 0 || len >= FUZZ_DECODE_LEN) {
+                fuzz_fail("0x%04X start %u: output length %zu", instr, start, len);
+                continue;
+            }
+            for (size_t jj = 0; jj < len; jj++) {
+                if ((buf[jj] < 0x20) || (buf[jj] > 0x7E)) {
+                    fuzz_fail("0x%04X start %u: unprintable output byte 0x%02X at %zu",
+                              instr, start, (uint8_t)buf[jj], jj);
+                    break;
+                }
+            }
+            for (size_t jj = FUZZ_DECODE_LEN; jj < sizeof(buf); jj++) {
+                if ((uint8_t)buf[jj] != FUZZ_CANARY) {
+                    fuzz_fail("0x%04X start %u: output overran to byte %zu",
+                              instr, start, jj);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+//
+// Main
+//
+
+static void fuzz_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-n ITERS] [-s SEED]\n", prog);
+    fprintf(stderr, "  -n ITERS  Random samples per stage (default %u)\n", FUZZ_DEFAULT_ITERS);
+    fprintf(stderr, "  -s SEED   PRNG seed, 0 for time based (default %u)\n", FUZZ_DEFAULT_SEED);
+}
+
+int main(int argc, char **argv) {
+    uint32_t iters = FUZZ_DEFAULT_ITERS;
+    fuzz_seed = FUZZ_DEFAULT_SEED;
+
+    for (int ii = 1; ii < argc; ii++) {
+        if (!strcmp(argv[ii], "-n") && (ii + 1 < argc)) {
+            iters = (uint32_t)strtoul(argv[++ii], NULL, 0);
+        } else if (!strcmp(argv[ii], "-s") && (ii + 1 < argc)) {
+            fuzz_seed = strtoull(argv[++ii], NULL, 0);
+        } else {
+            fuzz_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (!fuzz_seed) {
+        fuzz_seed = (uint64_t)time(NULL);
+    }
+    fuzz_state = fuzz_seed;
+
+    static const struct {
+        const char *name;
+        void (*fn)(uint32_t iters);
+        uint32_t divisor;       // Layout builds are far larger than a sample
+    } stages[] = {
+        { "instructions", fuzz_instructions, 1 },
+        { "registers", fuzz_registers, 1 },
+        { "layouts", fuzz_layouts, 100 },
+    };
+    for (size_t ii = 0; ii < sizeof(stages) / sizeof(stages[0]); ii++) {
+        uint32_t before = fuzz_failures;
+        uint32_t count = iters / stages[ii].divisor;
+        if (!count) {
+            count = 1;
+        }
+        stages[ii].fn(count);
+        printf("%-12s %10u samples, %u failures\n", stages[ii].name, count, fuzz_failures - before);
+    }
+
+    uint32_t before = fuzz_failures;
+    fuzz_decoder();
+    printf("%-12s %10u words, %u failures\n", "decoder", 0x10000 * APIO_MAX_PIO_INSTRS, fuzz_failures - before);
+
+    printf("Seed %llu: %s\n", (unsigned long long)fuzz_seed, fuzz_failures ? "FAILED" : "passed");
+    return fuzz_failures ? 1 : 0;
+}
@@ -82,7 +82,12 @@
 //
 // 18. Repeat steps 3 to 17 for each additional PIO block.
 
+#include <stddef.h>
 #include <stdint.h>
+#include <string.h>
+#if defined(APIO_PHASE_TIMING) && defined(APIO_EMULATION) && !defined(APIO_PHASE_TIMESTAMP)
+#include <time.h>
+#endif // APIO_PHASE_TIMING && APIO_EMULATION && !APIO_PHASE_TIMESTAMP
 #include <apio_reg.h>
 
 #define APIO_MAX_PIO_INSTRS      32
@@ -95,8 +100,89 @@
 #define APIO_GPIO_ALL_MASK  ((1ULL << APIO_MAX_GPIOS) - 1)
 
 #if defined(APIO_EMULATION)
-#define MAX_PRE_INSTRS   16
+// Capacity of each SM's emulated exec queue - the instructions queued by
+// APIO_SM_EXEC_INSTR() (including APIO_SM_JMP_TO_START()) for the emulator to
+// execute before the SM starts.  Define before including apio.h to override.
+// Instructions beyond this are dropped and counted in pre_instr_overflow.
+#if !defined(APIO_EMU_MAX_PRE_INSTRS)
+#define APIO_EMU_MAX_PRE_INSTRS  64
+#endif // !APIO_EMU_MAX_PRE_INSTRS
+_Static_assert((APIO_EMU_MAX_PRE_INSTRS > 0) && (APIO_EMU_MAX_PRE_INSTRS <= 0xFFFF), "APIO_EMU_MAX_PRE_INSTRS must be 1-65535");
+
+// Retain MAX_PRE_INSTRS for backwards compatibility
+#define MAX_PRE_INSTRS   APIO_EMU_MAX_PRE_INSTRS
+
+// Define APIO_EMU_PRE_INSTR_TIMESTAMPS to record a timestamp alongside each
+// queued exec instruction in pre_instr_time.  The timestamp is taken from
+// APIO_EMU_TIMESTAMP(), which may be defined to return the host simulation's
+// notion of time (e.g. the emulator's cycle count).  If not defined, a
+// sequence number is used, which preserves the order of injection across
+// SMs and blocks.
+#if defined(APIO_EMU_PRE_INSTR_TIMESTAMPS) && !defined(APIO_EMU_TIMESTAMP)
+#define APIO_EMU_TIMESTAMP()    (_apio_emulated_pio.pre_instr_seq++)
+#endif // APIO_EMU_PRE_INSTR_TIMESTAMPS && !APIO_EMU_TIMESTAMP
+
+// The emulated PIO state starts with a header describing its layout, so an
+// emulator can map the state and use it in place, without copying, whether
+// or not it was built with the same options as the apio code.  The header is
+// at offset 0, and is itself fixed for a given APIO_EMU_LAYOUT_VERSION.
+// The version is bumped on any incompatible change to the header, or to the
+// meaning of any field.
+#define APIO_EMU_LAYOUT_MAGIC       0x4F495041  // "APIO", little endian
+#define APIO_EMU_LAYOUT_VERSION     3
+
+// Set in the layout header's flags when pre_instr_time and pre_instr_seq are
+// present
+#define APIO_EMU_LAYOUT_FLAG_TIMESTAMPS 0x01
+
+// Indexes into the layout header's offset array
+#define APIO_EMU_FIELD_IRQ                  0
+#define APIO_EMU_FIELD_FIRST_INSTR          1
+#define APIO_EMU_FIELD_START                2
+#define APIO_EMU_FIELD_END                  3
+#define APIO_EMU_FIELD_WRAP_BOTTOM          4
+#define APIO_EMU_FIELD_WRAP_TOP             5
+#define APIO_EMU_FIELD_PIO_SM_REG           6
+#define APIO_EMU_FIELD_INSTR                7
+#define APIO_EMU_FIELD_PRE_INSTR            8
+#define APIO_EMU_FIELD_PRE_INSTR_COUNT      9
+#define APIO_EMU_FIELD_PRE_INSTR_OVERFLOW   10
+#define APIO_EMU_FIELD_PRE_INSTR_TIME       11  // 0 if not present
+#define APIO_EMU_FIELD_TX_FIFOS             12
+#define APIO_EMU_FIELD_TX_FIFO_COUNT        13
+#define APIO_EMU_FIELD_RX_FIFOS             14
+#define APIO_EMU_FIELD_RX_FIFO_COUNT        15
+#define APIO_EMU_FIELD_OFFSET               16
+#define APIO_EMU_FIELD_MAX_OFFSET           17
+#define APIO_EMU_FIELD_ENABLED_SMS          18
+#define APIO_EMU_FIELD_BLOCK_ENDED          19
+#define APIO_EMU_FIELD_PIOS_ENABLED         20
+#define APIO_EMU_FIELD_GPIO_BASE            21
+#define APIO_EMU_FIELD_FDEBUG               22
+#define APIO_EMU_FIELD_FLEVEL               23
+#define APIO_EMU_FIELD_NUM                  24
+
+// Bitmask of all PIO blocks, for dirty_blocks
+#define APIO_EMU_ALL_BLOCKS     ((1 << APIO_MAX_PIO_BLOCKS) - 1)
+
+typedef struct {
+    uint32_t magic;             // APIO_EMU_LAYOUT_MAGIC
+    uint16_t version;           // APIO_EMU_LAYOUT_VERSION
+    uint16_t header_size;       // sizeof(apio_emu_layout_t)
+    uint32_t size;              // sizeof(_apio_emulated_pio_t)
+    uint16_t max_pre_instrs;    // APIO_EMU_MAX_PRE_INSTRS
+    uint8_t flags;              // APIO_EMU_LAYOUT_FLAG_*
+    // Bit N is set when PIO block N may have changed since the last
+    // apio_emu_handoff().  Does not cover the emulated GPIO state.
+    uint8_t dirty_blocks;
+    // Incremented by each apio_emu_handoff()
+    uint32_t generation;
+    // Byte offset of each APIO_EMU_FIELD_* from the start of the state
+    uint32_t offset[APIO_EMU_FIELD_NUM];
+} apio_emu_layout_t;
+
 typedef struct {
+    apio_emu_layout_t layout;
     uint32_t irq[APIO_MAX_PIO_BLOCKS];
     uint8_t first_instr[APIO_MAX_PIO_BLOCKS][APIO_MAX_SMS_PER_BLOCK];
     uint8_t start[APIO_MAX_PIO_BLOCKS][APIO_MAX_SMS_PER_BLOCK];
@@ -105,8 +191,14 @@ typedef struct {
     uint8_t wrap_top[APIO_MAX_PIO_BLOCKS][APIO_MAX_SMS_PER_BLOCK];
     pio_sm_reg_t pio_sm_reg[APIO_MAX_PIO_BLOCKS][APIO_MAX_SMS_PER_BLOCK];
     uint16_t instr[APIO_MAX_PIO_BLOCKS][APIO_MAX_PIO_INSTRS];
-    uint16_t pre_instr[APIO_MAX_PIO_BLOCKS][APIO_MAX_SMS_PER_BLOCK][MAX_PRE_INSTRS];
-    uint8_t pre_instr_count[APIO_MAX_PIO_BLOCKS][APIO_MAX_SMS_PER_BLOCK];
+    uint16_t pre_instr[APIO_MAX_PIO_BLOCKS][APIO_MAX_SMS_PER_BLOCK][APIO_EMU_MAX_PRE_INSTRS];
+    uint16_t pre_instr_count[APIO_MAX_PIO_BLOCKS][APIO_MAX_SMS_PER_BLOCK];
+    // Number of exec instructions dropped because the queue was full
+    uint16_t pre_instr_overflow[APIO_MAX_PIO_BLOCKS][APIO_MAX_SMS_PER_BLOCK];
+#if defined(APIO_EMU_PRE_INSTR_TIMESTAMPS)
+    uint64_t pre_instr_time[APIO_MAX_PIO_BLOCKS][APIO_MAX_SMS_PER_BLOCK][APIO_EMU_MAX_PRE_INSTRS];
+    uint64_t pre_instr_seq;
+#endif // APIO_EMU_PRE_INSTR_TIMESTAMPS
     uint32_t tx_fifos[APIO_MAX_PIO_BLOCKS][APIO_MAX_SMS_PER_BLOCK][APIO_MAX_FIFO_DEPTH];
     uint8_t tx_fifo_count[APIO_MAX_PIO_BLOCKS][APIO_MAX_SMS_PER_BLOCK];
     uint32_t rx_fifos[APIO_MAX_PIO_BLOCKS][APIO_MAX_SMS_PER_BLOCK][APIO_MAX_FIFO_DEPTH];
@@ -119,6 +211,10 @@ typedef struct {
     uint8_t block_ended[APIO_MAX_PIO_BLOCKS];
     uint8_t pios_enabled;
     uint32_t gpio_base[APIO_MAX_PIO_BLOCKS];
+    // FDEBUG flags, APIO_FDEBUG_*, set by the emulated FIFOs
+    uint32_t fdebug[APIO_MAX_PIO_BLOCKS];
+    // FLEVEL, the emulator's current FIFO levels
+    uint32_t flevel[APIO_MAX_PIO_BLOCKS];
 } _apio_emulated_pio_t;
 
 typedef struct {
@@ -140,6 +236,158 @@ typedef struct {
 
 extern _apio_emulated_pio_t _apio_emulated_pio;
 extern _apio_emulated_gpio_t _apio_emulated_gpios;
+
+_Static_assert(offsetof(_apio_emulated_pio_t, layout) == 0, "Layout header must be at offset 0");
+_Static_assert(sizeof(apio_emu_layout_t) == 20 + (4 * APIO_EMU_FIELD_NUM), "Layout header must not contain padding");
+
+#if defined(APIO_EMU_PRE_INSTR_TIMESTAMPS)
+#define _APIO_EMU_LAYOUT_FLAGS          APIO_EMU_LAYOUT_FLAG_TIMESTAMPS
+#define _APIO_EMU_OFFSET_PRE_INSTR_TIME offsetof(_apio_emulated_pio_t, pre_instr_time)
+#else // !APIO_EMU_PRE_INSTR_TIMESTAMPS
+#define _APIO_EMU_LAYOUT_FLAGS          0
+#define _APIO_EMU_OFFSET_PRE_INSTR_TIME 0
+#endif // APIO_EMU_PRE_INSTR_TIMESTAMPS
+
+// Internal macro - do not use directly.  Initializer for the layout header.
+#define _APIO_EMU_LAYOUT_INIT {                                                                 \
+    .magic = APIO_EMU_LAYOUT_MAGIC,                                                             \
+    .version = APIO_EMU_LAYOUT_VERSION,                                                         \
+    .header_size = sizeof(apio_emu_layout_t),                                                   \
+    .size = sizeof(_apio_emulated_pio_t),                                                       \
+    .max_pre_instrs = APIO_EMU_MAX_PRE_INSTRS,                                                  \
+    .flags = _APIO_EMU_LAYOUT_FLAGS,                                                            \
+    .dirty_blocks = APIO_EMU_ALL_BLOCKS,                                                        \
+    .generation = 0,                                                                            \
+    .offset = {                                                                                 \
+        [APIO_EMU_FIELD_IRQ] = offsetof(_apio_emulated_pio_t, irq),                             \
+        [APIO_EMU_FIELD_FIRST_INSTR] = offsetof(_apio_emulated_pio_t, first_instr),             \
+        [APIO_EMU_FIELD_START] = offsetof(_apio_emulated_pio_t, start),                         \
+        [APIO_EMU_FIELD_END] = offsetof(_apio_emulated_pio_t, end),                             \
+        [APIO_EMU_FIELD_WRAP_BOTTOM] = offsetof(_apio_emulated_pio_t, wrap_bottom),             \
+        [APIO_EMU_FIELD_WRAP_TOP] = offsetof(_apio_emulated_pio_t, wrap_top),                   \
+        [APIO_EMU_FIELD_PIO_SM_REG] = offsetof(_apio_emulated_pio_t, pio_sm_reg),               \
+        [APIO_EMU_FIELD_INSTR] = offsetof(_apio_emulated_pio_t, instr),                         \
+        [APIO_EMU_FIELD_PRE_INSTR] = offsetof(_apio_emulated_pio_t, pre_instr),                 \
+        [APIO_EMU_FIELD_PRE_INSTR_COUNT] = offsetof(_apio_emulated_pio_t, pre_instr_count),     \
+        [APIO_EMU_FIELD_PRE_INSTR_OVERFLOW] = offsetof(_apio_emulated_pio_t, pre_instr_overflow), \
+        [APIO_EMU_FIELD_PRE_INSTR_TIME] = _APIO_EMU_OFFSET_PRE_INSTR_TIME,                      \
+        [APIO_EMU_FIELD_TX_FIFOS] = offsetof(_apio_emulated_pio_t, tx_fifos),                   \
+        [APIO_EMU_FIELD_TX_FIFO_COUNT] = offsetof(_apio_emulated_pio_t, tx_fifo_count),         \
+        [APIO_EMU_FIELD_RX_FIFOS] = offsetof(_apio_emulated_pio_t, rx_fifos),                   \
+        [APIO_EMU_FIELD_RX_FIFO_COUNT] = offsetof(_apio_emulated_pio_t, rx_fifo_count),         \
+        [APIO_EMU_FIELD_OFFSET] = offsetof(_apio_emulated_pio_t, offset),                       \
+        [APIO_EMU_FIELD_MAX_OFFSET] = offsetof(_apio_emulated_pio_t, max_offset),               \
+        [APIO_EMU_FIELD_ENABLED_SMS] = offsetof(_apio_emulated_pio_t, enabled_sms),             \
+        [APIO_EMU_FIELD_BLOCK_ENDED] = offsetof(_apio_emulated_pio_t, block_ended),             \
+        [APIO_EMU_FIELD_PIOS_ENABLED] = offsetof(_apio_emulated_pio_t, pios_enabled),           \
+        [APIO_EMU_FIELD_GPIO_BASE] = offsetof(_apio_emulated_pio_t, gpio_base),                 \
+        [APIO_EMU_FIELD_FDEBUG] = offsetof(_apio_emulated_pio_t, fdebug),                       \
+        [APIO_EMU_FIELD_FLEVEL] = offsetof(_apio_emulated_pio_t, flevel),                       \
+    },                                                                                          \
+}
+
+// Internal macro - do not use directly.  Marks a PIO block as changed since
+// the last handoff.
+#define _APIO_EMU_DIRTY(BLOCK)  (_apio_emulated_pio.layout.dirty_blocks |= (uint8_t)(1u << (BLOCK)))
+
+// Internal macro - do not use directly.  Evaluates EXPR, a write to the
+// current block's emulated state, marking the block dirty.  Its value is
+// EXPR's.
+#define _APIO_EMU_WRITE(EXPR)   (_APIO_EMU_DIRTY(__blk), (EXPR))
+
+// Internal function - do not use directly.  Resets the emulated PIO state for
+// APIO_ASM_INIT(), preserving pios_enabled, the handoff generation and, if
+// present, the exec timestamp sequence, so timestamps remain monotonic across
+// rebuilds.  All blocks are marked dirty.
+static inline void _apio_emu_asm_init(void) {
+    uint8_t pios_enabled = _apio_emulated_pio.pios_enabled;
+    uint32_t generation = _apio_emulated_pio.layout.generation;
+#if defined(APIO_EMU_PRE_INSTR_TIMESTAMPS)
+    uint64_t pre_instr_seq = _apio_emulated_pio.pre_instr_seq;
+#endif // APIO_EMU_PRE_INSTR_TIMESTAMPS
+    _apio_emulated_pio = (_apio_emulated_pio_t){ .layout = _APIO_EMU_LAYOUT_INIT };
+    _apio_emulated_pio.pios_enabled = pios_enabled;
+    _apio_emulated_pio.layout.generation = generation;
+#if defined(APIO_EMU_PRE_INSTR_TIMESTAMPS)
+    _apio_emulated_pio.pre_instr_seq = pre_instr_seq;
+#endif // APIO_EMU_PRE_INSTR_TIMESTAMPS
+}
+
+// Internal function - do not use directly.  Resets a single block of the
+// emulated PIO state for APIO_RESET_BLOCK(), leaving the other blocks
+// untouched.
+static inline void _apio_emu_reset_block(uint8_t block) {
+    _apio_emulated_pio_t *pio = &_apio_emulated_pio;
+    pio->irq[block] = 0;
+    memset(pio->first_instr[block], 0, sizeof(pio->first_instr[block]));
+    memset(pio->start[block], 0, sizeof(pio->start[block]));
+    memset(pio->end[block], 0, sizeof(pio->end[block]));
+    memset(pio->wrap_bottom[block], 0, sizeof(pio->wrap_bottom[block]));
+    memset(pio->wrap_top[block], 0, sizeof(pio->wrap_top[block]));
+    memset(pio->pio_sm_reg[block], 0, sizeof(pio->pio_sm_reg[block]));
+    memset(pio->instr[block], 0, sizeof(pio->instr[block]));
+    memset(pio->pre_instr[block], 0, sizeof(pio->pre_instr[block]));
+    memset(pio->pre_instr_count[block], 0, sizeof(pio->pre_instr_count[block]));
+    memset(pio->pre_instr_overflow[block], 0, sizeof(pio->pre_instr_overflow[block]));
+#if defined(APIO_EMU_PRE_INSTR_TIMESTAMPS)
+    memset(pio->pre_instr_time[block], 0, sizeof(pio->pre_instr_time[block]));
+#endif // APIO_EMU_PRE_INSTR_TIMESTAMPS
+    memset(pio->tx_fifos[block], 0, sizeof(pio->tx_fifos[block]));
+    memset(pio->tx_fifo_count[block], 0, sizeof(pio->tx_fifo_count[block]));
+    memset(pio->rx_fifos[block], 0, sizeof(pio->rx_fifos[block]));
+    memset(pio->rx_fifo_count[block], 0, sizeof(pio->rx_fifo_count[block]));
+    pio->offset[block] = 0;
+    pio->max_offset[block] = 0;
+    pio->enabled_sms[block] = 0;
+    pio->block_ended[block] = 0;
+    pio->gpio_base[block] = 0;
+    pio->fdebug[block] = 0;
+    pio->flevel[block] = 0;
+    _APIO_EMU_DIRTY(block);
+}
+
+// Internal functions - do not use directly.  The emulated GPIO state changes
+// made by APIO_GPIO_INIT(), APIO_GPIO_INPUT_OUTPUT() and
+// APIO_GPIO_INPUT_ONLY(), shared with operation log replay so the two apply
+// exactly the same changes.
+static inline void _apio_emu_gpio_init(void) {
+    for (int ii = 0; ii < APIO_MAX_GPIOS; ii++) {
+        _apio_emulated_gpios.output_block[ii] = -1;
+        _apio_emulated_gpios.inverted[ii] = 0;
+        _apio_emulated_gpios.force_input_low[ii] = 0;
+        _apio_emulated_gpios.force_input_high[ii] = 0;
+        _apio_emulated_gpios.drive_strength[ii] = APIO_DRIVE_4MA;
+    }
+    _apio_emulated_gpios.pull_up = 0;
+    _apio_emulated_gpios.pull_down = APIO_GPIO_ALL_MASK;
+    _apio_emulated_gpios.input_only = 0;
+    _apio_emulated_gpios.slew_fast = 0;
+}
+static inline void _apio_emu_gpio_input_output(uint8_t pin, uint8_t block) {
+    _apio_emulated_gpios.output_block[pin] = (int8_t)block;
+    _apio_emulated_gpios.input_only &= ~(1ULL << pin);
+}
+static inline void _apio_emu_gpio_input_only(uint8_t pin) {
+    _apio_emulated_gpios.output_block[pin] = -1;
+    _apio_emulated_gpios.input_only |= (1ULL << pin);
+}
+
+// Hand the emulated PIO state off to an emulator.  Returns a bitmask of the
+// PIO blocks that may have changed since the previous handoff, which the
+// emulator needs to re-read, and clears it.  The state itself can be used in
+// place, at apio_emu_state(), with field offsets taken from its layout
+// header.
+static inline uint8_t apio_emu_handoff(void) {
+    uint8_t dirty = _apio_emulated_pio.layout.dirty_blocks;
+    _apio_emulated_pio.layout.dirty_blocks = 0;
+    _apio_emulated_pio.layout.generation++;
+    return dirty;
+}
+
+// Returns the emulated PIO state, starting with its layout header
+static inline const apio_emu_layout_t *apio_emu_state(void) {
+    return &_apio_emulated_pio.layout;
+}
 #define __blk  _apio_emulated_pio.block
 #define __sm   _apio_emulated_pio.sm
 #define __pio_start   _apio_emulated_pio.start
@@ -162,6 +410,7 @@ extern _apio_emulated_gpio_t _apio_emulated_gpios;
 #define APIO2_GPIOBASE _apio_emulated_pio.gpio_base[2]
 #if defined(APIO_EMU_IMPL)
 _apio_emulated_pio_t _apio_emulated_pio = {
+    .layout = _APIO_EMU_LAYOUT_INIT,
     .irq = {0xFFFFFFFF},
     .first_instr = {{0xFF}},
     .start = {{0xFF}},
@@ -176,7 +425,8 @@ _apio_emulated_pio_t _apio_emulated_pio = {
     }}},
     .instr = {{0xFFFF}},
     .pre_instr = {{{0xFFFF}}},
-    .pre_instr_count = {{0xFF}},
+    .pre_instr_count = {{0xFFFF}},
+    .pre_instr_overflow = {{0xFFFF}},
     .tx_fifos = {{{0xFFFFFFFF}}},
     .tx_fifo_count = {{0xFF}},
     .rx_fifos = {{{0xFFFFFFFF}}},
@@ -219,6 +469,242 @@ _apio_emulated_gpio_t _apio_emulated_gpios = {
 // Internal macro - do not use directly
 #define _OFFSET_ARRAY_INIT       {{0, 0, 0, 0}, {0, 0, 0, 0}, {0, 0, 0, 0}}
 
+#if !defined(APIO_EMULATION)
+// Internal macro - do not use directly.  No handoff tracking on hardware.
+#define _APIO_EMU_DIRTY(BLOCK)  ((void)0)
+#define _APIO_EMU_WRITE(EXPR)   (EXPR)
+#endif // !APIO_EMULATION
+
+//
+// Operation log
+//
+
+// Define APIO_OPLOG to record every apio configuration operation - program
+// construction, SM register sets, exec'd instructions, TX FIFO writes via
+// APIO_TXF_PUT(), GPIO settings and SM enables - as a stream of compact
+// binary records.  This works on hardware and in emulation, so a
+// configuration built in the field can be captured (e.g. over RTT) and
+// rebuilt on a host using apio_oplog_replay() from apio_oplog.h.
+//
+// APIO_OPLOG_WRITE(DATA, LEN) must also be defined, to write each record,
+// e.g.:
+//
+//   #define APIO_OPLOG_WRITE(DATA, LEN)  fwrite(DATA, 1, LEN, oplog_file)
+//
+// Writes made by assigning to APIO_TXF directly are not recorded.
+//
+// When APIO_OPLOG is not defined, recording compiles to nothing.
+
+// Each record is APIO_OPLOG_RECORD_SIZE bytes:
+//   [0]    Operation, APIO_OPLOG_OP_*
+//   [1]    Block (bits 7:4) and SM (bits 3:0) selected when recorded.  Block
+//          is 0xF for GPIO operations.
+//   [2]    Argument - the GPIO number for GPIO operations, otherwise 0
+//   [3]    Reserved, 0
+//   [4-7]  Value, little endian
+#define APIO_OPLOG_RECORD_SIZE          8
+
+// The APIO_OPLOG_OP_INIT record's value identifies the format and version
+#define APIO_OPLOG_VERSION              1
+#define APIO_OPLOG_MAGIC                (0x41504C00 | APIO_OPLOG_VERSION)
+
+#define APIO_OPLOG_OP_INIT              0x01    // APIO_ASM_INIT()
+#define APIO_OPLOG_OP_CONTINUE          0x02    // APIO_ASM_CONTINUE()
+#define APIO_OPLOG_OP_ENABLE_PIOS       0x03
+#define APIO_OPLOG_OP_CLEAR_IRQ         0x04    // Value is the block
+#define APIO_OPLOG_OP_CLEAR_ALL_IRQS    0x05
+#define APIO_OPLOG_OP_SET_BLOCK         0x10
+#define APIO_OPLOG_OP_SET_BLOCK_FROM    0x11    // Value is the offset
+#define APIO_OPLOG_OP_SET_SM            0x12
+#define APIO_OPLOG_OP_START             0x13    // Value is the offset
+#define APIO_OPLOG_OP_END               0x14    // Value is the offset
+#define APIO_OPLOG_OP_WRAP_BOTTOM       0x15    // Value is the offset
+#define APIO_OPLOG_OP_WRAP_TOP          0x16    // Value is the offset
+#define APIO_OPLOG_OP_ADD_INSTR         0x17    // Value is the instruction
+#define APIO_OPLOG_OP_END_BLOCK_FROM    0x18    // Value is the from offset
+#define APIO_OPLOG_OP_RESET_BLOCK       0x19    // Value is the block
+#define APIO_OPLOG_OP_CLKDIV            0x20    // Value is the register
+#define APIO_OPLOG_OP_EXECCTRL          0x21    // Value is the register
+#define APIO_OPLOG_OP_SHIFTCTRL         0x22    // Value is the register
+#define APIO_OPLOG_OP_PINCTRL           0x23    // Value is the register
+#define APIO_OPLOG_OP_EXEC_INSTR        0x24    // Value is the instruction
+#define APIO_OPLOG_OP_TXF               0x25    // Value is the word
+#define APIO_OPLOG_OP_ENABLE_SMS        0x30    // Value is the block << 8 | SM mask
+#define APIO_OPLOG_OP_ENABLE_SM         0x31    // Value is the block << 8 | SM mask
+#define APIO_OPLOG_OP_GPIOBASE          0x32    // Value is the register
+#define APIO_OPLOG_OP_GPIO_INIT         0x40
+#define APIO_OPLOG_OP_GPIO_INPUT_OUTPUT 0x41    // Value is the block
+#define APIO_OPLOG_OP_GPIO_INPUT_ONLY   0x42
+#define APIO_OPLOG_OP_GPIO_PULL_UP      0x43
+#define APIO_OPLOG_OP_GPIO_PULL_DOWN    0x44
+#define APIO_OPLOG_OP_GPIO_PULL_NONE    0x45
+#define APIO_OPLOG_OP_GPIO_DRIVE        0x46    // Value is the strength
+#define APIO_OPLOG_OP_GPIO_SLEW_FAST    0x47
+#define APIO_OPLOG_OP_GPIO_SLEW_SLOW    0x48
+#define APIO_OPLOG_OP_GPIO_INPUT_INVERT 0x49
+#define APIO_OPLOG_OP_GPIO_FORCE_LOW    0x4A
+#define APIO_OPLOG_OP_GPIO_FORCE_HIGH   0x4B
+
+// Block/SM byte used for GPIO operations
+#define APIO_OPLOG_NO_BLOCK             0xF
+
+#if defined(APIO_OPLOG)
+#if !defined(APIO_OPLOG_WRITE)
+#error "APIO_OPLOG_WRITE(DATA, LEN) must be defined when APIO_OPLOG is defined"
+#endif // !APIO_OPLOG_WRITE
+
+// Internal function - do not use directly
+static inline void _apio_oplog_record(uint8_t op, uint8_t block, uint8_t sm, uint8_t arg, uint32_t value) {
+    uint8_t rec[APIO_OPLOG_RECORD_SIZE] = {
+        op,
+        (uint8_t)((block << 4) | (sm & 0xF)),
+        arg,
+        0,
+        (uint8_t)(value),
+        (uint8_t)(value >> 8),
+        (uint8_t)(value >> 16),
+        (uint8_t)(value >> 24),
+    };
+    APIO_OPLOG_WRITE(rec, sizeof(rec));
+}
+
+// Internal macros - do not use directly.  OP is an APIO_OPLOG_OP_* value.
+// _APIO_OPLOG_VAL() evaluates EXPR exactly once, recording its value.
+#define _APIO_OPLOG(OP, VALUE)          _apio_oplog_record(OP, __blk, __sm, 0, (uint32_t)(VALUE))
+#define _APIO_OPLOG_VAL(OP, EXPR)       _apio_oplog_record(OP, __blk, __sm, 0, (uint32_t)(EXPR))
+#define _APIO_OPLOG_GPIO(OP, PIN, VALUE) _apio_oplog_record(OP, APIO_OPLOG_NO_BLOCK, 0, (uint8_t)(PIN), (uint32_t)(VALUE))
+#define _APIO_OPLOG_GLOBAL(OP, VALUE)   _apio_oplog_record(OP, APIO_OPLOG_NO_BLOCK, 0, 0, (uint32_t)(VALUE))
+#else // !APIO_OPLOG
+#define _APIO_OPLOG(OP, VALUE)          ((void)0)
+#define _APIO_OPLOG_VAL(OP, EXPR)       (EXPR)
+#define _APIO_OPLOG_GPIO(OP, PIN, VALUE) ((void)0)
+#define _APIO_OPLOG_GLOBAL(OP, VALUE)   ((void)0)
+#endif // APIO_OPLOG
+
+//
+// Phase timing
+//
+
+// Define APIO_PHASE_TIMING to time each phase of the configuration sequence,
+// to see where a boot-time budget goes.  Every apio macro in a phase is
+// timestamped on entry and exit, and the elapsed ticks and number of calls
+// accumulated per PIO block and per phase in apio_phase.  Operations not
+// specific to a block - GPIO setup, APIO_ASM_INIT(), APIO_ENABLE_PIOS() and
+// APIO_CLEAR_ALL_IRQS() - are accumulated in the APIO_PHASE_GLOBAL row.
+//
+// Define APIO_PHASE_IMPL 1 in one C file to define apio_phase.  Call
+// APIO_PHASE_RESET() before the sequence being timed - on hardware this also
+// starts the DWT cycle counter - and APIO_LOG_PHASES() afterwards to log the
+// totals via APIO_LOG.
+//
+// Ticks come from APIO_PHASE_TIMESTAMP(), which may be defined to return a
+// uint32_t from another source.  By default it is the DWT cycle counter on
+// hardware, so ticks are system clock cycles, and the host's monotonic clock
+// in nanoseconds in emulation.  Timings include any operation log recording.
+//
+// When APIO_PHASE_TIMING is not defined, the hooks compile to nothing.
+
+// Phases
+#define APIO_PHASE_GPIO         0   // GPIO reset and configuration
+#define APIO_PHASE_ASM_INIT     1   // APIO_ASM_INIT(), PIO reset, IRQ clears
+#define APIO_PHASE_INSTR        2   // APIO_SET_SM() and APIO_ADD_INSTR()
+#define APIO_PHASE_SM_CONFIG    3   // SM registers, exec'd instructions, GPIOBASE
+#define APIO_PHASE_END_BLOCK    4   // APIO_END_BLOCK()
+#define APIO_PHASE_ENABLE       5   // APIO_ENABLE_SMS() and APIO_ENABLE_SM()
+#define APIO_PHASE_NUM          6
+
+// Rows of apio_phase - one per PIO block, and one for global operations
+#define APIO_PHASE_GLOBAL       APIO_MAX_PIO_BLOCKS
+#define APIO_PHASE_BLOCKS       (APIO_MAX_PIO_BLOCKS + 1)
+
+typedef struct {
+    uint32_t start;     // Timestamp of the current macro's entry
+    uint32_t ticks[APIO_PHASE_BLOCKS][APIO_PHASE_NUM];
+    uint32_t count[APIO_PHASE_BLOCKS][APIO_PHASE_NUM];
+} apio_phase_t;
+
+#if defined(APIO_PHASE_TIMING)
+#if !defined(APIO_PHASE_TIMESTAMP)
+#if !defined(APIO_EMULATION)
+#define APIO_PHASE_TIMESTAMP()  APIO_DWT_CYCCNT
+#else // APIO_EMULATION
+// Internal function - do not use directly
+static inline uint32_t _apio_phase_timestamp(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec);
+}
+#define APIO_PHASE_TIMESTAMP()  _apio_phase_timestamp()
+#endif // !APIO_EMULATION
+#endif // !APIO_PHASE_TIMESTAMP
+
+extern apio_phase_t apio_phase;
+#if defined(APIO_PHASE_IMPL)
+apio_phase_t apio_phase;
+#endif // APIO_PHASE_IMPL
+
+// Zero the accumulated totals.  On hardware, also starts the DWT cycle
+// counter, if not already running.
+#if !defined(APIO_EMULATION)
+#define APIO_PHASE_RESET()  do { \
+                                APIO_DEMCR |= APIO_DEMCR_TRCENA; \
+                                APIO_DWT_CTRL |= APIO_DWT_CTRL_CYCCNTENA; \
+                                memset(&apio_phase, 0, sizeof(apio_phase)); \
+                            } while(0)
+#else // APIO_EMULATION
+#define APIO_PHASE_RESET()  memset(&apio_phase, 0, sizeof(apio_phase))
+#endif // !APIO_EMULATION
+
+// Internal function - do not use directly.  Charges the ticks since the
+// current macro's entry to BLOCK and PHASE.
+static inline void _apio_phase_end(uint8_t block, uint8_t phase) {
+    apio_phase.ticks[block][phase] += APIO_PHASE_TIMESTAMP() - apio_phase.start;
+    apio_phase.count[block][phase]++;
+}
+
+// Internal macros - do not use directly.  _APIO_PHASE_EXPR() evaluates EXPR
+// exactly once, between the two timestamps.  As with _APIO_OPLOG_VAL(), the
+// result is only EXPR's value when disabled.
+#define _APIO_PHASE_BEGIN()                 ((void)(apio_phase.start = APIO_PHASE_TIMESTAMP()))
+#define _APIO_PHASE_END(BLOCK, PHASE)       _apio_phase_end(BLOCK, PHASE)
+#define _APIO_PHASE_EXPR(BLOCK, PHASE, EXPR) (_APIO_PHASE_BEGIN(), (void)(EXPR), _APIO_PHASE_END(BLOCK, PHASE))
+
+#if defined(APIO_LOG_ENABLE)
+// Internal function - do not use directly
+static inline void _apio_log_phases(void) {
+    static const char *phases[APIO_PHASE_NUM] = {
+        "gpio", "asm_init", "instr", "sm_config", "end_block", "enable"
+    };
+    (void)phases;
+    for (int ii = 0; ii < APIO_PHASE_BLOCKS; ii++) {
+        for (int jj = 0; jj < APIO_PHASE_NUM; jj++) {
+            if (apio_phase.count[ii][jj] == 0) {
+                continue;
+            }
+            if (ii == APIO_PHASE_GLOBAL) {
+                APIO_LOG("Phase global %s: %u ticks, %u calls", phases[jj],
+                    (unsigned)apio_phase.ticks[ii][jj], (unsigned)apio_phase.count[ii][jj]);
+            } else {
+                APIO_LOG("Phase PIO%d %s: %u ticks, %u calls", ii, phases[jj],
+                    (unsigned)apio_phase.ticks[ii][jj], (unsigned)apio_phase.count[ii][jj]);
+            }
+        }
+    }
+}
+
+// Log the non-zero phase totals
+#define APIO_LOG_PHASES()   _apio_log_phases()
+#else // !APIO_LOG_ENABLE
+#define APIO_LOG_PHASES()   do {} while(0)
+#endif // APIO_LOG_ENABLE
+#else // !APIO_PHASE_TIMING
+#define APIO_PHASE_RESET()                  do {} while(0)
+#define APIO_LOG_PHASES()                   do {} while(0)
+#define _APIO_PHASE_BEGIN()                 ((void)0)
+#define _APIO_PHASE_END(BLOCK, PHASE)       ((void)0)
+#define _APIO_PHASE_EXPR(BLOCK, PHASE, EXPR) (EXPR)
+#endif // APIO_PHASE_TIMING
+
 // Macro to bring JTAG/SWD out of reset, for SWD logging
 #if !defined(APIO_EMULATION)
 #define APIO_ENABLE_JTAG() do { \
@@ -232,8 +718,10 @@ _apio_emulated_gpio_t _apio_emulated_gpios = {
 // Macro to bring IOBANK0 and PADS_BANK0 out of reset, allowing GPIO usage.
 #if !defined(APIO_EMULATION)
 #define APIO_ENABLE_GPIOS() do { \
+                                _APIO_PHASE_BEGIN(); \
                                 APIO_RESET_RESET &= ~(APIO_RESET_IOBANK0 | APIO_RESET_PADS_BANK0); \
                                 while (!(APIO_RESET_DONE & (APIO_RESET_IOBANK0 | APIO_RESET_PADS_BANK0))); \
+                                _APIO_PHASE_END(APIO_PHASE_GLOBAL, APIO_PHASE_GPIO); \
                             } while(0)
 #else // APIO_EMULATION
 #define APIO_ENABLE_GPIOS()
@@ -247,16 +735,21 @@ _Static_assert(APIO_GPIO_CTRL_FUNC_PIO1 == (APIO_GPIO_CTRL_FUNC_PIO0 + 1), "APIO
 _Static_assert(APIO_GPIO_CTRL_FUNC_PIO2 == (APIO_GPIO_CTRL_FUNC_PIO0 + 2), "APIO_GPIO_CTRL_FUNC_PIO2 must be APIO_GPIO_CTRL_FUNC_PIO0 + 2");
 #define APIO_GPIO_INPUT_OUTPUT(PIN, BLOCK) \
                             do { \
+                                _APIO_PHASE_BEGIN(); \
                                 _STATIC_BLOCK_ASSERT(BLOCK); \
                                 APIO_GPIO_CTRL(PIN) = APIO_GPIO_CTRL_FUNC_PIO0 + (BLOCK); \
                                 APIO_GPIO_PAD(PIN) &= ~(APIO_PAD_ISO_BIT | APIO_PAD_OUTPUT_DIS_BIT); \
                                 APIO_GPIO_PAD(PIN) |=  APIO_PAD_INPUT_EN_BIT; \
+                                _APIO_OPLOG_GPIO(APIO_OPLOG_OP_GPIO_INPUT_OUTPUT, PIN, BLOCK); \
+                                _APIO_PHASE_END(APIO_PHASE_GLOBAL, APIO_PHASE_GPIO); \
                             } while(0)
 #else // APIO_EMULATION
 #define APIO_GPIO_INPUT_OUTPUT(PIN, BLOCK) do { \
+                                _APIO_PHASE_BEGIN(); \
                                 _STATIC_BLOCK_ASSERT(BLOCK); \
-                                _apio_emulated_gpios.output_block[PIN] = BLOCK; \
-                                _apio_emulated_gpios.input_only &= ~(1ULL << (PIN)); \
+                                _apio_emu_gpio_input_output((PIN), (BLOCK)); \
+                                _APIO_OPLOG_GPIO(APIO_OPLOG_OP_GPIO_INPUT_OUTPUT, PIN, BLOCK); \
+                                _APIO_PHASE_END(APIO_PHASE_GLOBAL, APIO_PHASE_GPIO); \
                             } while(0)
 #endif // !APIO_EMULATION
 // Retain APIO_GPIO_OUTPUT for backwards compatibility
@@ -270,13 +763,18 @@ _Static_assert(APIO_GPIO_CTRL_FUNC_PIO2 == (APIO_GPIO_CTRL_FUNC_PIO0 + 2), "APIO
 #if !defined(APIO_EMULATION)
 #define APIO_GPIO_INPUT_ONLY(PIN) \
                             do { \
+                                _APIO_PHASE_BEGIN(); \
                                 APIO_GPIO_CTRL(PIN) = APIO_GPIO_CTRL_FUNC_SIO; \
                                 APIO_GPIO_PAD(PIN) = APIO_PAD_INPUT_EN_BIT | APIO_PAD_OUTPUT_DIS_BIT; \
+                                _APIO_OPLOG_GPIO(APIO_OPLOG_OP_GPIO_INPUT_ONLY, PIN, 0); \
+                                _APIO_PHASE_END(APIO_PHASE_GLOBAL, APIO_PHASE_GPIO); \
                             } while(0)
 #else // APIO_EMULATION
 #define APIO_GPIO_INPUT_ONLY(PIN) do { \
-                                _apio_emulated_gpios.output_block[PIN] = -1; \
-                                _apio_emulated_gpios.input_only |= (1ULL << (PIN)); \
+                                _APIO_PHASE_BEGIN(); \
+                                _apio_emu_gpio_input_only(PIN); \
+                                _APIO_OPLOG_GPIO(APIO_OPLOG_OP_GPIO_INPUT_ONLY, PIN, 0); \
+                                _APIO_PHASE_END(APIO_PHASE_GLOBAL, APIO_PHASE_GPIO); \
                             } while(0)
 #endif // !APIO_EMULATION
 
@@ -284,13 +782,19 @@ _Static_assert(APIO_GPIO_CTRL_FUNC_PIO2 == (APIO_GPIO_CTRL_FUNC_PIO0 + 2), "APIO
 #if !defined(APIO_EMULATION)
 #define APIO_GPIO_PULL_UP(PIN) \
                             do { \
+                                _APIO_PHASE_BEGIN(); \
                                 APIO_GPIO_PAD(PIN) &= ~APIO_PAD_PDE_BIT; \
                                 APIO_GPIO_PAD(PIN) |=  APIO_PAD_PUE_BIT; \
+                                _APIO_OPLOG_GPIO(APIO_OPLOG_OP_GPIO_PULL_UP, PIN, 0); \
+                                _APIO_PHASE_END(APIO_PHASE_GLOBAL, APIO_PHASE_GPIO); \
                             } while(0)
 #else // APIO_EMULATION
 #define APIO_GPIO_PULL_UP(PIN) do { \
+                                _APIO_PHASE_BEGIN(); \
                                 _apio_emulated_gpios.pull_up   |=  (1ULL << (PIN)); \
                                 _apio_emulated_gpios.pull_down &= ~(1ULL << (PIN)); \
+                                _APIO_OPLOG_GPIO(APIO_OPLOG_OP_GPIO_PULL_UP, PIN, 0); \
+                                _APIO_PHASE_END(APIO_PHASE_GLOBAL, APIO_PHASE_GPIO); \
                             } while(0)
 #endif // !APIO_EMULATION
 
@@ -298,13 +802,19 @@ _Static_assert(APIO_GPIO_CTRL_FUNC_PIO2 == (APIO_GPIO_CTRL_FUNC_PIO0 + 2), "APIO
 #if !defined(APIO_EMULATION)
 #define APIO_GPIO_PULL_DOWN(PIN) \
                             do { \
+                                _APIO_PHASE_BEGIN(); \
                                 APIO_GPIO_PAD(PIN) &= ~APIO_PAD_PUE_BIT; \
                                 APIO_GPIO_PAD(PIN) |=  APIO_PAD_PDE_BIT; \
+                                _APIO_OPLOG_GPIO(APIO_OPLOG_OP_GPIO_PULL_DOWN, PIN, 0); \
+                                _APIO_PHASE_END(APIO_PHASE_GLOBAL, APIO_PHASE_GPIO); \
                             } while(0)
 #else // APIO_EMULATION
 #define APIO_GPIO_PULL_DOWN(PIN) do { \
+                                _APIO_PHASE_BEGIN(); \
                                 _apio_emulated_gpios.pull_down |=  (1ULL << (PIN)); \
                                 _apio_emulated_gpios.pull_up   &= ~(1ULL << (PIN)); \
+                                _APIO_OPLOG_GPIO(APIO_OPLOG_OP_GPIO_PULL_DOWN, PIN, 0); \
+                                _APIO_PHASE_END(APIO_PHASE_GLOBAL, APIO_PHASE_GPIO); \
                             } while(0)
 #endif // !APIO_EMULATION
 
@@ -312,12 +822,18 @@ _Static_assert(APIO_GPIO_CTRL_FUNC_PIO2 == (APIO_GPIO_CTRL_FUNC_PIO0 + 2), "APIO
 #if !defined(APIO_EMULATION)
 #define APIO_GPIO_PULL_NONE(PIN) \
                             do { \
+                                _APIO_PHASE_BEGIN(); \
                                 APIO_GPIO_PAD(PIN) &= ~(APIO_PAD_PUE_BIT | APIO_PAD_PDE_BIT); \
+                                _APIO_OPLOG_GPIO(APIO_OPLOG_OP_GPIO_PULL_NONE, PIN, 0); \
+                                _APIO_PHASE_END(APIO_PHASE_GLOBAL, APIO_PHASE_GPIO); \
                             } while(0)
 #else // APIO_EMULATION
 #define APIO_GPIO_PULL_NONE(PIN) do { \
+                                _APIO_PHASE_BEGIN(); \
                                 _apio_emulated_gpios.pull_up   &= ~(1ULL << (PIN)); \
                                 _apio_emulated_gpios.pull_down &= ~(1ULL << (PIN)); \
+                                _APIO_OPLOG_GPIO(APIO_OPLOG_OP_GPIO_PULL_NONE, PIN, 0); \
+                                _APIO_PHASE_END(APIO_PHASE_GLOBAL, APIO_PHASE_GPIO); \
                             } while(0)
 #endif // !APIO_EMULATION
 
@@ -327,12 +843,18 @@ _Static_assert(APIO_GPIO_CTRL_FUNC_PIO2 == (APIO_GPIO_CTRL_FUNC_PIO0 + 2), "APIO
 #if !defined(APIO_EMULATION)
 #define APIO_GPIO_DRIVE(PIN, STRENGTH) \
                             do { \
+                                _APIO_PHASE_BEGIN(); \
                                 APIO_GPIO_PAD(PIN) &= ~APIO_PAD_DRIVE_MASK; \
                                 APIO_GPIO_PAD(PIN) |=  APIO_PAD_DRIVE(STRENGTH); \
+                                _APIO_OPLOG_GPIO(APIO_OPLOG_OP_GPIO_DRIVE, PIN, STRENGTH); \
+                                _APIO_PHASE_END(APIO_PHASE_GLOBAL, APIO_PHASE_GPIO); \
                             } while(0)
 #else // APIO_EMULATION
 #define APIO_GPIO_DRIVE(PIN, STRENGTH) do { \
+                                _APIO_PHASE_BEGIN(); \
                                 _apio_emulated_gpios.drive_strength[PIN] = (STRENGTH); \
+                                _APIO_OPLOG_GPIO(APIO_OPLOG_OP_GPIO_DRIVE, PIN, STRENGTH); \
+                                _APIO_PHASE_END(APIO_PHASE_GLOBAL, APIO_PHASE_GPIO); \
                             } while(0)
 #endif // !APIO_EMULATION
 
@@ -341,11 +863,17 @@ _Static_assert(APIO_GPIO_CTRL_FUNC_PIO2 == (APIO_GPIO_CTRL_FUNC_PIO0 + 2), "APIO
 #if !defined(APIO_EMULATION)
 #define APIO_GPIO_SLEW_FAST(PIN) \
                             do { \
+                                _APIO_PHASE_BEGIN(); \
                                 APIO_GPIO_PAD(PIN) |= APIO_PAD_SLEWFAST_BIT; \
+                                _APIO_OPLOG_GPIO(APIO_OPLOG_OP_GPIO_SLEW_FAST, PIN, 0); \
+                                _APIO_PHASE_END(APIO_PHASE_GLOBAL, APIO_PHASE_GPIO); \
                             } while(0)
 #else // APIO_EMULATION
 #define APIO_GPIO_SLEW_FAST(PIN) do { \
+                                _APIO_PHASE_BEGIN(); \
                                 _apio_emulated_gpios.slew_fast |= (1ULL << (PIN)); \
+                                _APIO_OPLOG_GPIO(APIO_OPLOG_OP_GPIO_SLEW_FAST, PIN, 0); \
+                                _APIO_PHASE_END(APIO_PHASE_GLOBAL, APIO_PHASE_GPIO); \
                             } while(0)
 #endif // !APIO_EMULATION
 
@@ -353,43 +881,67 @@ _Static_assert(APIO_GPIO_CTRL_FUNC_PIO2 == (APIO_GPIO_CTRL_FUNC_PIO0 + 2), "APIO
 #if !defined(APIO_EMULATION)
 #define APIO_GPIO_SLEW_SLOW(PIN) \
                             do { \
+                                _APIO_PHASE_BEGIN(); \
                                 APIO_GPIO_PAD(PIN) &= ~APIO_PAD_SLEWFAST_BIT; \
+                                _APIO_OPLOG_GPIO(APIO_OPLOG_OP_GPIO_SLEW_SLOW, PIN, 0); \
+                                _APIO_PHASE_END(APIO_PHASE_GLOBAL, APIO_PHASE_GPIO); \
                             } while(0)
 #else // APIO_EMULATION
 #define APIO_GPIO_SLEW_SLOW(PIN) do { \
+                                _APIO_PHASE_BEGIN(); \
                                 _apio_emulated_gpios.slew_fast &= ~(1ULL << (PIN)); \
+                                _APIO_OPLOG_GPIO(APIO_OPLOG_OP_GPIO_SLEW_SLOW, PIN, 0); \
+                                _APIO_PHASE_END(APIO_PHASE_GLOBAL, APIO_PHASE_GPIO); \
                             } while(0)
 #endif // !APIO_EMULATION
 
 // Invert a GPIO input
 #if !defined(APIO_EMULATION)
 #define APIO_GPIO_INPUT_INVERT(PIN) do { \
+                                    _APIO_PHASE_BEGIN(); \
                                     APIO_GPIO_CTRL(PIN) &= ~APIO_GPIO_CTRL_INOVER_MASK; \
                                     APIO_GPIO_CTRL(PIN) |= APIO_GPIO_CTRL_INOVER_INVERT; \
+                                    _APIO_OPLOG_GPIO(APIO_OPLOG_OP_GPIO_INPUT_INVERT, PIN, 0); \
+                                    _APIO_PHASE_END(APIO_PHASE_GLOBAL, APIO_PHASE_GPIO); \
                                 } while(0)
 #define APIO_GPIO_FORCE_INPUT_LOW(PIN)  do { \
+                                    _APIO_PHASE_BEGIN(); \
                                     APIO_GPIO_CTRL(PIN) &= ~APIO_GPIO_CTRL_INOVER_MASK; \
                                     APIO_GPIO_CTRL(PIN) |= APIO_GPIO_CTRL_INOVER_LOW; \
+                                    _APIO_OPLOG_GPIO(APIO_OPLOG_OP_GPIO_FORCE_LOW, PIN, 0); \
+                                    _APIO_PHASE_END(APIO_PHASE_GLOBAL, APIO_PHASE_GPIO); \
                                 } while(0)
 #define APIO_GPIO_FORCE_INPUT_HIGH(PIN)  do { \
+                                    _APIO_PHASE_BEGIN(); \
                                     APIO_GPIO_CTRL(PIN) &= ~APIO_GPIO_CTRL_INOVER_MASK; \
                                     APIO_GPIO_CTRL(PIN) |= APIO_GPIO_CTRL_INOVER_HIGH; \
+                                    _APIO_OPLOG_GPIO(APIO_OPLOG_OP_GPIO_FORCE_HIGH, PIN, 0); \
+                                    _APIO_PHASE_END(APIO_PHASE_GLOBAL, APIO_PHASE_GPIO); \
                                 } while(0)
 #else // APIO_EMULATION
 #define APIO_GPIO_INPUT_INVERT(PIN) do { \
+                                    _APIO_PHASE_BEGIN(); \
                                     _apio_emulated_gpios.inverted[PIN] = 1; \
                                     _apio_emulated_gpios.force_input_high[PIN] = 0; \
                                     _apio_emulated_gpios.force_input_low[PIN] = 0; \
+                                    _APIO_OPLOG_GPIO(APIO_OPLOG_OP_GPIO_INPUT_INVERT, PIN, 0); \
+                                    _APIO_PHASE_END(APIO_PHASE_GLOBAL, APIO_PHASE_GPIO); \
                                 } while(0)
 #define APIO_GPIO_FORCE_INPUT_LOW(PIN)  do { \
+                                    _APIO_PHASE_BEGIN(); \
                                     _apio_emulated_gpios.inverted[PIN] = 0; \
                                     _apio_emulated_gpios.force_input_high[PIN] = 0; \
                                     _apio_emulated_gpios.force_input_low[PIN] = 1; \
+                                    _APIO_OPLOG_GPIO(APIO_OPLOG_OP_GPIO_FORCE_LOW, PIN, 0); \
+                                    _APIO_PHASE_END(APIO_PHASE_GLOBAL, APIO_PHASE_GPIO); \
                                 } while(0)
 #define APIO_GPIO_FORCE_INPUT_HIGH(PIN)  do { \
+                                    _APIO_PHASE_BEGIN(); \
                                     _apio_emulated_gpios.inverted[PIN] = 0; \
                                     _apio_emulated_gpios.force_input_low[PIN] = 0; \
                                     _apio_emulated_gpios.force_input_high[PIN] = 1; \
+                                    _APIO_OPLOG_GPIO(APIO_OPLOG_OP_GPIO_FORCE_HIGH, PIN, 0); \
+                                    _APIO_PHASE_END(APIO_PHASE_GLOBAL, APIO_PHASE_GPIO); \
                                 } while(0)
 #endif // !APIO_EMULATION
 
@@ -402,21 +954,31 @@ _Static_assert(APIO_GPIO_CTRL_FUNC_PIO2 == (APIO_GPIO_CTRL_FUNC_PIO0 + 2), "APIO
                                     APIO1_IRQ = 0xFFFFFFFF;  \
                                 } else {                    \
                                     APIO2_IRQ = 0xFFFFFFFF;  \
-                                }
+                                }                           \
+                                _APIO_OPLOG_GLOBAL(APIO_OPLOG_OP_CLEAR_IRQ, BLOCK)
 #else // APIO_EMULATION
 #define PIO_CLEAR_IRQ(BLOCK)    _STATIC_BLOCK_ASSERT(BLOCK); \
-                                _apio_emulated_pio.irq[BLOCK] = 0xFFFFFFFF
+                                _apio_emulated_pio.irq[BLOCK] = 0xFFFFFFFF; \
+                                _APIO_EMU_DIRTY(BLOCK); \
+                                _APIO_OPLOG_GLOBAL(APIO_OPLOG_OP_CLEAR_IRQ, BLOCK)
 #endif // !APIO_EMULATION
 
 // Clear all PIO IRQs
 #if !defined(APIO_EMULATION)
-#define APIO_CLEAR_ALL_IRQS()   APIO0_IRQ = 0xFFFFFFFF;  \
+#define APIO_CLEAR_ALL_IRQS()   _APIO_PHASE_BEGIN();     \
+                                APIO0_IRQ = 0xFFFFFFFF;  \
                                 APIO1_IRQ = 0xFFFFFFFF;  \
-                                APIO2_IRQ = 0xFFFFFFFF
+                                APIO2_IRQ = 0xFFFFFFFF;  \
+                                _APIO_OPLOG_GLOBAL(APIO_OPLOG_OP_CLEAR_ALL_IRQS, 0); \
+                                _APIO_PHASE_END(APIO_PHASE_GLOBAL, APIO_PHASE_ASM_INIT)
 #else // APIO_EMULATION
-#define APIO_CLEAR_ALL_IRQS()   for (int __i = 0; __i < APIO_MAX_PIO_BLOCKS; __i++) { \
+#define APIO_CLEAR_ALL_IRQS()   _APIO_PHASE_BEGIN();                          \
+                                for (int __i = 0; __i < APIO_MAX_PIO_BLOCKS; __i++) { \
                                     _apio_emulated_pio.irq[__i] = 0xFFFFFFFF; \
-                                }
+                                    _APIO_EMU_DIRTY(__i);                     \
+                                }                                             \
+                                _APIO_OPLOG_GLOBAL(APIO_OPLOG_OP_CLEAR_ALL_IRQS, 0); \
+                                _APIO_PHASE_END(APIO_PHASE_GLOBAL, APIO_PHASE_ASM_INIT)
 #endif // !APIO_EMULATION
 
 // Call at the start of a function that builds PIO programs from scratch.
@@ -424,7 +986,7 @@ _Static_assert(APIO_GPIO_CTRL_FUNC_PIO2 == (APIO_GPIO_CTRL_FUNC_PIO0 + 2), "APIO
 // function scope.
 //
 // In emulation mode, resets the accumulated apio state (preserving only
-// pios_enabled) so the new build starts clean.
+// pios_enabled and the handoff generation) so the new build starts clean.
 //
 // Use APIO_ASM_CONTINUE() instead when the function extends an
 // already-configured PIO setup (e.g. adding state machines to a block that
@@ -432,7 +994,8 @@ _Static_assert(APIO_GPIO_CTRL_FUNC_PIO2 == (APIO_GPIO_CTRL_FUNC_PIO0 + 2), "APIO
 //
 // Uses around 128 bytes of stack space in RP2350 hardware case.
 #if !defined(APIO_EMULATION)
-#define APIO_ASM_INIT()  \
+// Internal macro - do not use directly
+#define _APIO_ASM_DECLARE()  \
     uint16_t __attribute__((unused)) instr_scratch[APIO_MAX_PIO_INSTRS]; \
     uint8_t __attribute__((unused)) __pio_first_instr[APIO_MAX_PIO_BLOCKS][APIO_MAX_SMS_PER_BLOCK] = _OFFSET_ARRAY_INIT; \
     uint8_t __attribute__((unused)) __pio_start[APIO_MAX_PIO_BLOCKS][APIO_MAX_SMS_PER_BLOCK] = _OFFSET_ARRAY_INIT; \
@@ -442,10 +1005,15 @@ _Static_assert(APIO_GPIO_CTRL_FUNC_PIO2 == (APIO_GPIO_CTRL_FUNC_PIO0 + 2), "APIO
     uint8_t __attribute__((unused)) __pio_offset[APIO_MAX_PIO_BLOCKS] = {0, 0, 0}; \
     uint8_t __blk = 0; \
     uint8_t __sm = 0
+#define APIO_ASM_INIT() _APIO_PHASE_BEGIN(); \
+                        _APIO_ASM_DECLARE(); \
+                        _APIO_OPLOG(APIO_OPLOG_OP_INIT, APIO_OPLOG_MAGIC); \
+                        _APIO_PHASE_END(APIO_PHASE_GLOBAL, APIO_PHASE_ASM_INIT)
 #else // APIO_EMULATION
-#define APIO_ASM_INIT() uint8_t _pios_enabled = _apio_emulated_pio.pios_enabled; \
-                        _apio_emulated_pio = (_apio_emulated_pio_t){0};                    \
-                        _apio_emulated_pio.pios_enabled = _pios_enabled
+#define APIO_ASM_INIT() _APIO_PHASE_BEGIN(); \
+                        _apio_emu_asm_init(); \
+                        _APIO_OPLOG(APIO_OPLOG_OP_INIT, APIO_OPLOG_MAGIC); \
+                        _APIO_PHASE_END(APIO_PHASE_GLOBAL, APIO_PHASE_ASM_INIT)
 #endif // !APIO_EMULATION
 
 // Call at the start of a function that extends an already-configured PIO
@@ -466,32 +1034,31 @@ _Static_assert(APIO_GPIO_CTRL_FUNC_PIO2 == (APIO_GPIO_CTRL_FUNC_PIO0 + 2), "APIO
 // to pick up new programs, SM configs, pre_instrs, and tx_fifos written by
 // this function without disturbing the configuration laid down earlier.
 #if !defined(APIO_EMULATION)
-// In non-emulation mode, APIO_ASM_CONTINUE() is identical to APIO_ASM_INIT():
+// In non-emulation mode, APIO_ASM_CONTINUE() declares the same variables as
+// APIO_ASM_INIT():
 // the local variables required by all APIO macros must still be declared, and
 // the block offset is positioned correctly by the subsequent
 // APIO_SET_BLOCK_FROM() or APIO_SET_BLOCK_FROM_VAR() call.
-#define APIO_ASM_CONTINUE()  APIO_ASM_INIT()
+#define APIO_ASM_CONTINUE()  _APIO_ASM_DECLARE(); \
+                             _APIO_OPLOG(APIO_OPLOG_OP_CONTINUE, APIO_OPLOG_MAGIC)
 #else // APIO_EMULATION
-#define APIO_ASM_CONTINUE() /* no-op in emulation: accumulated apio state is preserved */
+// No-op in emulation, other than marking the current block dirty for
+// handoff and recording to the operation log: accumulated apio state is
+// preserved.
+#define APIO_ASM_CONTINUE()  (_APIO_EMU_DIRTY(__blk), \
+                              _APIO_OPLOG(APIO_OPLOG_OP_CONTINUE, APIO_OPLOG_MAGIC))
 #endif // !APIO_EMULATION
 
 // Call before using APIO GPIO macros.  Resets all GPIO configuration to
 // hardware reset defaults: pull-down, 4mA drive strength, slow slew.
 #if !defined(APIO_EMULATION)
-#define APIO_GPIO_INIT()
+#define APIO_GPIO_INIT()    _APIO_PHASE_EXPR(APIO_PHASE_GLOBAL, APIO_PHASE_GPIO, _APIO_OPLOG_GPIO(APIO_OPLOG_OP_GPIO_INIT, 0, 0))
 #else // APIO_EMULATION
 #define APIO_GPIO_INIT() do { \
-                            for (int __i = 0; __i < APIO_MAX_GPIOS; __i++) { \
-                                _apio_emulated_gpios.output_block[__i]   = -1; \
-                                _apio_emulated_gpios.inverted[__i]        = 0; \
-                                _apio_emulated_gpios.force_input_low[__i] = 0; \
-                                _apio_emulated_gpios.force_input_high[__i]= 0; \
-                                _apio_emulated_gpios.drive_strength[__i]  = APIO_DRIVE_4MA; \
-                            } \
-                            _apio_emulated_gpios.pull_up    = 0; \
-                            _apio_emulated_gpios.pull_down  = APIO_GPIO_ALL_MASK; \
-                            _apio_emulated_gpios.input_only = 0; \
-                            _apio_emulated_gpios.slew_fast  = 0; \
+                            _APIO_PHASE_BEGIN(); \
+                            _apio_emu_gpio_init(); \
+                            _APIO_OPLOG_GPIO(APIO_OPLOG_OP_GPIO_INIT, 0, 0); \
+                            _APIO_PHASE_END(APIO_PHASE_GLOBAL, APIO_PHASE_GPIO); \
                         } while(0)
 #endif // !APIO_EMULATION
 
@@ -503,30 +1070,87 @@ _Static_assert((APIO_MAX_PIO_INSTRS == 32), "APIO_MAX_PIO_INSTRS must be 32");
 // Bring PIO blocks out of reset
 #if !defined(APIO_EMULATION)
 #define APIO_ENABLE_PIOS()  do { \
+                                _APIO_PHASE_BEGIN(); \
                                 APIO_RESET_RESET &= ~(APIO_RESET_PIO0 | APIO_RESET_PIO1 | APIO_RESET_PIO2 ); \
                                 while (!(APIO_RESET_DONE & (APIO_RESET_PIO0 | APIO_RESET_PIO1 | APIO_RESET_PIO2))); \
+                                _APIO_OPLOG_GLOBAL(APIO_OPLOG_OP_ENABLE_PIOS, 0); \
+                                _APIO_PHASE_END(APIO_PHASE_GLOBAL, APIO_PHASE_ASM_INIT); \
                             } while(0)
 #else // APIO_EMULATION
-#define APIO_ENABLE_PIOS()    _apio_emulated_pio.pios_enabled = 1
+#define APIO_ENABLE_PIOS()    _APIO_PHASE_EXPR(APIO_PHASE_GLOBAL, APIO_PHASE_ASM_INIT, \
+                                (_apio_emulated_pio.pios_enabled = 1, _APIO_OPLOG_GLOBAL(APIO_OPLOG_OP_ENABLE_PIOS, 0)))
 #endif // !APIO_EMULATION
 
 #if !defined(APIO_EMULATION)
 #define APIO_ENABLE_SMS(BLOCK, SMS_MASK)  \
                                 _STATIC_BLOCK_ASSERT(BLOCK); \
                                 _Static_assert((SMS_MASK) > 0 && (SMS_MASK) < (1 << APIO_MAX_SMS_PER_BLOCK), "Invalid SMS_MASK"); \
+                                _APIO_PHASE_BEGIN();        \
                                 if (BLOCK == 0) {           \
                                     APIO0_CTRL_SM_ENABLE(SMS_MASK);  \
                                 } else if (BLOCK == 1) {    \
                                     APIO1_CTRL_SM_ENABLE(SMS_MASK);  \
                                 } else {                    \
                                     APIO2_CTRL_SM_ENABLE(SMS_MASK);  \
-                                }
+                                }                           \
+                                _APIO_OPLOG_GLOBAL(APIO_OPLOG_OP_ENABLE_SMS, ((BLOCK) << 8) | (SMS_MASK)); \
+                                _APIO_PHASE_END(BLOCK, APIO_PHASE_ENABLE)
+#else // APIO_EMULATION
+#define APIO_ENABLE_SMS(BLOCK, SMS_MASK)    (_APIO_PHASE_BEGIN(), \
+                                             _apio_emulated_pio.enabled_sms[BLOCK] = SMS_MASK, \
+                                             _APIO_EMU_DIRTY(BLOCK), \
+                                             _APIO_OPLOG_GLOBAL(APIO_OPLOG_OP_ENABLE_SMS, ((BLOCK) << 8) | (SMS_MASK)), \
+                                             _APIO_PHASE_END(BLOCK, APIO_PHASE_ENABLE))
+#endif // !APIO_EMULATION
+
+// Reset a single PIO block, where the block number is a runtime variable:
+// its instruction memory, SM registers, FIFOs, IRQ flags, GPIOBASE and SM
+// enables, as well as the assembler's instruction offset and program tracking
+// for that block.  Other blocks are untouched, so a block can be rebuilt
+// from scratch without disturbing the rest of the configuration, e.g. after
+// APIO_ASM_CONTINUE().  Must be called within the scope of APIO_ASM_INIT() or
+// APIO_ASM_CONTINUE().
+//
+// On hardware the block is pulsed through RESETS.  In emulation only that
+// block's part of the emulated state is cleared, and it is marked dirty for
+// handoff.
+#if !defined(APIO_EMULATION)
+#define APIO_RESET_BLOCK_VAR(BLOCK) do { \
+                            _APIO_PHASE_BEGIN();                                \
+                            uint32_t __reset_bit = (uint32_t)APIO_RESET_PIO0 << (BLOCK); \
+                            APIO_RESET_RESET |= __reset_bit;                    \
+                            APIO_RESET_RESET &= ~__reset_bit;                   \
+                            while (!(APIO_RESET_DONE & __reset_bit));           \
+                            __pio_offset[BLOCK] = 0;                            \
+                            for (int __i = 0; __i < APIO_MAX_SMS_PER_BLOCK; __i++) { \
+                                __pio_first_instr[BLOCK][__i] = 0;              \
+                                __pio_start[BLOCK][__i] = 0;                    \
+                                __pio_wrap_bottom[BLOCK][__i] = 0;              \
+                                __pio_wrap_top[BLOCK][__i] = 0;                 \
+                                __pio_end[BLOCK][__i] = 0;                      \
+                            }                                                   \
+                            _APIO_OPLOG_GLOBAL(APIO_OPLOG_OP_RESET_BLOCK, BLOCK); \
+                            _APIO_PHASE_END(BLOCK, APIO_PHASE_ASM_INIT);        \
+                        } while(0)
 #else // APIO_EMULATION
-#define APIO_ENABLE_SMS(BLOCK, SMS_MASK)    _apio_emulated_pio.enabled_sms[BLOCK] = SMS_MASK
+#define APIO_RESET_BLOCK_VAR(BLOCK) do { \
+                            _APIO_PHASE_BEGIN();                                \
+                            _apio_emu_reset_block(BLOCK);                       \
+                            _APIO_OPLOG_GLOBAL(APIO_OPLOG_OP_RESET_BLOCK, BLOCK); \
+                            _APIO_PHASE_END(BLOCK, APIO_PHASE_ASM_INIT);        \
+                        } while(0)
 #endif // !APIO_EMULATION
 
-// Set the current PIO block where the block number is a runtime variable
-#define APIO_SET_BLOCK_VAR(BLOCK)               __blk = (BLOCK)
+// Reset a single PIO block.  See APIO_RESET_BLOCK_VAR().
+#define APIO_RESET_BLOCK(BLOCK) _STATIC_BLOCK_ASSERT(BLOCK); \
+                                APIO_RESET_BLOCK_VAR(BLOCK)
+
+// Set the current PIO block where the block number is a runtime variable.
+// In emulation, the block is marked dirty for handoff, as it is about to be
+// modified.
+#define APIO_SET_BLOCK_VAR(BLOCK)               (__blk = (BLOCK), \
+                                                 _APIO_EMU_DIRTY(__blk), \
+                                                 _APIO_OPLOG(APIO_OPLOG_OP_SET_BLOCK, __blk))
 
 // Set the current PIO block
 #define APIO_SET_BLOCK(BLOCK)                   _STATIC_BLOCK_ASSERT(BLOCK); \
@@ -535,19 +1159,23 @@ _Static_assert((APIO_MAX_PIO_INSTRS == 32), "APIO_MAX_PIO_INSTRS must be 32");
 // Resume building a previously committed block from a known instruction
 // offset, where the block number is a runtime variable
 #define APIO_SET_BLOCK_FROM_VAR(BLOCK, OFFSET)  APIO_SET_BLOCK_VAR(BLOCK); \
-                                                __pio_offset[__blk] = (OFFSET)
+                                                _APIO_OPLOG_VAL(APIO_OPLOG_OP_SET_BLOCK_FROM, __pio_offset[__blk] = (OFFSET))
 
 // Resume building a previously committed block from a known instruction offset
 #define APIO_SET_BLOCK_FROM(BLOCK, OFFSET)      _STATIC_BLOCK_ASSERT(BLOCK); \
                                                 APIO_SET_BLOCK_FROM_VAR(BLOCK, OFFSET)
 
 // Set the current PIO SM using an SM variable
-#define APIO_SET_SM_VAR(SM)     __sm = (SM);                                            \
+#define APIO_SET_SM_VAR(SM)     _APIO_PHASE_BEGIN();                                    \
+                                __sm = (SM);                                            \
                                 __pio_first_instr[__blk][__sm] = __pio_offset[__blk];   \
                                 __pio_start[__blk][__sm] = __pio_offset[__blk];         \
                                 __pio_wrap_bottom[__blk][__sm] = __pio_offset[__blk];   \
                                 __pio_wrap_top[__blk][__sm] = __pio_offset[__blk];      \
-                                __pio_end[__blk][__sm] = __pio_offset[__blk]
+                                __pio_end[__blk][__sm] = __pio_offset[__blk];           \
+                                _APIO_EMU_DIRTY(__blk);                                 \
+                                _APIO_OPLOG(APIO_OPLOG_OP_SET_SM, __sm);                \
+                                _APIO_PHASE_END(__blk, APIO_PHASE_INSTR)
 
 // Set the current PIO SM
 #define APIO_SET_SM(SM)         _STATIC_SM_ASSERT(SM); \
@@ -564,7 +1192,7 @@ _Static_assert((APIO_MAX_PIO_INSTRS == 32), "APIO_MAX_PIO_INSTRS must be 32");
 
 // Set the start offset within a PIO program - call before `APIO_ADD_INSTR()`
 // for the start instruction.
-#define APIO_START()            __pio_start[__blk][__sm] = __pio_offset[__blk]
+#define APIO_START()            _APIO_OPLOG_VAL(APIO_OPLOG_OP_START, _APIO_EMU_WRITE(__pio_start[__blk][__sm] = __pio_offset[__blk]))
 
 // Get a label representing the start of the current PIO program
 #define APIO_START_LABEL()      __pio_start[__blk][__sm]
@@ -575,39 +1203,45 @@ _Static_assert((APIO_MAX_PIO_INSTRS == 32), "APIO_MAX_PIO_INSTRS must be 32");
 // Set the end offset within a PIO program - call before `APIO_ADD_INSTR()`
 // for the last instruction.  Must be called after `APIO_WRAP_TOP()`.  If
 // .wrap is the last instruction, this is not required.
-#define APIO_END()              __pio_end[__blk][__sm] = __pio_offset[__blk]
+#define APIO_END()              _APIO_OPLOG_VAL(APIO_OPLOG_OP_END, _APIO_EMU_WRITE(__pio_end[__blk][__sm] = __pio_offset[__blk]))
 
 // Set the wrap bottom offset within a PIO program - call before
 // `APIO_ADD_INSTR()` for the .wrap_target instruction.
-#define APIO_WRAP_BOTTOM()      __pio_wrap_bottom[__blk][__sm] = __pio_offset[__blk]
+#define APIO_WRAP_BOTTOM()      _APIO_OPLOG_VAL(APIO_OPLOG_OP_WRAP_BOTTOM, _APIO_EMU_WRITE(__pio_wrap_bottom[__blk][__sm] = __pio_offset[__blk]))
 
 // Set the wrap top offset within a PIO program - call before
 // `APIO_ADD_INSTR()` for the .wrap instruction.
-#define APIO_WRAP_TOP()         __pio_wrap_top[__blk][__sm] = __pio_offset[__blk];  \
+#define APIO_WRAP_TOP()         _APIO_OPLOG_VAL(APIO_OPLOG_OP_WRAP_TOP, _APIO_EMU_WRITE(__pio_wrap_top[__blk][__sm] = __pio_offset[__blk]));  \
                                 APIO_END()
 
 // Add an instruction to the current PIO program.
 #if !defined(APIO_EMULATION)
-#define APIO_ADD_INSTR(INST)    instr_scratch[__pio_offset[__blk]++] = INST
+#define APIO_ADD_INSTR(INST)    _APIO_PHASE_EXPR(__blk, APIO_PHASE_INSTR, \
+                                    _APIO_OPLOG_VAL(APIO_OPLOG_OP_ADD_INSTR, instr_scratch[__pio_offset[__blk]++] = INST))
 #else // APIO_EMULATION
-#define APIO_ADD_INSTR(INST)    _apio_emulated_pio.instr[__blk][_apio_emulated_pio.offset[__blk]++] = INST
+#define APIO_ADD_INSTR(INST)    _APIO_PHASE_EXPR(__blk, APIO_PHASE_INSTR, \
+                                    _APIO_OPLOG_VAL(APIO_OPLOG_OP_ADD_INSTR, _APIO_EMU_WRITE(_apio_emulated_pio.instr[__blk][_apio_emulated_pio.offset[__blk]++] = INST)))
 #endif // !APIO_EMULATION
 
 // Set the clock divider for the current PIO SM.
-#define APIO_SM_CLKDIV_SET(INT, FRAC)   _apio_sm_reg_ptr(__blk, __sm)->clkdiv = APIO_CLKDIV((INT), (FRAC))
+#define APIO_SM_CLKDIV_SET(INT, FRAC)   _APIO_PHASE_EXPR(__blk, APIO_PHASE_SM_CONFIG, \
+                                            _APIO_OPLOG_VAL(APIO_OPLOG_OP_CLKDIV, _APIO_EMU_WRITE(_apio_sm_reg_ptr(__blk, __sm)->clkdiv = APIO_CLKDIV((INT), (FRAC)))))
 
 // Set the EXECCTRL for the current PIO SM.  Do not include wrap top/bottom.
 // Those will be set automatically from the wrap values.
-#define APIO_SM_EXECCTRL_SET(EXECCTRL)  _apio_sm_reg_ptr(__blk, __sm)->execctrl =  \
+#define APIO_SM_EXECCTRL_SET(EXECCTRL)  _APIO_PHASE_EXPR(__blk, APIO_PHASE_SM_CONFIG, \
+                                        _APIO_OPLOG_VAL(APIO_OPLOG_OP_EXECCTRL, _APIO_EMU_WRITE(_apio_sm_reg_ptr(__blk, __sm)->execctrl =  \
                                             (EXECCTRL) | \
                                             APIO_WRAP_BOTTOM_AS_REG(__pio_wrap_bottom[__blk][__sm]) |  \
-                                            APIO_WRAP_TOP_AS_REG(__pio_wrap_top[__blk][__sm])
+                                            APIO_WRAP_TOP_AS_REG(__pio_wrap_top[__blk][__sm]))))
 
 // Set the SHIFTCTRL for the current PIO SM.
-#define APIO_SM_SHIFTCTRL_SET(SHIFTCTRL)    _apio_sm_reg_ptr(__blk, __sm)->shiftctrl = (SHIFTCTRL)
+#define APIO_SM_SHIFTCTRL_SET(SHIFTCTRL)    _APIO_PHASE_EXPR(__blk, APIO_PHASE_SM_CONFIG, \
+                                                _APIO_OPLOG_VAL(APIO_OPLOG_OP_SHIFTCTRL, _APIO_EMU_WRITE(_apio_sm_reg_ptr(__blk, __sm)->shiftctrl = (SHIFTCTRL))))
 
 // Set the PINCTRL for the current PIO SM.
-#define APIO_SM_PINCTRL_SET(PINCTRL)    _apio_sm_reg_ptr(__blk, __sm)->pinctrl = (PINCTRL)
+#define APIO_SM_PINCTRL_SET(PINCTRL)    _APIO_PHASE_EXPR(__blk, APIO_PHASE_SM_CONFIG, \
+                                            _APIO_OPLOG_VAL(APIO_OPLOG_OP_PINCTRL, _APIO_EMU_WRITE(_apio_sm_reg_ptr(__blk, __sm)->pinctrl = (PINCTRL))))
 
 static inline volatile pio_sm_reg_t* _apio_sm_reg_ptr(uint8_t block, uint8_t sm) {
     if (block == 0) return APIO0_SM_REG(sm);
@@ -615,12 +1249,58 @@ static inline volatile pio_sm_reg_t* _apio_sm_reg_ptr(uint8_t block, uint8_t sm)
     else return APIO2_SM_REG(sm);
 }
 
+#if defined(APIO_EMULATION)
+// Internal function - do not use directly.  Appends an instruction to an SM's
+// emulated exec queue, or counts it as dropped if the queue is full.  Define
+// APIO_EMU_EXEC_OVERFLOW_HOOK(BLOCK, SM) to be notified of overflows, e.g. to
+// fail a test immediately.
+static inline void _apio_emu_queue_instr(uint8_t block, uint8_t sm, uint16_t instr) {
+    uint16_t count = _apio_emulated_pio.pre_instr_count[block][sm];
+    if (count >= APIO_EMU_MAX_PRE_INSTRS) {
+        if (_apio_emulated_pio.pre_instr_overflow[block][sm] < 0xFFFF) {
+            _apio_emulated_pio.pre_instr_overflow[block][sm]++;
+        }
+#if defined(APIO_EMU_EXEC_OVERFLOW_HOOK)
+        APIO_EMU_EXEC_OVERFLOW_HOOK(block, sm);
+#endif // APIO_EMU_EXEC_OVERFLOW_HOOK
+        return;
+    }
+    _apio_emulated_pio.pre_instr[block][sm][count] = instr;
+    _APIO_EMU_DIRTY(block);
+#if defined(APIO_EMU_PRE_INSTR_TIMESTAMPS)
+    _apio_emulated_pio.pre_instr_time[block][sm][count] = APIO_EMU_TIMESTAMP();
+#endif // APIO_EMU_PRE_INSTR_TIMESTAMPS
+    _apio_emulated_pio.pre_instr_count[block][sm] = count + 1;
+}
+
+// Internal function - do not use directly
+static inline void _apio_emu_exec_instr(uint8_t block, uint8_t sm, uint16_t instr) {
+#if defined(APIO_OPLOG)
+    _apio_oplog_record(APIO_OPLOG_OP_EXEC_INSTR, block, sm, 0, instr);
+#endif // APIO_OPLOG
+    _apio_emu_queue_instr(block, sm, instr);
+}
+#endif // APIO_EMULATION
+
 // Immediately execute an instruction on the current PIO SM.  Can be called
 // before enabling the SM to set initial state.
+//
+// In emulation mode the instruction is queued for the emulator, up to
+// APIO_EMU_MAX_PRE_INSTRS per SM.
+#if !defined(APIO_EMULATION)
+#define APIO_SM_EXEC_INSTR(INSTR) _APIO_PHASE_EXPR(__blk, APIO_PHASE_SM_CONFIG, \
+                                    _APIO_OPLOG_VAL(APIO_OPLOG_OP_EXEC_INSTR, _apio_sm_reg_ptr(__blk, __sm)->instr = INSTR))
+#else // APIO_EMULATION
+#define APIO_SM_EXEC_INSTR(INSTR) _APIO_PHASE_EXPR(__blk, APIO_PHASE_SM_CONFIG, _apio_emu_exec_instr(__blk, __sm, (INSTR)))
+#endif // !APIO_EMULATION
+
+// Returns the number of exec instructions dropped for the current PIO SM
+// because its emulated exec queue was full.  Always 0 on hardware, where
+// instructions are executed immediately.
 #if !defined(APIO_EMULATION)
-#define APIO_SM_EXEC_INSTR(INSTR) _apio_sm_reg_ptr(__blk, __sm)->instr = INSTR
+#define APIO_SM_EXEC_OVERFLOW()   (0)
 #else // APIO_EMULATION
-#define APIO_SM_EXEC_INSTR(INSTR) _apio_emulated_pio.pre_instr[__blk][__sm][_apio_emulated_pio.pre_instr_count[__blk][__sm]++] = INSTR;
+#define APIO_SM_EXEC_OVERFLOW()   (_apio_emulated_pio.pre_instr_overflow[__blk][__sm])
 #endif // !APIO_EMULATION
 
 #if !defined(APIO_EMULATION)
@@ -634,20 +1314,52 @@ static inline volatile uint32_t* _apio_rxf_ptr(uint8_t block, uint8_t sm) {
     else if (block == 1) return (volatile uint32_t *)((uintptr_t)APIO1_BASE + APIO_RXF_OFFSET + (sm * 0x04));
     else return (volatile uint32_t *)((uintptr_t)APIO2_BASE + APIO_RXF_OFFSET + (sm * 0x04));
 }
+#else // APIO_EMULATION
+// Internal functions - do not use directly.  As on hardware, a write to a
+// full emulated TX FIFO is dropped, and a read from an exhausted emulated RX
+// FIFO returns 0, setting FDEBUG TXOVER and RXUNDER respectively.  Either
+// way the block is marked dirty.
+static inline uint32_t* _apio_emu_txf_ptr(uint8_t block, uint8_t sm) {
+    static uint32_t sink;
+    uint8_t count = _apio_emulated_pio.tx_fifo_count[block][sm];
+    _APIO_EMU_DIRTY(block);
+    if (count >= APIO_MAX_FIFO_DEPTH) {
+        _apio_emulated_pio.fdebug[block] |= APIO_FDEBUG_TXOVER(sm);
+        return &sink;
+    }
+    _apio_emulated_pio.tx_fifo_count[block][sm] = count + 1;
+    return &_apio_emulated_pio.tx_fifos[block][sm][count];
+}
+static inline uint32_t* _apio_emu_rxf_ptr(uint8_t block, uint8_t sm) {
+    static uint32_t sink;
+    uint8_t count = _apio_emulated_pio.rx_fifo_count[block][sm];
+    _APIO_EMU_DIRTY(block);
+    if (count >= APIO_MAX_FIFO_DEPTH) {
+        _apio_emulated_pio.fdebug[block] |= APIO_FDEBUG_RXUNDER(sm);
+        sink = 0;
+        return &sink;
+    }
+    _apio_emulated_pio.rx_fifo_count[block][sm] = count + 1;
+    return &_apio_emulated_pio.rx_fifos[block][sm][count];
+}
 #endif // !APIO_EMULATION
 
 // Access the current SM's TX FIFO
 #if !defined(APIO_EMULATION)
 #define APIO_TXF (*_apio_txf_ptr(__blk, __sm))
 #else // APIO_EMULATION
-#define APIO_TXF _apio_emulated_pio.tx_fifos[__blk][__sm][_apio_emulated_pio.tx_fifo_count[__blk][__sm]++]
+#define APIO_TXF (*_apio_emu_txf_ptr(__blk, __sm))
 #endif // !APIO_EMULATION
 
+// Write a word to the current SM's TX FIFO.  Equivalent to `APIO_TXF = VALUE`,
+// but recorded to the operation log when APIO_OPLOG is defined.
+#define APIO_TXF_PUT(VALUE) _APIO_OPLOG_VAL(APIO_OPLOG_OP_TXF, APIO_TXF = (VALUE))
+
 // Access the current SM's RX FIFO
 #if !defined(APIO_EMULATION)
 #define APIO_RXF (*_apio_rxf_ptr(__blk, __sm))
 #else // APIO_EMULATION
-#define APIO_RXF _apio_emulated_pio.rx_fifos[__blk][__sm][_apio_emulated_pio.rx_fifo_count[__blk][__sm]++]
+#define APIO_RXF (*_apio_emu_rxf_ptr(__blk, __sm))
 #endif // !APIO_EMULATION
 
 // Set the current PIO SM to jump to its start instruction after
@@ -667,13 +1379,19 @@ static inline volatile uint32_t* _apio_instr_mem_ptr(uint8_t block) {
 // previously committed instructions in PIO memory untouched.
 #if !defined(APIO_EMULATION)
 #define APIO_END_BLOCK_FROM(OFFSET) do { \
+                            _APIO_PHASE_BEGIN();                                        \
                             volatile uint32_t* ptr = _apio_instr_mem_ptr(__blk);        \
                             for (int ii = (OFFSET); ii < __pio_offset[__blk]; ii++) {   \
                                 ptr[ii] = instr_scratch[ii];                            \
                             }                                                           \
+                            _APIO_OPLOG(APIO_OPLOG_OP_END_BLOCK_FROM, OFFSET);          \
+                            _APIO_PHASE_END(__blk, APIO_PHASE_END_BLOCK);               \
                         } while(0)
 #else
-#define APIO_END_BLOCK_FROM(OFFSET) _apio_emulated_pio.max_offset[__blk] = __pio_offset[__blk]
+#define APIO_END_BLOCK_FROM(OFFSET) (_APIO_PHASE_BEGIN(), \
+                                     _APIO_EMU_WRITE(_apio_emulated_pio.max_offset[__blk] = __pio_offset[__blk]), \
+                                     _APIO_OPLOG(APIO_OPLOG_OP_END_BLOCK_FROM, OFFSET), \
+                                     _APIO_PHASE_END(__blk, APIO_PHASE_END_BLOCK))
 #endif
 
 // Write the constructed PIO programs to the PIO instruction memory for the
@@ -687,36 +1405,51 @@ static inline volatile uint32_t* _apio_instr_mem_ptr(uint8_t block) {
 #if !defined(APIO_EMULATION)
 #define APIO_ENABLE_SM(BLOCK, SM_MASK)  _STATIC_BLOCK_ASSERT(BLOCK);         \
                                         _Static_assert((SM_MASK < 0xF), "Attempt to enable invalid SM"); \
+                                        _APIO_PHASE_BEGIN();                \
                                         if (BLOCK == 0) {                   \
                                             APIO0_CTRL_SM_ENABLE(SM_MASK);   \
                                         } else if (BLOCK == 1) {            \
                                             APIO1_CTRL_SM_ENABLE(SM_MASK);   \
                                         } else {                            \
                                             APIO2_CTRL_SM_ENABLE(SM_MASK);   \
-                                        }
+                                        }                                   \
+                                        _APIO_OPLOG_GLOBAL(APIO_OPLOG_OP_ENABLE_SM, ((BLOCK) << 8) | (SM_MASK)); \
+                                        _APIO_PHASE_END(BLOCK, APIO_PHASE_ENABLE)
 #else // APIO_EMULATION
 #define APIO_ENABLE_SM(BLOCK, SM_MASK)  _STATIC_BLOCK_ASSERT(BLOCK);         \
                                         _Static_assert((SM_MASK < 0xF), "Attempt to enable invalid SM"); \
-                                        _apio_emulated_pio.enabled_sms[BLOCK] |= SM_MASK
+                                        _APIO_PHASE_BEGIN(); \
+                                        _apio_emulated_pio.enabled_sms[BLOCK] |= SM_MASK; \
+                                        _APIO_EMU_DIRTY(BLOCK); \
+                                        _APIO_OPLOG_GLOBAL(APIO_OPLOG_OP_ENABLE_SM, ((BLOCK) << 8) | (SM_MASK)); \
+                                        _APIO_PHASE_END(BLOCK, APIO_PHASE_ENABLE)
 #endif // !APIO_EMULATION
 
 // Set GPIOBASE to 0 for the current PIO block
-#define APIO_GPIOBASE_0()   if (__blk == 0) {                 \
+#define APIO_GPIOBASE_0()   _APIO_PHASE_BEGIN();               \
+                            if (__blk == 0) {                 \
                                 APIO0_GPIOBASE = APIO_GPIOBASE_VAL_0; \
                             } else if (__blk == 1) {          \
                                 APIO1_GPIOBASE = APIO_GPIOBASE_VAL_0; \
                             } else {                            \
                                 APIO2_GPIOBASE = APIO_GPIOBASE_VAL_0; \
-                            }
+                            }                                   \
+                            _APIO_EMU_DIRTY(__blk);                                   \
+                            _APIO_OPLOG(APIO_OPLOG_OP_GPIOBASE, APIO_GPIOBASE_VAL_0); \
+                            _APIO_PHASE_END(__blk, APIO_PHASE_SM_CONFIG)
 
 // Set GPIOBASE to 16 for the current PIO block
-#define APIO_GPIOBASE_16()  if (__blk == 0) {                     \
+#define APIO_GPIOBASE_16()  _APIO_PHASE_BEGIN();               \
+                            if (__blk == 0) {                     \
                                 APIO0_GPIOBASE = APIO_GPIOBASE_VAL_16;    \
                             } else if (__blk == 1) {              \
                                 APIO1_GPIOBASE = APIO_GPIOBASE_VAL_16;    \
                             } else {                                \
                                 APIO2_GPIOBASE = APIO_GPIOBASE_VAL_16;    \
-                            }
+                            }                                       \
+                            _APIO_EMU_DIRTY(__blk);                                    \
+                            _APIO_OPLOG(APIO_OPLOG_OP_GPIOBASE, APIO_GPIOBASE_VAL_16); \
+                            _APIO_PHASE_END(__blk, APIO_PHASE_SM_CONFIG)
 
 //
 // PIO Instruction Macros
@@ -0,0 +1,341 @@
+// Copyright (C) 2026 Piers Finlayson <piers@piers.rocks>
+//
+// MIT License
+
+// apio - Runtime RP2350 PIO Assembler and Disassembler
+//
+// Wide parallel-bus output engine.
+//
+// Drives a 1-32 bit parallel bus from an SRAM buffer, with `out pins, W` and
+// autopull, fed by a DREQ-paced DMA channel.  Bus words narrower than 16 bits
+// are packed several to each 32-bit buffer word, first in the least
+// significant bits, so DMA moves fewer words than the bus does.  Without a
+// strobe one bus word is output per SM cycle, so at CLKDIV 1 the bus runs at
+// the system clock.  With a strobe, driven by side-set, each word takes 2 SM
+// cycles: the data is output with the strobe inactive, then the strobe is
+// made active, so a receiver can latch the data on the strobe's active edge.
+//
+//   static const uint32_t buf[256] = { ... };
+//   apio_bus_t bus;
+//   apio_bus_cfg_t cfg = {
+//       .width = 16, .pin_base = 0,
+//       .strobe = APIO_BUS_STROBE_HIGH, .strobe_pin = 16,
+//       .sysclk_hz = 150000000, .rate_hz = 25000000,
+//       .dma_channel = 0, .buf = buf, .words = 256,
+//   };
+//   apio_bus_init(&bus, &cfg);          // Computes CLKDIV and the rate
+//   // In the assembly scope, with the bus and strobe pins set as outputs:
+//   APIO_SET_SM(0);
+//   APIO_BUS_ADD(&bus);
+//   // After APIO_END_BLOCK():
+//   apio_bus_start(&bus);
+//   while (!apio_bus_done(&bus));
+//
+// The rate is the closest the SM's fractional clock divider can get to the
+// target.  A fractional divider jitters the bus timing by one system clock
+// cycle - use a target which divides the maximum rate exactly to avoid this.
+//
+// In emulation there is no DMA, so apio_bus_run_sim() feeds the buffer to
+// the SM's TX FIFO in the built-in interpreter instead, and checks each bus
+// word as it is output - on each OUT, or on the strobe's active edge -
+// against the buffer, counting the words output and any mismatches.
+//
+// The implementation is included in the source file that defines
+// APIO_BUS_IMPL.
+
+#ifndef APIO_BUS_H
+#define APIO_BUS_H
+
+#include <apio.h>
+#if defined(APIO_EMULATION)
+#include <apio_sim.h>
+#endif // APIO_EMULATION
+
+// Return codes
+#define APIO_BUS_OK             0
+#define APIO_BUS_ERR_ARGS       -1
+#define APIO_BUS_ERR_RATE       -2  // Target rate is outside the divider's range
+
+// Strobes, for apio_bus_cfg_t.strobe
+#define APIO_BUS_STROBE_NONE    0
+#define APIO_BUS_STROBE_HIGH    1   // Active high - data latched on rising edge
+#define APIO_BUS_STROBE_LOW     2   // Active low - data latched on falling edge
+
+// Bus configuration, for apio_bus_init()
+typedef struct {
+    uint8_t width;          // Bus width in pins, 1-32
+    uint8_t pin_base;       // OUT_BASE, relative to GPIOBASE
+    uint8_t strobe;         // APIO_BUS_STROBE_*
+    uint8_t strobe_pin;     // Side-set pin, relative to GPIOBASE
+    uint32_t sysclk_hz;     // System clock
+    uint32_t rate_hz;       // Target bus words per second, 0 for the maximum
+    uint8_t dma_channel;
+    const uint32_t *buf;    // Packed bus words
+    uint32_t words;         // Length of buf, in 32-bit words
+} apio_bus_cfg_t;
+
+typedef struct {
+    apio_bus_cfg_t cfg;
+    uint8_t block;          // Set by APIO_BUS_ADD()
+    uint8_t sm;             // Set by APIO_BUS_ADD()
+    uint8_t per_word;       // Bus words packed into each 32-bit word
+    uint8_t cycles;         // SM cycles per bus word
+    uint32_t div256;        // Clock divider, 24.8 fixed point
+    uint32_t rate_hz;       // Achievable bus words per second at div256
+#if defined(APIO_EMULATION)
+    uint32_t fed;           // 32-bit words fed to the TX FIFO
+    uint32_t out;           // Bus words output
+    uint32_t errors;        // Bus words which didn't match the buffer
+#endif // APIO_EMULATION
+} apio_bus_t;
+
+// Instructions used by the program
+#define APIO_BUS_INSTRS(BUS)    ((BUS)->cycles)
+
+// Internal macro - do not use directly.  The strobe's side-set field, with
+// one non-optional side-set bit, for ACTIVE or inactive.
+#define _APIO_BUS_SIDE(BUS, ACTIVE) \
+                            ((uint16_t)(((BUS)->cfg.strobe == APIO_BUS_STROBE_NONE) ? 0 :      \
+                                ((((BUS)->cfg.strobe == APIO_BUS_STROBE_HIGH) == !!(ACTIVE)) << 12)))
+
+// Build the bus program for the current SM, and configure the SM.  Call
+// immediately after APIO_SET_SM().  Sets the bus and strobe pins' directions
+// to output, the bus low and the strobe inactive.  The pins must also be set
+// as outputs for the block with APIO_GPIO_OUTPUT().
+#define APIO_BUS_ADD(BUS) \
+                            do {                                                        \
+                                apio_bus_t *__bus = (BUS);                              \
+                                uint8_t __bus_width = __bus->cfg.width;                 \
+                                uint16_t __bus_idle = _APIO_BUS_SIDE(__bus, 0);         \
+                                __bus->block = __blk;                                   \
+                                __bus->sm = __sm;                                       \
+                                APIO_START();                                           \
+                                APIO_WRAP_BOTTOM();                                     \
+                                if (__bus->cfg.strobe == APIO_BUS_STROBE_NONE) {        \
+                                    APIO_WRAP_TOP();                                    \
+                                    APIO_ADD_INSTR(APIO_OUT_PINS(__bus_width));         \
+                                } else {                                                \
+                                    APIO_ADD_INSTR(APIO_OUT_PINS(__bus_width) | __bus_idle); \
+                                    APIO_WRAP_TOP();                                    \
+                                    APIO_ADD_INSTR(APIO_NOP | _APIO_BUS_SIDE(__bus, 1)); \
+                                }                                                       \
+                                APIO_SM_CLKDIV_SET(__bus->div256 >> 8, __bus->div256 & 0xFF); \
+                                APIO_SM_EXECCTRL_SET(0);                                \
+                                APIO_SM_SHIFTCTRL_SET(                                  \
+                                    APIO_AUTOPULL |                                     \
+                                    APIO_PULL_THRESH(__bus->per_word * __bus_width) |   \
+                                    APIO_OUT_SHIFTDIR_R |                               \
+                                    APIO_FJOIN_TX);                                     \
+                                if (__bus->cfg.strobe == APIO_BUS_STROBE_NONE) {        \
+                                    APIO_SM_PINCTRL_SET(                                \
+                                        APIO_OUT_BASE(__bus->cfg.pin_base) |            \
+                                        APIO_OUT_COUNT(__bus_width));                   \
+                                } else {                                                \
+                                    APIO_SM_PINCTRL_SET(                                \
+                                        APIO_OUT_BASE(__bus->cfg.pin_base) |            \
+                                        APIO_OUT_COUNT(__bus_width) |                   \
+                                        APIO_SET_BASE(__bus->cfg.strobe_pin) |          \
+                                        APIO_SET_COUNT(1) |                             \
+                                        APIO_SIDE_SET_BASE(__bus->cfg.strobe_pin) |     \
+                                        APIO_SIDE_SET_COUNT(1));                        \
+                                    APIO_SM_EXEC_INSTR(APIO_SET_PIN_DIRS(1) | __bus_idle); \
+                                }                                                       \
+                                APIO_SM_EXEC_INSTR(APIO_MOV_PINS_NULL | __bus_idle);    \
+                                APIO_SM_EXEC_INSTR(APIO_MOV_PINDIRS_NOT_NULL | __bus_idle); \
+                                APIO_SM_EXEC_INSTR(APIO_JMP(APIO_START_LABEL()) | __bus_idle); \
+                            } while (0)
+
+// Bus words per second from a 24.8 fixed point clock divider
+static inline uint32_t apio_bus_rate(uint32_t sysclk_hz, uint32_t div256, uint8_t cycles) {
+    return (uint32_t)(((uint64_t)sysclk_hz * 256) / ((uint64_t)div256 * cycles));
+}
+
+// Validate the configuration, and compute the clock divider and achievable
+// rate.  Returns APIO_BUS_OK, APIO_BUS_ERR_ARGS or APIO_BUS_ERR_RATE.
+int apio_bus_init(apio_bus_t *bus, const apio_bus_cfg_t *cfg);
+
+// Bus words per second at the SM's current CLKDIV, which may since have been
+// changed from the one apio_bus_init() chose.
+uint32_t apio_bus_current_rate(const apio_bus_t *bus);
+
+// Log the configuration and rates using APIO_LOG().  No-op if logging is
+// disabled.
+void apio_bus_log(const apio_bus_t *bus);
+
+#if !defined(APIO_EMULATION)
+// Start the DMA channel feeding the SM's TX FIFO, then enable the SM.  Does
+// not disturb the block's other SMs.
+void apio_bus_start(apio_bus_t *bus);
+
+// 32-bit words DMA has yet to transfer.
+uint32_t apio_bus_remaining(const apio_bus_t *bus);
+
+// Returns 1 once DMA has finished and the TX FIFO is empty.  The final word
+// may still be being output from the OSR.
+int apio_bus_done(const apio_bus_t *bus);
+
+// Disable the SM and abort its DMA channel.
+void apio_bus_stop(apio_bus_t *bus);
+#else // APIO_EMULATION
+// Enable the SM in the emulated state.  Call before apio_sim_init().
+void apio_bus_start(apio_bus_t *bus);
+
+// Run the built-in interpreter, feeding the buffer to the SM's TX FIFO as
+// DMA would, until all bus words are output or MAX_CYCLES system clock cycles
+// have run.  Checks each bus word against the buffer as it is output, counting
+// mismatches in errors.  Returns the number of bus words output.
+uint32_t apio_bus_run_sim(apio_bus_t *bus, apio_sim_t *sim, uint64_t max_cycles);
+#endif // !APIO_EMULATION
+
+#if defined(APIO_BUS_IMPL)
+
+int apio_bus_init(apio_bus_t *bus, const apio_bus_cfg_t *cfg) {
+    memset(bus, 0, sizeof(*bus));
+    if ((cfg->width < 1) || (cfg->width > 32) ||
+        (cfg->pin_base > 31) ||
+        (cfg->strobe > APIO_BUS_STROBE_LOW) ||
+        (cfg->strobe_pin > 31) ||
+        (cfg->sysclk_hz == 0) ||
+        (cfg->buf == NULL) ||
+        (cfg->words < 1) || (cfg->words > APIO_DMA_TRANS_COUNT_MASK) ||
+        (cfg->dma_channel > 15)) {
+        return APIO_BUS_ERR_ARGS;
+    }
+    bus->cfg = *cfg;
+    bus->per_word = (uint8_t)(32 / cfg->width);
+    bus->cycles = (cfg->strobe == APIO_BUS_STROBE_NONE) ? 1 : 2;
+
+    uint32_t max = cfg->sysclk_hz / bus->cycles;
+    if (cfg->rate_hz > max) {
+        return APIO_BUS_ERR_RATE;
+    }
+
+    // Nearest 24.8 divider, between 1 and 65536
+    uint64_t div256 = 256;
+    if (cfg->rate_hz) {
+        uint64_t den = (uint64_t)cfg->rate_hz * bus->cycles;
+        div256 = (((uint64_t)cfg->sysclk_hz * 256) + (den / 2)) / den;
+    }
+    if (div256 < 256) {
+        div256 = 256;
+    } else if (div256 > (0x10000u << 8)) {
+        return APIO_BUS_ERR_RATE;
+    }
+    bus->div256 = (uint32_t)div256;
+    bus->rate_hz = apio_bus_rate(cfg->sysclk_hz, bus->div256, bus->cycles);
+    return APIO_BUS_OK;
+}
+
+uint32_t apio_bus_current_rate(const apio_bus_t *bus) {
+    uint32_t clkdiv = _apio_sm_reg_ptr(bus->block, bus->sm)->clkdiv;
+    uint32_t div_int = APIO_CLKDIV_INT_FROM_REG(clkdiv);
+    uint32_t div256 = ((div_int ? div_int : 0x10000) << 8) | APIO_CLKDIV_FRAC_FROM_REG(clkdiv);
+    return apio_bus_rate(bus->cfg.sysclk_hz, div256, bus->cycles);
+}
+
+void apio_bus_log(const apio_bus_t *bus) {
+#if defined(APIO_LOG_ENABLE)
+    APIO_LOG("Bus PIO%d SM%d: %d-bit, %s strobe, CLKDIV %u+%u/256, %u words/s (max %u, current %u)",
+        bus->block, bus->sm, bus->cfg.width,
+        (bus->cfg.strobe == APIO_BUS_STROBE_NONE) ? "no" :
+            ((bus->cfg.strobe == APIO_BUS_STROBE_HIGH) ? "high" : "low"),
+        (unsigned)(bus->div256 >> 8), (unsigned)(bus->div256 & 0xFF),
+        (unsigned)bus->rate_hz, (unsigned)(bus->cfg.sysclk_hz / bus->cycles),
+        (unsigned)apio_bus_current_rate(bus));
+    (void)bus;
+#else // !APIO_LOG_ENABLE
+    (void)bus;
+#endif // APIO_LOG_ENABLE
+}
+
+#if !defined(APIO_EMULATION)
+static inline uintptr_t _apio_bus_base(uint8_t block) {
+    return (block == 0) ? APIO0_BASE : ((block == 1) ? APIO1_BASE : APIO2_BASE);
+}
+
+void apio_bus_start(apio_bus_t *bus) {
+    volatile uint32_t *ctrl = (volatile uint32_t *)(_apio_bus_base(bus->block) + APIO_CTRL_OFFSET);
+    uint8_t ch = bus->cfg.dma_channel;
+
+    APIO_DMA_READ_ADDR(ch) = (uint32_t)(uintptr_t)bus->cfg.buf;
+    APIO_DMA_WRITE_ADDR(ch) = (uint32_t)(uintptr_t)_apio_txf_ptr(bus->block, bus->sm);
+    APIO_DMA_TRANS_COUNT(ch) = bus->cfg.words;
+    APIO_DMA_CTRL_TRIG(ch) =
+        APIO_DMA_CTRL_EN |
+        APIO_DMA_CTRL_HIGH_PRIORITY |
+        APIO_DMA_CTRL_DATA_SIZE_WORD |
+        APIO_DMA_CTRL_INCR_READ |
+        APIO_DMA_CTRL_CHAIN_TO(ch) |
+        APIO_DMA_CTRL_TREQ_SEL(APIO_DREQ_PIO_X_SM_Y_TX(bus->block, bus->sm));
+
+    *ctrl |= APIO_CTRL_SM_ENABLE(1u << bus->sm);
+}
+
+uint32_t apio_bus_remaining(const apio_bus_t *bus) {
+    return APIO_DMA_TRANS_COUNT(bus->cfg.dma_channel) & APIO_DMA_TRANS_COUNT_MASK;
+}
+
+int apio_bus_done(const apio_bus_t *bus) {
+    volatile uint32_t *fstat = (volatile uint32_t *)(_apio_bus_base(bus->block) + APIO_FSTAT_OFFSET);
+    return !apio_bus_remaining(bus) && (*fstat & APIO_FSTAT_SMX_TX_EMPTY_BIT(bus->sm));
+}
+
+void apio_bus_stop(apio_bus_t *bus) {
+    volatile uint32_t *ctrl = (volatile uint32_t *)(_apio_bus_base(bus->block) + APIO_CTRL_OFFSET);
+    *ctrl &= ~APIO_CTRL_SM_ENABLE(1u << bus->sm);
+    APIO_DMA_CHAN_ABORT = (1u << bus->cfg.dma_channel);
+    while (APIO_DMA_CHAN_ABORT & (1u << bus->cfg.dma_channel));
+}
+#else // APIO_EMULATION
+void apio_bus_start(apio_bus_t *bus) {
+    bus->fed = 0;
+    bus->out = 0;
+    bus->errors = 0;
+    _apio_emulated_pio.enabled_sms[bus->block] |= (uint8_t)(1u << bus->sm);
+    _APIO_EMU_DIRTY(bus->block);
+}
+
+uint32_t apio_bus_run_sim(apio_bus_t *bus, apio_sim_t *sim, uint64_t max_cycles) {
+    apio_sim_sm_t *sm = &sim->sm[bus->sm];
+    uint8_t width = bus->cfg.width;
+    uint8_t base = bus->cfg.pin_base;
+    uint32_t mask = (width >= 32) ? 0xFFFFFFFFu : ((1u << width) - 1);
+    uint32_t total = bus->cfg.words * bus->per_word;
+    uint32_t active = (bus->cfg.strobe == APIO_BUS_STROBE_HIGH) ? 1 : 0;
+    uint32_t strobe = (apio_sim_pin_levels(sim) >> bus->cfg.strobe_pin) & 1;
+
+    for (uint64_t cycle = 0; (cycle < max_cycles) && (bus->out < total); cycle++) {
+        while ((bus->fed < bus->cfg.words) && (sm->tx.level < sm->tx.depth)) {
+            apio_sim_tx_put(sim, bus->sm, bus->cfg.buf[bus->fed++]);
+        }
+
+        uint64_t instrs = sm->stats.instrs;
+        apio_sim_step(sim);
+        uint32_t levels = apio_sim_pin_levels(sim);
+        int latch;
+        if (bus->cfg.strobe == APIO_BUS_STROBE_NONE) {
+            latch = (sm->stats.instrs != instrs);
+        } else {
+            uint32_t level = (levels >> bus->cfg.strobe_pin) & 1;
+            latch = (level == active) && (strobe != active);
+            strobe = level;
+        }
+        if (!latch) {
+            continue;
+        }
+
+        uint32_t got = (base ? ((levels >> base) | (levels << (32 - base))) : levels) & mask;
+        uint32_t word = bus->cfg.buf[bus->out / bus->per_word];
+        uint32_t expect = (width >= 32) ? word : ((word >> ((bus->out % bus->per_word) * width)) & mask);
+        if (got != expect) {
+            bus->errors++;
+        }
+        bus->out++;
+    }
+    return bus->out;
+}
+#endif // !APIO_EMULATION
+
+#endif // APIO_BUS_IMPL
+
+#endif // APIO_BUS_H
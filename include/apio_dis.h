@@ -314,6 +314,12 @@ void apio_instruction_decoder(uint16_t instr, char *out_str, uint8_t start_offse
 
             p = append_str(p, " ");
             p = append_uint(p, index);
+
+            // rel
+            if ((source == 0b10) && (idx_mode == 0b10)) {
+                p = append_str(p, " rel");
+            }
+
             p = append_delay(p, delay);
             *p = '\0';
             break;
@@ -321,7 +327,7 @@ void apio_instruction_decoder(uint16_t instr, char *out_str, uint8_t start_offse
         
         case 0b010: { // IN
             uint8_t source = (instr >> 5) & 0x7;
-            uint8_t bitcount = instr & 0x1F;
+            uint8_t bitcount = APIO_THRESH32(instr & 0x1F);
             p = out_str;
             p = append_str(p, "in ");
             p = append_str(p, piorom_get_in_source(source));
@@ -334,7 +340,7 @@ void apio_instruction_decoder(uint16_t instr, char *out_str, uint8_t start_offse
         
         case 0b011: { // OUT
             uint8_t dest = (instr >> 5) & 0x7;
-            uint8_t bitcount = instr & 0x1F;
+            uint8_t bitcount = APIO_THRESH32(instr & 0x1F);
             p = out_str;
             p = append_str(p, "out ");
             p = append_str(p, piorom_get_out_dest(dest));
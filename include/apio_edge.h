@@ -0,0 +1,411 @@
+// Copyright (C) 2026 Piers Finlayson <piers@piers.rocks>
+//
+// MIT License
+
+// apio - Runtime RP2350 PIO Assembler and Disassembler
+//
+// Edge timestamping and frequency counter.
+//
+// Builds an SM which times the edges on a pin by counting X down, testing the
+// pin with `jmp pin` between decrements, and pushes the counts to its RX
+// FIFO, which a DREQ-paced DMA channel drains into an SRAM buffer.  The CPU
+// converts the counts to intervals and timestamps in system clock cycles,
+// using the SM's CLKDIV.  Modes:
+//
+// - APIO_EDGE_MODE_RISING / FALLING - one count per period, from one rising
+//   (or falling) edge to the next.
+// - APIO_EDGE_MODE_BOTH - one count per edge, alternately the high and low
+//   times.
+// - APIO_EDGE_MODE_GATED - the number of rising edges in each gate of `gate`
+//   loops, for frequency measurement.
+//
+//   static uint32_t buf[256];
+//   static uint64_t ts[256];
+//   apio_edge_t edge;
+//   apio_edge_cfg_t cfg = {
+//       .mode = APIO_EDGE_MODE_RISING, .pin = 4, .clkdiv = 1,
+//       .sysclk_hz = 150000000, .dma_channel = 0, .buf = buf, .words = 256,
+//   };
+//   apio_edge_init(&edge, &cfg);
+//   // In the assembly scope:
+//   APIO_SET_SM(0);
+//   APIO_EDGE_ADD(&edge);
+//   // After APIO_END_BLOCK():
+//   apio_edge_start(&edge);
+//   while (apio_edge_captured(&edge) < 256);
+//   uint32_t num = apio_edge_timestamps(&edge, ts, 256);
+//
+// Each loop of the program tests the pin, then decrements X, so edges are
+// detected to within APIO_EDGE_LOOP_CYCLES SM cycles - an SM cycle can test
+// the pin or decrement X, but not both.  That detection error doesn't
+// accumulate, as the SM counts continuously, and the fixed cycles spent
+// pushing each count are added back on conversion, so timestamps stay within
+// APIO_EDGE_LOOP_CYCLES SM cycles of the edges however long the capture.
+// Pulses shorter than APIO_EDGE_MIN_CYCLES may be missed.
+//
+// The first count of a single- or dual-edge capture runs from the SM
+// starting, after it has waited for the pin to be low (high for FALLING), to
+// the first edge, so it is partial, and apio_edge_timestamps() uses that edge
+// as time 0.  In dual-edge mode it is a rising edge, so the counts after it
+// are alternately high and low times.  Counts wrap after 2^32 loops.
+//
+// In gated mode X counts down the gate while Y counts the rising edges.  As
+// each edge costs an extra APIO_EDGE_GATE_EDGE_CYCLES, the gate lasts
+// 2 * (gate + 1) + APIO_EDGE_GATE_CYCLES + (edges * APIO_EDGE_GATE_EDGE_CYCLES)
+// SM cycles, to within one, which apio_edge_freq() accounts for.
+//
+// In emulation there is no DMA, so apio_edge_poll_sim() drains the SM's RX
+// FIFO in the built-in interpreter into the buffer instead.  Call it between
+// runs, often enough that the FIFO does not fill.  Drive the pin via
+// apio_sim_t.gpio_in.
+//
+// The implementation is included in the source file that defines
+// APIO_EDGE_IMPL.
+
+#ifndef APIO_EDGE_H
+#define APIO_EDGE_H
+
+#include <apio.h>
+#if defined(APIO_EMULATION)
+#include <apio_sim.h>
+#endif // APIO_EMULATION
+
+// Return codes
+#define APIO_EDGE_OK            0
+#define APIO_EDGE_ERR_ARGS      -1
+
+// Modes, for apio_edge_cfg_t.mode
+#define APIO_EDGE_MODE_RISING   0
+#define APIO_EDGE_MODE_FALLING  1
+#define APIO_EDGE_MODE_BOTH     2
+#define APIO_EDGE_MODE_GATED    3
+
+// Timing, in SM cycles.  A single-edge count N is an interval of
+// (N * APIO_EDGE_LOOP_CYCLES) + APIO_EDGE_SINGLE_CYCLES, and a dual-edge
+// count (N * APIO_EDGE_LOOP_CYCLES) + APIO_EDGE_DUAL_CYCLES.
+#define APIO_EDGE_LOOP_CYCLES       2
+#define APIO_EDGE_SINGLE_CYCLES     4
+#define APIO_EDGE_DUAL_CYCLES       3
+#define APIO_EDGE_GATE_CYCLES       4
+#define APIO_EDGE_GATE_EDGE_CYCLES  3
+#define APIO_EDGE_MIN_CYCLES        4
+
+// Capture configuration, for apio_edge_init()
+typedef struct {
+    uint8_t mode;           // APIO_EDGE_MODE_*
+    uint8_t pin;            // JMP_PIN, relative to GPIOBASE
+    uint16_t clkdiv;        // SM clock divider, 1-65535
+    uint32_t gate;          // Gated mode: loops per gate, 1 or more
+    uint32_t sysclk_hz;     // System clock, for apio_edge_freq()
+    uint8_t dma_channel;
+    uint32_t *buf;
+    uint32_t words;         // Length of buf
+} apio_edge_cfg_t;
+
+typedef struct {
+    apio_edge_cfg_t cfg;
+    uint8_t block;          // Set by APIO_EDGE_ADD()
+    uint8_t sm;             // Set by APIO_EDGE_ADD()
+    uint8_t stalled;        // The RX FIFO filled, so edges may have been lost
+    uint32_t used;          // Words captured
+} apio_edge_t;
+
+// Instructions used by the program
+#define APIO_EDGE_INSTRS(EDGE)  ((uint8_t[]){ 9, 9, 11, 14 }[(EDGE)->cfg.mode & 3])
+
+// Internal macro - do not use directly.  The single- and dual-edge programs.
+// lo and hi each test the pin and then decrement X, and an edge detected by
+// one branches to the other, via a push if the edge is counted.  The `jmp`
+// after each `jmp x--` is only reached when X wraps.
+#define _APIO_EDGE_ADD_EDGES(EDGE) \
+                            do {                                                        \
+                                uint8_t __e = APIO_INSTR_COUNT();                       \
+                                uint8_t __e_pin = (EDGE)->cfg.pin;                      \
+                                if ((EDGE)->cfg.mode == APIO_EDGE_MODE_FALLING) {       \
+                                    APIO_ADD_INSTR(APIO_WAIT_GPIO_HIGH(__e_pin));       \
+                                    APIO_WRAP_BOTTOM();                                 \
+                                    APIO_ADD_INSTR(APIO_JMP_PIN(__e + 7));              \
+                                    APIO_ADD_INSTR(APIO_IN_X(32));                      \
+                                    APIO_ADD_INSTR(APIO_MOV_SRC_INVERT(APIO_MOV_X_NULL)); \
+                                    APIO_ADD_INSTR(APIO_JMP_PIN(__e + 1));              \
+                                    APIO_ADD_INSTR(APIO_JMP_X_DEC(__e + 4));            \
+                                    APIO_ADD_INSTR(APIO_JMP(__e + 4));                  \
+                                    APIO_ADD_INSTR(APIO_JMP_X_DEC(__e + 1));            \
+                                    APIO_WRAP_TOP();                                    \
+                                    APIO_ADD_INSTR(APIO_JMP(__e + 1));                  \
+                                } else {                                                \
+                                    uint8_t __e_both = ((EDGE)->cfg.mode == APIO_EDGE_MODE_BOTH) ? 2 : 0; \
+                                    APIO_ADD_INSTR(APIO_WAIT_GPIO_LOW(__e_pin));        \
+                                    APIO_WRAP_BOTTOM();                                 \
+                                    APIO_ADD_INSTR(APIO_JMP_PIN(__e + 4));              \
+                                    APIO_ADD_INSTR(APIO_JMP_X_DEC(__e + 1));            \
+                                    APIO_ADD_INSTR(APIO_JMP(__e + 1));                  \
+                                    APIO_ADD_INSTR(APIO_IN_X(32));                      \
+                                    APIO_ADD_INSTR(APIO_MOV_SRC_INVERT(APIO_MOV_X_NULL)); \
+                                    if (__e_both) {                                     \
+                                        APIO_ADD_INSTR(APIO_JMP_PIN(__e + 9));          \
+                                        APIO_ADD_INSTR(APIO_IN_X(32));                  \
+                                        APIO_WRAP_TOP();                                \
+                                        APIO_ADD_INSTR(APIO_MOV_SRC_INVERT(APIO_MOV_X_NULL)); \
+                                    } else {                                            \
+                                        APIO_WRAP_TOP();                                \
+                                        APIO_ADD_INSTR(APIO_JMP_PIN(__e + 7));          \
+                                    }                                                   \
+                                    APIO_ADD_INSTR(APIO_JMP_X_DEC(__e + 6));            \
+                                    APIO_ADD_INSTR(APIO_JMP(__e + 6));                  \
+                                }                                                       \
+                            } while (0)
+
+// Internal macro - do not use directly.  The gated program.  X counts down
+// the gate, loaded from the OSR, and Y counts rising edges down from ~0.
+// When X runs out, Y is pushed and both are reloaded, resuming in the same
+// pin state.
+#define _APIO_EDGE_ADD_GATED(EDGE) \
+                            do {                                                        \
+                                uint8_t __e = APIO_INSTR_COUNT();                       \
+                                APIO_ADD_INSTR(APIO_WAIT_GPIO_LOW((EDGE)->cfg.pin));    \
+                                APIO_WRAP_BOTTOM();                                     \
+                                APIO_ADD_INSTR(APIO_JMP_PIN(__e + 7));                  \
+                                APIO_ADD_INSTR(APIO_JMP_X_DEC(__e + 1));                \
+                                APIO_ADD_INSTR(APIO_IN_Y(32));                          \
+                                APIO_ADD_INSTR(APIO_MOV_SRC_INVERT(APIO_MOV_Y_NULL));   \
+                                APIO_ADD_INSTR(APIO_MOV_X_OSR);                         \
+                                APIO_ADD_INSTR(APIO_JMP(__e + 1));                      \
+                                APIO_ADD_INSTR(APIO_JMP_Y_DEC(__e + 8));                \
+                                APIO_WRAP_TOP();                                        \
+                                APIO_ADD_INSTR(APIO_JMP_PIN(__e + 9));                  \
+                                APIO_ADD_INSTR(APIO_JMP_X_DEC(__e + 8));                \
+                                APIO_ADD_INSTR(APIO_IN_Y(32));                          \
+                                APIO_ADD_INSTR(APIO_MOV_SRC_INVERT(APIO_MOV_Y_NULL));   \
+                                APIO_ADD_INSTR(APIO_MOV_X_OSR);                         \
+                                APIO_ADD_INSTR(APIO_JMP(__e + 8));                      \
+                            } while (0)
+
+// Build the program for the current SM, and configure the SM.  Call
+// immediately after APIO_SET_SM().  The RX FIFO is joined, except in gated
+// mode, where the gate is loaded into the OSR via the TX FIFO - one push per
+// gate doesn't need the depth.
+#define APIO_EDGE_ADD(EDGE) \
+                            do {                                                        \
+                                apio_edge_t *__edge = (EDGE);                           \
+                                __edge->block = __blk;                                  \
+                                __edge->sm = __sm;                                      \
+                                APIO_START();                                           \
+                                if (__edge->cfg.mode == APIO_EDGE_MODE_GATED) {         \
+                                    _APIO_EDGE_ADD_GATED(__edge);                       \
+                                } else {                                                \
+                                    _APIO_EDGE_ADD_EDGES(__edge);                       \
+                                }                                                       \
+                                APIO_SM_CLKDIV_SET(__edge->cfg.clkdiv, 0);              \
+                                APIO_SM_EXECCTRL_SET(APIO_EXECCTRL_JMP_PIN(__edge->cfg.pin)); \
+                                APIO_SM_PINCTRL_SET(0);                                 \
+                                if (__edge->cfg.mode == APIO_EDGE_MODE_GATED) {         \
+                                    APIO_SM_SHIFTCTRL_SET(                              \
+                                        APIO_AUTOPUSH |                                 \
+                                        APIO_PUSH_THRESH(32) |                          \
+                                        APIO_IN_SHIFTDIR_L);                            \
+                                    APIO_TXF_PUT(__edge->cfg.gate);                     \
+                                    APIO_SM_EXEC_INSTR(APIO_PULL_BLOCK);                \
+                                    APIO_SM_EXEC_INSTR(APIO_MOV_X_OSR);                 \
+                                    APIO_SM_EXEC_INSTR(APIO_MOV_SRC_INVERT(APIO_MOV_Y_NULL)); \
+                                } else {                                                \
+                                    APIO_SM_SHIFTCTRL_SET(                              \
+                                        APIO_AUTOPUSH |                                 \
+                                        APIO_PUSH_THRESH(32) |                          \
+                                        APIO_IN_SHIFTDIR_L |                            \
+                                        APIO_FJOIN_RX);                                 \
+                                    APIO_SM_EXEC_INSTR(APIO_MOV_SRC_INVERT(APIO_MOV_X_NULL)); \
+                                }                                                       \
+                                APIO_SM_JMP_TO_START();                                 \
+                            } while (0)
+
+// Validate the configuration.  Returns APIO_EDGE_OK or APIO_EDGE_ERR_ARGS.
+int apio_edge_init(apio_edge_t *edge, const apio_edge_cfg_t *cfg);
+
+// The SM's current clock divider, 24.8 fixed point.
+uint32_t apio_edge_div256(const apio_edge_t *edge);
+
+// SM cycles between the edges bounding a single- or dual-edge count.
+static inline uint64_t apio_edge_sm_cycles(const apio_edge_t *edge, uint32_t count) {
+    return ((uint64_t)~count * APIO_EDGE_LOOP_CYCLES) +
+           ((edge->cfg.mode == APIO_EDGE_MODE_BOTH) ? APIO_EDGE_DUAL_CYCLES : APIO_EDGE_SINGLE_CYCLES);
+}
+
+// Convert the captured single- or dual-edge counts to timestamps of the
+// edges which ended them, in system clock cycles from the first edge, at the
+// SM's current CLKDIV.  ts[0] is the first edge, so 0, as the first count is
+// partial.  Returns the number of timestamps, up to MAX.
+uint32_t apio_edge_timestamps(const apio_edge_t *edge, uint64_t *ts, uint32_t max);
+
+// The frequency, in Hz, from captured gated count INDEX.
+uint32_t apio_edge_freq(const apio_edge_t *edge, uint32_t index);
+
+// Log the configuration and capture state using APIO_LOG().  No-op if
+// logging is disabled.
+void apio_edge_log(const apio_edge_t *edge);
+
+#if !defined(APIO_EMULATION)
+// Clear the SM's RX FIFO, start the DMA channel draining it into the buffer,
+// then restart and enable the SM.
+void apio_edge_start(apio_edge_t *edge);
+
+// Words captured so far.  Also latches stalled if the RX FIFO filled.
+uint32_t apio_edge_captured(apio_edge_t *edge);
+
+// Disable the SM and abort its DMA channel.
+void apio_edge_stop(apio_edge_t *edge);
+#else // APIO_EMULATION
+// Enable the SM in the emulated state.  Call before apio_sim_init().
+void apio_edge_start(apio_edge_t *edge);
+
+// Drain the SM's RX FIFO into the buffer.  Returns the words captured so far.
+// Sets stalled if the SM stalled on a full RX FIFO.
+uint32_t apio_edge_poll_sim(apio_edge_t *edge, apio_sim_t *sim);
+#endif // !APIO_EMULATION
+
+#if defined(APIO_EDGE_IMPL)
+
+int apio_edge_init(apio_edge_t *edge, const apio_edge_cfg_t *cfg) {
+    memset(edge, 0, sizeof(*edge));
+    if ((cfg->mode > APIO_EDGE_MODE_GATED) ||
+        (cfg->pin > 31) ||
+        (cfg->clkdiv < 1) ||
+        ((cfg->mode == APIO_EDGE_MODE_GATED) && (cfg->gate < 1)) ||
+        (cfg->sysclk_hz == 0) ||
+        (cfg->buf == NULL) ||
+        (cfg->words < 1) || (cfg->words > APIO_DMA_TRANS_COUNT_MASK) ||
+        (cfg->dma_channel > 15)) {
+        return APIO_EDGE_ERR_ARGS;
+    }
+    edge->cfg = *cfg;
+    return APIO_EDGE_OK;
+}
+
+uint32_t apio_edge_div256(const apio_edge_t *edge) {
+    uint32_t clkdiv = _apio_sm_reg_ptr(edge->block, edge->sm)->clkdiv;
+    uint32_t div_int = APIO_CLKDIV_INT_FROM_REG(clkdiv);
+    return ((div_int ? div_int : 0x10000) << 8) | APIO_CLKDIV_FRAC_FROM_REG(clkdiv);
+}
+
+uint32_t apio_edge_timestamps(const apio_edge_t *edge, uint64_t *ts, uint32_t max) {
+    if (edge->cfg.mode == APIO_EDGE_MODE_GATED) {
+        return 0;
+    }
+
+    // Accumulate in SM cycles, converting each, so rounding doesn't accumulate
+    uint64_t div256 = apio_edge_div256(edge);
+    uint64_t sm_cycles = 0;
+    uint32_t num = 0;
+    for (uint32_t ii = 0; (ii < edge->used) && (num < max); ii++) {
+        if (ii > 0) {
+            sm_cycles += apio_edge_sm_cycles(edge, edge->cfg.buf[ii]);
+        }
+        ts[num++] = ((sm_cycles * div256) + 128) >> 8;
+    }
+    return num;
+}
+
+uint32_t apio_edge_freq(const apio_edge_t *edge, uint32_t index) {
+    if ((edge->cfg.mode != APIO_EDGE_MODE_GATED) || (index >= edge->used)) {
+        return 0;
+    }
+    uint64_t edges = (uint32_t)~edge->cfg.buf[index];
+    uint64_t sm_cycles = ((uint64_t)edge->cfg.gate + 1) * APIO_EDGE_LOOP_CYCLES +
+                         APIO_EDGE_GATE_CYCLES + (edges * APIO_EDGE_GATE_EDGE_CYCLES);
+    uint64_t sys_cycles = ((sm_cycles * apio_edge_div256(edge)) + 128) >> 8;
+    return (uint32_t)(((edges * edge->cfg.sysclk_hz) + (sys_cycles / 2)) / sys_cycles);
+}
+
+void apio_edge_log(const apio_edge_t *edge) {
+#if defined(APIO_LOG_ENABLE)
+    static const char *modes[] = { "rising", "falling", "both", "gated" };
+    uint32_t div256 = apio_edge_div256(edge);
+    APIO_LOG("Edge PIO%d SM%d: pin %d, %s, CLKDIV %u+%u/256, gate %u, %u/%u words%s",
+        edge->block, edge->sm, edge->cfg.pin, modes[edge->cfg.mode & 3],
+        (unsigned)(div256 >> 8), (unsigned)(div256 & 0xFF), (unsigned)edge->cfg.gate,
+        (unsigned)edge->used, (unsigned)edge->cfg.words, edge->stalled ? ", stalled" : "");
+    (void)edge;
+    (void)modes;
+    (void)div256;
+#else // !APIO_LOG_ENABLE
+    (void)edge;
+#endif // APIO_LOG_ENABLE
+}
+
+#if !defined(APIO_EMULATION)
+static inline uintptr_t _apio_edge_base(uint8_t block) {
+    return (block == 0) ? APIO0_BASE : ((block == 1) ? APIO1_BASE : APIO2_BASE);
+}
+
+void apio_edge_start(apio_edge_t *edge) {
+    uintptr_t base = _apio_edge_base(edge->block);
+    volatile uint32_t *ctrl = (volatile uint32_t *)(base + APIO_CTRL_OFFSET);
+    volatile uint32_t *fdebug = (volatile uint32_t *)(base + APIO_FDEBUG_OFFSET);
+    volatile pio_sm_reg_t *reg = (volatile pio_sm_reg_t *)(base + APIO_SM_REG_OFFSET + (edge->sm * 0x18));
+    uint8_t ch = edge->cfg.dma_channel;
+
+    edge->used = 0;
+    edge->stalled = 0;
+
+    // Toggling FJOIN_RX twice clears the FIFOs - so in gated mode, where the
+    // gate was loaded via the TX FIFO, the OSR already holds it
+    reg->shiftctrl ^= APIO_FJOIN_RX;
+    reg->shiftctrl ^= APIO_FJOIN_RX;
+    *fdebug = APIO_FDEBUG_RXSTALL(edge->sm);
+
+    APIO_DMA_READ_ADDR(ch) = (uint32_t)(uintptr_t)_apio_rxf_ptr(edge->block, edge->sm);
+    APIO_DMA_WRITE_ADDR(ch) = (uint32_t)(uintptr_t)edge->cfg.buf;
+    APIO_DMA_TRANS_COUNT(ch) = edge->cfg.words;
+    APIO_DMA_CTRL_TRIG(ch) =
+        APIO_DMA_CTRL_EN |
+        APIO_DMA_CTRL_HIGH_PRIORITY |
+        APIO_DMA_CTRL_DATA_SIZE_WORD |
+        APIO_DMA_CTRL_INCR_WRITE |
+        APIO_DMA_CTRL_CHAIN_TO(ch) |
+        APIO_DMA_CTRL_TREQ_SEL(APIO_DREQ_PIO_X_SM_Y_RX(edge->block, edge->sm));
+
+    *ctrl |= APIO_CTRL_SM_ENABLE(1u << edge->sm) | APIO_CTRL_CLKDIV_RESTART(1u << edge->sm);
+}
+
+uint32_t apio_edge_captured(apio_edge_t *edge) {
+    volatile uint32_t *fdebug = (volatile uint32_t *)(_apio_edge_base(edge->block) + APIO_FDEBUG_OFFSET);
+    uint32_t remaining = APIO_DMA_TRANS_COUNT(edge->cfg.dma_channel) & APIO_DMA_TRANS_COUNT_MASK;
+    if (remaining && (*fdebug & APIO_FDEBUG_RXSTALL(edge->sm))) {
+        *fdebug = APIO_FDEBUG_RXSTALL(edge->sm);
+        edge->stalled = 1;
+    }
+    edge->used = edge->cfg.words - remaining;
+    return edge->used;
+}
+
+void apio_edge_stop(apio_edge_t *edge) {
+    volatile uint32_t *ctrl = (volatile uint32_t *)(_apio_edge_base(edge->block) + APIO_CTRL_OFFSET);
+    *ctrl &= ~APIO_CTRL_SM_ENABLE(1u << edge->sm);
+    APIO_DMA_CHAN_ABORT = (1u << edge->cfg.dma_channel);
+    while (APIO_DMA_CHAN_ABORT & (1u << edge->cfg.dma_channel));
+}
+#else // APIO_EMULATION
+void apio_edge_start(apio_edge_t *edge) {
+    edge->used = 0;
+    edge->stalled = 0;
+    _apio_emulated_pio.enabled_sms[edge->block] |= (uint8_t)(1u << edge->sm);
+    _APIO_EMU_DIRTY(edge->block);
+}
+
+uint32_t apio_edge_poll_sim(apio_edge_t *edge, apio_sim_t *sim) {
+    apio_sim_sm_t *sm = &sim->sm[edge->sm];
+    if (sm->stats.stall_cycles[APIO_SIM_STALL_RX_FULL]) {
+        edge->stalled = 1;
+    }
+    uint32_t word;
+    while ((edge->used < edge->cfg.words) && sm->rx.level &&
+           apio_sim_rx_get(sim, edge->sm, &word)) {
+        edge->cfg.buf[edge->used++] = word;
+    }
+    return edge->used;
+}
+#endif // !APIO_EMULATION
+
+#endif // APIO_EDGE_IMPL
+
+#endif // APIO_EDGE_H
@@ -0,0 +1,263 @@
+// Copyright (C) 2026 Piers Finlayson <piers@piers.rocks>
+//
+// MIT License
+
+// apio - Runtime RP2350 PIO Assembler and Disassembler
+//
+// Emulation state snapshot, restore and diff.
+//
+// Allows a configured emulated PIO and GPIO state to be checkpointed once and
+// then restored before each of several test scenarios, instead of re-running
+// the whole APIO_ASM_INIT() based setup for each.  Two snapshots can also be
+// compared, reporting which blocks, SMs, registers and instruction slots
+// differ.
+//
+// Only available when APIO_EMULATION is defined.  As with the emulated state
+// itself, the implementation is included in the source file that defines
+// APIO_EMU_IMPL.
+
+#ifndef APIO_EMU_H
+#define APIO_EMU_H
+
+#include <apio.h>
+
+#if defined(APIO_EMULATION)
+
+// A complete copy of the emulated PIO and GPIO state.
+typedef struct {
+    _apio_emulated_pio_t pio;
+    _apio_emulated_gpio_t gpios;
+} apio_emu_snapshot_t;
+
+// SM register bits in apio_emu_diff_t.sm_regs
+#define APIO_EMU_DIFF_REG_CLKDIV        (1 << 0)
+#define APIO_EMU_DIFF_REG_EXECCTRL      (1 << 1)
+#define APIO_EMU_DIFF_REG_SHIFTCTRL     (1 << 2)
+#define APIO_EMU_DIFF_REG_ADDR          (1 << 3)
+#define APIO_EMU_DIFF_REG_INSTR         (1 << 4)
+#define APIO_EMU_DIFF_REG_PINCTRL       (1 << 5)
+
+// Per-SM program and queue bits in apio_emu_diff_t.sm_fields
+#define APIO_EMU_DIFF_SM_FIRST_INSTR    (1 << 0)
+#define APIO_EMU_DIFF_SM_START          (1 << 1)
+#define APIO_EMU_DIFF_SM_END            (1 << 2)
+#define APIO_EMU_DIFF_SM_WRAP           (1 << 3)
+#define APIO_EMU_DIFF_SM_PRE_INSTR      (1 << 4)
+#define APIO_EMU_DIFF_SM_TX_FIFO        (1 << 5)
+#define APIO_EMU_DIFF_SM_RX_FIFO        (1 << 6)
+
+// Per-block bits in apio_emu_diff_t.block_fields
+#define APIO_EMU_DIFF_BLOCK_IRQ         (1 << 0)
+#define APIO_EMU_DIFF_BLOCK_OFFSET      (1 << 1)
+#define APIO_EMU_DIFF_BLOCK_ENABLED     (1 << 2)
+#define APIO_EMU_DIFF_BLOCK_ENDED       (1 << 3)
+#define APIO_EMU_DIFF_BLOCK_GPIOBASE    (1 << 4)
+#define APIO_EMU_DIFF_BLOCK_FDEBUG      (1 << 5)
+#define APIO_EMU_DIFF_BLOCK_FLEVEL      (1 << 6)
+
+// Structural differences between two snapshots.  All fields are bitmasks.
+typedef struct {
+    // Blocks with any difference, including in their SMs
+    uint8_t blocks;
+    // Per block, SMs with any difference
+    uint8_t sms[APIO_MAX_PIO_BLOCKS];
+    // Per block, APIO_EMU_DIFF_BLOCK_* fields that differ
+    uint8_t block_fields[APIO_MAX_PIO_BLOCKS];
+    // Per block, instruction slots that differ
+    uint32_t instr[APIO_MAX_PIO_BLOCKS];
+    // Per SM, APIO_EMU_DIFF_REG_* registers that differ
+    uint8_t sm_regs[APIO_MAX_PIO_BLOCKS][APIO_MAX_SMS_PER_BLOCK];
+    // Per SM, APIO_EMU_DIFF_SM_* fields that differ
+    uint8_t sm_fields[APIO_MAX_PIO_BLOCKS][APIO_MAX_SMS_PER_BLOCK];
+    // GPIOs whose emulated configuration differs
+    uint64_t gpios;
+    // Non-zero if the current block/SM selection or pios_enabled differ
+    uint8_t cursor;
+} apio_emu_diff_t;
+
+// Copy the current emulated PIO and GPIO state into SNAP.
+void apio_emu_snapshot(apio_emu_snapshot_t *snap);
+
+// Replace the current emulated PIO and GPIO state with SNAP.
+void apio_emu_restore(const apio_emu_snapshot_t *snap);
+
+// Compare two snapshots, filling in DIFF.  Returns 0 if they are identical,
+// non-zero otherwise.
+int apio_emu_diff(
+    const apio_emu_snapshot_t *a,
+    const apio_emu_snapshot_t *b,
+    apio_emu_diff_t *diff
+);
+
+// Log the contents of a diff using APIO_LOG().  No-op if logging is disabled.
+void apio_emu_diff_log(const apio_emu_diff_t *diff);
+
+#if defined(APIO_EMU_IMPL)
+
+#include <string.h>
+
+void apio_emu_snapshot(apio_emu_snapshot_t *snap) {
+    snap->pio = _apio_emulated_pio;
+    snap->gpios = _apio_emulated_gpios;
+}
+
+void apio_emu_restore(const apio_emu_snapshot_t *snap) {
+    uint32_t generation = _apio_emulated_pio.layout.generation;
+    _apio_emulated_pio = snap->pio;
+    _apio_emulated_gpios = snap->gpios;
+
+    // Any block may differ from what was last handed off
+    _apio_emulated_pio.layout.generation = generation;
+    _apio_emulated_pio.layout.dirty_blocks = APIO_EMU_ALL_BLOCKS;
+}
+
+static uint8_t apio_emu_diff_sm_regs(const pio_sm_reg_t *a, const pio_sm_reg_t *b) {
+    uint8_t regs = 0;
+    if (a->clkdiv != b->clkdiv) regs |= APIO_EMU_DIFF_REG_CLKDIV;
+    if (a->execctrl != b->execctrl) regs |= APIO_EMU_DIFF_REG_EXECCTRL;
+    if (a->shiftctrl != b->shiftctrl) regs |= APIO_EMU_DIFF_REG_SHIFTCTRL;
+    if (a->addr != b->addr) regs |= APIO_EMU_DIFF_REG_ADDR;
+    if (a->instr != b->instr) regs |= APIO_EMU_DIFF_REG_INSTR;
+    if (a->pinctrl != b->pinctrl) regs |= APIO_EMU_DIFF_REG_PINCTRL;
+    return regs;
+}
+
+// Compares the populated part of a FIFO or queue - entries beyond the count
+// (or capacity, if the count has overrun it) are stale and ignored.
+static int apio_emu_diff_queue(
+    const void *a,
+    const void *b,
+    uint32_t count_a,
+    uint32_t count_b,
+    uint32_t capacity,
+    uint32_t entry_size
+) {
+    if (count_a != count_b) return 1;
+    if (count_a > capacity) count_a = capacity;
+    return memcmp(a, b, count_a * entry_size) != 0;
+}
+
+int apio_emu_diff(
+    const apio_emu_snapshot_t *a,
+    const apio_emu_snapshot_t *b,
+    apio_emu_diff_t *diff
+) {
+    const _apio_emulated_pio_t *pa = &a->pio;
+    const _apio_emulated_pio_t *pb = &b->pio;
+
+    memset(diff, 0, sizeof(*diff));
+
+    // Fast path - snapshots taken from the same state compare equal bytewise
+    if (memcmp(a, b, sizeof(*a)) == 0) {
+        return 0;
+    }
+
+    for (int blk = 0; blk < APIO_MAX_PIO_BLOCKS; blk++) {
+        uint8_t fields = 0;
+        if (pa->irq[blk] != pb->irq[blk]) fields |= APIO_EMU_DIFF_BLOCK_IRQ;
+        if ((pa->offset[blk] != pb->offset[blk]) ||
+            (pa->max_offset[blk] != pb->max_offset[blk])) {
+            fields |= APIO_EMU_DIFF_BLOCK_OFFSET;
+        }
+        if (pa->enabled_sms[blk] != pb->enabled_sms[blk]) fields |= APIO_EMU_DIFF_BLOCK_ENABLED;
+        if (pa->block_ended[blk] != pb->block_ended[blk]) fields |= APIO_EMU_DIFF_BLOCK_ENDED;
+        if (pa->gpio_base[blk] != pb->gpio_base[blk]) fields |= APIO_EMU_DIFF_BLOCK_GPIOBASE;
+        if (pa->fdebug[blk] != pb->fdebug[blk]) fields |= APIO_EMU_DIFF_BLOCK_FDEBUG;
+        if (pa->flevel[blk] != pb->flevel[blk]) fields |= APIO_EMU_DIFF_BLOCK_FLEVEL;
+        diff->block_fields[blk] = fields;
+
+        uint32_t instr = 0;
+        for (int ii = 0; ii < APIO_MAX_PIO_INSTRS; ii++) {
+            if (pa->instr[blk][ii] != pb->instr[blk][ii]) {
+                instr |= (1u << ii);
+            }
+        }
+        diff->instr[blk] = instr;
+
+        uint8_t sms = 0;
+        for (int sm = 0; sm < APIO_MAX_SMS_PER_BLOCK; sm++) {
+            uint8_t regs = apio_emu_diff_sm_regs(&pa->pio_sm_reg[blk][sm], &pb->pio_sm_reg[blk][sm]);
+            uint8_t sm_fields = 0;
+            if (pa->first_instr[blk][sm] != pb->first_instr[blk][sm]) sm_fields |= APIO_EMU_DIFF_SM_FIRST_INSTR;
+            if (pa->start[blk][sm] != pb->start[blk][sm]) sm_fields |= APIO_EMU_DIFF_SM_START;
+            if (pa->end[blk][sm] != pb->end[blk][sm]) sm_fields |= APIO_EMU_DIFF_SM_END;
+            if ((pa->wrap_bottom[blk][sm] != pb->wrap_bottom[blk][sm]) ||
+                (pa->wrap_top[blk][sm] != pb->wrap_top[blk][sm])) {
+                sm_fields |= APIO_EMU_DIFF_SM_WRAP;
+            }
+            if ((pa->pre_instr_overflow[blk][sm] != pb->pre_instr_overflow[blk][sm]) ||
+                apio_emu_diff_queue(pa->pre_instr[blk][sm], pb->pre_instr[blk][sm],
+                                    pa->pre_instr_count[blk][sm], pb->pre_instr_count[blk][sm],
+                                    APIO_EMU_MAX_PRE_INSTRS, sizeof(uint16_t))) {
+                sm_fields |= APIO_EMU_DIFF_SM_PRE_INSTR;
+            }
+            if (apio_emu_diff_queue(pa->tx_fifos[blk][sm], pb->tx_fifos[blk][sm],
+                                    pa->tx_fifo_count[blk][sm], pb->tx_fifo_count[blk][sm],
+                                    APIO_MAX_FIFO_DEPTH, sizeof(uint32_t))) {
+                sm_fields |= APIO_EMU_DIFF_SM_TX_FIFO;
+            }
+            if (apio_emu_diff_queue(pa->rx_fifos[blk][sm], pb->rx_fifos[blk][sm],
+                                    pa->rx_fifo_count[blk][sm], pb->rx_fifo_count[blk][sm],
+                                    APIO_MAX_FIFO_DEPTH, sizeof(uint32_t))) {
+                sm_fields |= APIO_EMU_DIFF_SM_RX_FIFO;
+            }
+            diff->sm_regs[blk][sm] = regs;
+            diff->sm_fields[blk][sm] = sm_fields;
+            if (regs || sm_fields) {
+                sms |= (1 << sm);
+            }
+        }
+        diff->sms[blk] = sms;
+
+        if (fields || instr || sms) {
+            diff->blocks |= (1 << blk);
+        }
+    }
+
+    diff->cursor = (pa->block != pb->block) ||
+                   (pa->sm != pb->sm) ||
+                   (pa->pios_enabled != pb->pios_enabled);
+
+    const _apio_emulated_gpio_t *ga = &a->gpios;
+    const _apio_emulated_gpio_t *gb = &b->gpios;
+    uint64_t gpios = (ga->pull_up ^ gb->pull_up) |
+                     (ga->pull_down ^ gb->pull_down) |
+                     (ga->input_only ^ gb->input_only) |
+                     (ga->slew_fast ^ gb->slew_fast);
+    for (int pin = 0; pin < APIO_MAX_GPIOS; pin++) {
+        if ((ga->output_block[pin] != gb->output_block[pin]) ||
+            (ga->inverted[pin] != gb->inverted[pin]) ||
+            (ga->force_input_low[pin] != gb->force_input_low[pin]) ||
+            (ga->force_input_high[pin] != gb->force_input_high[pin]) ||
+            (ga->drive_strength[pin] != gb->drive_strength[pin])) {
+            gpios |= (1ULL << pin);
+        }
+    }
+    diff->gpios = gpios;
+
+    return (diff->blocks != 0) || (diff->gpios != 0) || (diff->cursor != 0);
+}
+
+void apio_emu_diff_log(const apio_emu_diff_t *diff) {
+    APIO_LOG("apio emulation diff: blocks=0x%X gpios=0x%012llX cursor=%d",
+        diff->blocks, (unsigned long long)diff->gpios, diff->cursor);
+    for (int blk = 0; blk < APIO_MAX_PIO_BLOCKS; blk++) {
+        if (!(diff->blocks & (1 << blk))) {
+            continue;
+        }
+        APIO_LOG("  PIO%d: fields=0x%02X instr=0x%08X sms=0x%X",
+            blk, diff->block_fields[blk], diff->instr[blk], diff->sms[blk]);
+        for (int sm = 0; sm < APIO_MAX_SMS_PER_BLOCK; sm++) {
+            if (diff->sms[blk] & (1 << sm)) {
+                APIO_LOG("    SM%d: regs=0x%02X fields=0x%02X",
+                    sm, diff->sm_regs[blk][sm], diff->sm_fields[blk][sm]);
+            }
+        }
+    }
+}
+
+#endif // APIO_EMU_IMPL
+
+#endif // APIO_EMULATION
+
+#endif // APIO_EMU_H
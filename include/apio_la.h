@@ -0,0 +1,490 @@
+// Copyright (C) 2026 Piers Finlayson <piers@piers.rocks>
+//
+// MIT License
+
+// apio - Runtime RP2350 PIO Assembler and Disassembler
+//
+// Multi-SM interleaved logic analyser capture engine.
+//
+// Captures up to 32 pins, using 1-4 SMs of a block which sample in turn, so
+// that each SM only has to sample every num_sms sample periods.  Each SM
+// runs `in pins, N` with autopush, packing as many samples as fit into each
+// 32-bit word, and its RX FIFO is drained by its own DREQ-paced DMA channel
+// into an SRAM buffer.  The SMs share a clock divider, restarted together, so
+// the sample period is a whole number of system clock cycles, down to 1.
+//
+//   static uint32_t buf[4][1024];
+//   apio_la_t la;
+//   apio_la_cfg_t cfg = {
+//       .num_sms = 4, .first_sm = 0, .pin_base = 0, .pin_count = 16,
+//       .interval = 1, .trigger = APIO_LA_TRIG_PIN_HIGH, .trigger_arg = 0,
+//       .dma_channel = 0, .buf = { buf[0], buf[1], buf[2], buf[3] },
+//       .words = 1024,
+//   };
+//   apio_la_init(&la, &cfg);
+//   // In the assembly scope, after APIO_SET_BLOCK():
+//   APIO_LA_ADD(&la);
+//   // After APIO_END_BLOCK():
+//   apio_la_arm(&la);
+//   while (!apio_la_poll(&la));
+//   for (uint32_t ii = 0; ii < apio_la_samples(&la); ii++) {
+//       uint32_t sample = apio_la_sample(&la, ii);
+//   }
+//
+// Triggers are a WAIT at the start of each SM's program, after which the SMs
+// are staggered by one sample period each:
+// - APIO_LA_TRIG_NONE - capture starts when the SMs are enabled.
+// - APIO_LA_TRIG_PIN_HIGH/LOW - a level on a pin, relative to pin_base.  As
+//   all SMs see the same synchronised input, they are released together.
+// - APIO_LA_TRIG_IRQ - PIO IRQ flags trigger_arg to trigger_arg + num_sms - 1,
+//   one per SM, as a WAIT clears its flag.  apio_la_trigger() sets them
+//   together, using IRQ_FORCE.
+//
+// An SM whose RX FIFO fills, because DMA has not kept up, stalls and drops
+// samples, and the SMs are no longer interleaved correctly from that point.
+// On hardware, where FDEBUG only latches that an SM stalled, the SM is
+// flagged in stalled and counted as a single dropped sample.  In emulation
+// dropped is exact.
+//
+// RLE mode, APIO_LA_MODE_RLE, captures sparse signals using a single SM.
+// Rather than sampling at a fixed rate, the SM counts its loops between
+// changes of the pins' state, pushing a (state, count) pair of words for each
+// segment, so the capture's length is limited by the number of changes
+// rather than its duration.  Resolution is APIO_LA_RLE_LOOP_CYCLES SM cycles,
+// and changes lasting less than that may be missed.  apio_la_rle_decode()
+// turns the pairs into a timeline of segments.  The final segment is only
+// pushed when the state next changes.  A stall delays the SM, and the
+// timeline falls behind - in emulation dropped counts the cycles.
+//
+// In emulation there is no DMA, so apio_la_poll_sim() drains the SMs' RX
+// FIFOs in the built-in interpreter into the buffers instead.  Call it
+// between runs, often enough that the FIFOs do not fill.
+//
+// The implementation is included in the source file that defines
+// APIO_LA_IMPL.
+
+#ifndef APIO_LA_H
+#define APIO_LA_H
+
+#include <apio.h>
+#if defined(APIO_EMULATION)
+#include <apio_sim.h>
+#endif // APIO_EMULATION
+
+// Return codes
+#define APIO_LA_OK              0
+#define APIO_LA_ERR_ARGS        -1
+
+// Capture modes, for apio_la_cfg_t.mode
+#define APIO_LA_MODE_RAW        0
+#define APIO_LA_MODE_RLE        1
+
+// RLE timing, in SM cycles.  A segment of N loops lasts
+// APIO_LA_RLE_CHANGE_CYCLES + (N * APIO_LA_RLE_LOOP_CYCLES), measured from
+// the sample which detected its start, except the first, which starts at the
+// initial sample and lasts APIO_LA_RLE_FIRST_CYCLES + (N * LOOP_CYCLES).
+#define APIO_LA_RLE_LOOP_CYCLES     5
+#define APIO_LA_RLE_CHANGE_CYCLES   8
+#define APIO_LA_RLE_FIRST_CYCLES    3
+
+// Triggers, for apio_la_cfg_t.trigger
+#define APIO_LA_TRIG_NONE       0
+#define APIO_LA_TRIG_PIN_HIGH   1
+#define APIO_LA_TRIG_PIN_LOW    2
+#define APIO_LA_TRIG_IRQ        3
+
+// Capture configuration, for apio_la_init()
+typedef struct {
+    uint8_t num_sms;        // Interleaved SMs, 1-4
+    uint8_t first_sm;       // SMs first_sm to first_sm + num_sms - 1 are used
+    uint8_t pin_base;       // IN_BASE, relative to GPIOBASE
+    uint8_t pin_count;      // Pins sampled, 1-32
+    uint16_t interval;      // System clock cycles between samples, 1-65535
+    uint8_t trigger;        // APIO_LA_TRIG_*
+    uint8_t trigger_arg;    // Pin, relative to pin_base, or first IRQ flag
+    uint8_t dma_channel;    // First of num_sms consecutive DMA channels
+    uint32_t *buf[APIO_MAX_SMS_PER_BLOCK];  // One per SM
+    uint32_t words;         // Length of each buffer
+    uint8_t mode;           // APIO_LA_MODE_RAW or APIO_LA_MODE_RLE
+} apio_la_cfg_t;
+
+typedef struct {
+    apio_la_cfg_t cfg;
+    uint8_t block;          // Set by APIO_LA_ADD()
+    uint8_t per_word;       // Samples packed into each word
+    uint8_t done;           // All buffers are full, and the SMs stopped
+    uint8_t stalled;        // Mask of SMs, by index from first_sm, that stalled
+    uint32_t used[APIO_MAX_SMS_PER_BLOCK];      // Words captured, by SM
+    uint32_t dropped[APIO_MAX_SMS_PER_BLOCK];   // Samples dropped, by SM
+} apio_la_t;
+
+// A segment of an RLE capture, decoded by apio_la_rle_decode()
+typedef struct {
+    uint32_t state;         // Pin levels, with pin_base in bit 0
+    uint64_t start;         // System clock cycles from the initial sample
+    uint64_t cycles;        // Duration, in system clock cycles
+} apio_la_seg_t;
+
+// Internal macro - do not use directly.  The RLE program, after any trigger.
+// The loop samples the pins every APIO_LA_RLE_LOOP_CYCLES, counting X down,
+// with the previous state in Y and the count saved in OSR while X holds the
+// pins.  On a change it pushes the previous state and the count, using
+// autopush.  If the count wraps, after 2^32 loops, the duration is lost.
+#define _APIO_LA_ADD_RLE() \
+                            do {                                                        \
+                                uint8_t __rle = APIO_INSTR_COUNT();                     \
+                                APIO_ADD_INSTR(APIO_MOV_Y_PINS);                        \
+                                APIO_ADD_INSTR(APIO_MOV_SRC_INVERT(APIO_MOV_X_NULL));   \
+                                APIO_WRAP_BOTTOM();                                     \
+                                APIO_ADD_INSTR(APIO_MOV_OSR_X);                         \
+                                APIO_ADD_INSTR(APIO_MOV_X_PINS);                        \
+                                APIO_ADD_INSTR(APIO_JMP_X_NOT_Y(__rle + 7));            \
+                                APIO_ADD_INSTR(APIO_MOV_X_OSR);                         \
+                                APIO_WRAP_TOP();                                        \
+                                APIO_ADD_INSTR(APIO_JMP_X_DEC(__rle + 2));              \
+                                APIO_ADD_INSTR(APIO_IN_Y(32));                          \
+                                APIO_ADD_INSTR(APIO_IN_OSR(32));                        \
+                                APIO_ADD_INSTR(APIO_MOV_Y_X);                           \
+                                APIO_ADD_INSTR(APIO_JMP(__rle + 1));                    \
+                            } while (0)
+
+// Build the capture programs and configure the SMs, for the current block.
+// Call within the assembly scope, after APIO_SET_BLOCK().  Leaves the last
+// capture SM selected.  Uses 2 instructions per SM, or 11 in RLE mode, plus 1
+// with a trigger.
+#define APIO_LA_ADD(LA) \
+                            do {                                                        \
+                                apio_la_t *__la = (LA);                                 \
+                                uint8_t __la_count = __la->cfg.pin_count;               \
+                                __la->block = __blk;                                    \
+                                for (uint8_t __ii = 0; __ii < __la->cfg.num_sms; __ii++) { \
+                                    APIO_SET_SM_VAR(__la->cfg.first_sm + __ii);         \
+                                    APIO_START();                                       \
+                                    if (__la->cfg.trigger != APIO_LA_TRIG_NONE) {       \
+                                        APIO_ADD_INSTR(apio_la_trigger_instr(__la, __ii)); \
+                                    }                                                   \
+                                    if (__la->cfg.mode == APIO_LA_MODE_RLE) {           \
+                                        _APIO_LA_ADD_RLE();                             \
+                                    } else {                                            \
+                                        APIO_ADD_INSTR(APIO_ADD_DELAY(APIO_NOP, __ii)); \
+                                        APIO_WRAP_BOTTOM();                             \
+                                        APIO_WRAP_TOP();                                \
+                                        APIO_ADD_INSTR(APIO_ADD_DELAY(APIO_IN_PINS(__la_count), __la->cfg.num_sms - 1)); \
+                                    }                                                   \
+                                    APIO_SM_CLKDIV_SET(__la->cfg.interval, 0);          \
+                                    APIO_SM_EXECCTRL_SET(0);                            \
+                                    APIO_SM_SHIFTCTRL_SET(                              \
+                                        APIO_AUTOPUSH |                                 \
+                                        APIO_PUSH_THRESH((__la->cfg.mode == APIO_LA_MODE_RLE) ? 32 : (__la->per_word * __la_count)) | \
+                                        APIO_IN_SHIFTDIR_L |                            \
+                                        APIO_IN_COUNT(__la_count) |                     \
+                                        APIO_FJOIN_RX);                                 \
+                                    APIO_SM_PINCTRL_SET(APIO_IN_BASE(__la->cfg.pin_base)); \
+                                    APIO_SM_JMP_TO_START();                             \
+                                }                                                       \
+                            } while (0)
+
+// The trigger WAIT for the SM at INDEX from first_sm
+static inline uint16_t apio_la_trigger_instr(const apio_la_t *la, uint8_t index) {
+    switch (la->cfg.trigger) {
+        case APIO_LA_TRIG_PIN_HIGH:
+            return APIO_WAIT_PIN_HIGH(la->cfg.trigger_arg);
+        case APIO_LA_TRIG_PIN_LOW:
+            return APIO_WAIT_PIN_LOW(la->cfg.trigger_arg);
+        default:
+            return APIO_WAIT_IRQ_HIGH(la->cfg.trigger_arg + index);
+    }
+}
+
+// Mask of the capture SMs within the block
+static inline uint8_t apio_la_sm_mask(const apio_la_t *la) {
+    return (uint8_t)(((1u << la->cfg.num_sms) - 1) << la->cfg.first_sm);
+}
+
+// Samples held by the buffers when the capture is complete
+static inline uint32_t apio_la_samples(const apio_la_t *la) {
+    return la->cfg.num_sms * la->cfg.words * la->per_word;
+}
+
+// Samples captured so far, in order, from the start of the capture
+static inline uint32_t apio_la_captured(const apio_la_t *la) {
+    uint32_t words = la->used[0];
+    for (uint8_t ii = 1; ii < la->cfg.num_sms; ii++) {
+        if (la->used[ii] < words) {
+            words = la->used[ii];
+        }
+    }
+    return la->cfg.num_sms * words * la->per_word;
+}
+
+// Decode the pairs captured by an RLE capture into segments, with their
+// start times and durations in system clock cycles.  Returns the number of
+// segments written, up to MAX_SEGS.
+uint32_t apio_la_rle_decode(const apio_la_t *la, apio_la_seg_t *segs, uint32_t max_segs);
+
+// Validate the configuration and initialise.  Returns APIO_LA_OK or
+// APIO_LA_ERR_ARGS.
+int apio_la_init(apio_la_t *la, const apio_la_cfg_t *cfg);
+
+// Returns sample INDEX, de-interleaved, with pin_base in bit 0.
+uint32_t apio_la_sample(const apio_la_t *la, uint32_t index);
+
+// Log the capture's progress and any drops using APIO_LOG().  No-op if
+// logging is disabled.
+void apio_la_log(const apio_la_t *la);
+
+#if !defined(APIO_EMULATION)
+// Start the DMA channels, then enable the capture SMs together, with their
+// clock dividers in phase.  Does not disturb the block's other SMs.
+void apio_la_arm(apio_la_t *la);
+
+// Fire an APIO_LA_TRIG_IRQ trigger.
+void apio_la_trigger(const apio_la_t *la);
+
+// Update progress and stall detection from the DMA channels and FDEBUG.
+// Returns 1, having stopped the capture, once all buffers are full.  Poll
+// often - a stall is only attributed to an SM whose channel is still busy,
+// as the SMs also stall once their buffers are full.
+int apio_la_poll(apio_la_t *la);
+
+// Disable the capture SMs and abort their DMA channels.
+void apio_la_stop(apio_la_t *la);
+#else // APIO_EMULATION
+// Enable the capture SMs in the emulated state.  Call before apio_sim_init().
+void apio_la_arm(apio_la_t *la);
+
+// Fire an APIO_LA_TRIG_IRQ trigger in the built-in interpreter.
+void apio_la_trigger_sim(const apio_la_t *la, apio_sim_t *sim);
+
+// Drain the capture SMs' RX FIFOs in the built-in interpreter into the
+// buffers, as DMA would, and count drops from the SMs' RX stall cycles.
+// Returns 1, having stopped the capture, once all buffers are full.
+int apio_la_poll_sim(apio_la_t *la, apio_sim_t *sim);
+#endif // !APIO_EMULATION
+
+#if defined(APIO_LA_IMPL)
+
+int apio_la_init(apio_la_t *la, const apio_la_cfg_t *cfg) {
+    memset(la, 0, sizeof(*la));
+    if ((cfg->num_sms < 1) ||
+        ((cfg->first_sm + cfg->num_sms) > APIO_MAX_SMS_PER_BLOCK) ||
+        (cfg->pin_count < 1) || (cfg->pin_count > 32) ||
+        (cfg->pin_base > 31) ||
+        (cfg->interval < 1) ||
+        (cfg->trigger > APIO_LA_TRIG_IRQ) ||
+        (cfg->mode > APIO_LA_MODE_RLE) ||
+        ((cfg->mode == APIO_LA_MODE_RLE) && (cfg->num_sms != 1)) ||
+        (cfg->words < 1) || (cfg->words > APIO_DMA_TRANS_COUNT_MASK) ||
+        ((cfg->dma_channel + cfg->num_sms) > 16)) {
+        return APIO_LA_ERR_ARGS;
+    }
+    if ((cfg->trigger == APIO_LA_TRIG_IRQ) && ((cfg->trigger_arg + cfg->num_sms) > 8)) {
+        return APIO_LA_ERR_ARGS;
+    }
+    if ((cfg->trigger != APIO_LA_TRIG_IRQ) && (cfg->trigger_arg > 31)) {
+        return APIO_LA_ERR_ARGS;
+    }
+    for (uint8_t ii = 0; ii < cfg->num_sms; ii++) {
+        if (cfg->buf[ii] == NULL) {
+            return APIO_LA_ERR_ARGS;
+        }
+    }
+    la->cfg = *cfg;
+    la->per_word = (cfg->mode == APIO_LA_MODE_RLE) ? 1 : (uint8_t)(32 / cfg->pin_count);
+    return APIO_LA_OK;
+}
+
+uint32_t apio_la_sample(const apio_la_t *la, uint32_t index) {
+    // SM ii takes samples ii, ii + num_sms, ...  Each word is shifted left,
+    // so its first sample is the most significant.
+    uint8_t count = la->cfg.pin_count;
+    uint32_t mask = (count >= 32) ? 0xFFFFFFFFu : ((1u << count) - 1);
+    uint32_t seq = index / la->cfg.num_sms;
+    uint32_t word = la->cfg.buf[index % la->cfg.num_sms][seq / la->per_word];
+    uint32_t shift = (la->per_word - 1 - (seq % la->per_word)) * count;
+    return (word >> shift) & mask;
+}
+
+uint32_t apio_la_rle_decode(const apio_la_t *la, apio_la_seg_t *segs, uint32_t max_segs) {
+    uint32_t mask = (la->cfg.pin_count >= 32) ? 0xFFFFFFFFu : ((1u << la->cfg.pin_count) - 1);
+    uint64_t time = 0;
+    uint32_t num = 0;
+    for (uint32_t ii = 0; ((ii + 1) < la->used[0]) && (num < max_segs); ii += 2) {
+        // X counts down from 0xFFFFFFFF
+        uint64_t loops = ~la->cfg.buf[0][ii + 1];
+        uint64_t cycles = (num ? APIO_LA_RLE_CHANGE_CYCLES : APIO_LA_RLE_FIRST_CYCLES) +
+                          (loops * APIO_LA_RLE_LOOP_CYCLES);
+        cycles *= la->cfg.interval;
+        segs[num].state = la->cfg.buf[0][ii] & mask;
+        segs[num].start = time;
+        segs[num].cycles = cycles;
+        time += cycles;
+        num++;
+    }
+    return num;
+}
+
+void apio_la_log(const apio_la_t *la) {
+#if defined(APIO_LOG_ENABLE)
+    uint32_t dropped = 0;
+    for (uint8_t ii = 0; ii < la->cfg.num_sms; ii++) {
+        dropped += la->dropped[ii];
+    }
+    const char *unit = (la->cfg.mode == APIO_LA_MODE_RLE) ? "words" : "samples";
+    APIO_LOG("LA PIO%d SM%d-%d: %u/%u %s, %u dropped, stalled 0x%x%s",
+        la->block, la->cfg.first_sm, la->cfg.first_sm + la->cfg.num_sms - 1,
+        (unsigned)apio_la_captured(la), (unsigned)apio_la_samples(la), unit,
+        (unsigned)dropped, la->stalled, la->done ? ", done" : "");
+    (void)dropped;
+    (void)unit;
+#else // !APIO_LOG_ENABLE
+    (void)la;
+#endif // APIO_LOG_ENABLE
+}
+
+#if !defined(APIO_EMULATION)
+static inline uintptr_t _apio_la_base(uint8_t block) {
+    return (block == 0) ? APIO0_BASE : ((block == 1) ? APIO1_BASE : APIO2_BASE);
+}
+
+void apio_la_arm(apio_la_t *la) {
+    uintptr_t base = _apio_la_base(la->block);
+    volatile uint32_t *ctrl = (volatile uint32_t *)(base + APIO_CTRL_OFFSET);
+    volatile uint32_t *fdebug = (volatile uint32_t *)(base + APIO_FDEBUG_OFFSET);
+    uint8_t mask = apio_la_sm_mask(la);
+
+    la->done = 0;
+    la->stalled = 0;
+    for (uint8_t ii = 0; ii < la->cfg.num_sms; ii++) {
+        uint8_t sm = la->cfg.first_sm + ii;
+        uint8_t ch = la->cfg.dma_channel + ii;
+        volatile pio_sm_reg_t *reg = (volatile pio_sm_reg_t *)(base + APIO_SM_REG_OFFSET + (sm * 0x18));
+
+        // Toggling FJOIN_RX twice clears the FIFOs
+        reg->shiftctrl ^= APIO_FJOIN_RX;
+        reg->shiftctrl ^= APIO_FJOIN_RX;
+        *fdebug = APIO_FDEBUG_RXSTALL(sm);
+
+        la->used[ii] = 0;
+        la->dropped[ii] = 0;
+        APIO_DMA_READ_ADDR(ch) = (uint32_t)(uintptr_t)_apio_rxf_ptr(la->block, sm);
+        APIO_DMA_WRITE_ADDR(ch) = (uint32_t)(uintptr_t)la->cfg.buf[ii];
+        APIO_DMA_TRANS_COUNT(ch) = la->cfg.words;
+        APIO_DMA_CTRL_TRIG(ch) =
+            APIO_DMA_CTRL_EN |
+            APIO_DMA_CTRL_HIGH_PRIORITY |
+            APIO_DMA_CTRL_DATA_SIZE_WORD |
+            APIO_DMA_CTRL_INCR_WRITE |
+            APIO_DMA_CTRL_CHAIN_TO(ch) |
+            APIO_DMA_CTRL_TREQ_SEL(APIO_DREQ_PIO_X_SM_Y_RX(la->block, sm));
+    }
+
+    *ctrl |= APIO_CTRL_SM_ENABLE(mask) | APIO_CTRL_SM_RESTART(mask) | APIO_CTRL_CLKDIV_RESTART(mask);
+}
+
+void apio_la_trigger(const apio_la_t *la) {
+    volatile uint32_t *force = (volatile uint32_t *)(_apio_la_base(la->block) + APIO_IRQ_FORCE_OFFSET);
+    *force = ((1u << la->cfg.num_sms) - 1) << la->cfg.trigger_arg;
+}
+
+int apio_la_poll(apio_la_t *la) {
+    if (la->done) {
+        return 1;
+    }
+
+    // Read FDEBUG before the channels, so a stall is only attributed to an SM
+    // whose channel had not finished
+    volatile uint32_t *fdebug = (volatile uint32_t *)(_apio_la_base(la->block) + APIO_FDEBUG_OFFSET);
+    uint32_t flags = *fdebug;
+    int done = 1;
+    for (uint8_t ii = 0; ii < la->cfg.num_sms; ii++) {
+        uint8_t sm = la->cfg.first_sm + ii;
+        uint32_t remaining = APIO_DMA_TRANS_COUNT(la->cfg.dma_channel + ii) & APIO_DMA_TRANS_COUNT_MASK;
+        la->used[ii] = la->cfg.words - remaining;
+        if (!remaining) {
+            continue;
+        }
+        done = 0;
+        if (flags & APIO_FDEBUG_RXSTALL(sm)) {
+            *fdebug = APIO_FDEBUG_RXSTALL(sm);
+            if (!(la->stalled & (1 << ii))) {
+                la->stalled |= (uint8_t)(1 << ii);
+                la->dropped[ii] = 1;
+            }
+        }
+    }
+
+    if (done) {
+        apio_la_stop(la);
+        la->done = 1;
+    }
+    return done;
+}
+
+void apio_la_stop(apio_la_t *la) {
+    volatile uint32_t *ctrl = (volatile uint32_t *)(_apio_la_base(la->block) + APIO_CTRL_OFFSET);
+    *ctrl &= ~APIO_CTRL_SM_ENABLE(apio_la_sm_mask(la));
+
+    uint32_t channels = ((1u << la->cfg.num_sms) - 1) << la->cfg.dma_channel;
+    APIO_DMA_CHAN_ABORT = channels;
+    while (APIO_DMA_CHAN_ABORT & channels);
+}
+#else // APIO_EMULATION
+void apio_la_arm(apio_la_t *la) {
+    la->done = 0;
+    la->stalled = 0;
+    for (uint8_t ii = 0; ii < la->cfg.num_sms; ii++) {
+        la->used[ii] = 0;
+        la->dropped[ii] = 0;
+    }
+    _apio_emulated_pio.enabled_sms[la->block] |= apio_la_sm_mask(la);
+    _APIO_EMU_DIRTY(la->block);
+}
+
+void apio_la_trigger_sim(const apio_la_t *la, apio_sim_t *sim) {
+    sim->irq |= (uint8_t)(((1u << la->cfg.num_sms) - 1) << la->cfg.trigger_arg);
+}
+
+int apio_la_poll_sim(apio_la_t *la, apio_sim_t *sim) {
+    if (la->done) {
+        return 1;
+    }
+
+    int done = 1;
+    for (uint8_t ii = 0; ii < la->cfg.num_sms; ii++) {
+        uint8_t sm = la->cfg.first_sm + ii;
+        if (la->used[ii] >= la->cfg.words) {
+            continue;
+        }
+
+        // Each SM samples every num_sms of its cycles, so a stall of that
+        // many cycles loses one sample
+        uint64_t stall = sim->sm[sm].stats.stall_cycles[APIO_SIM_STALL_RX_FULL];
+        if (stall) {
+            la->stalled |= (uint8_t)(1 << ii);
+            la->dropped[ii] = (uint32_t)((stall + la->cfg.num_sms - 1) / la->cfg.num_sms);
+        }
+
+        uint32_t word;
+        while ((la->used[ii] < la->cfg.words) && sim->sm[sm].rx.level &&
+               apio_sim_rx_get(sim, sm, &word)) {
+            la->cfg.buf[ii][la->used[ii]++] = word;
+        }
+        if (la->used[ii] < la->cfg.words) {
+            done = 0;
+        }
+    }
+
+    if (done) {
+        apio_sim_set_enabled(sim, sim->enabled & ~apio_la_sm_mask(la));
+        _apio_emulated_pio.enabled_sms[la->block] &= (uint8_t)~apio_la_sm_mask(la);
+        _APIO_EMU_DIRTY(la->block);
+        la->done = 1;
+    }
+    return done;
+}
+#endif // !APIO_EMULATION
+
+#endif // APIO_LA_IMPL
+
+#endif // APIO_LA_H
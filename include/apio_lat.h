@@ -0,0 +1,366 @@
+// Copyright (C) 2026 Piers Finlayson <piers@piers.rocks>
+//
+// MIT License
+
+// apio - Runtime RP2350 PIO Assembler and Disassembler
+//
+// End-to-end latency measurement for PIO response paths.
+//
+// Builds a measurement SM, which times a latency in its own cycles by
+// counting X down in a tight loop, pushing the final X to its RX FIFO.
+// Collect the results with apio_lat_collect(), and report minimum, mean,
+// maximum and percentile latencies, in system clock cycles, with
+// apio_lat_report() or apio_lat_log().  The measurement SM runs at the
+// system clock (CLKDIV 1), so its cycles are system clock cycles.
+//
+// Edge latency - APIO_LAT_EDGE_SM() waits for a rising edge on the stimulus
+// pin, then counts until the response pin goes high, for example the output
+// of the SM under test, read back by the measurement SM.  Resolution is 2
+// cycles.  The stimulus and response pins must both return low before the
+// next measurement:
+//
+//   apio_lat_t lat;
+//   apio_lat_init(&lat, APIO_LAT_EDGE);
+//   // In the assembly scope:
+//   APIO_SET_SM(3);
+//   APIO_LAT_EDGE_SM(STIM_PIN, RESP_PIN);
+//   // Toggle STIM_PIN repeatedly, then:
+//   apio_lat_collect(&lat, 0, 3);
+//   apio_lat_log(&lat);
+//
+// IRQ latency - APIO_LAT_IRQ_SM() raises a PIO IRQ flag, then counts until
+// the flag is cleared by the CPU's handler calling apio_lat_irq_ack(), so the
+// measurement covers interrupt entry and any handler code preceding the
+// acknowledgement.  Resolution is 3 cycles.  Route the flag to an interrupt
+// with the block's IRQ0_INTE or IRQ1_INTE, using APIO_INTE_SM(), and enable
+// that interrupt in the NVIC.  The PIO and CPU have no common timebase, so
+// the measurement is made entirely by the SM.
+//
+// In emulation, apio_lat_model_edge() computes the PIO side of an edge
+// response analytically from the emulated program and SM configuration, and
+// apio_lat_collect_sim() collects results from the built-in interpreter, so
+// a measurement SM can be run against the SM under test on the host.
+//
+// The implementation is included in the source file that defines
+// APIO_LAT_IMPL.
+
+#ifndef APIO_LAT_H
+#define APIO_LAT_H
+
+#include <apio.h>
+#if defined(APIO_EMULATION)
+#include <apio_sim.h>
+#endif // APIO_EMULATION
+
+// Results retained for percentiles.  Minimum, mean and maximum cover all
+// results.
+#ifndef APIO_LAT_MAX_SAMPLES
+#define APIO_LAT_MAX_SAMPLES    256
+#endif // APIO_LAT_MAX_SAMPLES
+
+// Measurement types, for apio_lat_init()
+#define APIO_LAT_EDGE           0
+#define APIO_LAT_IRQ            1
+
+// Input synchroniser delay, in system clock cycles, unless bypassed with
+// INPUT_SYNC_BYPASS
+#define APIO_LAT_SYNC_CYCLES    2
+
+// Convert a measurement SM's count to cycles.  The edge loop is 2 cycles per
+// count, and the response is first sampled 1 cycle after the stimulus.  The
+// IRQ loop is 3 cycles per count, and the flag is first sampled 1 cycle
+// after it is raised, and tested the next.
+#define APIO_LAT_EDGE_CYCLES(COUNT) (((COUNT) * 2) + 1)
+#define APIO_LAT_IRQ_CYCLES(COUNT)  (((COUNT) * 3) + 2)
+
+// Instructions used by the measurement programs
+#define APIO_LAT_EDGE_INSTRS    8
+#define APIO_LAT_IRQ_INSTRS     7
+
+// Build an edge latency measurement program for the current SM, and
+// configure the SM.  Call immediately after APIO_SET_SM().  STIM_PIN and
+// RESP_PIN are relative to GPIOBASE.  Uses IN_BASE for the stimulus and
+// JMP_PIN for the response, and joins the FIFOs for RX.
+#define APIO_LAT_EDGE_SM(STIM_PIN, RESP_PIN) \
+                            do {                                                        \
+                                uint8_t __lat_base = APIO_INSTR_COUNT();                \
+                                APIO_START();                                           \
+                                APIO_WRAP_BOTTOM();                                     \
+                                APIO_ADD_INSTR(APIO_MOV_SRC_INVERT(APIO_MOV_X_NULL));   \
+                                APIO_ADD_INSTR(APIO_WAIT_JMP_PIN_LOW());                \
+                                APIO_ADD_INSTR(APIO_WAIT_PIN_LOW(0));                   \
+                                APIO_ADD_INSTR(APIO_WAIT_PIN_HIGH(0));                  \
+                                APIO_ADD_INSTR(APIO_JMP_PIN(__lat_base + 6));           \
+                                APIO_ADD_INSTR(APIO_JMP_X_DEC(__lat_base + 4));         \
+                                APIO_ADD_INSTR(APIO_IN_X(32));                          \
+                                APIO_WRAP_TOP();                                        \
+                                APIO_ADD_INSTR(APIO_PUSH_BLOCK);                        \
+                                APIO_SM_CLKDIV_SET(1, 0);                               \
+                                APIO_SM_EXECCTRL_SET(APIO_EXECCTRL_JMP_PIN(RESP_PIN));  \
+                                APIO_SM_SHIFTCTRL_SET(APIO_IN_SHIFTDIR_L | APIO_FJOIN_RX); \
+                                APIO_SM_PINCTRL_SET(APIO_IN_BASE(STIM_PIN));            \
+                                APIO_SM_JMP_TO_START();                                 \
+                            } while (0)
+
+// Build an IRQ latency measurement program for the current SM, and configure
+// the SM.  Call immediately after APIO_SET_SM().  IRQ is the PIO IRQ flag,
+// 0-3 to be routable to the CPU.  Uses STATUS_SEL to test the flag, and
+// joins the FIFOs for RX.
+#define APIO_LAT_IRQ_SM(IRQ) \
+                            do {                                                        \
+                                uint8_t __lat_base = APIO_INSTR_COUNT();                \
+                                APIO_START();                                           \
+                                APIO_WRAP_BOTTOM();                                     \
+                                APIO_ADD_INSTR(APIO_MOV_SRC_INVERT(APIO_MOV_X_NULL));   \
+                                APIO_ADD_INSTR(APIO_IRQ_SET(IRQ));                      \
+                                APIO_ADD_INSTR(APIO_MOV_Y_STATUS);                      \
+                                APIO_ADD_INSTR(APIO_JMP_NOT_Y(__lat_base + 5));         \
+                                APIO_ADD_INSTR(APIO_JMP_X_DEC(__lat_base + 2));         \
+                                APIO_ADD_INSTR(APIO_IN_X(32));                          \
+                                APIO_WRAP_TOP();                                        \
+                                APIO_ADD_INSTR(APIO_PUSH_BLOCK);                        \
+                                APIO_SM_CLKDIV_SET(1, 0);                               \
+                                APIO_SM_EXECCTRL_SET(APIO_STATUS_SEL_IRQ | APIO_STATUS_N(APIO_STATUS_N_IRQ + (IRQ))); \
+                                APIO_SM_SHIFTCTRL_SET(APIO_IN_SHIFTDIR_L | APIO_FJOIN_RX); \
+                                APIO_SM_PINCTRL_SET(0);                                 \
+                                APIO_SM_JMP_TO_START();                                 \
+                            } while (0)
+
+typedef struct {
+    uint8_t type;           // APIO_LAT_EDGE or APIO_LAT_IRQ
+    uint32_t count;         // Results
+    uint64_t sum;           // Of all results, in cycles
+    uint32_t min;
+    uint32_t max;
+    uint32_t stored;        // Results in samples[]
+    uint32_t samples[APIO_LAT_MAX_SAMPLES];
+} apio_lat_t;
+
+// Latency summary from apio_lat_report(), in system clock cycles.
+// Percentiles cover the first APIO_LAT_MAX_SAMPLES results.
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t mean;
+    uint32_t max;
+    uint32_t p50;
+    uint32_t p90;
+    uint32_t p99;
+} apio_lat_report_t;
+
+// Initialise for measurements of TYPE, APIO_LAT_EDGE or APIO_LAT_IRQ.
+void apio_lat_init(apio_lat_t *lat, uint8_t type);
+
+// Add a word pushed by a measurement SM.
+void apio_lat_add(apio_lat_t *lat, uint32_t word);
+
+// Add a latency already in cycles, for example from apio_lat_model_edge().
+void apio_lat_add_cycles(apio_lat_t *lat, uint32_t cycles);
+
+// Summarise the results.  Sorts the retained samples.
+void apio_lat_report(apio_lat_t *lat, apio_lat_report_t *report);
+
+// Log the summary using APIO_LOG().  No-op if logging is disabled.
+void apio_lat_log(apio_lat_t *lat);
+
+// Cycles an SM takes from starting the instruction at FROM, typically the
+// WAIT for the stimulus, to completing the first cycle of the instruction at
+// TO, which drives the response.  Follows unconditional JMPs and wrap,
+// assumes conditional JMPs are not taken and later WAITs are satisfied, and
+// includes delays.  SIDE_SET_COUNT is PINCTRL's, including any enable bit,
+// and determines the delay field's width.  Returns UINT32_MAX if TO isn't
+// reached.
+uint32_t apio_lat_path_cycles(
+    const uint16_t *instr,
+    uint8_t side_set_count,
+    uint8_t wrap_bottom,
+    uint8_t wrap_top,
+    uint8_t from,
+    uint8_t to
+);
+
+#if !defined(APIO_EMULATION)
+// Drain a measurement SM's RX FIFO, adding its results.  Returns the number
+// added.
+uint32_t apio_lat_collect(apio_lat_t *lat, uint8_t block, uint8_t sm);
+
+// Acknowledge an IRQ latency measurement, clearing the PIO IRQ flag.  Call as
+// early as possible in the handler.
+static inline void apio_lat_irq_ack(uint8_t block, uint8_t irq) {
+    if (block == 0) APIO0_IRQ = (1u << irq);
+    else if (block == 1) APIO1_IRQ = (1u << irq);
+    else APIO2_IRQ = (1u << irq);
+}
+#else // APIO_EMULATION
+// Drain a measurement SM's RX FIFO in the built-in interpreter, adding its
+// results.  Returns the number added.
+uint32_t apio_lat_collect_sim(apio_lat_t *lat, apio_sim_t *sim, uint8_t sm);
+
+// Compute the PIO side of an edge response from the emulated program and
+// configuration of BLOCK's SM: the input synchroniser, unless SYNC_BYPASS is
+// non-zero, plus apio_lat_path_cycles() scaled by the SM's clock divider.  In
+// system clock cycles.
+uint32_t apio_lat_model_edge(uint8_t block, uint8_t sm, uint8_t from, uint8_t to, uint8_t sync_bypass);
+#endif // !APIO_EMULATION
+
+#if defined(APIO_LAT_IMPL)
+
+void apio_lat_init(apio_lat_t *lat, uint8_t type) {
+    memset(lat, 0, sizeof(*lat));
+    lat->type = type;
+    lat->min = UINT32_MAX;
+}
+
+void apio_lat_add_cycles(apio_lat_t *lat, uint32_t cycles) {
+    lat->count++;
+    lat->sum += cycles;
+    if (cycles < lat->min) {
+        lat->min = cycles;
+    }
+    if (cycles > lat->max) {
+        lat->max = cycles;
+    }
+    if (lat->stored < APIO_LAT_MAX_SAMPLES) {
+        lat->samples[lat->stored++] = cycles;
+    }
+}
+
+void apio_lat_add(apio_lat_t *lat, uint32_t word) {
+    // X counts down from 0xFFFFFFFF
+    uint32_t count = ~word;
+    if (lat->type == APIO_LAT_IRQ) {
+        apio_lat_add_cycles(lat, APIO_LAT_IRQ_CYCLES(count));
+    } else {
+        apio_lat_add_cycles(lat, APIO_LAT_EDGE_CYCLES(count));
+    }
+}
+
+// Nearest-rank percentile of sorted samples
+static uint32_t apio_lat_percentile(const apio_lat_t *lat, uint32_t pct) {
+    uint32_t rank = ((lat->stored * pct) + 99) / 100;
+    return lat->samples[(rank > 0) ? (rank - 1) : 0];
+}
+
+void apio_lat_report(apio_lat_t *lat, apio_lat_report_t *report) {
+    memset(report, 0, sizeof(*report));
+    if (!lat->count) {
+        return;
+    }
+
+    // Insertion sort - the samples are few, and often nearly sorted
+    for (uint32_t ii = 1; ii < lat->stored; ii++) {
+        uint32_t val = lat->samples[ii];
+        uint32_t jj = ii;
+        while ((jj > 0) && (lat->samples[jj - 1] > val)) {
+            lat->samples[jj] = lat->samples[jj - 1];
+            jj--;
+        }
+        lat->samples[jj] = val;
+    }
+
+    report->count = lat->count;
+    report->min = lat->min;
+    report->mean = (uint32_t)(lat->sum / lat->count);
+    report->max = lat->max;
+    report->p50 = apio_lat_percentile(lat, 50);
+    report->p90 = apio_lat_percentile(lat, 90);
+    report->p99 = apio_lat_percentile(lat, 99);
+}
+
+void apio_lat_log(apio_lat_t *lat) {
+#if defined(APIO_LOG_ENABLE)
+    apio_lat_report_t report;
+    apio_lat_report(lat, &report);
+    APIO_LOG("%s latency: %u results, cycles min=%u mean=%u max=%u p50=%u p90=%u p99=%u",
+        (lat->type == APIO_LAT_IRQ) ? "IRQ" : "Edge",
+        (unsigned)report.count, (unsigned)report.min, (unsigned)report.mean,
+        (unsigned)report.max, (unsigned)report.p50, (unsigned)report.p90,
+        (unsigned)report.p99);
+    (void)report;
+#else // !APIO_LOG_ENABLE
+    (void)lat;
+#endif // APIO_LOG_ENABLE
+}
+
+uint32_t apio_lat_path_cycles(
+    const uint16_t *instr,
+    uint8_t side_set_count,
+    uint8_t wrap_bottom,
+    uint8_t wrap_top,
+    uint8_t from,
+    uint8_t to
+) {
+    uint8_t delay_mask = (uint8_t)((1 << (5 - side_set_count)) - 1);
+    uint32_t cycles = 0;
+    uint8_t pc = from & (APIO_MAX_PIO_INSTRS - 1);
+    for (int steps = 0; steps < APIO_MAX_PIO_INSTRS; steps++) {
+        uint16_t inst = instr[pc];
+        cycles++;
+        if (pc == to) {
+            return cycles;
+        }
+        cycles += (inst >> 8) & delay_mask;
+        if ((inst & 0xE0E0) == 0x0000) {
+            // Unconditional JMP
+            pc = inst & 0x1F;
+        } else if (pc == wrap_top) {
+            pc = wrap_bottom;
+        } else {
+            pc = (pc + 1) & (APIO_MAX_PIO_INSTRS - 1);
+        }
+    }
+    return UINT32_MAX;
+}
+
+#if !defined(APIO_EMULATION)
+uint32_t apio_lat_collect(apio_lat_t *lat, uint8_t block, uint8_t sm) {
+    volatile uint32_t *fstat = (block == 0) ? &APIO0_FSTAT : ((block == 1) ? &APIO1_FSTAT : &APIO2_FSTAT);
+    volatile uint32_t *rxf = _apio_rxf_ptr(block, sm);
+    uint32_t added = 0;
+    while (!(*fstat & APIO_FSTAT_SMX_RX_EMPTY_BIT(sm))) {
+        apio_lat_add(lat, *rxf);
+        added++;
+    }
+    return added;
+}
+#else // APIO_EMULATION
+uint32_t apio_lat_collect_sim(apio_lat_t *lat, apio_sim_t *sim, uint8_t sm) {
+    uint32_t word;
+    uint32_t added = 0;
+    while (apio_sim_rx_get(sim, sm, &word)) {
+        apio_lat_add(lat, word);
+        added++;
+    }
+    return added;
+}
+
+uint32_t apio_lat_model_edge(uint8_t block, uint8_t sm, uint8_t from, uint8_t to, uint8_t sync_bypass) {
+    const pio_sm_reg_t *reg = &_apio_emulated_pio.pio_sm_reg[block][sm];
+    uint32_t path = apio_lat_path_cycles(
+        _apio_emulated_pio.instr[block],
+        (uint8_t)((reg->pinctrl >> 29) & 0x7),
+        (uint8_t)APIO_WRAP_BOTTOM_FROM_REG(reg->execctrl),
+        (uint8_t)APIO_WRAP_TOP_FROM_REG(reg->execctrl),
+        from,
+        to
+    );
+    if (path == UINT32_MAX) {
+        return UINT32_MAX;
+    }
+
+    // Clock divider in 24.8 fixed point, an integer part of 0 being 65536,
+    // rounded up to whole system cycles
+    uint32_t div_int = APIO_CLKDIV_INT_FROM_REG(reg->clkdiv);
+    uint32_t div256 = ((div_int ? div_int : 0x10000) << 8) | APIO_CLKDIV_FRAC_FROM_REG(reg->clkdiv);
+    uint32_t cycles = (uint32_t)((((uint64_t)path * div256) + 255) >> 8);
+
+    if (!sync_bypass) {
+        cycles += APIO_LAT_SYNC_CYCLES;
+    }
+    return cycles;
+}
+#endif // !APIO_EMULATION
+
+#endif // APIO_LAT_IMPL
+
+#endif // APIO_LAT_H
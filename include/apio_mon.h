@@ -0,0 +1,677 @@
+// Copyright (C) 2026 Piers Finlayson <piers@piers.rocks>
+//
+// MIT License
+
+// apio - Runtime RP2350 PIO Assembler and Disassembler
+//
+// Runtime monitoring of running PIO state machines.
+//
+// PC-sampling profiler - apio_prof_sample(), called periodically, e.g. from a
+// timer interrupt, reads each chosen SM's ADDR register and its FDEBUG TX and
+// RX stall flags, building a histogram of where each SM spends its time and
+// where it stalls on a FIFO, such as on a blocking PULL with no data.  Use
+// apio_prof_log() to dump the histograms alongside the disassembly:
+//
+//   apio_prof_t prof;
+//   apio_prof_start(&prof, APIO_MON_SM(0, 0) | APIO_MON_SM(0, 1), 10000);
+//   // From a timer interrupt:
+//   apio_prof_sample(&prof);
+//   // Once apio_prof_done(&prof):
+//   apio_prof_log(&prof, 0, program);  // Instructions as loaded, or NULL
+//
+// FIFO telemetry - apio_fdebug_poll() reads and clears the FDEBUG register of
+// each PIO block, counting TX stall, TX overflow, RX underrun and RX stall
+// events per SM, showing when the code feeding or draining an SM falls
+// behind.  apio_fdebug_snapshot() polls and returns a copy of the counters:
+//
+//   apio_fdebug_t fdebug, snap;
+//   apio_fdebug_reset(&fdebug);
+//   // Periodically:
+//   apio_fdebug_poll(&fdebug);
+//   // To report:
+//   apio_fdebug_snapshot(&fdebug, &snap);
+//
+// FIFO occupancy - apio_flevel_sample(), called at a fixed rate, reads the
+// FLEVEL register of each block, building per-SM histograms of TX and RX FIFO
+// levels, and from them the time each FIFO spent empty and full, for sizing
+// DMA bursts and deciding whether to join FIFOs:
+//
+//   apio_flevel_t flevel;
+//   apio_flevel_start(&flevel, APIO_MON_SM(0, 0), 10);  // Sampled every 10us
+//   // Every 10us:
+//   apio_flevel_sample(&flevel);
+//   // To report:
+//   apio_flevel_log(&flevel);
+//
+// Stalled-SM watchdog - apio_wdog_poll(), called at a fixed rate, reads the
+// ADDR of each watched, enabled SM.  An SM whose ADDR doesn't change for the
+// timeout, such as one blocked on a WAIT for a pin that never toggles, or a
+// PULL after its feeding DMA faulted, is reported, and optionally restarted
+// from the start of its program with its FIFOs cleared:
+//
+//   apio_wdog_t wdog;
+//   apio_wdog_init(&wdog, 1000, 50000, 1);  // Polled every 1ms, 50ms timeout
+//   // In the assembly scope, after APIO_SM_JMP_TO_START() for each SM:
+//   APIO_WDOG_WATCH(&wdog);
+//   // Every 1ms:
+//   apio_wdog_poll(&wdog);
+//
+// Works on hardware and in emulation.  In emulation, the SM registers are
+// read from the emulated PIO state, which apio_sim_run() updates from the
+// built-in interpreter, or which a test can set directly to synthetic values.
+//
+// The implementation is included in the source file that defines
+// APIO_MON_IMPL.
+
+#ifndef APIO_MON_H
+#define APIO_MON_H
+
+#include <apio.h>
+#if defined(APIO_EMULATION)
+#include <apio_sim.h>
+#endif // APIO_EMULATION
+
+// Bit for a PIO SM in a monitoring SM mask, covering all SMs in all blocks
+#define APIO_MON_SM(BLOCK, SM)  (1u << (((BLOCK) * APIO_MAX_SMS_PER_BLOCK) + (SM)))
+#define APIO_MON_ALL_SMS        ((1u << (APIO_MAX_PIO_BLOCKS * APIO_MAX_SMS_PER_BLOCK)) - 1)
+
+// A block's instructions, for apio_prof_log().  PIO instruction memory is
+// write-only on hardware, so the caller must retain its own copy there.
+#if !defined(APIO_EMULATION)
+#define APIO_MON_INSTR(BLOCK)   ((const uint16_t *)0)
+#else // APIO_EMULATION
+#define APIO_MON_INSTR(BLOCK)   ((const uint16_t *)_apio_emulated_pio.instr[BLOCK])
+#endif // !APIO_EMULATION
+
+// Internal functions - do not use directly.  Access a block's registers,
+// independently of the APIO_SET_BLOCK() selection.  FDEBUG flags in MASK are
+// read and those set cleared in one operation.
+#if !defined(APIO_EMULATION)
+static inline uintptr_t _apio_mon_base(uint8_t block) {
+    return (block == 0) ? APIO0_BASE : ((block == 1) ? APIO1_BASE : APIO2_BASE);
+}
+static inline volatile pio_sm_reg_t *_apio_mon_sm_reg(uint8_t block, uint8_t sm) {
+    return (volatile pio_sm_reg_t *)(_apio_mon_base(block) + APIO_SM_REG_OFFSET + (sm * 0x18));
+}
+static inline uint32_t _apio_mon_fdebug_take(uint8_t block, uint32_t mask) {
+    volatile uint32_t *reg = (volatile uint32_t *)(_apio_mon_base(block) + APIO_FDEBUG_OFFSET);
+    uint32_t flags = *reg & mask;
+    *reg = flags;
+    return flags;
+}
+static inline uint32_t _apio_mon_flevel(uint8_t block) {
+    return *(volatile uint32_t *)(_apio_mon_base(block) + APIO_FLEVEL_OFFSET);
+}
+static inline uint8_t _apio_mon_enabled(uint8_t block) {
+    return (uint8_t)APIO_CTRL_SM_ENABLE_FROM_REG(*(volatile uint32_t *)(_apio_mon_base(block) + APIO_CTRL_OFFSET));
+}
+// Toggling FJOIN_RX twice clears both FIFOs, then SM_RESTART clears any
+// stalled instruction, so the JMP executes immediately.
+static inline void _apio_mon_sm_restart(uint8_t block, uint8_t sm, uint8_t start) {
+    volatile pio_sm_reg_t *reg = _apio_mon_sm_reg(block, sm);
+    volatile uint32_t *ctrl = (volatile uint32_t *)(_apio_mon_base(block) + APIO_CTRL_OFFSET);
+    reg->shiftctrl ^= APIO_FJOIN_RX;
+    reg->shiftctrl ^= APIO_FJOIN_RX;
+    *ctrl |= APIO_CTRL_SM_RESTART(1u << sm);
+    reg->instr = APIO_JMP(start);
+}
+#else // APIO_EMULATION
+static inline volatile pio_sm_reg_t *_apio_mon_sm_reg(uint8_t block, uint8_t sm) {
+    return &_apio_emulated_pio.pio_sm_reg[block][sm];
+}
+static inline uint32_t _apio_mon_fdebug_take(uint8_t block, uint32_t mask) {
+    uint32_t flags = _apio_emulated_pio.fdebug[block] & mask;
+    _apio_emulated_pio.fdebug[block] &= ~flags;
+    if (flags) {
+        _APIO_EMU_DIRTY(block);
+    }
+    return flags;
+}
+static inline uint32_t _apio_mon_flevel(uint8_t block) {
+    return _apio_emulated_pio.flevel[block];
+}
+static inline uint8_t _apio_mon_enabled(uint8_t block) {
+    return _apio_emulated_pio.enabled_sms[block];
+}
+// Reflects the restart in the emulated registers.  apio_wdog_recover()
+// restarts the SM in the block's interpreter, if any.
+static inline void _apio_mon_sm_restart(uint8_t block, uint8_t sm, uint8_t start) {
+    pio_sm_reg_t *reg = &_apio_emulated_pio.pio_sm_reg[block][sm];
+    _apio_emulated_pio.tx_fifo_count[block][sm] = 0;
+    _apio_emulated_pio.rx_fifo_count[block][sm] = 0;
+    _apio_emulated_pio.flevel[block] &= ~(APIO_FLEVEL_TX(sm, 0xF) | APIO_FLEVEL_RX(sm, 0xF));
+    _APIO_EMU_DIRTY(block);
+    reg->addr = start;
+    reg->execctrl &= ~APIO_EXECCTRL_EXEC_STALLED;
+}
+#endif // !APIO_EMULATION
+
+//
+// PC-sampling profiler
+//
+
+// Histogram for a single SM
+typedef struct {
+    uint32_t hits[APIO_MAX_PIO_INSTRS];     // Samples at each instruction
+    uint32_t stalled[APIO_MAX_PIO_INSTRS];  // Of those, FIFO stalled
+} apio_prof_sm_t;
+
+typedef struct {
+    uint32_t sm_mask;       // SMs sampled, APIO_MON_SM() bits
+    uint32_t window;        // Samples to take, 0 for no limit
+    uint32_t samples;       // Samples taken
+    apio_prof_sm_t sm[APIO_MAX_PIO_BLOCKS][APIO_MAX_SMS_PER_BLOCK];
+} apio_prof_t;
+
+// Clear the histograms and start a window of WINDOW samples, or an unlimited
+// window if 0, of the SMs in SM_MASK.
+void apio_prof_start(apio_prof_t *prof, uint32_t sm_mask, uint32_t window);
+
+// Take a sample of each SM being profiled.  Suitable for calling from an
+// interrupt handler.  Returns 0, without sampling, once the window is
+// complete.
+//
+// A sample counts as stalled if the SM's FDEBUG TXSTALL or RXSTALL flag is
+// set, and the profiler clears those flags for the SMs it samples, so each
+// marks a FIFO stall since the previous sample - which may have occurred at
+// an instruction before the one sampled.  apio_fdebug_poll() does not see
+// those flags for profiled SMs.  WAIT and IRQ stalls count as hits only.
+int apio_prof_sample(apio_prof_t *prof);
+
+// Returns non-zero once the window is complete
+#define apio_prof_done(PROF)    (((PROF)->window != 0) && ((PROF)->samples >= (PROF)->window))
+
+// Log the histograms of the profiled SMs in BLOCK using APIO_LOG(), with each
+// instruction's disassembly if INSTR, the block's instruction memory, is not
+// NULL.  Only instructions that were sampled are logged.  No-op if logging is
+// disabled.
+void apio_prof_log(const apio_prof_t *prof, uint8_t block, const uint16_t *instr);
+
+//
+// FIFO telemetry
+//
+
+// Event counters for a single SM.  FDEBUG flags are sticky, so each counts
+// the polls which found its flag set, i.e. a lower bound on the number of
+// events.  Counters saturate at 0xFFFFFFFF.
+typedef struct {
+    uint32_t tx_stall;      // Stalled on an empty TX FIFO - feeder too slow
+    uint32_t tx_over;       // Write to a full TX FIFO - data lost
+    uint32_t rx_under;      // Read from an empty RX FIFO - bad data read
+    uint32_t rx_stall;      // Stalled on a full RX FIFO - drainer too slow
+} apio_fdebug_sm_t;
+
+typedef struct {
+    uint32_t polls;
+    apio_fdebug_sm_t sm[APIO_MAX_PIO_BLOCKS][APIO_MAX_SMS_PER_BLOCK];
+} apio_fdebug_t;
+
+// Zero the counters and clear all FDEBUG flags, so earlier events are not
+// counted.
+void apio_fdebug_reset(apio_fdebug_t *fdebug);
+
+// Read and clear FDEBUG for all blocks, counting the flags found set.
+// Suitable for calling from an interrupt handler.
+void apio_fdebug_poll(apio_fdebug_t *fdebug);
+
+// Poll, then copy the counters to SNAP.  Call from the same context as
+// apio_fdebug_poll(), or with it masked, for a consistent copy.
+void apio_fdebug_snapshot(apio_fdebug_t *fdebug, apio_fdebug_t *snap);
+
+// Log the non-zero counters using APIO_LOG().  No-op if logging is disabled.
+void apio_fdebug_log(const apio_fdebug_t *fdebug);
+
+//
+// FIFO occupancy
+//
+
+// Histogram bins, one per FIFO level, 0 to the joined FIFO depth
+#define APIO_FLEVEL_BINS        ((APIO_MAX_FIFO_DEPTH * 2) + 1)
+
+// Histograms for a single SM
+typedef struct {
+    uint32_t tx[APIO_FLEVEL_BINS];  // Samples at each TX FIFO level
+    uint32_t rx[APIO_FLEVEL_BINS];  // Samples at each RX FIFO level
+    uint8_t tx_depth;               // FIFO depths, from SHIFTCTRL's FJOIN
+    uint8_t rx_depth;               // bits at apio_flevel_start().  0 if unused.
+} apio_flevel_sm_t;
+
+typedef struct {
+    uint32_t sm_mask;       // SMs sampled, APIO_MON_SM() bits
+    uint32_t period_us;     // Sampling period, for reporting times
+    uint32_t samples;       // Samples taken
+    apio_flevel_sm_t sm[APIO_MAX_PIO_BLOCKS][APIO_MAX_SMS_PER_BLOCK];
+} apio_flevel_t;
+
+// Occupancy summary for a single SM, from apio_flevel_report().  Mean levels
+// are in hundredths of a FIFO entry.
+typedef struct {
+    uint64_t tx_empty_us;
+    uint64_t tx_full_us;
+    uint64_t rx_empty_us;
+    uint64_t rx_full_us;
+    uint32_t tx_mean_x100;
+    uint32_t rx_mean_x100;
+} apio_flevel_report_t;
+
+// Clear the histograms and start sampling the SMs in SM_MASK, which will be
+// sampled every PERIOD_US microseconds.  Records each SM's FIFO depths, so
+// call once the SMs are configured.
+void apio_flevel_start(apio_flevel_t *flevel, uint32_t sm_mask, uint32_t period_us);
+
+// Take a sample of each SM's FIFO levels.  Suitable for calling from an
+// interrupt handler.
+void apio_flevel_sample(apio_flevel_t *flevel);
+
+// Summarise an SM's histograms.
+void apio_flevel_report(
+    const apio_flevel_t *flevel,
+    uint8_t block,
+    uint8_t sm,
+    apio_flevel_report_t *report
+);
+
+// Log the histograms and summaries of the sampled SMs using APIO_LOG().
+// No-op if logging is disabled.
+void apio_flevel_log(const apio_flevel_t *flevel);
+
+//
+// Stalled-SM watchdog
+//
+
+// Called when an SM is found stuck, before any restart.  Return non-zero to
+// allow the watchdog to restart the SM, for example after resetting the DMA
+// channel feeding it.
+typedef int (*apio_wdog_fn_t)(uint8_t block, uint8_t sm, void *user);
+
+// State for a single SM
+typedef struct {
+    uint8_t start;          // Restart address, from APIO_WDOG_WATCH()
+    uint8_t addr;           // ADDR at the last poll
+    uint8_t exec_stalled;   // EXEC_STALLED when last found stuck
+    uint8_t stuck;          // Stuck, and not restarted
+    uint32_t unchanged;     // Consecutive polls with ADDR unchanged
+    uint32_t stuck_count;   // Times found stuck
+    uint32_t recoveries;    // Times restarted
+} apio_wdog_sm_t;
+
+typedef struct {
+    uint32_t sm_mask;       // SMs watched, APIO_MON_SM() bits
+    uint32_t timeout_polls; // Polls with ADDR unchanged before an SM is stuck
+    uint8_t recover;        // Restart stuck SMs
+    apio_wdog_fn_t fn;      // Optional, set after apio_wdog_init()
+    void *user;             // Passed to fn
+    apio_wdog_sm_t sm[APIO_MAX_PIO_BLOCKS][APIO_MAX_SMS_PER_BLOCK];
+#if defined(APIO_EMULATION)
+    // Optional, set after apio_wdog_init() - the interpreter running each
+    // block, in which stuck SMs are also restarted
+    apio_sim_t *sim[APIO_MAX_PIO_BLOCKS];
+#endif // APIO_EMULATION
+} apio_wdog_t;
+
+// Watch the current PIO SM, restarting it, if stuck, at the current
+// __pio_start.  Use within the assembly scope, once the SM's program has been
+// added.
+#define APIO_WDOG_WATCH(WD) \
+                            do {                                                \
+                                (WD)->sm[__blk][__sm].start = __pio_start[__blk][__sm]; \
+                                (WD)->sm[__blk][__sm].unchanged = 0;            \
+                                (WD)->sm[__blk][__sm].stuck = 0;                \
+                                (WD)->sm_mask |= APIO_MON_SM(__blk, __sm);      \
+                            } while (0)
+
+// Initialise a watchdog, watching no SMs.  It is polled every PERIOD_US
+// microseconds, and an SM whose ADDR is unchanged for TIMEOUT_US is stuck.
+// If RECOVER is non-zero, stuck SMs are restarted.
+void apio_wdog_init(apio_wdog_t *wdog, uint32_t period_us, uint32_t timeout_us, uint8_t recover);
+
+// Check the watched SMs which are enabled, returning an APIO_MON_SM() mask
+// of those found stuck by this poll.  A stuck SM is reported once, until it
+// moves or is restarted.  Suitable for calling from an interrupt handler if
+// fn is too.
+//
+// An SM legitimately parked at one instruction for longer than the timeout,
+// or looping with a period which is a multiple of the polling period, will be
+// reported, so choose the timeout and period with the programs in mind.
+uint32_t apio_wdog_poll(apio_wdog_t *wdog);
+
+// Restart an SM at its start address, clearing its FIFOs, shift counters, ISR
+// and any stalled instruction.  X, Y, OSR and pin state are retained.
+void apio_wdog_recover(apio_wdog_t *wdog, uint8_t block, uint8_t sm);
+
+// Log the watched SMs' stuck and recovery counts using APIO_LOG().  No-op if
+// logging is disabled.
+void apio_wdog_log(const apio_wdog_t *wdog);
+
+#if defined(APIO_MON_IMPL)
+
+void apio_prof_start(apio_prof_t *prof, uint32_t sm_mask, uint32_t window) {
+    memset(prof, 0, sizeof(*prof));
+    prof->sm_mask = sm_mask & APIO_MON_ALL_SMS;
+    prof->window = window;
+}
+
+int apio_prof_sample(apio_prof_t *prof) {
+    if (apio_prof_done(prof)) {
+        return 0;
+    }
+    for (uint8_t block = 0; block < APIO_MAX_PIO_BLOCKS; block++) {
+        for (uint8_t sm = 0; sm < APIO_MAX_SMS_PER_BLOCK; sm++) {
+            if (!(prof->sm_mask & APIO_MON_SM(block, sm))) {
+                continue;
+            }
+            volatile pio_sm_reg_t *reg = _apio_mon_sm_reg(block, sm);
+            uint8_t addr = (uint8_t)(reg->addr & (APIO_MAX_PIO_INSTRS - 1));
+            uint32_t stalled = _apio_mon_fdebug_take(block, APIO_FDEBUG_TXSTALL(sm) | APIO_FDEBUG_RXSTALL(sm)) ? 1 : 0;
+            prof->sm[block][sm].hits[addr]++;
+            prof->sm[block][sm].stalled[addr] += stalled;
+        }
+    }
+    prof->samples++;
+    return 1;
+}
+
+void apio_prof_log(const apio_prof_t *prof, uint8_t block, const uint16_t *instr) {
+#if defined(APIO_LOG_ENABLE)
+    char dis[64];
+    for (uint8_t sm = 0; sm < APIO_MAX_SMS_PER_BLOCK; sm++) {
+        if (!(prof->sm_mask & APIO_MON_SM(block, sm))) {
+            continue;
+        }
+        const apio_prof_sm_t *hist = &prof->sm[block][sm];
+        uint32_t stalled = 0;
+        for (int ii = 0; ii < APIO_MAX_PIO_INSTRS; ii++) {
+            stalled += hist->stalled[ii];
+        }
+        APIO_LOG("PIO%d:%d profile: %u samples, %u stalled",
+            block, sm, (unsigned)prof->samples, (unsigned)stalled);
+        APIO_LOG("  addr      hits      %%    stalled ; disassembly");
+        for (int ii = 0; ii < APIO_MAX_PIO_INSTRS; ii++) {
+            if (!hist->hits[ii]) {
+                continue;
+            }
+            uint32_t permille = (uint32_t)(((uint64_t)hist->hits[ii] * 1000) / prof->samples);
+            if (instr) {
+                apio_instruction_decoder(instr[ii], dis, 0);
+            } else {
+                dis[0] = '\0';
+            }
+            (void)permille;
+            APIO_LOG("  %4d %9u %3u.%u%% %10u ; %s",
+                ii,
+                (unsigned)hist->hits[ii],
+                (unsigned)(permille / 10), (unsigned)(permille % 10),
+                (unsigned)hist->stalled[ii],
+                dis);
+        }
+    }
+#else // !APIO_LOG_ENABLE
+    (void)prof;
+    (void)block;
+    (void)instr;
+#endif // APIO_LOG_ENABLE
+}
+
+void apio_fdebug_reset(apio_fdebug_t *fdebug) {
+    for (uint8_t block = 0; block < APIO_MAX_PIO_BLOCKS; block++) {
+        (void)_apio_mon_fdebug_take(block, 0xFFFFFFFF);
+    }
+    memset(fdebug, 0, sizeof(*fdebug));
+}
+
+// Counts an event, saturating
+static inline void apio_fdebug_count(uint32_t *counter, uint32_t flags, uint32_t bit) {
+    if ((flags & bit) && (*counter != 0xFFFFFFFF)) {
+        (*counter)++;
+    }
+}
+
+void apio_fdebug_poll(apio_fdebug_t *fdebug) {
+    for (uint8_t block = 0; block < APIO_MAX_PIO_BLOCKS; block++) {
+        uint32_t flags = _apio_mon_fdebug_take(block, 0xFFFFFFFF);
+        if (!flags) {
+            continue;
+        }
+        for (uint8_t sm = 0; sm < APIO_MAX_SMS_PER_BLOCK; sm++) {
+            apio_fdebug_sm_t *counts = &fdebug->sm[block][sm];
+            apio_fdebug_count(&counts->tx_stall, flags, APIO_FDEBUG_TXSTALL(sm));
+            apio_fdebug_count(&counts->tx_over, flags, APIO_FDEBUG_TXOVER(sm));
+            apio_fdebug_count(&counts->rx_under, flags, APIO_FDEBUG_RXUNDER(sm));
+            apio_fdebug_count(&counts->rx_stall, flags, APIO_FDEBUG_RXSTALL(sm));
+        }
+    }
+    fdebug->polls++;
+}
+
+void apio_fdebug_snapshot(apio_fdebug_t *fdebug, apio_fdebug_t *snap) {
+    apio_fdebug_poll(fdebug);
+    *snap = *fdebug;
+}
+
+void apio_fdebug_log(const apio_fdebug_t *fdebug) {
+    APIO_LOG("FDEBUG: %u polls", (unsigned)fdebug->polls);
+    for (int block = 0; block < APIO_MAX_PIO_BLOCKS; block++) {
+        for (int sm = 0; sm < APIO_MAX_SMS_PER_BLOCK; sm++) {
+            const apio_fdebug_sm_t *counts = &fdebug->sm[block][sm];
+            if (!(counts->tx_stall | counts->tx_over | counts->rx_under | counts->rx_stall)) {
+                continue;
+            }
+            APIO_LOG("  PIO%d:%d tx_stall=%u tx_over=%u rx_under=%u rx_stall=%u",
+                block, sm,
+                (unsigned)counts->tx_stall,
+                (unsigned)counts->tx_over,
+                (unsigned)counts->rx_under,
+                (unsigned)counts->rx_stall);
+        }
+    }
+}
+
+void apio_flevel_start(apio_flevel_t *flevel, uint32_t sm_mask, uint32_t period_us) {
+    memset(flevel, 0, sizeof(*flevel));
+    flevel->sm_mask = sm_mask & APIO_MON_ALL_SMS;
+    flevel->period_us = period_us;
+    for (uint8_t block = 0; block < APIO_MAX_PIO_BLOCKS; block++) {
+        for (uint8_t sm = 0; sm < APIO_MAX_SMS_PER_BLOCK; sm++) {
+            uint32_t shiftctrl = _apio_mon_sm_reg(block, sm)->shiftctrl;
+            apio_flevel_sm_t *hist = &flevel->sm[block][sm];
+            if (APIO_SHIFTCTRL_FJOIN_TX_FROM_REG(shiftctrl)) {
+                hist->tx_depth = APIO_MAX_FIFO_DEPTH * 2;
+            } else if (APIO_SHIFTCTRL_FJOIN_RX_FROM_REG(shiftctrl)) {
+                hist->rx_depth = APIO_MAX_FIFO_DEPTH * 2;
+            } else {
+                hist->tx_depth = APIO_MAX_FIFO_DEPTH;
+                hist->rx_depth = APIO_MAX_FIFO_DEPTH;
+            }
+        }
+    }
+}
+
+void apio_flevel_sample(apio_flevel_t *flevel) {
+    for (uint8_t block = 0; block < APIO_MAX_PIO_BLOCKS; block++) {
+        uint32_t mask = (flevel->sm_mask >> (block * APIO_MAX_SMS_PER_BLOCK)) & ((1u << APIO_MAX_SMS_PER_BLOCK) - 1);
+        if (!mask) {
+            continue;
+        }
+        uint32_t reg = _apio_mon_flevel(block);
+        for (uint8_t sm = 0; sm < APIO_MAX_SMS_PER_BLOCK; sm++) {
+            if (!(mask & (1u << sm))) {
+                continue;
+            }
+            uint8_t tx = (uint8_t)APIO_FLEVEL_TX_FROM_REG(reg, sm);
+            uint8_t rx = (uint8_t)APIO_FLEVEL_RX_FROM_REG(reg, sm);
+            flevel->sm[block][sm].tx[(tx < APIO_FLEVEL_BINS) ? tx : (APIO_FLEVEL_BINS - 1)]++;
+            flevel->sm[block][sm].rx[(rx < APIO_FLEVEL_BINS) ? rx : (APIO_FLEVEL_BINS - 1)]++;
+        }
+    }
+    flevel->samples++;
+}
+
+// Mean level of a histogram, in hundredths
+static uint32_t apio_flevel_mean_x100(const uint32_t *bins, uint32_t samples) {
+    if (!samples) {
+        return 0;
+    }
+    uint64_t sum = 0;
+    for (int ii = 0; ii < APIO_FLEVEL_BINS; ii++) {
+        sum += (uint64_t)bins[ii] * ii;
+    }
+    return (uint32_t)((sum * 100) / samples);
+}
+
+void apio_flevel_report(
+    const apio_flevel_t *flevel,
+    uint8_t block,
+    uint8_t sm,
+    apio_flevel_report_t *report
+) {
+    const apio_flevel_sm_t *hist = &flevel->sm[block][sm];
+    uint64_t period = flevel->period_us;
+    memset(report, 0, sizeof(*report));
+    if (hist->tx_depth) {
+        report->tx_empty_us = hist->tx[0] * period;
+        report->tx_full_us = hist->tx[hist->tx_depth] * period;
+        report->tx_mean_x100 = apio_flevel_mean_x100(hist->tx, flevel->samples);
+    }
+    if (hist->rx_depth) {
+        report->rx_empty_us = hist->rx[0] * period;
+        report->rx_full_us = hist->rx[hist->rx_depth] * period;
+        report->rx_mean_x100 = apio_flevel_mean_x100(hist->rx, flevel->samples);
+    }
+}
+
+void apio_flevel_log(const apio_flevel_t *flevel) {
+#if defined(APIO_LOG_ENABLE)
+    APIO_LOG("FLEVEL: %u samples, every %uus",
+        (unsigned)flevel->samples, (unsigned)flevel->period_us);
+    for (uint8_t block = 0; block < APIO_MAX_PIO_BLOCKS; block++) {
+        for (uint8_t sm = 0; sm < APIO_MAX_SMS_PER_BLOCK; sm++) {
+            if (!(flevel->sm_mask & APIO_MON_SM(block, sm))) {
+                continue;
+            }
+            const apio_flevel_sm_t *hist = &flevel->sm[block][sm];
+            apio_flevel_report_t report;
+            apio_flevel_report(flevel, block, sm, &report);
+            APIO_LOG("  PIO%d:%d", block, sm);
+            if (hist->tx_depth) {
+                APIO_LOG("    tx: depth=%d mean=%u.%02u empty=%lluus full=%lluus",
+                    hist->tx_depth,
+                    (unsigned)(report.tx_mean_x100 / 100), (unsigned)(report.tx_mean_x100 % 100),
+                    (unsigned long long)report.tx_empty_us,
+                    (unsigned long long)report.tx_full_us);
+                for (int ii = 0; ii <= hist->tx_depth; ii++) {
+                    APIO_LOG("      %d: %u", ii, (unsigned)hist->tx[ii]);
+                }
+            }
+            if (hist->rx_depth) {
+                APIO_LOG("    rx: depth=%d mean=%u.%02u empty=%lluus full=%lluus",
+                    hist->rx_depth,
+                    (unsigned)(report.rx_mean_x100 / 100), (unsigned)(report.rx_mean_x100 % 100),
+                    (unsigned long long)report.rx_empty_us,
+                    (unsigned long long)report.rx_full_us);
+                for (int ii = 0; ii <= hist->rx_depth; ii++) {
+                    APIO_LOG("      %d: %u", ii, (unsigned)hist->rx[ii]);
+                }
+            }
+        }
+    }
+#else // !APIO_LOG_ENABLE
+    (void)flevel;
+#endif // APIO_LOG_ENABLE
+}
+
+void apio_wdog_init(apio_wdog_t *wdog, uint32_t period_us, uint32_t timeout_us, uint8_t recover) {
+    memset(wdog, 0, sizeof(*wdog));
+    if (period_us == 0) {
+        period_us = 1;
+    }
+    wdog->timeout_polls = (timeout_us + period_us - 1) / period_us;
+    if (wdog->timeout_polls == 0) {
+        wdog->timeout_polls = 1;
+    }
+    wdog->recover = recover;
+}
+
+void apio_wdog_recover(apio_wdog_t *wdog, uint8_t block, uint8_t sm) {
+    apio_wdog_sm_t *state = &wdog->sm[block][sm];
+    _apio_mon_sm_restart(block, sm, state->start);
+#if defined(APIO_EMULATION)
+    if (wdog->sim[block]) {
+        apio_sim_restart(wdog->sim[block], sm, state->start);
+    }
+#endif // APIO_EMULATION
+    state->addr = state->start;
+    state->unchanged = 0;
+    state->stuck = 0;
+    state->recoveries++;
+}
+
+uint32_t apio_wdog_poll(apio_wdog_t *wdog) {
+    uint32_t found = 0;
+    for (uint8_t block = 0; block < APIO_MAX_PIO_BLOCKS; block++) {
+        uint8_t enabled = _apio_mon_enabled(block);
+        for (uint8_t sm = 0; sm < APIO_MAX_SMS_PER_BLOCK; sm++) {
+            if (!(wdog->sm_mask & APIO_MON_SM(block, sm))) {
+                continue;
+            }
+            apio_wdog_sm_t *state = &wdog->sm[block][sm];
+            if (!(enabled & (1u << sm))) {
+                state->unchanged = 0;
+                state->stuck = 0;
+                continue;
+            }
+            volatile pio_sm_reg_t *reg = _apio_mon_sm_reg(block, sm);
+            uint8_t addr = (uint8_t)(reg->addr & (APIO_MAX_PIO_INSTRS - 1));
+            if (addr != state->addr) {
+                state->addr = addr;
+                state->unchanged = 0;
+                state->stuck = 0;
+                continue;
+            }
+            if (state->stuck || (++state->unchanged < wdog->timeout_polls)) {
+                continue;
+            }
+
+            state->exec_stalled = (uint8_t)APIO_EXECCTRL_EXEC_STALLED_FROM_REG(reg->execctrl);
+            state->stuck = 1;
+            state->stuck_count++;
+            found |= APIO_MON_SM(block, sm);
+            APIO_LOG("PIO%d:%d stuck at 0x%02X%s",
+                block, sm, addr, state->exec_stalled ? " (EXEC_STALLED)" : "");
+
+            int recover = wdog->recover;
+            if (wdog->fn) {
+                recover = wdog->fn(block, sm, wdog->user) && recover;
+            }
+            if (recover) {
+                apio_wdog_recover(wdog, block, sm);
+                APIO_LOG("PIO%d:%d restarted at 0x%02X", block, sm, state->start);
+            }
+        }
+    }
+    return found;
+}
+
+void apio_wdog_log(const apio_wdog_t *wdog) {
+#if defined(APIO_LOG_ENABLE)
+    APIO_LOG("Watchdog: timeout %u polls", (unsigned)wdog->timeout_polls);
+    for (uint8_t block = 0; block < APIO_MAX_PIO_BLOCKS; block++) {
+        for (uint8_t sm = 0; sm < APIO_MAX_SMS_PER_BLOCK; sm++) {
+            if (!(wdog->sm_mask & APIO_MON_SM(block, sm))) {
+                continue;
+            }
+            const apio_wdog_sm_t *state = &wdog->sm[block][sm];
+            APIO_LOG("  PIO%d:%d start=0x%02X stuck=%u recoveries=%u%s",
+                block, sm, state->start,
+                (unsigned)state->stuck_count, (unsigned)state->recoveries,
+                state->stuck ? " (stuck)" : "");
+            (void)state;
+        }
+    }
+#else // !APIO_LOG_ENABLE
+    (void)wdog;
+#endif // APIO_LOG_ENABLE
+}
+
+#endif // APIO_MON_IMPL
+
+#endif // APIO_MON_H
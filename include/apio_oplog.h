@@ -0,0 +1,327 @@
+// Copyright (C) 2026 Piers Finlayson <piers@piers.rocks>
+//
+// MIT License
+
+// apio - Runtime RP2350 PIO Assembler and Disassembler
+//
+// Replays an operation log, recorded by building with APIO_OPLOG defined, into
+// the emulated PIO and GPIO state.  The log may have been recorded on hardware
+// or in emulation.  The result is the same state the recorded apio calls
+// would have produced in emulation, ready for apio_sim_init(),
+// apio_emu_snapshot() or an external emulator.
+//
+// Usage:
+//
+//   int count = apio_oplog_replay_file("capture.oplog");
+//   if (count < 0) {
+//       // Handle APIO_OPLOG_ERR_*
+//   }
+//
+// Only available when APIO_EMULATION is defined.  The implementation is
+// included in the source file that defines APIO_EMU_IMPL.  Replayed
+// operations are not themselves re-recorded.
+
+#ifndef APIO_OPLOG_H
+#define APIO_OPLOG_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include <apio.h>
+
+#if defined(APIO_EMULATION)
+
+// Errors returned by the replay functions
+#define APIO_OPLOG_ERR_TRUNCATED    -1  // Length not a multiple of the record size
+#define APIO_OPLOG_ERR_FORMAT       -2  // Not an operation log
+#define APIO_OPLOG_ERR_VERSION      -3  // Unsupported operation log version
+#define APIO_OPLOG_ERR_OP           -4  // Unknown operation
+#define APIO_OPLOG_ERR_RANGE        -5  // Block, SM, GPIO, offset or FIFO out of range
+#define APIO_OPLOG_ERR_IO           -6  // File could not be read
+
+// Apply a single APIO_OPLOG_RECORD_SIZE byte record.  Returns 0 on success or
+// an APIO_OPLOG_ERR_* value, in which case the state is unchanged.
+int apio_oplog_replay_record(const uint8_t *rec);
+
+// Apply LEN bytes of records in order.  Returns the number of records applied,
+// or an APIO_OPLOG_ERR_* value.  On error, records before the failing one
+// have been applied.
+int apio_oplog_replay(const uint8_t *data, size_t len);
+
+// Apply all records in a file.  Returns as apio_oplog_replay().
+int apio_oplog_replay_file(const char *path);
+
+#if defined(APIO_EMU_IMPL)
+
+// GPIO operations, applied through the same helpers as the emulated GPIO
+// macros
+static int apio_oplog_replay_gpio(uint8_t op, uint8_t pin, uint32_t value) {
+    if (op == APIO_OPLOG_OP_GPIO_INIT) {
+        _apio_emu_gpio_init();
+        return 0;
+    }
+    if (pin >= APIO_MAX_GPIOS) {
+        return APIO_OPLOG_ERR_RANGE;
+    }
+    uint64_t bit = 1ULL << pin;
+    switch (op) {
+        case APIO_OPLOG_OP_GPIO_INPUT_OUTPUT:
+            if (value >= APIO_MAX_PIO_BLOCKS) {
+                return APIO_OPLOG_ERR_RANGE;
+            }
+            _apio_emu_gpio_input_output(pin, (uint8_t)value);
+            break;
+        case APIO_OPLOG_OP_GPIO_INPUT_ONLY:
+            _apio_emu_gpio_input_only(pin);
+            break;
+        case APIO_OPLOG_OP_GPIO_PULL_UP:
+            _apio_emulated_gpios.pull_up |= bit;
+            _apio_emulated_gpios.pull_down &= ~bit;
+            break;
+        case APIO_OPLOG_OP_GPIO_PULL_DOWN:
+            _apio_emulated_gpios.pull_down |= bit;
+            _apio_emulated_gpios.pull_up &= ~bit;
+            break;
+        case APIO_OPLOG_OP_GPIO_PULL_NONE:
+            _apio_emulated_gpios.pull_up &= ~bit;
+            _apio_emulated_gpios.pull_down &= ~bit;
+            break;
+        case APIO_OPLOG_OP_GPIO_DRIVE:
+            _apio_emulated_gpios.drive_strength[pin] = (uint8_t)value;
+            break;
+        case APIO_OPLOG_OP_GPIO_SLEW_FAST:
+            _apio_emulated_gpios.slew_fast |= bit;
+            break;
+        case APIO_OPLOG_OP_GPIO_SLEW_SLOW:
+            _apio_emulated_gpios.slew_fast &= ~bit;
+            break;
+        case APIO_OPLOG_OP_GPIO_INPUT_INVERT:
+        case APIO_OPLOG_OP_GPIO_FORCE_LOW:
+        case APIO_OPLOG_OP_GPIO_FORCE_HIGH:
+            _apio_emulated_gpios.inverted[pin] = (op == APIO_OPLOG_OP_GPIO_INPUT_INVERT);
+            _apio_emulated_gpios.force_input_low[pin] = (op == APIO_OPLOG_OP_GPIO_FORCE_LOW);
+            _apio_emulated_gpios.force_input_high[pin] = (op == APIO_OPLOG_OP_GPIO_FORCE_HIGH);
+            break;
+        default:
+            return APIO_OPLOG_ERR_OP;
+    }
+    return 0;
+}
+
+// Operations with no block/SM context
+static int apio_oplog_replay_global(uint8_t op, uint32_t value) {
+    uint32_t block = value >> 8;
+    uint8_t mask = value & 0xFF;
+    switch (op) {
+        case APIO_OPLOG_OP_ENABLE_PIOS:
+            _apio_emulated_pio.pios_enabled = 1;
+            break;
+        case APIO_OPLOG_OP_CLEAR_IRQ:
+            if (value >= APIO_MAX_PIO_BLOCKS) {
+                return APIO_OPLOG_ERR_RANGE;
+            }
+            _apio_emulated_pio.irq[value] = 0xFFFFFFFF;
+            _APIO_EMU_DIRTY(value);
+            break;
+        case APIO_OPLOG_OP_CLEAR_ALL_IRQS:
+            for (int ii = 0; ii < APIO_MAX_PIO_BLOCKS; ii++) {
+                _apio_emulated_pio.irq[ii] = 0xFFFFFFFF;
+            }
+            _apio_emulated_pio.layout.dirty_blocks = APIO_EMU_ALL_BLOCKS;
+            break;
+        case APIO_OPLOG_OP_RESET_BLOCK:
+            if (value >= APIO_MAX_PIO_BLOCKS) {
+                return APIO_OPLOG_ERR_RANGE;
+            }
+            _apio_emu_reset_block((uint8_t)value);
+            break;
+        case APIO_OPLOG_OP_ENABLE_SMS:
+        case APIO_OPLOG_OP_ENABLE_SM:
+            if ((block >= APIO_MAX_PIO_BLOCKS) || (mask >= (1 << APIO_MAX_SMS_PER_BLOCK))) {
+                return APIO_OPLOG_ERR_RANGE;
+            }
+            if (op == APIO_OPLOG_OP_ENABLE_SMS) {
+                _apio_emulated_pio.enabled_sms[block] = mask;
+            } else {
+                _apio_emulated_pio.enabled_sms[block] |= mask;
+            }
+            _APIO_EMU_DIRTY(block);
+            break;
+        default:
+            return APIO_OPLOG_ERR_OP;
+    }
+    return 0;
+}
+
+int apio_oplog_replay_record(const uint8_t *rec) {
+    uint8_t op = rec[0];
+    uint8_t block = rec[1] >> 4;
+    uint8_t sm = rec[1] & 0xF;
+    uint32_t value = (uint32_t)rec[4] |
+                     ((uint32_t)rec[5] << 8) |
+                     ((uint32_t)rec[6] << 16) |
+                     ((uint32_t)rec[7] << 24);
+
+    if (block == APIO_OPLOG_NO_BLOCK) {
+        if (op >= APIO_OPLOG_OP_GPIO_INIT) {
+            return apio_oplog_replay_gpio(op, rec[2], value);
+        }
+        return apio_oplog_replay_global(op, value);
+    }
+    if ((block >= APIO_MAX_PIO_BLOCKS) || (sm >= APIO_MAX_SMS_PER_BLOCK)) {
+        return APIO_OPLOG_ERR_RANGE;
+    }
+
+    // Program offsets must lie within instruction memory, and offsets being
+    // appended to must leave room for the instruction.
+    uint8_t offset = _apio_emulated_pio.offset[block];
+    switch (op) {
+        case APIO_OPLOG_OP_SET_BLOCK_FROM:
+        case APIO_OPLOG_OP_END_BLOCK_FROM:
+            if (value > APIO_MAX_PIO_INSTRS) {
+                return APIO_OPLOG_ERR_RANGE;
+            }
+            break;
+        case APIO_OPLOG_OP_ADD_INSTR:
+            if (offset >= APIO_MAX_PIO_INSTRS) {
+                return APIO_OPLOG_ERR_RANGE;
+            }
+            break;
+        case APIO_OPLOG_OP_TXF:
+            if (_apio_emulated_pio.tx_fifo_count[block][sm] >= APIO_MAX_FIFO_DEPTH) {
+                return APIO_OPLOG_ERR_RANGE;
+            }
+            break;
+        default:
+            break;
+    }
+
+    switch (op) {
+        case APIO_OPLOG_OP_INIT:
+        case APIO_OPLOG_OP_CONTINUE:
+            if ((value & 0xFFFFFF00) != (APIO_OPLOG_MAGIC & 0xFFFFFF00)) {
+                return APIO_OPLOG_ERR_FORMAT;
+            }
+            if (value != APIO_OPLOG_MAGIC) {
+                return APIO_OPLOG_ERR_VERSION;
+            }
+            if (op == APIO_OPLOG_OP_INIT) {
+                _apio_emu_asm_init();
+            }
+            break;
+        case APIO_OPLOG_OP_SET_BLOCK:
+            break;
+        case APIO_OPLOG_OP_SET_BLOCK_FROM:
+            _apio_emulated_pio.offset[block] = (uint8_t)value;
+            break;
+        case APIO_OPLOG_OP_SET_SM:
+            _apio_emulated_pio.first_instr[block][sm] = offset;
+            _apio_emulated_pio.start[block][sm] = offset;
+            _apio_emulated_pio.wrap_bottom[block][sm] = offset;
+            _apio_emulated_pio.wrap_top[block][sm] = offset;
+            _apio_emulated_pio.end[block][sm] = offset;
+            break;
+        case APIO_OPLOG_OP_START:
+            _apio_emulated_pio.start[block][sm] = offset;
+            break;
+        case APIO_OPLOG_OP_END:
+            _apio_emulated_pio.end[block][sm] = offset;
+            break;
+        case APIO_OPLOG_OP_WRAP_BOTTOM:
+            _apio_emulated_pio.wrap_bottom[block][sm] = offset;
+            break;
+        case APIO_OPLOG_OP_WRAP_TOP:
+            _apio_emulated_pio.wrap_top[block][sm] = offset;
+            break;
+        case APIO_OPLOG_OP_ADD_INSTR:
+            _apio_emulated_pio.instr[block][offset] = (uint16_t)value;
+            _apio_emulated_pio.offset[block] = offset + 1;
+            break;
+        case APIO_OPLOG_OP_END_BLOCK_FROM:
+            _apio_emulated_pio.max_offset[block] = offset;
+            break;
+        case APIO_OPLOG_OP_CLKDIV:
+            _apio_emulated_pio.pio_sm_reg[block][sm].clkdiv = value;
+            break;
+        case APIO_OPLOG_OP_EXECCTRL:
+            _apio_emulated_pio.pio_sm_reg[block][sm].execctrl = value;
+            break;
+        case APIO_OPLOG_OP_SHIFTCTRL:
+            _apio_emulated_pio.pio_sm_reg[block][sm].shiftctrl = value;
+            break;
+        case APIO_OPLOG_OP_PINCTRL:
+            _apio_emulated_pio.pio_sm_reg[block][sm].pinctrl = value;
+            break;
+        case APIO_OPLOG_OP_EXEC_INSTR:
+            _apio_emu_queue_instr(block, sm, (uint16_t)value);
+            break;
+        case APIO_OPLOG_OP_TXF:
+            _apio_emulated_pio.tx_fifos[block][sm][_apio_emulated_pio.tx_fifo_count[block][sm]++] = value;
+            break;
+        case APIO_OPLOG_OP_GPIOBASE:
+            _apio_emulated_pio.gpio_base[block] = value;
+            break;
+        default:
+            return APIO_OPLOG_ERR_OP;
+    }
+
+    // Reflect the block and SM selected when the record was made, and mark
+    // the block for handoff
+    _apio_emulated_pio.block = block;
+    _apio_emulated_pio.sm = sm;
+    _APIO_EMU_DIRTY(block);
+    return 0;
+}
+
+// Applies record INDEX of a log, logging any failure
+static int apio_oplog_replay_indexed(const uint8_t *rec, int index) {
+    int rc = apio_oplog_replay_record(rec);
+    if (rc < 0) {
+        APIO_LOG("Operation log record %d (op 0x%02X) failed: %d", index, rec[0], rc);
+    }
+#if !defined(APIO_LOG_ENABLE)
+    (void)index;
+#endif // !APIO_LOG_ENABLE
+    return rc;
+}
+
+int apio_oplog_replay(const uint8_t *data, size_t len) {
+    if (len % APIO_OPLOG_RECORD_SIZE) {
+        return APIO_OPLOG_ERR_TRUNCATED;
+    }
+    int count = 0;
+    for (size_t ii = 0; ii < len; ii += APIO_OPLOG_RECORD_SIZE) {
+        int rc = apio_oplog_replay_indexed(data + ii, count);
+        if (rc < 0) {
+            return rc;
+        }
+        count++;
+    }
+    return count;
+}
+
+int apio_oplog_replay_file(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return APIO_OPLOG_ERR_IO;
+    }
+    uint8_t rec[APIO_OPLOG_RECORD_SIZE];
+    int count = 0;
+    size_t len;
+    while ((len = fread(rec, 1, sizeof(rec), file)) == sizeof(rec)) {
+        int rc = apio_oplog_replay_indexed(rec, count);
+        if (rc < 0) {
+            fclose(file);
+            return rc;
+        }
+        count++;
+    }
+    int rc = ferror(file) ? APIO_OPLOG_ERR_IO : (len ? APIO_OPLOG_ERR_TRUNCATED : count);
+    fclose(file);
+    return rc;
+}
+
+#endif // APIO_EMU_IMPL
+
+#endif // APIO_EMULATION
+
+#endif // APIO_OPLOG_H
@@ -49,6 +49,7 @@ typedef struct pio_sm_reg {
 #define APIO_RESETS_BASE        (0x40020000U)
 #define APIO_IO_BANK0_BASE      (0x40028000U)
 #define APIO_PADS_BANK0_BASE    (0x40038000U)
+#define APIO_DMA_BASE           (0x50000000U)
 
 // Registers used for configuring GPIOs
 #define APIO_RESET_RESET            (*((volatile uint32_t *)(APIO_RESETS_BASE + 0x00)))
@@ -113,6 +114,9 @@ typedef struct pio_sm_reg {
 #define APIO_SM_RXF_OFFSET              (0x128)
 #define APIO_SM_TXF_OFFSET              (0x138)
 #define APIO_GPIOBASE_OFFSET            (0x168)
+#define APIO_INTR_OFFSET                (0x16C)
+#define APIO_IRQ0_INTE_OFFSET           (0x170)
+#define APIO_IRQ1_INTE_OFFSET           (0x17C)
 
 /// Macros for accessing PIO control registers
 #define APIO0_CTRL          (*(volatile uint32_t *)(APIO0_BASE + APIO_CTRL_OFFSET))
@@ -124,6 +128,9 @@ typedef struct pio_sm_reg {
 #define APIO0_FLEVEL        (*(volatile uint32_t *)(APIO0_BASE + APIO_FLEVEL_OFFSET))
 #define APIO1_FLEVEL        (*(volatile uint32_t *)(APIO1_BASE + APIO_FLEVEL_OFFSET))
 #define APIO2_FLEVEL        (*(volatile uint32_t *)(APIO2_BASE + APIO_FLEVEL_OFFSET))
+#define APIO0_FDEBUG        (*(volatile uint32_t *)(APIO0_BASE + APIO_FDEBUG_OFFSET))
+#define APIO1_FDEBUG        (*(volatile uint32_t *)(APIO1_BASE + APIO_FDEBUG_OFFSET))
+#define APIO2_FDEBUG        (*(volatile uint32_t *)(APIO2_BASE + APIO_FDEBUG_OFFSET))
 #define APIO0_SM_TXF(X)     (*(volatile uint32_t *)(APIO0_BASE + APIO_TXF_OFFSET + ((X) * 0x04)))
 #define APIO1_SM_TXF(X)     (*(volatile uint32_t *)(APIO1_BASE + APIO_TXF_OFFSET + ((X) * 0x04)))
 #define APIO2_SM_TXF(X)     (*(volatile uint32_t *)(APIO2_BASE + APIO_TXF_OFFSET + ((X) * 0x04)))
@@ -143,6 +150,16 @@ typedef struct pio_sm_reg {
 #define APIO1_GPIOBASE (*(volatile uint32_t *)(APIO1_BASE + APIO_GPIOBASE_OFFSET))
 #define APIO2_GPIOBASE (*(volatile uint32_t *)(APIO2_BASE + APIO_GPIOBASE_OFFSET))
 
+#define APIO0_IRQ0_INTE     (*(volatile uint32_t *)(APIO0_BASE + APIO_IRQ0_INTE_OFFSET))
+#define APIO1_IRQ0_INTE     (*(volatile uint32_t *)(APIO1_BASE + APIO_IRQ0_INTE_OFFSET))
+#define APIO2_IRQ0_INTE     (*(volatile uint32_t *)(APIO2_BASE + APIO_IRQ0_INTE_OFFSET))
+#define APIO0_IRQ1_INTE     (*(volatile uint32_t *)(APIO0_BASE + APIO_IRQ1_INTE_OFFSET))
+#define APIO1_IRQ1_INTE     (*(volatile uint32_t *)(APIO1_BASE + APIO_IRQ1_INTE_OFFSET))
+#define APIO2_IRQ1_INTE     (*(volatile uint32_t *)(APIO2_BASE + APIO_IRQ1_INTE_OFFSET))
+
+// IRQ0_INTE/IRQ1_INTE - route a PIO IRQ flag, 0-7, to the block's interrupt
+#define APIO_INTE_SM(X)     (1u << ((X) + 8))
+
 // GPIOBASE
 #define APIO_GPIOBASE_VAL_0     (0)
 #define APIO_GPIOBASE_VAL_16    (1 << 4)
@@ -152,11 +169,32 @@ typedef struct pio_sm_reg {
 #define APIO0_CTRL_SM_ENABLE(X)     APIO0_CTRL = APIO_CTRL_SM_ENABLE(X)
 #define APIO1_CTRL_SM_ENABLE(X)     APIO1_CTRL = APIO_CTRL_SM_ENABLE(X)
 #define APIO2_CTRL_SM_ENABLE(X)     APIO2_CTRL = APIO_CTRL_SM_ENABLE(X)
+#define APIO_CTRL_SM_ENABLE_FROM_REG(REG)   ((REG) & 0xf)
+// Self-clearing.  Clears the SM's shift counters, ISR, delay and any stalled
+// instruction, but not its PC or FIFOs.
+#define APIO_CTRL_SM_RESTART(X)     (((X) & 0xf) << 4)
+// Self-clearing.  Restarts the SMs' clock dividers, so SMs started together
+// with the same divider stay in phase.
+#define APIO_CTRL_CLKDIV_RESTART(X) (((X) & 0xf) << 8)
 
 // Macros for PIO FSTAT registers
 #define APIO_FSTAT_SMX_RX_EMPTY_BIT(X)       (1 << (X + 8))
+#define APIO_FSTAT_SMX_TX_EMPTY_BIT(X)       (1 << (X + 24))
 #define APIO0_FSTAT_SMX_RX_EMPTY(X)          (APIO_FSTAT_SMX_RX_EMPTY_BIT(X) & APIO0_FSTAT)
 
+// Macros for PIO FLEVEL registers.  Levels are 0-8, the upper half only with
+// joined FIFOs.
+#define APIO_FLEVEL_TX(X, LEVEL)            (((LEVEL) & 0xFu) << ((X) * 8))
+#define APIO_FLEVEL_RX(X, LEVEL)            (((LEVEL) & 0xFu) << (((X) * 8) + 4))
+#define APIO_FLEVEL_TX_FROM_REG(REG, X)     (((REG) >> ((X) * 8)) & 0xFu)
+#define APIO_FLEVEL_RX_FROM_REG(REG, X)     (((REG) >> (((X) * 8) + 4)) & 0xFu)
+
+// Macros for PIO FDEBUG registers.  Flags are sticky - write 1 to clear.
+#define APIO_FDEBUG_TXSTALL(X)      (1u << ((X) + 24))  // Stalled on empty TX FIFO, by PULL or autopull
+#define APIO_FDEBUG_TXOVER(X)       (1u << ((X) + 16))  // Write to full TX FIFO
+#define APIO_FDEBUG_RXUNDER(X)      (1u << ((X) + 8))   // Read from empty RX FIFO
+#define APIO_FDEBUG_RXSTALL(X)      (1u << ((X) + 0))   // Stalled on full RX FIFO, by PUSH or autopush
+
 // Macros for filling PIO instruction memory
 #define APIO0_INSTR_MEM(X)       (*(volatile uint32_t *)(APIO0_BASE + APIO_INSTR_MEM_OFFSET + ((X) * 4)))
 #define APIO1_INSTR_MEM(X)       (*(volatile uint32_t *)(APIO1_BASE + APIO_INSTR_MEM_OFFSET + ((X) * 4)))
@@ -178,6 +216,12 @@ typedef struct pio_sm_reg {
 #define APIO_WRAP_BOTTOM_AS_REG(X)  (((X) & 0x1F) << 7)
 #define APIO_WRAP_TOP_AS_REG(X)     (((X) & 0x1F) << 12)
 #define APIO_EXECCTRL_JMP_PIN(X)        (((X) & 0x1F) << 24)
+#define APIO_EXECCTRL_EXEC_STALLED      (1u << 31)  // Read-only, instruction written to SMx_INSTR is stalled
+#define APIO_EXECCTRL_SIDE_EN           (1u << 30)  // MSB of side-set is an enable
+#define APIO_EXECCTRL_SIDE_PINDIR       (1u << 29)  // Side-set sets pindirs, not pins
+#define APIO_EXECCTRL_OUT_EN_SEL(X)     (((X) & 0x1F) << 19)
+#define APIO_EXECCTRL_INLINE_OUT_EN     (1u << 18)  // OUT data bit OUT_EN_SEL gates OUT's pin writes
+#define APIO_EXECCTRL_OUT_STICKY        (1u << 17)  // Continuously assert the last OUT/SET
 #define APIO_WRAP_TOP_FROM_REG(REG)     (((REG) >> 12) & 0x1F)
 #define APIO_WRAP_BOTTOM_FROM_REG(REG)  (((REG) >> 7) & 0x1F)
 
@@ -204,6 +248,8 @@ typedef struct pio_sm_reg {
 #define APIO_OUT_SHIFTDIR_L      (0 << 19)
 #define APIO_PUSH_THRESH(X)      (((X) & 0x1F) << 20)
 #define APIO_PULL_THRESH(X)      (((X) & 0x1F) << 25)
+#define APIO_FJOIN_TX            (1u << 30)
+#define APIO_FJOIN_RX            (1u << 31)
 
 // PINCTRL
 #define APIO_OUT_BASE(X)         (((X) & 0x1F) << 0)
@@ -212,7 +258,54 @@ typedef struct pio_sm_reg {
 #define APIO_IN_BASE(X)          (((X) & 0x1F) << 15)
 #define APIO_OUT_COUNT(X)        (((X) & 0x3F) << 20)
 #define APIO_SET_COUNT(X)        (((X) & 0x07) << 26)
-#define APIO_SIDE_SET_COUNT(X)   (((X) & 0x07) << 29)
+#define APIO_SIDE_SET_COUNT(X)   (((X) & 0x07u) << 29)
+
+// DMA channel registers, used to drain and fill SM FIFOs.  Channels are at
+// 0x40 intervals from the base of the DMA register space.
+#define APIO_DMA_CH_STRIDE              (0x40)
+#define APIO_DMA_READ_ADDR_OFFSET       (0x00)
+#define APIO_DMA_WRITE_ADDR_OFFSET      (0x04)
+#define APIO_DMA_TRANS_COUNT_OFFSET     (0x08)
+#define APIO_DMA_CTRL_TRIG_OFFSET       (0x0C)
+#define APIO_DMA_READ_ADDR(CH)      (*(volatile uint32_t *)(APIO_DMA_BASE + ((CH) * APIO_DMA_CH_STRIDE) + APIO_DMA_READ_ADDR_OFFSET))
+#define APIO_DMA_WRITE_ADDR(CH)     (*(volatile uint32_t *)(APIO_DMA_BASE + ((CH) * APIO_DMA_CH_STRIDE) + APIO_DMA_WRITE_ADDR_OFFSET))
+#define APIO_DMA_TRANS_COUNT(CH)    (*(volatile uint32_t *)(APIO_DMA_BASE + ((CH) * APIO_DMA_CH_STRIDE) + APIO_DMA_TRANS_COUNT_OFFSET))
+#define APIO_DMA_CTRL_TRIG(CH)      (*(volatile uint32_t *)(APIO_DMA_BASE + ((CH) * APIO_DMA_CH_STRIDE) + APIO_DMA_CTRL_TRIG_OFFSET))
+
+// DMA channel register aliases.  AL1_CTRL writes CTRL without triggering the
+// channel.  A write to AL3_READ_ADDR_TRIG sets READ_ADDR and triggers the
+// channel, so one channel can start another by writing it an address.
+#define APIO_DMA_AL1_CTRL_OFFSET            (0x10)
+#define APIO_DMA_AL3_READ_ADDR_TRIG_OFFSET  (0x3C)
+#define APIO_DMA_AL1_CTRL(CH)       (*(volatile uint32_t *)(APIO_DMA_BASE + ((CH) * APIO_DMA_CH_STRIDE) + APIO_DMA_AL1_CTRL_OFFSET))
+#define APIO_DMA_AL3_READ_ADDR_TRIG(CH) (*(volatile uint32_t *)(APIO_DMA_BASE + ((CH) * APIO_DMA_CH_STRIDE) + APIO_DMA_AL3_READ_ADDR_TRIG_OFFSET))
+
+// Write a mask of channels to abort them.  Reads back non-zero until the
+// aborts complete.
+#define APIO_DMA_CHAN_ABORT_OFFSET      (0x464)
+#define APIO_DMA_CHAN_ABORT         (*(volatile uint32_t *)(APIO_DMA_BASE + APIO_DMA_CHAN_ABORT_OFFSET))
+
+// DMA CTRL_TRIG
+#define APIO_DMA_CTRL_EN                (1u << 0)
+#define APIO_DMA_CTRL_HIGH_PRIORITY     (1u << 1)
+#define APIO_DMA_CTRL_DATA_SIZE_BYTE    (0u << 2)
+#define APIO_DMA_CTRL_DATA_SIZE_HALF    (1u << 2)
+#define APIO_DMA_CTRL_DATA_SIZE_WORD    (2u << 2)
+#define APIO_DMA_CTRL_INCR_READ         (1u << 4)
+#define APIO_DMA_CTRL_INCR_WRITE        (1u << 6)
+#define APIO_DMA_CTRL_CHAIN_TO(CH)      (((CH) & 0xF) << 13)    // Own channel to disable chaining
+#define APIO_DMA_CTRL_TREQ_SEL(DREQ)    (((DREQ) & 0x3F) << 17)
+#define APIO_DMA_CTRL_BUSY              (1u << 26)
+
+// TREQ_SEL value for unpaced transfers
+#define APIO_DMA_TREQ_PERMANENT         (0x3F)
+
+// DMA TRANS_COUNT - the count is in bits 27:0, reading back as the transfers
+// remaining.  Mode, bits 31:28, is 0 for a normal transfer.  Pace transfers
+// with APIO_DREQ_PIO_X_SM_Y_TX/RX().  An endless transfer never completes,
+// and the count is ignored.
+#define APIO_DMA_TRANS_COUNT_MASK       (0x0FFFFFFFu)
+#define APIO_DMA_TRANS_COUNT_ENDLESS    (0xFu << 28)
 
 // EXECCTRL
 #define APIO_EXECCTRL_EXEC_STALLED_FROM_REG(REG)  (((REG) >> 31) & 0x1u)
@@ -251,6 +344,14 @@ typedef struct pio_sm_reg {
 #define APIO1_SM_X_RXF_Y(X, Y)   (*(volatile uint32_t *)(APIO1_BASE + APIO_SM_RXF_OFFSET + ((X) * 0x10) + ((Y) * 4)))
 #define APIO2_SM_X_RXF_Y(X, Y)   (*(volatile uint32_t *)(APIO2_BASE + APIO_SM_RXF_OFFSET + ((X) * 0x10) + ((Y) * 4)))
 
+// Cortex-M33 DWT cycle counter, used for phase timing.  CYCCNT counts
+// system clock cycles once TRCENA and CYCCNTENA are both set.
+#define APIO_DEMCR                  (*(volatile uint32_t *)0xE000EDFC)
+#define APIO_DEMCR_TRCENA           (1 << 24)
+#define APIO_DWT_CTRL               (*(volatile uint32_t *)0xE0001000)
+#define APIO_DWT_CTRL_CYCCNTENA     (1 << 0)
+#define APIO_DWT_CYCCNT             (*(volatile uint32_t *)0xE0001004)
+
 // Macros to construct DREQ values
 #define APIO_DREQ_PIO_X_SM_Y_TX(X, Y)      (0 + (X * 8) + Y)
 #define APIO_DREQ_PIO_X_SM_Y_RX(X, Y)      (4 + (X * 8) + Y)
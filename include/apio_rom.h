@@ -0,0 +1,455 @@
+// Copyright (C) 2026 Piers Finlayson <piers@piers.rocks>
+//
+// MIT License
+
+// apio - Runtime RP2350 PIO Assembler and Disassembler
+//
+// ROM emulation response pipeline.
+//
+// Serves a data table in SRAM to a host's parallel ROM bus, using three SMs
+// and two DMA channels:
+//
+// - The address SM samples the address pins while CS is active.  When the
+//   address changes it pushes the table entry's SRAM address - the table
+//   base with the address pins in the low bits - to its RX FIFO.
+// - The address DMA channel, paced by that RX FIFO, writes each SRAM address
+//   to the data DMA channel's AL3_READ_ADDR_TRIG register, triggering it.
+// - The data DMA channel reads the table entry and writes it to the data
+//   SM's TX FIFO.
+// - The data SM outputs each entry to the data pins with `out pins`.
+// - The control SM drives the data pins while both CS and OE are active,
+//   and floats them otherwise.
+//
+// So the table must hold 2^addr_count entries of 1, 2 or 4 bytes - the
+// smallest which hold data_width bits - and be aligned to its size:
+//
+//   static uint8_t table[0x2000] __attribute__((aligned(0x2000)));
+//   apio_rom_t rom;
+//   apio_rom_cfg_t cfg = {
+//       .addr_base = 0, .addr_count = 13,
+//       .data_base = 16, .data_width = 8,
+//       .cs_pin = 24, .cs_active = APIO_ROM_ACTIVE_LOW,
+//       .oe_pin = 25, .oe_active = APIO_ROM_ACTIVE_LOW,
+//       .first_sm = 0, .dma_addr = 0, .dma_data = 1,
+//       .table = table,
+//   };
+//   apio_rom_init(&rom, &cfg);          // Computes worst-case latency
+//   // In the assembly scope, with the data pins set as outputs and the
+//   // address, CS and OE pins as inputs:
+//   APIO_ROM_ADD(&rom);
+//   // After APIO_END_BLOCK():
+//   apio_rom_start(&rom);
+//
+// The SMs run at the system clock.  apio_rom_init() reports the worst-case
+// address-to-data latency in rom.lat, in system clock cycles, broken down
+// by pipeline stage.  The PIO stages are exact, from the programs.  The DMA
+// stage is APIO_ROM_DMA_CYCLES, an estimate for an uncontended bus - measure
+// it with apio_lat.h on the target, and define APIO_ROM_DMA_CYCLES before
+// including this file to use the measured figure.
+//
+// The worst case assumes the previous lookup has completed.  If the address
+// SM samples the address pins mid-transition, each intermediate address it
+// pushes is looked up ahead of the final one, adding up to lat.dma cycles
+// apiece.
+//
+// In emulation there is no DMA, so apio_rom_run_sim() services the lookups
+// in the built-in interpreter instead, delivering each table entry to the
+// data SM APIO_ROM_DMA_CYCLES cycles after the address was pushed.  It times
+// each address change, made via apio_sim_t.gpio_in while CS is active, until
+// the data SM outputs the new entry, recording the worst case in
+// rom.max_latency for comparison with rom.lat.  The emulator does not model
+// the input synchronisers, so this excludes rom.lat.sync.
+//
+// The implementation is included in the source file that defines
+// APIO_ROM_IMPL.
+
+#ifndef APIO_ROM_H
+#define APIO_ROM_H
+
+#include <apio.h>
+#if defined(APIO_EMULATION)
+#include <apio_sim.h>
+#endif // APIO_EMULATION
+
+// Return codes
+#define APIO_ROM_OK             0
+#define APIO_ROM_ERR_ARGS       -1
+#define APIO_ROM_ERR_ALIGN      -2  // Table isn't aligned to its size
+
+// CS and OE polarities, for apio_rom_cfg_t.cs_active and oe_active
+#define APIO_ROM_ACTIVE_LOW     0
+#define APIO_ROM_ACTIVE_HIGH    1
+
+// GPIO input synchroniser delay, in system clock cycles
+#define APIO_ROM_SYNC_CYCLES    2
+
+// Estimated system clock cycles from the address SM's push to the data SM's
+// TX FIFO write: the RX FIFO DREQ, the address channel's RX FIFO read and
+// write to the data channel's trigger, and the data channel's table read and
+// TX FIFO write.  Other bus masters contending for the PIO or the table's
+// SRAM bank add to this.
+#if !defined(APIO_ROM_DMA_CYCLES)
+#define APIO_ROM_DMA_CYCLES     10
+#endif // !APIO_ROM_DMA_CYCLES
+
+// ROM configuration, for apio_rom_init()
+typedef struct {
+    uint8_t addr_base;      // First address pin, relative to GPIOBASE
+    uint8_t addr_count;     // Address pins
+    uint8_t data_base;      // First data pin, relative to GPIOBASE
+    uint8_t data_width;     // Data pins, 1-32
+    uint8_t cs_pin;         // Relative to GPIOBASE
+    uint8_t cs_active;      // APIO_ROM_ACTIVE_*
+    uint8_t oe_pin;         // Relative to GPIOBASE
+    uint8_t oe_active;      // APIO_ROM_ACTIVE_*
+    uint8_t first_sm;       // Address, data and control SMs, in that order, 0-1
+    uint8_t dma_addr;       // Address DMA channel
+    uint8_t dma_data;       // Data DMA channel
+    const void *table;      // 2^addr_count entries, aligned to its size
+} apio_rom_cfg_t;
+
+// Worst-case latencies, in system clock cycles
+typedef struct {
+    uint16_t sync;          // Input synchroniser
+    uint16_t sample;        // Until the address SM samples a new address
+    uint16_t push;          // Sample to RX FIFO push
+    uint16_t dma;           // RX FIFO push to TX FIFO write - estimated
+    uint16_t out;           // TX FIFO write to data pins
+    uint16_t total;         // Address to data, the sum of the above
+    uint16_t oe;            // CS or OE to data pins driven or floated
+} apio_rom_lat_t;
+
+typedef struct {
+    apio_rom_cfg_t cfg;
+    uint8_t block;          // Set by APIO_ROM_ADD()
+    uint8_t shift;          // log2 of the table entry size in bytes
+    uint8_t addr_instrs;    // Address SM program length
+    uint8_t ctrl_instrs;    // Control SM program length
+    apio_rom_lat_t lat;
+#if defined(APIO_EMULATION)
+    uint32_t lookups;       // Table entries delivered to the data SM
+    uint32_t max_latency;   // Worst measured address to data, in cycles
+    uint64_t cycle;         // Cycles run by apio_rom_run_sim()
+    uint32_t addr;          // Address pins at the last cycle
+    uint32_t served;        // Address of the last entry delivered
+    uint32_t word;          // SRAM address of the lookup in progress
+    uint64_t due;           // Cycle the lookup in progress completes
+    uint64_t changed;       // Cycle of the address change being timed
+    uint8_t busy;           // A lookup is in progress
+    uint8_t timing;         // An address change is being timed
+#endif // APIO_EMULATION
+} apio_rom_t;
+
+// Instructions used by the three programs
+#define APIO_ROM_INSTRS(ROM)    ((ROM)->addr_instrs + 1 + (ROM)->ctrl_instrs)
+
+// SMs used, as a mask
+static inline uint8_t apio_rom_sm_mask(const apio_rom_t *rom) {
+    return (uint8_t)(0x7u << rom->cfg.first_sm);
+}
+
+// Worst-case address to data latency, in nanoseconds at SYSCLK_HZ
+static inline uint32_t apio_rom_latency_ns(const apio_rom_t *rom, uint32_t sysclk_hz) {
+    return (uint32_t)(((uint64_t)rom->lat.total * 1000000000u) / sysclk_hz);
+}
+
+// Build the address, data and control SMs' programs, at first_sm to
+// first_sm + 2, and configure the SMs.  The address SM's OSR holds the
+// table base, loaded via its TX FIFO, and Y the last address pushed.  The
+// data pins start floating.  The data pins must also be set as outputs for
+// the block with APIO_GPIO_OUTPUT(), and the address, CS and OE pins as
+// inputs.
+#define APIO_ROM_ADD(ROM) \
+                            do {                                                        \
+                                apio_rom_t *__rom = (ROM);                              \
+                                uint8_t __rom_n = __rom->cfg.addr_count;                \
+                                uint8_t __rom_w = __rom->cfg.data_width;                \
+                                __rom->block = __blk;                                   \
+                                /* Address SM */                                        \
+                                APIO_SET_SM_VAR(__rom->cfg.first_sm);                   \
+                                uint8_t __rom_push = APIO_INSTR_COUNT();                \
+                                APIO_ADD_INSTR(APIO_MOV_Y_X);                           \
+                                APIO_ADD_INSTR(APIO_MOV_ISR_OSR);                       \
+                                APIO_ADD_INSTR(APIO_IN_Y(__rom_n));                     \
+                                if (__rom->shift) {                                     \
+                                    APIO_ADD_INSTR(APIO_IN_NULL(__rom->shift));         \
+                                }                                                       \
+                                APIO_START();                                           \
+                                APIO_WRAP_BOTTOM();                                     \
+                                APIO_ADD_INSTR(__rom->cfg.cs_active ?                   \
+                                    APIO_WAIT_GPIO_HIGH(__rom->cfg.cs_pin) :            \
+                                    APIO_WAIT_GPIO_LOW(__rom->cfg.cs_pin));             \
+                                APIO_ADD_INSTR(APIO_MOV_X_PINS);                        \
+                                APIO_WRAP_TOP();                                        \
+                                APIO_ADD_INSTR(APIO_JMP_X_NOT_Y(__rom_push));           \
+                                APIO_SM_CLKDIV_SET(1, 0);                               \
+                                APIO_SM_EXECCTRL_SET(0);                                \
+                                APIO_SM_SHIFTCTRL_SET(                                  \
+                                    APIO_AUTOPUSH |                                     \
+                                    APIO_PUSH_THRESH(__rom_n + __rom->shift) |          \
+                                    APIO_IN_SHIFTDIR_L |                                \
+                                    APIO_IN_COUNT(__rom_n));                            \
+                                APIO_SM_PINCTRL_SET(APIO_IN_BASE(__rom->cfg.addr_base)); \
+                                APIO_TXF_PUT((uint32_t)(uintptr_t)__rom->cfg.table >> (__rom_n + __rom->shift)); \
+                                APIO_SM_EXEC_INSTR(APIO_PULL_BLOCK);                    \
+                                APIO_SM_EXEC_INSTR(APIO_MOV_SRC_INVERT(APIO_MOV_Y_NULL)); \
+                                APIO_SM_JMP_TO_START();                                 \
+                                /* Data SM */                                           \
+                                APIO_SET_SM_VAR(__rom->cfg.first_sm + 1);               \
+                                APIO_START();                                           \
+                                APIO_WRAP_BOTTOM();                                     \
+                                APIO_WRAP_TOP();                                        \
+                                APIO_ADD_INSTR(APIO_OUT_PINS(__rom_w));                 \
+                                APIO_SM_CLKDIV_SET(1, 0);                               \
+                                APIO_SM_EXECCTRL_SET(0);                                \
+                                APIO_SM_SHIFTCTRL_SET(                                  \
+                                    APIO_AUTOPULL |                                     \
+                                    APIO_PULL_THRESH(__rom_w) |                         \
+                                    APIO_OUT_SHIFTDIR_R);                               \
+                                APIO_SM_PINCTRL_SET(                                    \
+                                    APIO_OUT_BASE(__rom->cfg.data_base) |               \
+                                    APIO_OUT_COUNT(__rom_w));                           \
+                                APIO_SM_JMP_TO_START();                                 \
+                                /* Control SM */                                        \
+                                APIO_SET_SM_VAR(__rom->cfg.first_sm + 2);               \
+                                uint8_t __rom_idle = APIO_INSTR_COUNT();                \
+                                APIO_START();                                           \
+                                APIO_ADD_INSTR(APIO_MOV_PINDIRS_NULL);                  \
+                                APIO_WRAP_BOTTOM();                                     \
+                                if (__rom->cfg.cs_active) {                             \
+                                    APIO_ADD_INSTR(APIO_JMP_PIN(__rom_idle + 3));       \
+                                    APIO_ADD_INSTR(APIO_JMP(__rom_idle));               \
+                                } else {                                                \
+                                    APIO_ADD_INSTR(APIO_JMP_PIN(__rom_idle));           \
+                                }                                                       \
+                                APIO_ADD_INSTR(APIO_MOV_X_PINS);                        \
+                                APIO_ADD_INSTR(__rom->cfg.oe_active ?                   \
+                                    APIO_JMP_NOT_X(__rom_idle) :                        \
+                                    APIO_JMP_X_DEC(__rom_idle));                        \
+                                APIO_WRAP_TOP();                                        \
+                                APIO_ADD_INSTR(APIO_MOV_PINDIRS_NOT_NULL);              \
+                                APIO_SM_CLKDIV_SET(1, 0);                               \
+                                APIO_SM_EXECCTRL_SET(APIO_EXECCTRL_JMP_PIN(__rom->cfg.cs_pin)); \
+                                APIO_SM_SHIFTCTRL_SET(APIO_IN_COUNT(1));                \
+                                APIO_SM_PINCTRL_SET(                                    \
+                                    APIO_OUT_BASE(__rom->cfg.data_base) |               \
+                                    APIO_OUT_COUNT(__rom_w) |                           \
+                                    APIO_IN_BASE(__rom->cfg.oe_pin));                   \
+                                APIO_SM_JMP_TO_START();                                 \
+                            } while (0)
+
+// Validate the configuration and compute the worst-case latencies.  Returns
+// APIO_ROM_OK, APIO_ROM_ERR_ARGS or APIO_ROM_ERR_ALIGN.  The table's
+// alignment is not checked in emulation.
+int apio_rom_init(apio_rom_t *rom, const apio_rom_cfg_t *cfg);
+
+// Log the configuration and worst-case latencies using APIO_LOG().  No-op if
+// logging is disabled.
+void apio_rom_log(const apio_rom_t *rom, uint32_t sysclk_hz);
+
+#if !defined(APIO_EMULATION)
+// Start the DMA channels, then enable the SMs.  Does not disturb the block's
+// other SMs.
+void apio_rom_start(apio_rom_t *rom);
+
+// Disable the SMs and abort the DMA channels.
+void apio_rom_stop(apio_rom_t *rom);
+#else // APIO_EMULATION
+// Enable the SMs in the emulated state.  Call before apio_sim_init().
+void apio_rom_start(apio_rom_t *rom);
+
+// Run the built-in interpreter for CYCLES system clock cycles, servicing
+// table lookups as the DMA channels would, and timing address changes.
+// Returns the number of lookups serviced.
+uint32_t apio_rom_run_sim(apio_rom_t *rom, apio_sim_t *sim, uint64_t cycles);
+#endif // !APIO_EMULATION
+
+#if defined(APIO_ROM_IMPL)
+
+int apio_rom_init(apio_rom_t *rom, const apio_rom_cfg_t *cfg) {
+    memset(rom, 0, sizeof(*rom));
+    if ((cfg->addr_count < 1) ||
+        (cfg->addr_base > 31) ||
+        (cfg->data_width < 1) || (cfg->data_width > 32) ||
+        (cfg->data_base > 31) ||
+        (cfg->cs_pin > 31) || (cfg->cs_active > APIO_ROM_ACTIVE_HIGH) ||
+        (cfg->oe_pin > 31) || (cfg->oe_active > APIO_ROM_ACTIVE_HIGH) ||
+        (cfg->first_sm > 1) ||
+        (cfg->dma_addr > 15) || (cfg->dma_data > 15) ||
+        (cfg->dma_addr == cfg->dma_data) ||
+        (cfg->table == NULL)) {
+        return APIO_ROM_ERR_ARGS;
+    }
+    rom->cfg = *cfg;
+    rom->shift = (cfg->data_width <= 8) ? 0 : ((cfg->data_width <= 16) ? 1 : 2);
+    if ((cfg->addr_count + rom->shift) > 24) {
+        return APIO_ROM_ERR_ARGS;
+    }
+#if !defined(APIO_EMULATION)
+    uint32_t size = 1u << (cfg->addr_count + rom->shift);
+    if ((uint32_t)(uintptr_t)cfg->table & (size - 1)) {
+        return APIO_ROM_ERR_ALIGN;
+    }
+#endif // !APIO_EMULATION
+
+    // Address SM: mov y, x; mov isr, osr; in y; [in null]; wait; mov x, pins;
+    // jmp x!=y.  It samples every 3 cycles while the address is unchanged,
+    // but after a push the next sample is 2 + push cycles after the last.
+    rom->addr_instrs = (uint8_t)(6 + (rom->shift ? 1 : 0));
+    rom->ctrl_instrs = (uint8_t)(cfg->cs_active ? 6 : 5);
+    rom->lat.sync = APIO_ROM_SYNC_CYCLES;
+    rom->lat.push = (uint16_t)(rom->addr_instrs - 2);
+    rom->lat.sample = (uint16_t)(rom->lat.push + 1);
+    rom->lat.dma = APIO_ROM_DMA_CYCLES;
+    rom->lat.out = 1;
+    rom->lat.total = (uint16_t)(rom->lat.sync + rom->lat.sample + rom->lat.push +
+                                rom->lat.dma + rom->lat.out);
+
+    // Control SM: a change just after it was tested is seen on the next pass
+    // of the loop, then takes up to a further pass to reach the MOV PINDIRS.
+    rom->lat.oe = (uint16_t)(APIO_ROM_SYNC_CYCLES + (2 * rom->ctrl_instrs));
+    return APIO_ROM_OK;
+}
+
+void apio_rom_log(const apio_rom_t *rom, uint32_t sysclk_hz) {
+#if defined(APIO_LOG_ENABLE)
+    APIO_LOG("ROM PIO%d SM%d-%d: A%d-%d, D%d-%d, CS%d active %s, OE%d active %s, DMA %d->%d, %d instrs",
+        rom->block, rom->cfg.first_sm, rom->cfg.first_sm + 2,
+        rom->cfg.addr_base, rom->cfg.addr_base + rom->cfg.addr_count - 1,
+        rom->cfg.data_base, rom->cfg.data_base + rom->cfg.data_width - 1,
+        rom->cfg.cs_pin, rom->cfg.cs_active ? "high" : "low",
+        rom->cfg.oe_pin, rom->cfg.oe_active ? "high" : "low",
+        rom->cfg.dma_addr, rom->cfg.dma_data, APIO_ROM_INSTRS(rom));
+    APIO_LOG("ROM worst-case address to data: %u cycles (%uns) - sync %u, sample %u, push %u, DMA %u (est), out %u",
+        rom->lat.total, (unsigned)apio_rom_latency_ns(rom, sysclk_hz),
+        rom->lat.sync, rom->lat.sample, rom->lat.push, rom->lat.dma, rom->lat.out);
+    APIO_LOG("ROM worst-case CS/OE to data driven/floated: %u cycles", rom->lat.oe);
+#if defined(APIO_EMULATION)
+    APIO_LOG("ROM emulated: %u lookups, worst measured address to data %u cycles",
+        (unsigned)rom->lookups, (unsigned)rom->max_latency);
+#endif // APIO_EMULATION
+    (void)rom;
+    (void)sysclk_hz;
+#else // !APIO_LOG_ENABLE
+    (void)rom;
+    (void)sysclk_hz;
+#endif // APIO_LOG_ENABLE
+}
+
+#if !defined(APIO_EMULATION)
+static inline uintptr_t _apio_rom_base(uint8_t block) {
+    return (block == 0) ? APIO0_BASE : ((block == 1) ? APIO1_BASE : APIO2_BASE);
+}
+
+void apio_rom_start(apio_rom_t *rom) {
+    volatile uint32_t *ctrl = (volatile uint32_t *)(_apio_rom_base(rom->block) + APIO_CTRL_OFFSET);
+    uint8_t sm = rom->cfg.first_sm;
+    uint8_t ch_addr = rom->cfg.dma_addr;
+    uint8_t ch_data = rom->cfg.dma_data;
+    uint32_t size = (rom->shift == 0) ? APIO_DMA_CTRL_DATA_SIZE_BYTE :
+                    ((rom->shift == 1) ? APIO_DMA_CTRL_DATA_SIZE_HALF : APIO_DMA_CTRL_DATA_SIZE_WORD);
+
+    // Data channel - armed, but not triggered, until it's given an address.
+    // Narrow writes are replicated across the TX FIFO word.
+    APIO_DMA_WRITE_ADDR(ch_data) = (uint32_t)(uintptr_t)_apio_txf_ptr(rom->block, sm + 1);
+    APIO_DMA_TRANS_COUNT(ch_data) = 1;
+    APIO_DMA_AL1_CTRL(ch_data) =
+        APIO_DMA_CTRL_EN |
+        APIO_DMA_CTRL_HIGH_PRIORITY |
+        size |
+        APIO_DMA_CTRL_CHAIN_TO(ch_data) |
+        APIO_DMA_CTRL_TREQ_SEL(APIO_DMA_TREQ_PERMANENT);
+
+    // Address channel - runs forever, paced by the address SM's RX FIFO
+    APIO_DMA_READ_ADDR(ch_addr) = (uint32_t)(uintptr_t)_apio_rxf_ptr(rom->block, sm);
+    APIO_DMA_WRITE_ADDR(ch_addr) = (uint32_t)(uintptr_t)&APIO_DMA_AL3_READ_ADDR_TRIG(ch_data);
+    APIO_DMA_TRANS_COUNT(ch_addr) = APIO_DMA_TRANS_COUNT_ENDLESS | 1;
+    APIO_DMA_CTRL_TRIG(ch_addr) =
+        APIO_DMA_CTRL_EN |
+        APIO_DMA_CTRL_HIGH_PRIORITY |
+        APIO_DMA_CTRL_DATA_SIZE_WORD |
+        APIO_DMA_CTRL_CHAIN_TO(ch_addr) |
+        APIO_DMA_CTRL_TREQ_SEL(APIO_DREQ_PIO_X_SM_Y_RX(rom->block, sm));
+
+    *ctrl |= APIO_CTRL_SM_ENABLE(apio_rom_sm_mask(rom));
+}
+
+void apio_rom_stop(apio_rom_t *rom) {
+    volatile uint32_t *ctrl = (volatile uint32_t *)(_apio_rom_base(rom->block) + APIO_CTRL_OFFSET);
+    uint32_t chans = (1u << rom->cfg.dma_addr) | (1u << rom->cfg.dma_data);
+    *ctrl &= ~APIO_CTRL_SM_ENABLE(apio_rom_sm_mask(rom));
+    APIO_DMA_CHAN_ABORT = chans;
+    while (APIO_DMA_CHAN_ABORT & chans);
+}
+#else // APIO_EMULATION
+void apio_rom_start(apio_rom_t *rom) {
+    rom->lookups = 0;
+    rom->max_latency = 0;
+    rom->cycle = 0;
+    rom->addr = 0xFFFFFFFFu;
+    rom->served = 0xFFFFFFFFu;
+    rom->busy = 0;
+    rom->timing = 0;
+    _apio_emulated_pio.enabled_sms[rom->block] |= apio_rom_sm_mask(rom);
+    _APIO_EMU_DIRTY(rom->block);
+}
+
+uint32_t apio_rom_run_sim(apio_rom_t *rom, apio_sim_t *sim, uint64_t cycles) {
+    apio_sim_sm_t *addr_sm = &sim->sm[rom->cfg.first_sm];
+    apio_sim_sm_t *data_sm = &sim->sm[rom->cfg.first_sm + 1];
+    uint8_t bits = (uint8_t)(rom->cfg.addr_count + rom->shift);
+    uint32_t addr_mask = (1u << rom->cfg.addr_count) - 1;
+    uint32_t start = rom->lookups;
+
+    for (uint64_t ii = 0; ii < cycles; ii++, rom->cycle++) {
+        uint32_t levels = apio_sim_pin_levels(sim);
+        uint32_t addr = (uint32_t)(((uint64_t)levels | ((uint64_t)levels << 32)) >> rom->cfg.addr_base) & addr_mask;
+        uint32_t cs = (levels >> rom->cfg.cs_pin) & 1;
+        if ((addr != rom->addr) && (cs == rom->cfg.cs_active)) {
+            rom->changed = rom->cycle;
+            rom->timing = 1;
+        }
+        rom->addr = addr;
+
+        // The address channel takes a pushed address as soon as the data
+        // channel is free, and the data channel delivers its entry
+        // APIO_ROM_DMA_CYCLES after the push.
+        if (!rom->busy && addr_sm->rx.level) {
+            apio_sim_rx_get(sim, rom->cfg.first_sm, &rom->word);
+            rom->due = rom->cycle + APIO_ROM_DMA_CYCLES;
+            rom->busy = 1;
+        }
+        if (rom->busy && (rom->cycle >= rom->due) && (data_sm->tx.level < data_sm->tx.depth)) {
+            uint32_t offset = rom->word & ((1u << bits) - 1);
+            const uint8_t *entry = (const uint8_t *)rom->cfg.table + offset;
+            uint32_t data;
+            if (rom->shift == 0) {
+                data = entry[0] * 0x01010101u;
+            } else if (rom->shift == 1) {
+                data = (uint32_t)(*(const uint16_t *)entry) * 0x00010001u;
+            } else {
+                data = *(const uint32_t *)entry;
+            }
+            apio_sim_tx_put(sim, rom->cfg.first_sm + 1, data);
+            rom->served = offset >> rom->shift;
+            rom->lookups++;
+            rom->busy = 0;
+        }
+
+        uint64_t instrs = data_sm->stats.instrs;
+        apio_sim_step(sim);
+        if (rom->timing && (data_sm->stats.instrs != instrs) && (rom->served == rom->addr)) {
+            uint32_t latency = (uint32_t)(rom->cycle + 1 - rom->changed);
+            if (latency > rom->max_latency) {
+                rom->max_latency = latency;
+            }
+            rom->timing = 0;
+        }
+    }
+    return rom->lookups - start;
+}
+#endif // !APIO_EMULATION
+
+#endif // APIO_ROM_IMPL
+
+#endif // APIO_ROM_H
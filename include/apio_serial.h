@@ -0,0 +1,392 @@
+// Copyright (C) 2026 Piers Finlayson <piers@piers.rocks>
+//
+// MIT License
+
+// apio - Runtime RP2350 PIO Assembler and Disassembler
+//
+// Serial protocol generators.
+//
+// Builds UART transmit and receive, SPI master and I2S transmit programs
+// from protocol parameters - bits per frame, bit order, UART stop bits and
+// SPI CPOL/CPHA - and computes the clock divider for a target bit rate.
+// Clocks are driven with side-set, and data is moved with autopull and
+// autopush where the protocol allows, so each program is as few instructions
+// as possible:
+//
+// | Protocol                | Instructions | SM cycles per bit |
+// |-------------------------|--------------|-------------------|
+// | APIO_SERIAL_UART_TX     | 4            | 2                 |
+// | APIO_SERIAL_UART_RX     | 4            | 8                 |
+// | APIO_SERIAL_SPI, CPHA 0 | 2            | 4                 |
+// | APIO_SERIAL_SPI, CPHA 1 | 3            | 4                 |
+// | APIO_SERIAL_I2S         | 8            | 2                 |
+//
+// So the maximum bit rate is the system clock divided by the SM cycles per
+// bit.  The rate is the UART's baud rate, SPI's SCK and I2S's BCLK - an I2S
+// frame is 2 * bits BCLK cycles.
+//
+//   apio_serial_t uart;
+//   apio_serial_cfg_t cfg = {
+//       .protocol = APIO_SERIAL_UART_TX, .bits = 8, .order = APIO_SERIAL_LSB_FIRST,
+//       .stop_bits = 1, .pin_data = 0,
+//       .sysclk_hz = 150000000, .rate_hz = 115200,
+//   };
+//   apio_serial_init(&uart, &cfg);      // Computes CLKDIV, the rate and maximum
+//   // In the assembly scope, with the pin set as an output:
+//   APIO_SET_SM(0);
+//   APIO_SERIAL_ADD(&uart);
+//   // After APIO_END_BLOCK(), for each frame:
+//   APIO_TXF = apio_serial_tx_word(&uart, 'A');
+//
+// Each FIFO word holds one frame, or one I2S channel's sample.  Least
+// significant bit first frames are shifted right out of, or into, a FIFO
+// word, and most significant bit first frames left, so apio_serial_tx_word()
+// and apio_serial_rx_value() move a frame between the bottom bits of a value
+// and where the SM expects it.
+//
+// - UART TX idles high, and each frame is a start bit, `bits` data bits and
+//   1 or 2 stop bits.  There's no parity.
+// - UART RX waits for a start bit, then samples each data bit at its centre.
+//   It doesn't check the stop bit, so framing errors aren't detected.
+// - SPI drives SCK via side-set, MOSI via OUT, and samples MISO via IN,
+//   shifting a frame out and in at once - so a read needs a word written,
+//   and each word written must be read.  Chip select is left to the caller.
+// - I2S drives BCLK and LRCLK (pin_clk + 1) via side-set, and data via OUT,
+//   left channel first, each sample's MSB one BCLK after LRCLK changes.
+//
+// The implementation is included in the source file that defines
+// APIO_SERIAL_IMPL.
+
+#ifndef APIO_SERIAL_H
+#define APIO_SERIAL_H
+
+#include <apio.h>
+
+// Return codes
+#define APIO_SERIAL_OK          0
+#define APIO_SERIAL_ERR_ARGS    -1
+#define APIO_SERIAL_ERR_RATE    -2  // Target rate is outside the divider's range
+
+// Protocols, for apio_serial_cfg_t.protocol
+#define APIO_SERIAL_UART_TX     0
+#define APIO_SERIAL_UART_RX     1
+#define APIO_SERIAL_SPI         2   // Master
+#define APIO_SERIAL_I2S         3   // Transmit, clock master
+
+// Bit orders, for apio_serial_cfg_t.order
+#define APIO_SERIAL_LSB_FIRST   0
+#define APIO_SERIAL_MSB_FIRST   1
+
+// Serial configuration, for apio_serial_init()
+typedef struct {
+    uint8_t protocol;       // APIO_SERIAL_*
+    uint8_t bits;           // Bits per frame, or per I2S channel, 1-32 (I2S 2-32)
+    uint8_t order;          // APIO_SERIAL_*_FIRST
+    uint8_t stop_bits;      // UART TX, 1 or 2
+    uint8_t cpol;           // SPI, SCK idle level
+    uint8_t cpha;           // SPI, 0 to sample on SCK's leading edge, 1 trailing
+    uint8_t pin_data;       // UART TX or RX, SPI MOSI, I2S data
+    uint8_t pin_in;         // SPI MISO
+    uint8_t pin_clk;        // SPI SCK, I2S BCLK, with LRCLK the next pin
+    uint32_t sysclk_hz;     // System clock
+    uint32_t rate_hz;       // Target bits per second, 0 for the maximum
+} apio_serial_cfg_t;
+
+typedef struct {
+    apio_serial_cfg_t cfg;
+    uint8_t block;          // Set by APIO_SERIAL_ADD()
+    uint8_t sm;             // Set by APIO_SERIAL_ADD()
+    uint8_t instrs;         // Program length
+    uint8_t cycles;         // SM cycles per bit
+    uint32_t div256;        // Clock divider, 24.8 fixed point
+    uint32_t rate_hz;       // Achievable bits per second at div256
+    uint32_t max_rate_hz;   // Bits per second at CLKDIV 1
+} apio_serial_t;
+
+// Instructions used by the program
+#define APIO_SERIAL_INSTRS(SER) ((SER)->instrs)
+
+// Internal macros - do not use directly.  Side-set fields for the UART's
+// optional side-set pin, SPI's SCK and I2S's BCLK and LRCLK.
+#define _APIO_SERIAL_SIDE_OPT(LEVEL)    ((uint16_t)(0x1000 | ((LEVEL) << 11)))
+#define _APIO_SERIAL_SIDE_SCK(SER, LEVEL) \
+                            ((uint16_t)((((SER)->cfg.cpol ^ (LEVEL)) & 1) << 12))
+#define _APIO_SERIAL_SIDE_I2S(LRCLK, BCLK) \
+                            ((uint16_t)(((LRCLK) << 12) | ((BCLK) << 11)))
+
+// Internal macro - do not use directly.  Shift directions for the bit order.
+#define _APIO_SERIAL_SHIFTDIR(SER) \
+                            (((SER)->cfg.order == APIO_SERIAL_MSB_FIRST) ?              \
+                                (APIO_OUT_SHIFTDIR_L | APIO_IN_SHIFTDIR_L) :            \
+                                (APIO_OUT_SHIFTDIR_R | APIO_IN_SHIFTDIR_R))
+
+// Internal macro - do not use directly.  UART TX.  The stop bits are the
+// delay on `pull`, which keeps the line idle while it stalls.
+#define _APIO_SERIAL_ADD_UART_TX(SER) \
+                            do {                                                        \
+                                uint8_t __s_bit = APIO_INSTR_COUNT() + 2;               \
+                                uint8_t __s_pin = (SER)->cfg.pin_data;                  \
+                                APIO_ADD_INSTR(APIO_ADD_DELAY(APIO_PULL_BLOCK | _APIO_SERIAL_SIDE_OPT(1), \
+                                    ((SER)->cfg.stop_bits * 2) - 1));                   \
+                                APIO_ADD_INSTR(APIO_ADD_DELAY(APIO_SET_X((SER)->cfg.bits - 1) | \
+                                    _APIO_SERIAL_SIDE_OPT(0), 1));                      \
+                                APIO_ADD_INSTR(APIO_OUT_PINS(1));                       \
+                                APIO_WRAP_TOP();                                        \
+                                APIO_ADD_INSTR(APIO_JMP_X_DEC(__s_bit));                \
+                                APIO_SM_EXECCTRL_SET(APIO_EXECCTRL_SIDE_EN);            \
+                                APIO_SM_SHIFTCTRL_SET(_APIO_SERIAL_SHIFTDIR(SER) | APIO_FJOIN_TX); \
+                                APIO_SM_PINCTRL_SET(                                    \
+                                    APIO_OUT_BASE(__s_pin) |                            \
+                                    APIO_OUT_COUNT(1) |                                 \
+                                    APIO_SET_BASE(__s_pin) |                            \
+                                    APIO_SET_COUNT(1) |                                 \
+                                    APIO_SIDE_SET_BASE(__s_pin) |                       \
+                                    APIO_SIDE_SET_COUNT(2));                            \
+                                APIO_SM_EXEC_INSTR(APIO_SET_PINS(1));                   \
+                                APIO_SM_EXEC_INSTR(APIO_SET_PIN_DIRS(1));               \
+                                APIO_SM_JMP_TO_START();                                 \
+                            } while (0)
+
+// Internal macro - do not use directly.  UART RX, 8 SM cycles per bit.  The
+// first sample is 12 cycles - 1.5 bits - after the start bit is seen, and
+// the last bit's `jmp` delay takes the SM to the middle of the stop bit
+// before it waits for the next start bit.
+#define _APIO_SERIAL_ADD_UART_RX(SER) \
+                            do {                                                        \
+                                uint8_t __s_bit = APIO_INSTR_COUNT() + 2;               \
+                                APIO_ADD_INSTR(APIO_WAIT_GPIO_LOW((SER)->cfg.pin_data)); \
+                                APIO_ADD_INSTR(APIO_ADD_DELAY(APIO_SET_X((SER)->cfg.bits - 1), 10)); \
+                                APIO_ADD_INSTR(APIO_IN_PINS(1));                        \
+                                APIO_WRAP_TOP();                                        \
+                                APIO_ADD_INSTR(APIO_ADD_DELAY(APIO_JMP_X_DEC(__s_bit), 6)); \
+                                APIO_SM_EXECCTRL_SET(0);                                \
+                                APIO_SM_SHIFTCTRL_SET(                                  \
+                                    APIO_AUTOPUSH |                                     \
+                                    APIO_PUSH_THRESH((SER)->cfg.bits) |                 \
+                                    _APIO_SERIAL_SHIFTDIR(SER) |                        \
+                                    APIO_FJOIN_RX);                                     \
+                                APIO_SM_PINCTRL_SET(APIO_IN_BASE((SER)->cfg.pin_data)); \
+                                APIO_SM_JMP_TO_START();                                 \
+                            } while (0)
+
+// Internal macro - do not use directly.  SPI master.  With CPHA 0 the data
+// is output half a clock before SCK's leading edge, on which MISO is
+// sampled.  With CPHA 1 it is output on the leading edge, via X, and MISO
+// sampled on the trailing edge.  Either way the SM stalls on autopull with
+// SCK idle between frames.
+#define _APIO_SERIAL_ADD_SPI(SER) \
+                            do {                                                        \
+                                if ((SER)->cfg.cpha) {                                  \
+                                    APIO_ADD_INSTR(APIO_OUT_X(1) | _APIO_SERIAL_SIDE_SCK(SER, 0)); \
+                                    APIO_ADD_INSTR(APIO_ADD_DELAY(APIO_MOV_PINS_X |     \
+                                        _APIO_SERIAL_SIDE_SCK(SER, 1), 1));             \
+                                    APIO_WRAP_TOP();                                    \
+                                    APIO_ADD_INSTR(APIO_IN_PINS(1) | _APIO_SERIAL_SIDE_SCK(SER, 0)); \
+                                } else {                                                \
+                                    APIO_ADD_INSTR(APIO_ADD_DELAY(APIO_OUT_PINS(1) |    \
+                                        _APIO_SERIAL_SIDE_SCK(SER, 0), 1));             \
+                                    APIO_WRAP_TOP();                                    \
+                                    APIO_ADD_INSTR(APIO_ADD_DELAY(APIO_IN_PINS(1) |     \
+                                        _APIO_SERIAL_SIDE_SCK(SER, 1), 1));             \
+                                }                                                       \
+                                APIO_SM_EXECCTRL_SET(0);                                \
+                                APIO_SM_SHIFTCTRL_SET(                                  \
+                                    APIO_AUTOPULL |                                     \
+                                    APIO_PULL_THRESH((SER)->cfg.bits) |                 \
+                                    APIO_AUTOPUSH |                                     \
+                                    APIO_PUSH_THRESH((SER)->cfg.bits) |                 \
+                                    _APIO_SERIAL_SHIFTDIR(SER));                        \
+                                APIO_SM_PINCTRL_SET(                                    \
+                                    APIO_OUT_BASE((SER)->cfg.pin_data) |                \
+                                    APIO_OUT_COUNT(1) |                                 \
+                                    APIO_SET_BASE((SER)->cfg.pin_clk) |                 \
+                                    APIO_SET_COUNT(1) |                                 \
+                                    APIO_IN_BASE((SER)->cfg.pin_in) |                   \
+                                    APIO_SIDE_SET_BASE((SER)->cfg.pin_clk) |            \
+                                    APIO_SIDE_SET_COUNT(1));                            \
+                                APIO_SM_EXEC_INSTR(APIO_SET_PIN_DIRS(1) | _APIO_SERIAL_SIDE_SCK(SER, 0)); \
+                                APIO_SM_EXEC_INSTR(APIO_MOV_PINS_NULL | _APIO_SERIAL_SIDE_SCK(SER, 0)); \
+                                APIO_SM_EXEC_INSTR(APIO_MOV_PINDIRS_NOT_NULL | _APIO_SERIAL_SIDE_SCK(SER, 0)); \
+                                APIO_SM_EXEC_INSTR(APIO_JMP(APIO_START_LABEL()) | _APIO_SERIAL_SIDE_SCK(SER, 0)); \
+                            } while (0)
+
+// Internal macro - do not use directly.  I2S, with BCLK falling as each bit
+// is output and rising mid-bit.  Each channel's loop outputs all but its
+// last bit, which is output as LRCLK changes for the other channel.  The
+// start is exec'd as the end of a right channel - BCLK rising with LRCLK
+// high, then falling as LRCLK falls - so the first left sample is framed
+// like the rest, with LRCLK only ever changing while BCLK is low.
+#define _APIO_SERIAL_ADD_I2S(SER) \
+                            do {                                                        \
+                                uint8_t __s = APIO_INSTR_COUNT();                       \
+                                uint8_t __s_x = (SER)->cfg.bits - 2;                    \
+                                APIO_ADD_INSTR(APIO_SET_X(__s_x) | _APIO_SERIAL_SIDE_I2S(0, 1)); \
+                                APIO_ADD_INSTR(APIO_OUT_PINS(1) | _APIO_SERIAL_SIDE_I2S(0, 0)); \
+                                APIO_ADD_INSTR(APIO_JMP_X_DEC(__s + 1) | _APIO_SERIAL_SIDE_I2S(0, 1)); \
+                                APIO_ADD_INSTR(APIO_OUT_PINS(1) | _APIO_SERIAL_SIDE_I2S(1, 0)); \
+                                APIO_ADD_INSTR(APIO_SET_X(__s_x) | _APIO_SERIAL_SIDE_I2S(1, 1)); \
+                                APIO_ADD_INSTR(APIO_OUT_PINS(1) | _APIO_SERIAL_SIDE_I2S(1, 0)); \
+                                APIO_ADD_INSTR(APIO_JMP_X_DEC(__s + 5) | _APIO_SERIAL_SIDE_I2S(1, 1)); \
+                                APIO_WRAP_TOP();                                        \
+                                APIO_ADD_INSTR(APIO_OUT_PINS(1) | _APIO_SERIAL_SIDE_I2S(0, 0)); \
+                                APIO_SM_EXECCTRL_SET(0);                                \
+                                APIO_SM_SHIFTCTRL_SET(                                  \
+                                    APIO_AUTOPULL |                                     \
+                                    APIO_PULL_THRESH((SER)->cfg.bits) |                 \
+                                    _APIO_SERIAL_SHIFTDIR(SER) |                        \
+                                    APIO_FJOIN_TX);                                     \
+                                APIO_SM_PINCTRL_SET(                                    \
+                                    APIO_OUT_BASE((SER)->cfg.pin_data) |                \
+                                    APIO_OUT_COUNT(1) |                                 \
+                                    APIO_SET_BASE((SER)->cfg.pin_clk) |                 \
+                                    APIO_SET_COUNT(2) |                                 \
+                                    APIO_SIDE_SET_BASE((SER)->cfg.pin_clk) |            \
+                                    APIO_SIDE_SET_COUNT(2));                            \
+                                APIO_SM_EXEC_INSTR(APIO_SET_PIN_DIRS(3) | _APIO_SERIAL_SIDE_I2S(1, 0)); \
+                                APIO_SM_EXEC_INSTR(APIO_MOV_PINS_NULL | _APIO_SERIAL_SIDE_I2S(1, 0)); \
+                                APIO_SM_EXEC_INSTR(APIO_MOV_PINDIRS_NOT_NULL | _APIO_SERIAL_SIDE_I2S(1, 1)); \
+                                APIO_SM_EXEC_INSTR(APIO_JMP(APIO_START_LABEL()) | _APIO_SERIAL_SIDE_I2S(0, 0)); \
+                            } while (0)
+
+// Build the program for the current SM, and configure the SM.  Call
+// immediately after APIO_SET_SM().  Sets the output pins' directions to
+// output, with UART TX idle high, SCK at CPOL, I2S BCLK and LRCLK low as
+// after a right channel, and other outputs low.  The pins must also be set
+// as outputs for the block with APIO_GPIO_OUTPUT().
+#define APIO_SERIAL_ADD(SER) \
+                            do {                                                        \
+                                apio_serial_t *__ser = (SER);                           \
+                                __ser->block = __blk;                                   \
+                                __ser->sm = __sm;                                       \
+                                APIO_START();                                           \
+                                APIO_WRAP_BOTTOM();                                     \
+                                APIO_SM_CLKDIV_SET(__ser->div256 >> 8, __ser->div256 & 0xFF); \
+                                switch (__ser->cfg.protocol) {                          \
+                                    case APIO_SERIAL_UART_TX:                           \
+                                        _APIO_SERIAL_ADD_UART_TX(__ser);                \
+                                        break;                                          \
+                                    case APIO_SERIAL_UART_RX:                           \
+                                        _APIO_SERIAL_ADD_UART_RX(__ser);                \
+                                        break;                                          \
+                                    case APIO_SERIAL_SPI:                               \
+                                        _APIO_SERIAL_ADD_SPI(__ser);                    \
+                                        break;                                          \
+                                    default:                                            \
+                                        _APIO_SERIAL_ADD_I2S(__ser);                    \
+                                        break;                                          \
+                                }                                                       \
+                            } while (0)
+
+// Bits per second from a 24.8 fixed point clock divider
+static inline uint32_t apio_serial_rate(uint32_t sysclk_hz, uint32_t div256, uint8_t cycles) {
+    return (uint32_t)(((uint64_t)sysclk_hz * 256) / ((uint64_t)div256 * cycles));
+}
+
+// The FIFO word to write to transmit frame VALUE, from its bottom bits.
+static inline uint32_t apio_serial_tx_word(const apio_serial_t *ser, uint32_t value) {
+    if ((ser->cfg.order == APIO_SERIAL_MSB_FIRST) && (ser->cfg.bits < 32)) {
+        return value << (32 - ser->cfg.bits);
+    }
+    return value;
+}
+
+// The frame received in FIFO WORD, in its bottom bits.
+static inline uint32_t apio_serial_rx_value(const apio_serial_t *ser, uint32_t word) {
+    if ((ser->cfg.order == APIO_SERIAL_LSB_FIRST) && (ser->cfg.bits < 32)) {
+        return word >> (32 - ser->cfg.bits);
+    }
+    return word;
+}
+
+// Validate the configuration, and compute the clock divider, achievable rate
+// and maximum rate.  Returns APIO_SERIAL_OK, APIO_SERIAL_ERR_ARGS or
+// APIO_SERIAL_ERR_RATE.
+int apio_serial_init(apio_serial_t *ser, const apio_serial_cfg_t *cfg);
+
+// Bits per second at the SM's current CLKDIV, which may since have been
+// changed from the one apio_serial_init() chose.
+uint32_t apio_serial_current_rate(const apio_serial_t *ser);
+
+// Log the configuration and rates using APIO_LOG().  No-op if logging is
+// disabled.
+void apio_serial_log(const apio_serial_t *ser);
+
+#if defined(APIO_SERIAL_IMPL)
+
+int apio_serial_init(apio_serial_t *ser, const apio_serial_cfg_t *cfg) {
+    static const uint8_t cycles[] = { 2, 8, 4, 2 };
+
+    memset(ser, 0, sizeof(*ser));
+    if ((cfg->protocol > APIO_SERIAL_I2S) ||
+        (cfg->bits < ((cfg->protocol == APIO_SERIAL_I2S) ? 2 : 1)) || (cfg->bits > 32) ||
+        (cfg->order > APIO_SERIAL_MSB_FIRST) ||
+        ((cfg->protocol == APIO_SERIAL_UART_TX) && ((cfg->stop_bits < 1) || (cfg->stop_bits > 2))) ||
+        (cfg->cpol > 1) || (cfg->cpha > 1) ||
+        (cfg->pin_data > 31) ||
+        (cfg->pin_in > 31) ||
+        (cfg->pin_clk > ((cfg->protocol == APIO_SERIAL_I2S) ? 30 : 31)) ||
+        (cfg->sysclk_hz == 0)) {
+        return APIO_SERIAL_ERR_ARGS;
+    }
+    ser->cfg = *cfg;
+    ser->cycles = cycles[cfg->protocol];
+    switch (cfg->protocol) {
+        case APIO_SERIAL_SPI:
+            ser->instrs = cfg->cpha ? 3 : 2;
+            break;
+        case APIO_SERIAL_I2S:
+            ser->instrs = 8;
+            break;
+        default:
+            ser->instrs = 4;
+            break;
+    }
+
+    ser->max_rate_hz = cfg->sysclk_hz / ser->cycles;
+    if (cfg->rate_hz > ser->max_rate_hz) {
+        return APIO_SERIAL_ERR_RATE;
+    }
+
+    // Nearest 24.8 divider, between 1 and 65536
+    uint64_t div256 = 256;
+    if (cfg->rate_hz) {
+        uint64_t den = (uint64_t)cfg->rate_hz * ser->cycles;
+        div256 = (((uint64_t)cfg->sysclk_hz * 256) + (den / 2)) / den;
+    }
+    if (div256 < 256) {
+        div256 = 256;
+    } else if (div256 > (0x10000u << 8)) {
+        return APIO_SERIAL_ERR_RATE;
+    }
+    ser->div256 = (uint32_t)div256;
+    ser->rate_hz = apio_serial_rate(cfg->sysclk_hz, ser->div256, ser->cycles);
+    return APIO_SERIAL_OK;
+}
+
+uint32_t apio_serial_current_rate(const apio_serial_t *ser) {
+    uint32_t clkdiv = _apio_sm_reg_ptr(ser->block, ser->sm)->clkdiv;
+    uint32_t div_int = APIO_CLKDIV_INT_FROM_REG(clkdiv);
+    uint32_t div256 = ((div_int ? div_int : 0x10000) << 8) | APIO_CLKDIV_FRAC_FROM_REG(clkdiv);
+    return apio_serial_rate(ser->cfg.sysclk_hz, div256, ser->cycles);
+}
+
+void apio_serial_log(const apio_serial_t *ser) {
+#if defined(APIO_LOG_ENABLE)
+    static const char *protocols[] = { "UART TX", "UART RX", "SPI", "I2S" };
+    uint32_t current_hz = apio_serial_current_rate(ser);
+    APIO_LOG("Serial PIO%d SM%d: %s, %d bits %s first, %d instrs, CLKDIV %u+%u/256, %u bits/s (max %u, current %u)",
+        ser->block, ser->sm, protocols[ser->cfg.protocol & 3], ser->cfg.bits,
+        (ser->cfg.order == APIO_SERIAL_MSB_FIRST) ? "MSB" : "LSB", ser->instrs,
+        (unsigned)(ser->div256 >> 8), (unsigned)(ser->div256 & 0xFF),
+        (unsigned)ser->rate_hz, (unsigned)ser->max_rate_hz,
+        (unsigned)current_hz);
+    (void)protocols;
+    (void)current_hz;
+#else // !APIO_LOG_ENABLE
+    (void)ser;
+#endif // APIO_LOG_ENABLE
+}
+
+#endif // APIO_SERIAL_IMPL
+
+#endif // APIO_SERIAL_H
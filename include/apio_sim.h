@@ -0,0 +1,1075 @@
+// Copyright (C) 2026 Piers Finlayson <piers@piers.rocks>
+//
+// MIT License
+
+// apio - Runtime RP2350 PIO Assembler and Disassembler
+//
+// Lightweight PIO interpreter for emulation mode.
+//
+// Executes the programs assembled into _apio_emulated_pio for a single PIO
+// block, counting cycles and FIFO stalls, so program variants can be
+// benchmarked on the host without an external emulator.  For full-fidelity
+// emulation, including multiple blocks and DMA, use epio.
+//
+// Modelled:
+// - All instructions, including RP2350 indexed RX FIFO MOVs.
+// - Clock dividers, wrap, delays, side-set (optional and pindirs variants).
+// - Autopush/autopull with thresholds and shift directions, joined FIFOs.
+// - The block's IRQ flags, including relative addressing.
+// - FDEBUG stall, overflow and underrun flags, in the emulated FDEBUG state.
+// - FIFO levels, reflected in the emulated FLEVEL state by apio_sim_run().
+// - EXECCTRL EXEC_STALLED, set by apio_sim_run() while an instruction written
+//   by apio_sim_exec() to a running SM is stalled.  Program stalls are
+//   reported in apio_sim_sm_t.stall and the stall statistics instead.
+// - GPIO inputs, set via apio_sim_t.gpio_in, and outputs, honouring
+//   GPIOBASE and the emulated GPIO function and input override settings.
+//
+// Not modelled: prev/next block IRQs (which operate on apio_sim_t.irq_prev and
+// irq_next instead of another block), OUT_STICKY, INLINE_OUT_EN and input
+// synchronisers.
+//
+// Usage:
+//
+//   apio_sim_t sim;
+//   apio_sim_init(&sim, 0);           // After the apio code has run
+//   apio_sim_tx_put(&sim, 0, 0x1234);
+//   apio_sim_run(&sim, 1000);         // System clock cycles
+//   apio_sim_log_stats(&sim);
+//
+// Define APIO_SIM_PROFILE to also collect per-instruction slot execution
+// profiles - execution counts, and stall cycles by cause and delay cycles
+// attributed to the instruction that caused them.  Use apio_sim_log_profile()
+// to dump them alongside the disassembly, to find the hot spots in a program.
+//
+// Only available when APIO_EMULATION is defined.  The implementation is
+// included in the source file that defines APIO_EMU_IMPL.
+
+#ifndef APIO_SIM_H
+#define APIO_SIM_H
+
+#include <apio.h>
+
+#if defined(APIO_EMULATION)
+
+// Maximum FIFO depth, when joined
+#define APIO_SIM_MAX_FIFO_DEPTH     (APIO_MAX_FIFO_DEPTH * 2)
+
+// Number of IRQ flags per PIO block
+#define APIO_SIM_NUM_IRQS           8
+
+// Reasons an instruction can stall
+typedef enum {
+    APIO_SIM_STALL_NONE = 0,
+    APIO_SIM_STALL_TX_EMPTY,    // PULL or autopull with an empty TX FIFO
+    APIO_SIM_STALL_RX_FULL,     // PUSH or autopush with a full RX FIFO
+    APIO_SIM_STALL_WAIT,        // WAIT on a GPIO, pin or IRQ
+    APIO_SIM_STALL_IRQ,         // IRQ WAIT for the flag to be cleared
+    APIO_SIM_STALL_NUM,
+} apio_sim_stall_t;
+
+struct apio_sim;
+struct apio_sim_sm;
+struct apio_sim_op;
+
+typedef apio_sim_stall_t (*apio_sim_fn_t)(
+    struct apio_sim *sim,
+    struct apio_sim_sm *sm,
+    const struct apio_sim_op *op
+);
+
+// A pre-decoded instruction.  The meaning of a, b and c depends on the
+// handler - generally destination/source, operation and bit count/index.
+typedef struct apio_sim_op {
+    apio_sim_fn_t fn;
+    uint16_t instr;
+    uint8_t a;
+    uint8_t b;
+    uint8_t c;
+    uint8_t delay;
+    uint8_t side_en;        // Side-set applies to this instruction
+    uint8_t side_data;
+} apio_sim_op_t;
+
+// A FIFO, up to APIO_SIM_MAX_FIFO_DEPTH entries
+typedef struct {
+    uint32_t data[APIO_SIM_MAX_FIFO_DEPTH];
+    uint8_t head;
+    uint8_t level;
+    uint8_t depth;
+} apio_sim_fifo_t;
+
+// Per-SM execution statistics.  Cycle counts are SM clock cycles, i.e. after
+// the clock divider.
+typedef struct {
+    uint64_t cycles;        // Cycles while enabled
+    uint64_t instrs;        // Instructions completed
+    uint64_t delay_cycles;  // Cycles spent in instruction delays
+    uint64_t stall_cycles[APIO_SIM_STALL_NUM];  // By apio_sim_stall_t
+    uint64_t exec_stall_cycles; // Stalled on an apio_sim_exec() instruction
+    uint64_t tx_words;      // Words taken from the TX FIFO
+    uint64_t rx_words;      // Words pushed to the RX FIFO
+} apio_sim_stats_t;
+
+typedef struct apio_sim_sm {
+    uint8_t num;
+    uint8_t pc;
+    uint8_t next_pc;
+    uint8_t delay;          // Remaining delay cycles
+    uint8_t pending;        // Multi-cycle instruction in progress
+    uint8_t exec_pending;   // exec_instr to be executed next
+    uint8_t exec_latched;   // exec_instr is a stalled apio_sim_exec() one
+    uint16_t exec_instr;
+    uint32_t x;
+    uint32_t y;
+    uint32_t isr;
+    uint32_t osr;
+    uint8_t isr_count;
+    uint8_t osr_count;
+    apio_sim_stall_t stall; // Current stall reason, if any
+
+    // Decoded configuration
+    uint8_t wrap_bottom;
+    uint8_t wrap_top;
+    uint8_t out_base;
+    uint8_t out_count;
+    uint8_t set_base;
+    uint8_t set_count;
+    uint8_t side_base;
+    uint8_t side_count;     // Data bits, excluding any enable bit
+    uint8_t side_pindir;
+    uint8_t in_base;
+    uint8_t jmp_pin;
+    uint8_t status_sel;
+    uint8_t status_n;
+    uint8_t autopush;
+    uint8_t autopull;
+    uint8_t in_shift_right;
+    uint8_t out_shift_right;
+    uint8_t push_thresh;
+    uint8_t pull_thresh;
+    uint32_t in_mask;       // MOV x, pins mask from IN_COUNT
+    uint32_t div256;        // Clock divider, 24.8 fixed point
+    uint32_t div_acc;
+
+    apio_sim_fifo_t tx;
+    apio_sim_fifo_t rx;
+    uint32_t rxf_storage[APIO_MAX_FIFO_DEPTH];  // Indexed RX FIFO MOVs
+
+    // Dispatch table - program memory decoded for this SM's configuration
+    apio_sim_op_t ops[APIO_MAX_PIO_INSTRS];
+
+    apio_sim_stats_t stats;
+#if defined(APIO_SIM_PROFILE)
+    uint8_t delay_slot;     // Profile slot the current delay belongs to
+#endif // APIO_SIM_PROFILE
+} apio_sim_sm_t;
+
+#if defined(APIO_SIM_PROFILE)
+// Profile slot used for instructions executed via APIO_SM_EXEC_INSTR(), OUT
+// EXEC and MOV EXEC, rather than from instruction memory
+#define APIO_SIM_PROFILE_EXEC       APIO_MAX_PIO_INSTRS
+
+// Execution profile for a single instruction slot, accumulated across all
+// SMs executing it.  Cycle counts are SM clock cycles.
+typedef struct {
+    uint64_t execs;         // Times the instruction completed
+    uint64_t delay_cycles;  // Cycles spent in the instruction's delay
+    uint64_t stall_cycles[APIO_SIM_STALL_NUM];  // By apio_sim_stall_t
+} apio_sim_profile_t;
+#endif // APIO_SIM_PROFILE
+
+typedef struct apio_sim {
+    uint8_t block;
+    uint8_t enabled;        // Mask of enabled SMs
+    uint8_t irq;            // IRQ flags
+    uint8_t irq_prev;       // Stand-ins for the previous/next blocks' flags
+    uint8_t irq_next;
+    uint32_t gpio_base;
+    uint32_t pins;          // Output levels, relative to GPIOBASE
+    uint32_t pindirs;       // Output enables, relative to GPIOBASE
+    uint64_t gpio_in;       // Externally driven GPIO levels - set by caller
+    uint64_t cycles;        // System clock cycles run
+
+    // GPIO configuration, relative to GPIOBASE
+    uint32_t owned;         // GPIOs whose function is this block
+    uint32_t in_invert;
+    uint32_t in_force_low;
+    uint32_t in_force_high;
+
+    apio_sim_sm_t sm[APIO_MAX_SMS_PER_BLOCK];
+
+#if defined(APIO_SIM_PROFILE)
+    apio_sim_profile_t profile[APIO_MAX_PIO_INSTRS + 1];
+#endif // APIO_SIM_PROFILE
+} apio_sim_t;
+
+// Load a PIO block's programs, SM configuration, exec queues, TX FIFO
+// contents and enabled SMs from _apio_emulated_pio, and GPIO configuration
+// from _apio_emulated_gpios.  Queued exec instructions are executed
+// immediately, as on hardware.
+void apio_sim_init(apio_sim_t *sim, uint8_t block);
+
+// Enable or disable SMs.  Enabling a disabled SM does not reset it.
+void apio_sim_set_enabled(apio_sim_t *sim, uint8_t sm_mask);
+
+// Immediately execute an instruction on an SM, as APIO_SM_EXEC_INSTR().  If
+// it stalls on a running SM, it is latched and retried each cycle, with
+// EXEC_STALLED set, until it completes.
+void apio_sim_exec(apio_sim_t *sim, uint8_t sm, uint16_t instr);
+
+// Restart an SM at START, as CTRL SM_RESTART followed by an exec'd JMP,
+// clearing its FIFOs, shift counters, ISR, delay and any stalled
+// instruction.  X, Y, OSR and pin state are retained.
+void apio_sim_restart(apio_sim_t *sim, uint8_t sm, uint8_t start);
+
+// Run for a single system clock cycle.
+void apio_sim_step(apio_sim_t *sim);
+
+// Run for a number of system clock cycles.  Also updates the emulated SM
+// ADDR registers and EXECCTRL EXEC_STALLED bits, and the block's FLEVEL.
+void apio_sim_run(apio_sim_t *sim, uint64_t cycles);
+
+// Write a word to an SM's TX FIFO.  Returns 0 if the FIFO was full, setting
+// the block's emulated FDEBUG TXOVER flag.
+int apio_sim_tx_put(apio_sim_t *sim, uint8_t sm, uint32_t word);
+
+// Read a word from an SM's RX FIFO.  Returns 0 if the FIFO was empty, setting
+// the block's emulated FDEBUG RXUNDER flag.
+int apio_sim_rx_get(apio_sim_t *sim, uint8_t sm, uint32_t *word);
+
+// Returns the current level of the GPIOs within the block's 32 GPIO window,
+// as seen by the PIO block's inputs.
+uint32_t apio_sim_pin_levels(const apio_sim_t *sim);
+
+// Log the statistics for all SMs using APIO_LOG().  No-op if logging is
+// disabled.
+void apio_sim_log_stats(const apio_sim_t *sim);
+
+#if defined(APIO_SIM_PROFILE)
+// Clear the per-instruction profiles.
+void apio_sim_profile_reset(apio_sim_t *sim);
+
+// Log the per-instruction profiles using APIO_LOG(), alongside each
+// instruction's disassembly.  Only slots that have used cycles are logged.
+// No-op if logging is disabled.
+void apio_sim_log_profile(const apio_sim_t *sim);
+#endif // APIO_SIM_PROFILE
+
+#if defined(APIO_EMU_IMPL)
+
+//
+// FIFOs
+//
+
+static inline int apio_sim_fifo_push(apio_sim_fifo_t *fifo, uint32_t word) {
+    if (fifo->level >= fifo->depth) {
+        return 0;
+    }
+    fifo->data[(fifo->head + fifo->level) % APIO_SIM_MAX_FIFO_DEPTH] = word;
+    fifo->level++;
+    return 1;
+}
+
+static inline int apio_sim_fifo_pop(apio_sim_fifo_t *fifo, uint32_t *word) {
+    if (fifo->level == 0) {
+        return 0;
+    }
+    *word = fifo->data[fifo->head];
+    fifo->head = (fifo->head + 1) % APIO_SIM_MAX_FIFO_DEPTH;
+    fifo->level--;
+    return 1;
+}
+
+//
+// Pins
+//
+
+uint32_t apio_sim_pin_levels(const apio_sim_t *sim) {
+    uint32_t driven = sim->pindirs & sim->owned;
+    uint32_t in = (uint32_t)(sim->gpio_in >> sim->gpio_base);
+    uint32_t levels = (sim->pins & driven) | (in & ~driven);
+    levels ^= sim->in_invert;
+    levels &= ~sim->in_force_low;
+    levels |= sim->in_force_high;
+    return levels;
+}
+
+static inline uint32_t apio_sim_rotr(uint32_t val, uint8_t shift) {
+    shift &= 31;
+    return shift ? ((val >> shift) | (val << (32 - shift))) : val;
+}
+
+static inline uint32_t apio_sim_mask(uint8_t bits) {
+    return (bits >= 32) ? 0xFFFFFFFFu : ((1u << bits) - 1);
+}
+
+// Writes COUNT bits of DATA to pins (or pindirs) starting at BASE, wrapping
+// at 32.
+static inline void apio_sim_write_pins(
+    apio_sim_t *sim,
+    uint8_t base,
+    uint8_t count,
+    uint32_t data,
+    uint8_t dirs
+) {
+    uint32_t mask = apio_sim_mask(count);
+    uint32_t rot_mask = (mask << (base & 31)) | (base ? (mask >> (32 - (base & 31))) : 0);
+    uint32_t rot_data = ((data & mask) << (base & 31)) | (base ? ((data & mask) >> (32 - (base & 31))) : 0);
+    if (dirs) {
+        sim->pindirs = (sim->pindirs & ~rot_mask) | (rot_data & rot_mask);
+    } else {
+        sim->pins = (sim->pins & ~rot_mask) | (rot_data & rot_mask);
+    }
+}
+
+static inline uint32_t apio_sim_read_pins(const apio_sim_t *sim, const apio_sim_sm_t *sm) {
+    return apio_sim_rotr(apio_sim_pin_levels(sim), sm->in_base);
+}
+
+static inline uint32_t apio_sim_pin(const apio_sim_t *sim, uint8_t pin) {
+    return (apio_sim_pin_levels(sim) >> (pin & 31)) & 1;
+}
+
+//
+// Shift registers
+//
+
+static inline void apio_sim_shift_in(apio_sim_sm_t *sm, uint32_t data, uint8_t bits) {
+    data &= apio_sim_mask(bits);
+    if (bits >= 32) {
+        sm->isr = data;
+    } else if (sm->in_shift_right) {
+        sm->isr = (sm->isr >> bits) | (data << (32 - bits));
+    } else {
+        sm->isr = (sm->isr << bits) | data;
+    }
+    sm->isr_count = (sm->isr_count + bits > 32) ? 32 : (sm->isr_count + bits);
+}
+
+static inline uint32_t apio_sim_shift_out(apio_sim_sm_t *sm, uint8_t bits) {
+    uint32_t data;
+    if (bits >= 32) {
+        data = sm->osr;
+        sm->osr = 0;
+    } else if (sm->out_shift_right) {
+        data = sm->osr & apio_sim_mask(bits);
+        sm->osr >>= bits;
+    } else {
+        data = sm->osr >> (32 - bits);
+        sm->osr <<= bits;
+    }
+    sm->osr_count = (sm->osr_count + bits > 32) ? 32 : (sm->osr_count + bits);
+    return data;
+}
+
+static inline int apio_sim_push(apio_sim_sm_t *sm) {
+    if (!apio_sim_fifo_push(&sm->rx, sm->isr)) {
+        return 0;
+    }
+    sm->stats.rx_words++;
+    sm->isr = 0;
+    sm->isr_count = 0;
+    return 1;
+}
+
+static inline int apio_sim_pull(apio_sim_sm_t *sm) {
+    if (!apio_sim_fifo_pop(&sm->tx, &sm->osr)) {
+        return 0;
+    }
+    sm->stats.tx_words++;
+    sm->osr_count = 0;
+    return 1;
+}
+
+//
+// Instruction handlers.  Each returns APIO_SIM_STALL_NONE if the instruction
+// completed, or the reason it stalled, in which case it is retried next SM
+// cycle.
+//
+
+static uint32_t apio_sim_source(apio_sim_t *sim, apio_sim_sm_t *sm, uint8_t src) {
+    switch (src) {
+        case 0b000: return apio_sim_read_pins(sim, sm);
+        case 0b001: return sm->x;
+        case 0b010: return sm->y;
+        case 0b011: return 0;
+        case 0b101: // STATUS
+            if (sm->status_sel == 0) {
+                return (sm->tx.level < sm->status_n) ? 0xFFFFFFFFu : 0;
+            } else if (sm->status_sel == 1) {
+                return (sm->rx.level < sm->status_n) ? 0xFFFFFFFFu : 0;
+            } else {
+                return (sim->irq & (1 << (sm->status_n & 0x7))) ? 0xFFFFFFFFu : 0;
+            }
+        case 0b110: return sm->isr;
+        case 0b111: return sm->osr;
+        default: return 0;
+    }
+}
+
+// Returns a pointer to the IRQ flags and the flag number for an IRQ/WAIT
+// instruction's index and index mode.
+static uint8_t *apio_sim_irq_flag(
+    apio_sim_t *sim,
+    apio_sim_sm_t *sm,
+    uint8_t index,
+    uint8_t idx_mode,
+    uint8_t *flag
+) {
+    switch (idx_mode) {
+        case 0b01:
+            *flag = index & 0x7;
+            return &sim->irq_prev;
+        case 0b10:
+            *flag = (index & 0x4) | ((index + sm->num) & 0x3);
+            return &sim->irq;
+        case 0b11:
+            *flag = index & 0x7;
+            return &sim->irq_next;
+        default:
+            *flag = index & 0x7;
+            return &sim->irq;
+    }
+}
+
+static apio_sim_stall_t apio_sim_op_jmp(apio_sim_t *sim, apio_sim_sm_t *sm, const apio_sim_op_t *op) {
+    int take;
+    switch (op->a) {
+        case 0b000: take = 1; break;
+        case 0b001: take = (sm->x == 0); break;
+        case 0b010: take = (sm->x != 0); sm->x--; break;
+        case 0b011: take = (sm->y == 0); break;
+        case 0b100: take = (sm->y != 0); sm->y--; break;
+        case 0b101: take = (sm->x != sm->y); break;
+        case 0b110: take = apio_sim_pin(sim, sm->jmp_pin); break;
+        default: take = (sm->osr_count < sm->pull_thresh); break;
+    }
+    if (take) {
+        sm->next_pc = op->c;
+    }
+    return APIO_SIM_STALL_NONE;
+}
+
+static apio_sim_stall_t apio_sim_op_wait(apio_sim_t *sim, apio_sim_sm_t *sm, const apio_sim_op_t *op) {
+    uint8_t pol = op->b;
+    switch (op->a) {
+        case 0b00: // GPIO, relative to GPIOBASE
+            return (apio_sim_pin(sim, op->c) == pol) ? APIO_SIM_STALL_NONE : APIO_SIM_STALL_WAIT;
+        case 0b01: // PIN, relative to IN_BASE
+            return (apio_sim_pin(sim, sm->in_base + op->c) == pol) ? APIO_SIM_STALL_NONE : APIO_SIM_STALL_WAIT;
+        case 0b10: { // IRQ
+            uint8_t flag;
+            uint8_t *flags = apio_sim_irq_flag(sim, sm, op->c & 0x7, (op->c >> 3) & 0x3, &flag);
+            uint8_t set = (*flags >> flag) & 1;
+            if (set != pol) {
+                return APIO_SIM_STALL_WAIT;
+            }
+            if (pol) {
+                *flags &= ~(1 << flag);
+            }
+            return APIO_SIM_STALL_NONE;
+        }
+        default: // JMPPIN
+            return (apio_sim_pin(sim, sm->jmp_pin + (op->c & 0x3)) == pol) ? APIO_SIM_STALL_NONE : APIO_SIM_STALL_WAIT;
+    }
+}
+
+static apio_sim_stall_t apio_sim_op_in(apio_sim_t *sim, apio_sim_sm_t *sm, const apio_sim_op_t *op) {
+    if (!sm->pending) {
+        apio_sim_shift_in(sm, apio_sim_source(sim, sm, op->a), op->c);
+        if (!sm->autopush || (sm->isr_count < sm->push_thresh)) {
+            return APIO_SIM_STALL_NONE;
+        }
+        sm->pending = 1;
+    }
+    // Autopush - stall until there's space in the RX FIFO
+    if (!apio_sim_push(sm)) {
+        return APIO_SIM_STALL_RX_FULL;
+    }
+    return APIO_SIM_STALL_NONE;
+}
+
+static apio_sim_stall_t apio_sim_op_out(apio_sim_t *sim, apio_sim_sm_t *sm, const apio_sim_op_t *op) {
+    // Autopull - refill an exhausted OSR before shifting, stalling if the TX
+    // FIFO is empty
+    if (sm->autopull && (sm->osr_count >= sm->pull_thresh)) {
+        if (!apio_sim_pull(sm)) {
+            return APIO_SIM_STALL_TX_EMPTY;
+        }
+    }
+    uint32_t data = apio_sim_shift_out(sm, op->c);
+    switch (op->a) {
+        case 0b000: apio_sim_write_pins(sim, sm->out_base, sm->out_count, data, 0); break;
+        case 0b001: sm->x = data; break;
+        case 0b010: sm->y = data; break;
+        case 0b011: break;
+        case 0b100: apio_sim_write_pins(sim, sm->out_base, sm->out_count, data, 1); break;
+        case 0b101: sm->next_pc = data & 0x1F; break;
+        case 0b110: sm->isr = data; sm->isr_count = op->c; break;
+        default:
+            sm->exec_instr = (uint16_t)data;
+            sm->exec_pending = 1;
+            break;
+    }
+    // The OSR is refilled in the same cycle if the threshold has been reached
+    // and data is available
+    if (sm->autopull && (sm->osr_count >= sm->pull_thresh)) {
+        apio_sim_pull(sm);
+    }
+    return APIO_SIM_STALL_NONE;
+}
+
+static apio_sim_stall_t apio_sim_op_push(apio_sim_t *sim, apio_sim_sm_t *sm, const apio_sim_op_t *op) {
+    (void)sim;
+    uint8_t if_full = op->a;
+    uint8_t block = op->b;
+    if (if_full && (sm->isr_count < sm->push_thresh)) {
+        return APIO_SIM_STALL_NONE;
+    }
+    if (!apio_sim_push(sm)) {
+        if (block) {
+            return APIO_SIM_STALL_RX_FULL;
+        }
+        // Non-blocking push to a full FIFO discards the data, but still
+        // clears the ISR
+        sm->isr = 0;
+        sm->isr_count = 0;
+    }
+    return APIO_SIM_STALL_NONE;
+}
+
+static apio_sim_stall_t apio_sim_op_pull(apio_sim_t *sim, apio_sim_sm_t *sm, const apio_sim_op_t *op) {
+    (void)sim;
+    uint8_t if_empty = op->a;
+    uint8_t block = op->b;
+    if (if_empty && (sm->osr_count < sm->pull_thresh)) {
+        return APIO_SIM_STALL_NONE;
+    }
+    if (!apio_sim_pull(sm)) {
+        if (block) {
+            return APIO_SIM_STALL_TX_EMPTY;
+        }
+        // Non-blocking pull from an empty FIFO copies X to the OSR
+        sm->osr = sm->x;
+        sm->osr_count = 0;
+    }
+    return APIO_SIM_STALL_NONE;
+}
+
+static apio_sim_stall_t apio_sim_op_mov_rxfifo(apio_sim_t *sim, apio_sim_sm_t *sm, const apio_sim_op_t *op) {
+    (void)sim;
+    uint8_t index = op->a ? op->c : (uint8_t)(sm->y & 0x3);
+    if (op->b) {
+        // mov osr, rxfifo[]
+        sm->osr = sm->rxf_storage[index];
+        sm->osr_count = 0;
+    } else {
+        // mov rxfifo[], isr
+        sm->rxf_storage[index] = sm->isr;
+    }
+    return APIO_SIM_STALL_NONE;
+}
+
+static uint32_t apio_sim_reverse(uint32_t val) {
+    val = ((val >> 1) & 0x55555555u) | ((val & 0x55555555u) << 1);
+    val = ((val >> 2) & 0x33333333u) | ((val & 0x33333333u) << 2);
+    val = ((val >> 4) & 0x0F0F0F0Fu) | ((val & 0x0F0F0F0Fu) << 4);
+    val = ((val >> 8) & 0x00FF00FFu) | ((val & 0x00FF00FFu) << 8);
+    return (val >> 16) | (val << 16);
+}
+
+static apio_sim_stall_t apio_sim_op_mov(apio_sim_t *sim, apio_sim_sm_t *sm, const apio_sim_op_t *op) {
+    uint32_t val = apio_sim_source(sim, sm, op->c);
+    if (op->c == 0b000) {
+        val &= sm->in_mask;
+    }
+    if (op->b == 0b01) {
+        val = ~val;
+    } else if (op->b == 0b10) {
+        val = apio_sim_reverse(val);
+    }
+    switch (op->a) {
+        case 0b000: apio_sim_write_pins(sim, sm->out_base, sm->out_count, val, 0); break;
+        case 0b001: sm->x = val; break;
+        case 0b010: sm->y = val; break;
+        case 0b011: apio_sim_write_pins(sim, sm->out_base, sm->out_count, val, 1); break;
+        case 0b100:
+            sm->exec_instr = (uint16_t)val;
+            sm->exec_pending = 1;
+            break;
+        case 0b101: sm->next_pc = val & 0x1F; break;
+        case 0b110: sm->isr = val; sm->isr_count = 0; break;
+        default: sm->osr = val; sm->osr_count = 0; break;
+    }
+    return APIO_SIM_STALL_NONE;
+}
+
+static apio_sim_stall_t apio_sim_op_irq(apio_sim_t *sim, apio_sim_sm_t *sm, const apio_sim_op_t *op) {
+    uint8_t flag;
+    uint8_t *flags = apio_sim_irq_flag(sim, sm, op->c, op->b, &flag);
+    if (op->a & 0x2) {
+        // Clear
+        *flags &= ~(1 << flag);
+        return APIO_SIM_STALL_NONE;
+    }
+    if (!sm->pending) {
+        *flags |= (1 << flag);
+        if (!(op->a & 0x1)) {
+            return APIO_SIM_STALL_NONE;
+        }
+        sm->pending = 1;
+    }
+    // Wait for the flag to be cleared
+    return (*flags & (1 << flag)) ? APIO_SIM_STALL_IRQ : APIO_SIM_STALL_NONE;
+}
+
+static apio_sim_stall_t apio_sim_op_set(apio_sim_t *sim, apio_sim_sm_t *sm, const apio_sim_op_t *op) {
+    switch (op->a) {
+        case 0b000: apio_sim_write_pins(sim, sm->set_base, sm->set_count, op->c, 0); break;
+        case 0b001: sm->x = op->c; break;
+        case 0b010: sm->y = op->c; break;
+        case 0b100: apio_sim_write_pins(sim, sm->set_base, sm->set_count, op->c, 1); break;
+        default: break;
+    }
+    return APIO_SIM_STALL_NONE;
+}
+
+// Decodes an instruction for an SM's side-set configuration.
+static void apio_sim_decode(uint16_t instr, apio_sim_op_t *op, uint8_t side_opt, uint8_t side_bits) {
+    uint8_t field = (instr >> 8) & 0x1F;
+    uint8_t delay_bits = 5 - side_bits;
+    uint8_t side = field >> delay_bits;
+
+    op->instr = instr;
+    op->delay = field & ((1 << delay_bits) - 1);
+    if (side_opt) {
+        op->side_en = (side >> (side_bits - 1)) & 1;
+        op->side_data = side & ((1 << (side_bits - 1)) - 1);
+    } else {
+        op->side_en = (side_bits > 0);
+        op->side_data = side;
+    }
+
+    switch ((instr >> 13) & 0x7) {
+        case 0b000:
+            op->fn = apio_sim_op_jmp;
+            op->a = (instr >> 5) & 0x7;
+            op->c = instr & 0x1F;
+            break;
+        case 0b001:
+            op->fn = apio_sim_op_wait;
+            op->a = (instr >> 5) & 0x3;
+            op->b = (instr >> 7) & 0x1;
+            op->c = instr & 0x1F;
+            break;
+        case 0b010:
+            op->fn = apio_sim_op_in;
+            op->a = (instr >> 5) & 0x7;
+            op->c = APIO_THRESH32(instr & 0x1F);
+            break;
+        case 0b011:
+            op->fn = apio_sim_op_out;
+            op->a = (instr >> 5) & 0x7;
+            op->c = APIO_THRESH32(instr & 0x1F);
+            break;
+        case 0b100:
+            if (instr & (1 << 4)) {
+                op->fn = apio_sim_op_mov_rxfifo;
+                op->a = (instr >> 3) & 0x1;
+                op->b = (instr >> 7) & 0x1;
+                op->c = instr & 0x3;
+            } else {
+                op->fn = (instr & (1 << 7)) ? apio_sim_op_pull : apio_sim_op_push;
+                op->a = (instr >> 6) & 0x1;
+                op->b = (instr >> 5) & 0x1;
+            }
+            break;
+        case 0b101:
+            op->fn = apio_sim_op_mov;
+            op->a = (instr >> 5) & 0x7;
+            op->b = (instr >> 3) & 0x3;
+            op->c = instr & 0x7;
+            break;
+        case 0b110:
+            op->fn = apio_sim_op_irq;
+            op->a = (instr >> 5) & 0x3;
+            op->b = (instr >> 3) & 0x3;
+            op->c = instr & 0x7;
+            break;
+        default:
+            op->fn = apio_sim_op_set;
+            op->a = (instr >> 5) & 0x7;
+            op->c = instr & 0x1F;
+            break;
+    }
+}
+
+// Decodes an instruction using the SM's current side-set configuration.
+static void apio_sim_decode_sm(uint16_t instr, apio_sim_op_t *op, const pio_sm_reg_t *reg) {
+    uint8_t side_opt = (uint8_t)APIO_EXECCTRL_SIDE_EN_FROM_REG(reg->execctrl);
+    uint8_t side_bits = (uint8_t)APIO_SIDE_SET_COUNT_FROM_REG(reg->pinctrl);
+    if (side_bits > 5) {
+        side_bits = 5;
+    }
+    apio_sim_decode(instr, op, side_opt && (side_bits > 0), side_bits);
+}
+
+static inline void apio_sim_side_set(apio_sim_t *sim, const apio_sim_sm_t *sm, const apio_sim_op_t *op) {
+    if (op->side_en) {
+        apio_sim_write_pins(sim, sm->side_base, sm->side_count, op->side_data, sm->side_pindir);
+    }
+}
+
+// Executes an instruction, returning the stall reason.  On completion updates
+// the PC and loads the instruction's delay.
+static inline apio_sim_stall_t apio_sim_execute(
+    apio_sim_t *sim,
+    apio_sim_sm_t *sm,
+    const apio_sim_op_t *op,
+    uint8_t advance
+) {
+    // Side-set takes effect when the instruction is issued, even if it
+    // subsequently stalls
+    apio_sim_side_set(sim, sm, op);
+    sm->next_pc = advance ? ((sm->pc == sm->wrap_top) ? sm->wrap_bottom : ((sm->pc + 1) & 0x1F)) : sm->pc;
+    uint8_t exec_was_pending = sm->exec_pending;
+    sm->exec_pending = 0;
+    apio_sim_stall_t stall = op->fn(sim, sm, op);
+    if (stall != APIO_SIM_STALL_NONE) {
+        sm->exec_pending = exec_was_pending;
+        return stall;
+    }
+    sm->pending = 0;
+    sm->exec_latched = 0;
+    sm->pc = sm->next_pc;
+    // Delay is ignored on OUT/MOV EXEC - the executed instruction's is used
+    if (!sm->exec_pending) {
+        sm->delay = op->delay;
+    }
+    sm->stats.instrs++;
+    return APIO_SIM_STALL_NONE;
+}
+
+// Runs a single SM clock cycle.
+static inline void apio_sim_sm_cycle(apio_sim_t *sim, apio_sim_sm_t *sm) {
+    sm->stats.cycles++;
+    if (sm->delay) {
+        sm->delay--;
+        sm->stats.delay_cycles++;
+#if defined(APIO_SIM_PROFILE)
+        sim->profile[sm->delay_slot].delay_cycles++;
+#endif // APIO_SIM_PROFILE
+        return;
+    }
+    apio_sim_stall_t stall;
+    uint8_t slot;
+    if (sm->exec_pending) {
+        apio_sim_op_t op;
+        apio_sim_decode_sm(sm->exec_instr, &op, &_apio_emulated_pio.pio_sm_reg[sim->block][sm->num]);
+        slot = APIO_MAX_PIO_INSTRS;
+        stall = apio_sim_execute(sim, sm, &op, 0);
+    } else {
+        slot = sm->pc;
+        stall = apio_sim_execute(sim, sm, &sm->ops[sm->pc], 1);
+    }
+    sm->stall = stall;
+    if (sm->exec_latched) {
+        sm->stats.exec_stall_cycles++;
+    } else {
+        sm->stats.stall_cycles[stall]++;
+    }
+    if (stall == APIO_SIM_STALL_TX_EMPTY) {
+        _apio_emulated_pio.fdebug[sim->block] |= APIO_FDEBUG_TXSTALL(sm->num);
+        _APIO_EMU_DIRTY(sim->block);
+    } else if (stall == APIO_SIM_STALL_RX_FULL) {
+        _apio_emulated_pio.fdebug[sim->block] |= APIO_FDEBUG_RXSTALL(sm->num);
+        _APIO_EMU_DIRTY(sim->block);
+    }
+#if defined(APIO_SIM_PROFILE)
+    if (stall == APIO_SIM_STALL_NONE) {
+        sim->profile[slot].execs++;
+        sm->delay_slot = slot;
+    } else {
+        sim->profile[slot].stall_cycles[stall]++;
+    }
+#else // !APIO_SIM_PROFILE
+    (void)slot;
+#endif // APIO_SIM_PROFILE
+}
+
+void apio_sim_step(apio_sim_t *sim) {
+    sim->cycles++;
+    for (int ii = 0; ii < APIO_MAX_SMS_PER_BLOCK; ii++) {
+        if (!(sim->enabled & (1 << ii))) {
+            continue;
+        }
+        apio_sim_sm_t *sm = &sim->sm[ii];
+        if (sm->div256 > 256) {
+            sm->div_acc += 256;
+            if (sm->div_acc < sm->div256) {
+                continue;
+            }
+            sm->div_acc -= sm->div256;
+        }
+        apio_sim_sm_cycle(sim, sm);
+    }
+}
+
+void apio_sim_run(apio_sim_t *sim, uint64_t cycles) {
+    for (uint64_t ii = 0; ii < cycles; ii++) {
+        apio_sim_step(sim);
+    }
+
+    // Reflect the current PC, exec stall state and FIFO levels in the
+    // emulated registers, marking the block for handoff
+    uint32_t flevel = 0;
+    for (int ii = 0; ii < APIO_MAX_SMS_PER_BLOCK; ii++) {
+        flevel |= APIO_FLEVEL_TX(ii, sim->sm[ii].tx.level) | APIO_FLEVEL_RX(ii, sim->sm[ii].rx.level);
+        pio_sm_reg_t *reg = &_apio_emulated_pio.pio_sm_reg[sim->block][ii];
+        reg->addr = sim->sm[ii].pc;
+        if (sim->sm[ii].exec_latched) {
+            reg->execctrl |= APIO_EXECCTRL_EXEC_STALLED;
+        } else {
+            reg->execctrl &= ~APIO_EXECCTRL_EXEC_STALLED;
+        }
+    }
+    _apio_emulated_pio.flevel[sim->block] = flevel;
+    _APIO_EMU_DIRTY(sim->block);
+}
+
+void apio_sim_exec(apio_sim_t *sim, uint8_t sm_num, uint16_t instr) {
+    apio_sim_sm_t *sm = &sim->sm[sm_num];
+    apio_sim_op_t op;
+    apio_sim_decode_sm(instr, &op, &_apio_emulated_pio.pio_sm_reg[sim->block][sm_num]);
+    sm->pending = 0;
+    sm->exec_latched = 0;
+    apio_sim_stall_t stall = apio_sim_execute(sim, sm, &op, 0);
+    if ((sim->enabled & (1u << sm_num)) && (stall != APIO_SIM_STALL_NONE)) {
+        // A running SM latches a stalled instruction, retrying it each cycle
+        // with EXEC_STALLED set until it completes
+        sm->exec_instr = instr;
+        sm->exec_pending = 1;
+        sm->exec_latched = 1;
+        sm->stall = stall;
+        return;
+    }
+    // Exec'd instructions are not subject to delays, and any stall is
+    // abandoned, when the SM is not running
+    sm->delay = 0;
+    sm->pending = 0;
+}
+
+void apio_sim_restart(apio_sim_t *sim, uint8_t sm_num, uint8_t start) {
+    apio_sim_sm_t *sm = &sim->sm[sm_num];
+    sm->tx.head = sm->tx.level = 0;
+    sm->rx.head = sm->rx.level = 0;
+    sm->isr = 0;
+    sm->isr_count = 0;
+    sm->osr_count = 32;
+    sm->delay = 0;
+    sm->pending = 0;
+    sm->exec_pending = 0;
+    sm->exec_latched = 0;
+    sm->stall = APIO_SIM_STALL_NONE;
+    apio_sim_exec(sim, sm_num, APIO_JMP(start));
+}
+
+void apio_sim_set_enabled(apio_sim_t *sim, uint8_t sm_mask) {
+    sim->enabled = sm_mask & ((1 << APIO_MAX_SMS_PER_BLOCK) - 1);
+}
+
+int apio_sim_tx_put(apio_sim_t *sim, uint8_t sm, uint32_t word) {
+    if (!apio_sim_fifo_push(&sim->sm[sm].tx, word)) {
+        _apio_emulated_pio.fdebug[sim->block] |= APIO_FDEBUG_TXOVER(sm);
+        _APIO_EMU_DIRTY(sim->block);
+        return 0;
+    }
+    return 1;
+}
+
+int apio_sim_rx_get(apio_sim_t *sim, uint8_t sm, uint32_t *word) {
+    if (!apio_sim_fifo_pop(&sim->sm[sm].rx, word)) {
+        _apio_emulated_pio.fdebug[sim->block] |= APIO_FDEBUG_RXUNDER(sm);
+        _APIO_EMU_DIRTY(sim->block);
+        return 0;
+    }
+    return 1;
+}
+
+static void apio_sim_load_sm(apio_sim_t *sim, uint8_t block, uint8_t num) {
+    const pio_sm_reg_t *reg = &_apio_emulated_pio.pio_sm_reg[block][num];
+    apio_sim_sm_t *sm = &sim->sm[num];
+    uint32_t execctrl = reg->execctrl;
+    uint32_t shiftctrl = reg->shiftctrl;
+    uint32_t pinctrl = reg->pinctrl;
+
+    sm->num = num;
+    sm->wrap_bottom = APIO_WRAP_BOTTOM_FROM_REG(execctrl);
+    sm->wrap_top = APIO_WRAP_TOP_FROM_REG(execctrl);
+    sm->jmp_pin = APIO_EXECCTRL_JMP_PIN_FROM_REG(execctrl);
+    sm->side_pindir = APIO_EXECCTRL_SIDE_PINDIR_FROM_REG(execctrl);
+    sm->status_sel = APIO_EXECCTRL_STATUS_SEL_FROM_REG(execctrl);
+    sm->status_n = APIO_EXECCTRL_STATUS_N_FROM_REG(execctrl);
+
+    sm->autopush = (shiftctrl & APIO_AUTOPUSH) ? 1 : 0;
+    sm->autopull = (shiftctrl & APIO_AUTOPULL) ? 1 : 0;
+    sm->in_shift_right = (shiftctrl & APIO_IN_SHIFTDIR_R) ? 1 : 0;
+    sm->out_shift_right = (shiftctrl & APIO_OUT_SHIFTDIR_R) ? 1 : 0;
+    sm->push_thresh = APIO_THRESH32(APIO_PUSH_THRESH_FROM_REG(shiftctrl));
+    sm->pull_thresh = APIO_THRESH32(APIO_PULL_THRESH_FROM_REG(shiftctrl));
+    sm->in_mask = apio_sim_mask(APIO_THRESH32(APIO_IN_COUNT_FROM_REG(shiftctrl)));
+
+    sm->out_base = APIO_OUT_BASE_FROM_REG(pinctrl);
+    sm->out_count = APIO_OUT_COUNT_FROM_REG(pinctrl);
+    sm->set_base = APIO_SET_BASE_FROM_REG(pinctrl);
+    sm->set_count = APIO_SET_COUNT_FROM_REG(pinctrl);
+    sm->in_base = APIO_IN_BASE_FROM_REG(pinctrl);
+    sm->side_base = APIO_SIDE_SET_BASE_FROM_REG(pinctrl);
+    sm->side_count = APIO_SIDE_SET_COUNT_FROM_REG(pinctrl);
+    if (APIO_EXECCTRL_SIDE_EN_FROM_REG(execctrl) && sm->side_count) {
+        sm->side_count--;
+    }
+
+    uint32_t div_int = APIO_CLKDIV_INT_FROM_REG(reg->clkdiv);
+    sm->div256 = ((div_int ? div_int : 0x10000) << 8) | APIO_CLKDIV_FRAC_FROM_REG(reg->clkdiv);
+    sm->div_acc = 0;
+
+    // OSR starts empty, so autopull and !OSRE behave as on hardware
+    sm->osr_count = 32;
+
+    uint8_t depth = APIO_MAX_FIFO_DEPTH;
+    sm->tx.depth = APIO_SHIFTCTRL_FJOIN_RX_FROM_REG(shiftctrl) ? 0 : (APIO_SHIFTCTRL_FJOIN_TX_FROM_REG(shiftctrl) ? depth * 2 : depth);
+    sm->rx.depth = APIO_SHIFTCTRL_FJOIN_TX_FROM_REG(shiftctrl) ? 0 : (APIO_SHIFTCTRL_FJOIN_RX_FROM_REG(shiftctrl) ? depth * 2 : depth);
+
+    for (int ii = 0; ii < APIO_MAX_PIO_INSTRS; ii++) {
+        apio_sim_decode_sm(_apio_emulated_pio.instr[block][ii], &sm->ops[ii], reg);
+    }
+
+    uint8_t tx_count = _apio_emulated_pio.tx_fifo_count[block][num];
+    for (int ii = 0; (ii < tx_count) && (ii < APIO_MAX_FIFO_DEPTH); ii++) {
+        apio_sim_fifo_push(&sm->tx, _apio_emulated_pio.tx_fifos[block][num][ii]);
+    }
+}
+
+void apio_sim_init(apio_sim_t *sim, uint8_t block) {
+    *sim = (apio_sim_t){0};
+    sim->block = block;
+    sim->gpio_base = _apio_emulated_pio.gpio_base[block] ? 16 : 0;
+
+    for (int ii = 0; ii < 32; ii++) {
+        int gpio = ii + (int)sim->gpio_base;
+        if (gpio >= APIO_MAX_GPIOS) {
+            break;
+        }
+        if (_apio_emulated_gpios.output_block[gpio] == block) sim->owned |= (1u << ii);
+        if (_apio_emulated_gpios.inverted[gpio]) sim->in_invert |= (1u << ii);
+        if (_apio_emulated_gpios.force_input_low[gpio]) sim->in_force_low |= (1u << ii);
+        if (_apio_emulated_gpios.force_input_high[gpio]) sim->in_force_high |= (1u << ii);
+    }
+
+    for (uint8_t sm = 0; sm < APIO_MAX_SMS_PER_BLOCK; sm++) {
+        apio_sim_load_sm(sim, block, sm);
+        uint16_t count = _apio_emulated_pio.pre_instr_count[block][sm];
+        for (int ii = 0; (ii < count) && (ii < APIO_EMU_MAX_PRE_INSTRS); ii++) {
+            apio_sim_exec(sim, sm, _apio_emulated_pio.pre_instr[block][sm][ii]);
+        }
+        sim->sm[sm].stats = (apio_sim_stats_t){0};
+    }
+
+    apio_sim_set_enabled(sim, _apio_emulated_pio.enabled_sms[block]);
+}
+
+void apio_sim_log_stats(const apio_sim_t *sim) {
+    APIO_LOG("PIO%d: %llu cycles", sim->block, (unsigned long long)sim->cycles);
+    for (int ii = 0; ii < APIO_MAX_SMS_PER_BLOCK; ii++) {
+        const apio_sim_stats_t *stats = &sim->sm[ii].stats;
+        if (!stats->cycles) {
+            continue;
+        }
+        APIO_LOG("  SM%d: cycles=%llu instrs=%llu delay=%llu pc=%d",
+            ii,
+            (unsigned long long)stats->cycles,
+            (unsigned long long)stats->instrs,
+            (unsigned long long)stats->delay_cycles,
+            sim->sm[ii].pc);
+        APIO_LOG("    stalls: tx_empty=%llu rx_full=%llu wait=%llu irq=%llu exec=%llu  words: tx=%llu rx=%llu",
+            (unsigned long long)stats->stall_cycles[APIO_SIM_STALL_TX_EMPTY],
+            (unsigned long long)stats->stall_cycles[APIO_SIM_STALL_RX_FULL],
+            (unsigned long long)stats->stall_cycles[APIO_SIM_STALL_WAIT],
+            (unsigned long long)stats->stall_cycles[APIO_SIM_STALL_IRQ],
+            (unsigned long long)stats->exec_stall_cycles,
+            (unsigned long long)stats->tx_words,
+            (unsigned long long)stats->rx_words);
+    }
+}
+
+#if defined(APIO_SIM_PROFILE)
+void apio_sim_profile_reset(apio_sim_t *sim) {
+    for (int ii = 0; ii <= APIO_MAX_PIO_INSTRS; ii++) {
+        sim->profile[ii] = (apio_sim_profile_t){0};
+    }
+}
+
+// Total cycles attributed to a profile slot
+static uint64_t apio_sim_profile_cycles(const apio_sim_profile_t *prof) {
+    uint64_t cycles = prof->execs + prof->delay_cycles;
+    for (int ii = APIO_SIM_STALL_NONE + 1; ii < APIO_SIM_STALL_NUM; ii++) {
+        cycles += prof->stall_cycles[ii];
+    }
+    return cycles;
+}
+
+void apio_sim_log_profile(const apio_sim_t *sim) {
+#if defined(APIO_LOG_ENABLE)
+    char instr[64];
+    uint64_t total = 0;
+    for (int ii = 0; ii <= APIO_MAX_PIO_INSTRS; ii++) {
+        total += apio_sim_profile_cycles(&sim->profile[ii]);
+    }
+
+    APIO_LOG("PIO%d profile: %llu SM cycles", sim->block, (unsigned long long)total);
+    APIO_LOG("  slot  instr      execs     cycles      %%      delay   tx_empty    rx_full       wait        irq ; disassembly");
+    for (int ii = 0; ii <= APIO_MAX_PIO_INSTRS; ii++) {
+        const apio_sim_profile_t *prof = &sim->profile[ii];
+        uint64_t cycles = apio_sim_profile_cycles(prof);
+        if (!cycles) {
+            continue;
+        }
+        uint32_t permille = total ? (uint32_t)((cycles * 1000) / total) : 0;
+        if (ii < APIO_MAX_PIO_INSTRS) {
+            uint16_t op = _apio_emulated_pio.instr[sim->block][ii];
+            apio_instruction_decoder(op, instr, 0);
+            APIO_LOG("  %4d 0x%04X %10llu %10llu %3u.%u%% %10llu %10llu %10llu %10llu %10llu ; %s",
+                ii, op,
+                (unsigned long long)prof->execs,
+                (unsigned long long)cycles,
+                permille / 10, permille % 10,
+                (unsigned long long)prof->delay_cycles,
+                (unsigned long long)prof->stall_cycles[APIO_SIM_STALL_TX_EMPTY],
+                (unsigned long long)prof->stall_cycles[APIO_SIM_STALL_RX_FULL],
+                (unsigned long long)prof->stall_cycles[APIO_SIM_STALL_WAIT],
+                (unsigned long long)prof->stall_cycles[APIO_SIM_STALL_IRQ],
+                instr);
+        } else {
+            APIO_LOG("  exec        %10llu %10llu %3u.%u%% %10llu %10llu %10llu %10llu %10llu ; (executed instructions)",
+                (unsigned long long)prof->execs,
+                (unsigned long long)cycles,
+                permille / 10, permille % 10,
+                (unsigned long long)prof->delay_cycles,
+                (unsigned long long)prof->stall_cycles[APIO_SIM_STALL_TX_EMPTY],
+                (unsigned long long)prof->stall_cycles[APIO_SIM_STALL_RX_FULL],
+                (unsigned long long)prof->stall_cycles[APIO_SIM_STALL_WAIT],
+                (unsigned long long)prof->stall_cycles[APIO_SIM_STALL_IRQ]);
+        }
+    }
+#else // !APIO_LOG_ENABLE
+    (void)sim;
+#endif // APIO_LOG_ENABLE
+}
+#endif // APIO_SIM_PROFILE
+
+#endif // APIO_EMU_IMPL
+
+#endif // APIO_EMULATION
+
+#endif // APIO_SIM_H
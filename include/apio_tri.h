@@ -0,0 +1,216 @@
+// Copyright (C) 2026 Piers Finlayson <piers@piers.rocks>
+//
+// MIT License
+
+// apio - Runtime RP2350 PIO Assembler and Disassembler
+//
+// OE-gated tri-state output, for bidirectional bus turnaround.
+//
+// Builds an SM which drives a contiguous range of pins while an OE pin is
+// active, and floats them otherwise.  It controls the pins' directions only -
+// their levels come from other SMs' OUT, SET or side-set, such as
+// apio_bus.h's.  Three methods are available, and apio_tri_init() chooses
+// the one with the fewest cycles for the pin layout, then the fewest
+// instructions:
+//
+// - APIO_TRI_METHOD_MOV_PINS, for a single pin.  `mov pindirs, pins` (or
+//   `~pins` for an active low OE) copies OE straight to the pin's direction,
+//   every cycle.  1 instruction, 1 cycle.
+// - APIO_TRI_METHOD_SIDESET, for up to 5 pins.  Side-set, with EXECCTRL
+//   SIDE_PINDIR, sets the directions on two `wait gpio` instructions, which
+//   wait for OE to go active and inactive in turn.  2 instructions, 2 cycles.
+// - APIO_TRI_METHOD_MOV, for any number of pins.  The same `wait gpio`
+//   instructions, each followed by `mov pindirs, ~null` or `mov pindirs,
+//   null`.  4 instructions, 2 cycles.
+//
+// Cycles are the worst case, from the first SM cycle which sees OE change,
+// after the 2 cycle GPIO input synchroniser, to the one in which the
+// directions change, inclusive.
+//
+// EXECCTRL INLINE_OUT_EN and OUT_EN_SEL aren't a fourth method - they gate
+// OUT's writes to pin levels with a bit of the OUT data, rather than
+// enabling the pins' outputs.
+//
+//   apio_tri_t tri;
+//   apio_tri_cfg_t cfg = {
+//       .pin_base = 0, .count = 4,
+//       .oe_pin = 8, .oe_active = APIO_TRI_ACTIVE_LOW,
+//       .method = APIO_TRI_METHOD_AUTO,
+//   };
+//   apio_tri_init(&tri, &cfg);          // Chooses APIO_TRI_METHOD_SIDESET
+//   // In the assembly scope, after the SM driving the pins' levels:
+//   APIO_SET_SM(1);
+//   APIO_TRI_ADD(&tri);
+//
+// The implementation is included in the source file that defines
+// APIO_TRI_IMPL.
+
+#ifndef APIO_TRI_H
+#define APIO_TRI_H
+
+#include <apio.h>
+
+// Return codes
+#define APIO_TRI_OK             0
+#define APIO_TRI_ERR_ARGS       -1
+#define APIO_TRI_ERR_METHOD     -2  // Method doesn't support the pin count
+
+// OE polarities, for apio_tri_cfg_t.oe_active
+#define APIO_TRI_ACTIVE_LOW     0
+#define APIO_TRI_ACTIVE_HIGH    1
+
+// Methods, for apio_tri_cfg_t.method
+#define APIO_TRI_METHOD_AUTO        0   // Fewest cycles for the pin count
+#define APIO_TRI_METHOD_MOV_PINS    1   // 1 pin
+#define APIO_TRI_METHOD_SIDESET     2   // Up to 5 pins
+#define APIO_TRI_METHOD_MOV         3   // Up to 32 pins
+
+// Tri-state configuration, for apio_tri_init()
+typedef struct {
+    uint8_t pin_base;       // First pin, relative to GPIOBASE
+    uint8_t count;          // Pins, 1-32
+    uint8_t oe_pin;         // Relative to GPIOBASE
+    uint8_t oe_active;      // APIO_TRI_ACTIVE_*
+    uint8_t method;         // APIO_TRI_METHOD_*
+} apio_tri_cfg_t;
+
+typedef struct {
+    apio_tri_cfg_t cfg;
+    uint8_t block;          // Set by APIO_TRI_ADD()
+    uint8_t sm;             // Set by APIO_TRI_ADD()
+    uint8_t method;         // Method used, never APIO_TRI_METHOD_AUTO
+    uint8_t instrs;         // Program length
+    uint8_t cycles;         // Worst-case OE to direction change, in SM cycles
+} apio_tri_t;
+
+// Instructions used by the program
+#define APIO_TRI_INSTRS(TRI)    ((TRI)->instrs)
+
+// Internal macros - do not use directly.  The `wait gpio` instruction for OE
+// going ACTIVE or inactive, and the side-set field setting all pins'
+// directions to DRIVE, with non-optional side-set.
+#define _APIO_TRI_WAIT_OE(TRI, ACTIVE) \
+                            (((TRI)->cfg.oe_active == !!(ACTIVE)) ?                     \
+                                APIO_WAIT_GPIO_HIGH((TRI)->cfg.oe_pin) :                \
+                                APIO_WAIT_GPIO_LOW((TRI)->cfg.oe_pin))
+#define _APIO_TRI_SIDE(TRI, DRIVE) \
+                            ((uint16_t)((DRIVE) ?                                       \
+                                ((((1u << (TRI)->cfg.count) - 1)) << (13 - (TRI)->cfg.count)) : 0))
+
+// Build the tri-state program for the current SM, and configure the SM.
+// Call immediately after APIO_SET_SM().  The pins start floating, and must
+// also be set as outputs for the block with APIO_GPIO_OUTPUT().
+#define APIO_TRI_ADD(TRI) \
+                            do {                                                        \
+                                apio_tri_t *__tri = (TRI);                              \
+                                __tri->block = __blk;                                   \
+                                __tri->sm = __sm;                                       \
+                                APIO_START();                                           \
+                                APIO_WRAP_BOTTOM();                                     \
+                                APIO_SM_CLKDIV_SET(1, 0);                               \
+                                if (__tri->method == APIO_TRI_METHOD_MOV_PINS) {        \
+                                    APIO_WRAP_TOP();                                    \
+                                    APIO_ADD_INSTR(__tri->cfg.oe_active ?               \
+                                        APIO_MOV_PINDIRS_PINS :                         \
+                                        APIO_MOV_SRC_INVERT(APIO_MOV_PINDIRS_PINS));    \
+                                    APIO_SM_EXECCTRL_SET(0);                            \
+                                    APIO_SM_SHIFTCTRL_SET(APIO_IN_COUNT(1));            \
+                                    APIO_SM_PINCTRL_SET(                                \
+                                        APIO_OUT_BASE(__tri->cfg.pin_base) |            \
+                                        APIO_OUT_COUNT(1) |                             \
+                                        APIO_IN_BASE(__tri->cfg.oe_pin));               \
+                                    APIO_SM_EXEC_INSTR(APIO_MOV_PINDIRS_NULL);          \
+                                    APIO_SM_JMP_TO_START();                             \
+                                } else if (__tri->method == APIO_TRI_METHOD_SIDESET) {  \
+                                    APIO_ADD_INSTR(_APIO_TRI_WAIT_OE(__tri, 1) | _APIO_TRI_SIDE(__tri, 0)); \
+                                    APIO_WRAP_TOP();                                    \
+                                    APIO_ADD_INSTR(_APIO_TRI_WAIT_OE(__tri, 0) | _APIO_TRI_SIDE(__tri, 1)); \
+                                    APIO_SM_EXECCTRL_SET(APIO_EXECCTRL_SIDE_PINDIR);    \
+                                    APIO_SM_SHIFTCTRL_SET(0);                           \
+                                    APIO_SM_PINCTRL_SET(                                \
+                                        APIO_SIDE_SET_BASE(__tri->cfg.pin_base) |       \
+                                        APIO_SIDE_SET_COUNT(__tri->cfg.count));         \
+                                    APIO_SM_EXEC_INSTR(APIO_JMP(APIO_START_LABEL()) | _APIO_TRI_SIDE(__tri, 0)); \
+                                } else {                                                \
+                                    APIO_ADD_INSTR(_APIO_TRI_WAIT_OE(__tri, 1));        \
+                                    APIO_ADD_INSTR(APIO_MOV_PINDIRS_NOT_NULL);          \
+                                    APIO_ADD_INSTR(_APIO_TRI_WAIT_OE(__tri, 0));        \
+                                    APIO_WRAP_TOP();                                    \
+                                    APIO_ADD_INSTR(APIO_MOV_PINDIRS_NULL);              \
+                                    APIO_SM_EXECCTRL_SET(0);                            \
+                                    APIO_SM_SHIFTCTRL_SET(0);                           \
+                                    APIO_SM_PINCTRL_SET(                                \
+                                        APIO_OUT_BASE(__tri->cfg.pin_base) |            \
+                                        APIO_OUT_COUNT(__tri->cfg.count));              \
+                                    APIO_SM_EXEC_INSTR(APIO_MOV_PINDIRS_NULL);          \
+                                    APIO_SM_JMP_TO_START();                             \
+                                }                                                       \
+                            } while (0)
+
+// Validate the configuration, and choose the method if it is
+// APIO_TRI_METHOD_AUTO.  Returns APIO_TRI_OK, APIO_TRI_ERR_ARGS or
+// APIO_TRI_ERR_METHOD.
+int apio_tri_init(apio_tri_t *tri, const apio_tri_cfg_t *cfg);
+
+// Log the configuration, method and latency using APIO_LOG().  No-op if
+// logging is disabled.
+void apio_tri_log(const apio_tri_t *tri);
+
+#if defined(APIO_TRI_IMPL)
+
+int apio_tri_init(apio_tri_t *tri, const apio_tri_cfg_t *cfg) {
+    memset(tri, 0, sizeof(*tri));
+    if ((cfg->count < 1) || (cfg->count > 32) ||
+        (cfg->pin_base > 31) ||
+        (cfg->oe_pin > 31) ||
+        (cfg->oe_active > APIO_TRI_ACTIVE_HIGH) ||
+        (cfg->method > APIO_TRI_METHOD_MOV)) {
+        return APIO_TRI_ERR_ARGS;
+    }
+    tri->cfg = *cfg;
+
+    uint8_t method = cfg->method;
+    if (method == APIO_TRI_METHOD_AUTO) {
+        method = (cfg->count == 1) ? APIO_TRI_METHOD_MOV_PINS :
+                 ((cfg->count <= 5) ? APIO_TRI_METHOD_SIDESET : APIO_TRI_METHOD_MOV);
+    } else if (((method == APIO_TRI_METHOD_MOV_PINS) && (cfg->count != 1)) ||
+               ((method == APIO_TRI_METHOD_SIDESET) && (cfg->count > 5))) {
+        return APIO_TRI_ERR_METHOD;
+    }
+    tri->method = method;
+
+    switch (method) {
+        case APIO_TRI_METHOD_MOV_PINS:
+            tri->instrs = 1;
+            tri->cycles = 1;
+            break;
+        case APIO_TRI_METHOD_SIDESET:
+            tri->instrs = 2;
+            tri->cycles = 2;
+            break;
+        default:
+            tri->instrs = 4;
+            tri->cycles = 2;
+            break;
+    }
+    return APIO_TRI_OK;
+}
+
+void apio_tri_log(const apio_tri_t *tri) {
+#if defined(APIO_LOG_ENABLE)
+    static const char *methods[] = { "auto", "mov pindirs, pins", "side-set pindirs", "mov pindirs" };
+    APIO_LOG("Tri-state PIO%d SM%d: pins %d-%d, OE%d active %s, %s, %d instrs, %d cycles",
+        tri->block, tri->sm,
+        tri->cfg.pin_base, tri->cfg.pin_base + tri->cfg.count - 1,
+        tri->cfg.oe_pin, tri->cfg.oe_active ? "high" : "low",
+        methods[tri->method & 3], tri->instrs, tri->cycles);
+    (void)tri;
+    (void)methods;
+#else // !APIO_LOG_ENABLE
+    (void)tri;
+#endif // APIO_LOG_ENABLE
+}
+
+#endif // APIO_TRI_IMPL
+
+#endif // APIO_TRI_H
@@ -0,0 +1,278 @@
+// Copyright (C) 2026 Piers Finlayson <piers@piers.rocks>
+//
+// MIT License
+
+// apio - Runtime RP2350 PIO Assembler and Disassembler
+//
+// Streaming VCD waveform capture from the apio_sim.h interpreter.
+//
+// Records the block's pin levels, each SM's TX and RX FIFO levels and the
+// block's IRQ flags to a Value Change Dump file, viewable with standard
+// waveform viewers such as GTKWave or Surfer.  Only changes are written, and
+// output is buffered, so multi-million cycle runs remain fast and small.
+//
+// Usage:
+//
+//   apio_sim_t sim;
+//   apio_vcd_t vcd;
+//   apio_sim_init(&sim, 0);
+//   apio_vcd_open(&vcd, "pio0.vcd", &sim, 0x0000000F, 150000000);
+//   apio_vcd_run(&vcd, &sim, 1000000);    // Instead of apio_sim_run()
+//   apio_vcd_close(&vcd);
+//
+// Only available when APIO_EMULATION is defined.  The implementation is
+// included in the source file that defines APIO_EMU_IMPL.
+
+#ifndef APIO_VCD_H
+#define APIO_VCD_H
+
+#include <stdio.h>
+#include <apio_sim.h>
+
+#if defined(APIO_EMULATION)
+
+// Size of the output buffer.  Define before including to override.
+#if !defined(APIO_VCD_BUF_SIZE)
+#define APIO_VCD_BUF_SIZE   65536
+#endif // !APIO_VCD_BUF_SIZE
+
+typedef struct {
+    FILE *file;
+    uint32_t pin_mask;      // Pins recorded, relative to GPIOBASE
+    uint32_t gpio_base;
+    uint32_t sys_clk_hz;
+    uint64_t ps_per_cycle;  // Whole ps in a system clock period
+    uint64_t ps_rem;        // 1s in ps modulo sys_clk_hz, for exact timestamps
+
+    // Last recorded values
+    int started;
+    uint32_t pins;
+    uint8_t tx_level[APIO_MAX_SMS_PER_BLOCK];
+    uint8_t rx_level[APIO_MAX_SMS_PER_BLOCK];
+    uint8_t irq;
+
+    uint32_t len;
+    char buf[APIO_VCD_BUF_SIZE];
+} apio_vcd_t;
+
+// Create a VCD file and write its header.  PIN_MASK selects the pins to
+// record, relative to the block's GPIOBASE.  SYS_CLK_HZ is used to convert
+// system clock cycles to time.  Returns 0 on failure to open the file.
+int apio_vcd_open(
+    apio_vcd_t *vcd,
+    const char *path,
+    const apio_sim_t *sim,
+    uint32_t pin_mask,
+    uint32_t sys_clk_hz
+);
+
+// Record any changes since the last sample, timestamped with the
+// simulator's current cycle count.  Call after each apio_sim_step() if not
+// using apio_vcd_run().
+void apio_vcd_sample(apio_vcd_t *vcd, const apio_sim_t *sim);
+
+// Run the simulator for a number of system clock cycles, recording changes.
+// Equivalent to apio_sim_run().
+void apio_vcd_run(apio_vcd_t *vcd, apio_sim_t *sim, uint64_t cycles);
+
+// Flush buffered output and close the file.  Returns 0 if any write failed.
+int apio_vcd_close(apio_vcd_t *vcd);
+
+#if defined(APIO_EMU_IMPL)
+
+// VCD identifier codes
+#define APIO_VCD_ID_PIN(PIN)    ((char)('!' + (PIN)))
+#define APIO_VCD_ID_TX(SM)      ((char)('!' + 32 + (SM)))
+#define APIO_VCD_ID_RX(SM)      ((char)('!' + 36 + (SM)))
+#define APIO_VCD_ID_IRQ         ((char)('!' + 40))
+
+static void apio_vcd_flush(apio_vcd_t *vcd) {
+    if (vcd->len) {
+        fwrite(vcd->buf, 1, vcd->len, vcd->file);
+        vcd->len = 0;
+    }
+}
+
+// Make room for at least BYTES more characters
+static inline void apio_vcd_reserve(apio_vcd_t *vcd, uint32_t bytes) {
+    if (vcd->len + bytes > APIO_VCD_BUF_SIZE) {
+        apio_vcd_flush(vcd);
+    }
+}
+
+static inline void apio_vcd_put_char(apio_vcd_t *vcd, char c) {
+    vcd->buf[vcd->len++] = c;
+}
+
+static void apio_vcd_put_str(apio_vcd_t *vcd, const char *str) {
+    while (*str) {
+        apio_vcd_reserve(vcd, 1);
+        apio_vcd_put_char(vcd, *str++);
+    }
+}
+
+static void apio_vcd_put_uint(apio_vcd_t *vcd, uint64_t val) {
+    char temp[21];
+    int ii = 0;
+    do {
+        temp[ii++] = (char)('0' + (val % 10));
+        val /= 10;
+    } while (val);
+    apio_vcd_reserve(vcd, ii);
+    while (ii > 0) {
+        apio_vcd_put_char(vcd, temp[--ii]);
+    }
+}
+
+// Writes a vector value change, e.g. "b0101 #"
+static void apio_vcd_put_vector(apio_vcd_t *vcd, uint32_t val, uint8_t bits, char id) {
+    apio_vcd_reserve(vcd, bits + 4);
+    apio_vcd_put_char(vcd, 'b');
+    for (int ii = bits - 1; ii >= 0; ii--) {
+        apio_vcd_put_char(vcd, (val >> ii) & 1 ? '1' : '0');
+    }
+    apio_vcd_put_char(vcd, ' ');
+    apio_vcd_put_char(vcd, id);
+    apio_vcd_put_char(vcd, '\n');
+}
+
+static void apio_vcd_put_var(apio_vcd_t *vcd, const char *type, uint8_t bits, char id, const char *name, int num) {
+    apio_vcd_put_str(vcd, "$var ");
+    apio_vcd_put_str(vcd, type);
+    apio_vcd_put_char(vcd, ' ');
+    apio_vcd_put_uint(vcd, bits);
+    apio_vcd_put_char(vcd, ' ');
+    apio_vcd_put_char(vcd, id);
+    apio_vcd_put_char(vcd, ' ');
+    apio_vcd_put_str(vcd, name);
+    if (num >= 0) {
+        apio_vcd_put_uint(vcd, (uint64_t)num);
+    }
+    apio_vcd_put_str(vcd, " $end\n");
+}
+
+int apio_vcd_open(
+    apio_vcd_t *vcd,
+    const char *path,
+    const apio_sim_t *sim,
+    uint32_t pin_mask,
+    uint32_t sys_clk_hz
+) {
+    vcd->file = fopen(path, "wb");
+    if (!vcd->file) {
+        return 0;
+    }
+    vcd->pin_mask = pin_mask;
+    vcd->gpio_base = sim->gpio_base;
+    vcd->sys_clk_hz = sys_clk_hz ? sys_clk_hz : 1000000000;
+    vcd->ps_per_cycle = 1000000000000ULL / vcd->sys_clk_hz;
+    vcd->ps_rem = 1000000000000ULL % vcd->sys_clk_hz;
+    vcd->started = 0;
+    vcd->len = 0;
+
+    apio_vcd_put_str(vcd, "$version apio $end\n$timescale 1ps $end\n$scope module pio");
+    apio_vcd_put_uint(vcd, sim->block);
+    apio_vcd_put_str(vcd, " $end\n");
+    for (int ii = 0; ii < 32; ii++) {
+        if (pin_mask & (1u << ii)) {
+            apio_vcd_put_var(vcd, "wire", 1, APIO_VCD_ID_PIN(ii), "gpio", (int)(ii + sim->gpio_base));
+        }
+    }
+    for (int ii = 0; ii < APIO_MAX_SMS_PER_BLOCK; ii++) {
+        char name[] = "smN_tx_level";
+        name[2] = (char)('0' + ii);
+        apio_vcd_put_var(vcd, "reg", 4, APIO_VCD_ID_TX(ii), name, -1);
+        name[4] = 'r';
+        apio_vcd_put_var(vcd, "reg", 4, APIO_VCD_ID_RX(ii), name, -1);
+    }
+    apio_vcd_put_var(vcd, "wire", 8, APIO_VCD_ID_IRQ, "irq", -1);
+    apio_vcd_put_str(vcd, "$upscope $end\n$enddefinitions $end\n");
+    return 1;
+}
+
+// Time of CYCLES in ps, cycles * 10^12 / sys_clk_hz rounded down, without
+// the error of a rounded period accumulating or the product overflowing
+static inline uint64_t apio_vcd_time(const apio_vcd_t *vcd, uint64_t cycles) {
+    uint64_t secs = cycles / vcd->sys_clk_hz;
+    uint64_t part = cycles % vcd->sys_clk_hz;
+    return (cycles * vcd->ps_per_cycle) +
+           (secs * vcd->ps_rem) +
+           ((part * vcd->ps_rem) / vcd->sys_clk_hz);
+}
+
+void apio_vcd_sample(apio_vcd_t *vcd, const apio_sim_t *sim) {
+    uint32_t pins = apio_sim_pin_levels(sim) & vcd->pin_mask;
+    uint8_t irq = sim->irq;
+    int force = !vcd->started;
+    int changed = force || (pins != vcd->pins) || (irq != vcd->irq);
+    for (int ii = 0; !changed && (ii < APIO_MAX_SMS_PER_BLOCK); ii++) {
+        changed = (sim->sm[ii].tx.level != vcd->tx_level[ii]) ||
+                  (sim->sm[ii].rx.level != vcd->rx_level[ii]);
+    }
+    if (!changed) {
+        return;
+    }
+
+    apio_vcd_reserve(vcd, 1);
+    apio_vcd_put_char(vcd, '#');
+    apio_vcd_put_uint(vcd, apio_vcd_time(vcd, sim->cycles));
+    apio_vcd_reserve(vcd, 1);
+    apio_vcd_put_char(vcd, '\n');
+
+    uint32_t pin_changes = force ? vcd->pin_mask : (pins ^ vcd->pins);
+    while (pin_changes) {
+        int pin = __builtin_ctz(pin_changes);
+        pin_changes &= pin_changes - 1;
+        apio_vcd_reserve(vcd, 3);
+        apio_vcd_put_char(vcd, (pins >> pin) & 1 ? '1' : '0');
+        apio_vcd_put_char(vcd, APIO_VCD_ID_PIN(pin));
+        apio_vcd_put_char(vcd, '\n');
+    }
+    for (int ii = 0; ii < APIO_MAX_SMS_PER_BLOCK; ii++) {
+        uint8_t tx = sim->sm[ii].tx.level;
+        uint8_t rx = sim->sm[ii].rx.level;
+        if (force || (tx != vcd->tx_level[ii])) {
+            apio_vcd_put_vector(vcd, tx, 4, APIO_VCD_ID_TX(ii));
+            vcd->tx_level[ii] = tx;
+        }
+        if (force || (rx != vcd->rx_level[ii])) {
+            apio_vcd_put_vector(vcd, rx, 4, APIO_VCD_ID_RX(ii));
+            vcd->rx_level[ii] = rx;
+        }
+    }
+    if (force || (irq != vcd->irq)) {
+        apio_vcd_put_vector(vcd, irq, 8, APIO_VCD_ID_IRQ);
+    }
+
+    vcd->pins = pins;
+    vcd->irq = irq;
+    vcd->started = 1;
+}
+
+void apio_vcd_run(apio_vcd_t *vcd, apio_sim_t *sim, uint64_t cycles) {
+    if (!vcd->started) {
+        apio_vcd_sample(vcd, sim);
+    }
+    for (uint64_t ii = 0; ii < cycles; ii++) {
+        apio_sim_step(sim);
+        apio_vcd_sample(vcd, sim);
+    }
+    // Update the emulated SM registers, as apio_sim_run() would
+    apio_sim_run(sim, 0);
+}
+
+int apio_vcd_close(apio_vcd_t *vcd) {
+    apio_vcd_flush(vcd);
+    int ok = !ferror(vcd->file);
+    if (fclose(vcd->file) != 0) {
+        ok = 0;
+    }
+    vcd->file = NULL;
+    return ok;
+}
+
+#endif // APIO_EMU_IMPL
+
+#endif // APIO_EMULATION
+
+#endif // APIO_VCD_H
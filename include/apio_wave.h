@@ -0,0 +1,491 @@
+// Copyright (C) 2026 Piers Finlayson <piers@piers.rocks>
+//
+// MIT License
+
+// apio - Runtime RP2350 PIO Assembler and Disassembler
+//
+// Waveform compiler - turns a table of pin levels and durations into the
+// shortest PIO program which reproduces it within a tolerance.
+//
+// apio_wave_compile() tries each integer clock divider, and both SET and
+// side-set to drive the pins, fitting each segment's duration with, in order
+// of preference, one or two instructions and their delays, a counted X loop,
+// or nested X and Y loops.  The program with the fewest instructions, then
+// the smallest worst-case error, is chosen.  The result is position
+// independent - APIO_WAVE_ADD() relocates it to the current offset and
+// configures the current SM:
+//
+//   static const apio_wave_seg_t segs[] = {
+//       {0b01, 1000},       // Pin 0 high, pin 1 low, for 1us
+//       {0b10, 250},
+//       {0b00, 18750},
+//   };
+//   apio_wave_cfg_t cfg = {
+//       .segs = segs, .num_segs = 3, .pin_count = 2, .repeat = 1,
+//       .sysclk_hz = 150000000, .tolerance_ns = 10,
+//   };
+//   apio_wave_t wave;
+//   if (apio_wave_compile(&cfg, &wave) == APIO_WAVE_OK) {
+//       // In the assembly scope:
+//       APIO_SET_SM(0);
+//       APIO_WAVE_ADD(&wave, PIN_BASE);
+//   }
+//
+// Only integer clock dividers are used, as a fractional divider adds jitter.
+// Compilation is intended for the host, or for boot time on the RP2350 -
+// its cost is proportional to the number of dividers which can represent the
+// shortest segment.
+//
+// The implementation is included in the source file that defines
+// APIO_WAVE_IMPL.
+
+#ifndef APIO_WAVE_H
+#define APIO_WAVE_H
+
+#include <apio.h>
+
+// Maximum pins driven, limited by SET and side-set
+#define APIO_WAVE_MAX_PINS      5
+
+// apio_wave_compile() return values
+#define APIO_WAVE_OK            0
+#define APIO_WAVE_ERR_ARGS      -1  // Invalid configuration
+#define APIO_WAVE_ERR_FIT       -2  // No program fits within the tolerance
+
+// A segment of the waveform.  Bit N of LEVELS is the level of the Nth pin.
+typedef struct {
+    uint32_t levels;
+    uint32_t ns;
+} apio_wave_seg_t;
+
+typedef struct {
+    const apio_wave_seg_t *segs;
+    uint8_t num_segs;       // 1 to APIO_MAX_PIO_INSTRS
+    uint8_t pin_count;      // 1 to APIO_WAVE_MAX_PINS
+    uint8_t repeat;         // Non-zero to repeat, otherwise one-shot
+    uint8_t max_instrs;     // Instruction slots available, 0 for all
+    uint32_t sysclk_hz;     // Up to 1GHz
+    uint32_t tolerance_ns;  // Maximum error in any segment's duration
+} apio_wave_cfg_t;
+
+// A compiled waveform.  JMP targets are relative to the first instruction.
+// In a one-shot waveform the final segment's level is held indefinitely, its
+// duration ignored.
+typedef struct {
+    uint16_t instr[APIO_MAX_PIO_INSTRS];
+    uint8_t len;            // Instruction slots used
+    uint8_t wrap_bottom;
+    uint8_t wrap_top;
+    uint8_t side_set;       // Pins driven by side-set, rather than SET
+    uint8_t pin_count;
+    uint16_t clkdiv;        // Integer clock divider
+    uint64_t max_err_ps;    // Largest error in any segment
+    int64_t period_err_ps;  // Error in the whole waveform's duration
+    int64_t err_ps[APIO_MAX_PIO_INSTRS];    // Error in each segment
+} apio_wave_t;
+
+// Compile CFG into WAVE, returning APIO_WAVE_OK or an APIO_WAVE_ERR_* value.
+int apio_wave_compile(const apio_wave_cfg_t *cfg, apio_wave_t *wave);
+
+// Log the compiled waveform using APIO_LOG().  No-op if logging is disabled.
+void apio_wave_log(const apio_wave_t *wave);
+
+// Add a compiled waveform to the current PIO program, relocating its JMPs,
+// and configure the current SM to drive it on PIN_COUNT pins from PIN_BASE,
+// relative to GPIOBASE.  Call immediately after APIO_SET_SM().  The pins are
+// set to outputs, and the SM to start at the first instruction once enabled.
+#define APIO_WAVE_ADD(WAVE, PIN_BASE) \
+                            do {                                                        \
+                                const apio_wave_t *__wave = (WAVE);                     \
+                                uint8_t __wave_base = APIO_INSTR_COUNT();               \
+                                APIO_START();                                           \
+                                for (uint8_t __ii = 0; __ii < __wave->len; __ii++) {    \
+                                    uint16_t __inst = __wave->instr[__ii];              \
+                                    if ((__inst & 0xE000) == 0x0000) {                  \
+                                        __inst = (uint16_t)((__inst & ~0x1F) | ((__inst + __wave_base) & 0x1F)); \
+                                    }                                                   \
+                                    if (__ii == __wave->wrap_bottom) {                  \
+                                        APIO_WRAP_BOTTOM();                             \
+                                    }                                                   \
+                                    if (__ii == __wave->wrap_top) {                     \
+                                        APIO_WRAP_TOP();                                \
+                                    }                                                   \
+                                    APIO_ADD_INSTR(__inst);                             \
+                                }                                                       \
+                                APIO_SM_CLKDIV_SET(__wave->clkdiv, 0);                  \
+                                APIO_SM_EXECCTRL_SET(0);                                \
+                                APIO_SM_SHIFTCTRL_SET(0);                               \
+                                APIO_SM_PINCTRL_SET(                                    \
+                                    APIO_SET_BASE(PIN_BASE) |                           \
+                                    APIO_SET_COUNT(__wave->pin_count) |                 \
+                                    (__wave->side_set ?                                 \
+                                        (APIO_SIDE_SET_BASE(PIN_BASE) |                 \
+                                         APIO_SIDE_SET_COUNT(__wave->pin_count)) : 0)); \
+                                APIO_SM_EXEC_INSTR(APIO_SET_PIN_DIRS((1 << __wave->pin_count) - 1)); \
+                                APIO_SM_JMP_TO_START();                                 \
+                            } while (0)
+
+#if defined(APIO_WAVE_IMPL)
+
+// A segment's fit - the delays of its instructions, in emission order, and
+// any loop counts
+typedef struct {
+    uint8_t kind;
+    uint8_t instrs;
+    uint8_t n;
+    uint8_t m;
+    uint8_t delay[5];
+    uint32_t cycles;
+} apio_wave_fit_t;
+
+#define APIO_WAVE_KIND_STRAIGHT 0
+#define APIO_WAVE_KIND_LOOP     1
+#define APIO_WAVE_KIND_DLOOP    2
+
+// Duration of CYCLES system clock cycles, in picoseconds, avoiding overflow
+static uint64_t apio_wave_ps(uint64_t cycles, uint32_t sysclk_hz) {
+    uint64_t us = (cycles * 1000000ULL) / sysclk_hz;
+    uint64_t rem = (cycles * 1000000ULL) % sysclk_hz;
+    return (us * 1000000ULL) + ((rem * 1000000ULL) / sysclk_hz);
+}
+
+// Spread CYCLES over COUNT instructions' delays, starting at DELAY.  CYCLES
+// must be within [COUNT, COUNT * (MAX_DELAY + 1)].
+static void apio_wave_spread(uint32_t cycles, uint8_t count, uint8_t max_delay, uint8_t *delay) {
+    uint32_t extra = cycles - count;
+    for (uint8_t ii = 0; ii < count; ii++) {
+        uint32_t d = (extra > max_delay) ? max_delay : extra;
+        delay[ii] = (uint8_t)d;
+        extra -= d;
+    }
+}
+
+// Clamp C to the nearest achievable value in [LO, HI]
+static uint32_t apio_wave_clamp(uint32_t c, uint32_t lo, uint32_t hi) {
+    return (c < lo) ? lo : ((c > hi) ? hi : c);
+}
+
+static uint32_t apio_wave_diff(uint32_t a, uint32_t b) {
+    return (a > b) ? (a - b) : (b - a);
+}
+
+// Find the closest to C cycles of SLACK straight instructions followed by a
+// counted loop of a single instruction: SLACK + (N + 1) * (D + 1).  Sets N, D
+// and the straight cycles, returning the cycles achieved.  For each D, only
+// the iteration counts either side of the largest loop not exceeding C need
+// be tried.
+static uint32_t apio_wave_fit_loop(
+    uint32_t c,
+    uint8_t slack,
+    uint8_t max_delay,
+    uint8_t *n,
+    uint8_t *d,
+    uint32_t *straight
+) {
+    uint32_t lo = slack;
+    uint32_t hi = (uint32_t)slack * (max_delay + 1);
+    uint32_t best = 0;
+    uint32_t best_diff = UINT32_MAX;
+    for (uint32_t dd = 0; dd <= max_delay; dd++) {
+        // The iteration counts either side of C - LO
+        uint32_t k = (c > lo) ? ((c - lo) / (dd + 1)) : 0;
+        uint32_t first = (k > 1) ? (k - 1) : 0;
+        for (uint32_t nn = first; (nn <= first + 1) && (nn < 32); nn++) {
+            uint32_t p = (nn + 1) * (dd + 1);
+            uint32_t s = apio_wave_clamp((c > p) ? (c - p) : 0, lo, hi);
+            uint32_t diff = apio_wave_diff(p + s, c);
+            if (diff < best_diff) {
+                best_diff = diff;
+                best = p + s;
+                *n = (uint8_t)nn;
+                *d = (uint8_t)dd;
+                *straight = s;
+                if (!diff) {
+                    return best;
+                }
+            }
+        }
+    }
+    return best;
+}
+
+// Find the closest to C cycles of SLACK straight instructions, followed by M
+// + 1 iterations of an outer loop containing a counted inner loop and two
+// further instructions.
+static uint32_t apio_wave_fit_dloop(uint32_t c, uint8_t slack, uint8_t max_delay, apio_wave_fit_t *fit) {
+    uint32_t lo = slack;
+    uint32_t hi = (uint32_t)slack * (max_delay + 1);
+    uint32_t inner_max = (2 * (max_delay + 1)) + (32 * (max_delay + 1));
+    uint32_t best = 0;
+    uint32_t best_diff = UINT32_MAX;
+    for (uint32_t mm = 0; mm < 32; mm++) {
+        uint32_t base = (c > lo) ? ((c - lo) / (mm + 1)) : 0;
+        for (uint32_t target = base; target <= base + 1; target++) {
+            uint8_t n, d;
+            uint32_t inner_straight;
+            uint32_t inner = apio_wave_fit_loop(apio_wave_clamp(target, 3, inner_max), 2, max_delay, &n, &d, &inner_straight);
+            uint32_t loops = (mm + 1) * inner;
+            uint32_t s = apio_wave_clamp((c > loops) ? (c - loops) : 0, lo, hi);
+            uint32_t diff = apio_wave_diff(loops + s, c);
+            if (diff < best_diff) {
+                best_diff = diff;
+                best = loops + s;
+                fit->m = (uint8_t)mm;
+                fit->n = n;
+                // Outer straight instructions, then the inner loop's set x,
+                // jmp x-- and jmp y--
+                apio_wave_spread(s, slack, max_delay, fit->delay);
+                uint8_t inner_delay[2];
+                apio_wave_spread(inner_straight, 2, max_delay, inner_delay);
+                fit->delay[slack] = inner_delay[0];
+                fit->delay[slack + 1] = d;
+                fit->delay[slack + 2] = inner_delay[1];
+                if (!diff) {
+                    return best;
+                }
+            }
+        }
+    }
+    return best;
+}
+
+// Fit C cycles, accepting [LO, HI], with each kind of segment in turn,
+// stopping at the first which fits.  LEAD is the number of instructions
+// needed before any loop to set the pins - 1 with SET, 0 with side-set.
+// Returns 0 if nothing fits in MAX_INSTRS.
+static int apio_wave_fit(
+    uint32_t c,
+    uint32_t lo,
+    uint32_t hi,
+    uint8_t lead,
+    uint8_t max_delay,
+    uint8_t max_instrs,
+    apio_wave_fit_t *fit
+) {
+    memset(fit, 0, sizeof(*fit));
+
+    // One or two straight instructions
+    for (uint8_t count = 1; (count <= 2) && (count <= max_instrs); count++) {
+        if ((count == 2) && !lead) {
+            // Side-set's counted loop is also two instructions, and longer
+            break;
+        }
+        uint32_t got = apio_wave_clamp(c, count, (uint32_t)count * (max_delay + 1));
+        if ((got >= lo) && (got <= hi)) {
+            fit->kind = APIO_WAVE_KIND_STRAIGHT;
+            fit->instrs = count;
+            fit->cycles = got;
+            apio_wave_spread(got, count, max_delay, fit->delay);
+            return 1;
+        }
+    }
+
+    // Counted loop - lead, set x, jmp x--
+    if (max_instrs < (lead + 2)) {
+        return 0;
+    }
+    uint8_t n, d;
+    uint32_t straight;
+    uint32_t got = apio_wave_fit_loop(c, lead + 1, max_delay, &n, &d, &straight);
+    if ((got >= lo) && (got <= hi)) {
+        fit->kind = APIO_WAVE_KIND_LOOP;
+        fit->instrs = lead + 2;
+        fit->n = n;
+        fit->cycles = got;
+        apio_wave_spread(straight, lead + 1, max_delay, fit->delay);
+        fit->delay[lead + 1] = d;
+        return 1;
+    }
+
+    // Nested loops - lead, set y, set x, jmp x--, jmp y--
+    if (max_instrs < (lead + 4)) {
+        return 0;
+    }
+    got = apio_wave_fit_dloop(c, lead + 1, max_delay, fit);
+    if ((got >= lo) && (got <= hi)) {
+        fit->kind = APIO_WAVE_KIND_DLOOP;
+        fit->instrs = lead + 4;
+        fit->cycles = got;
+        return 1;
+    }
+    return 0;
+}
+
+// Add an instruction, driving LEVEL via side-set if used
+static void apio_wave_emit(apio_wave_t *wave, uint16_t instr, uint32_t level, uint8_t delay) {
+    uint16_t field = delay;
+    if (wave->side_set) {
+        field |= (uint16_t)(level << (5 - wave->pin_count));
+    }
+    wave->instr[wave->len++] = (uint16_t)(instr | ((field & 0x1F) << 8));
+}
+
+// Build the waveform with a given divider and pin drive method, in at most
+// MAX_INSTRS.  Returns 0 if it doesn't fit.
+static int apio_wave_build(
+    const apio_wave_cfg_t *cfg,
+    uint8_t side_set,
+    uint16_t div,
+    uint8_t max_instrs,
+    apio_wave_t *wave
+) {
+    uint8_t max_delay = (uint8_t)((1 << (5 - (side_set ? cfg->pin_count : 0))) - 1);
+    uint8_t lead = side_set ? 0 : 1;
+    uint32_t mask = (1u << cfg->pin_count) - 1;
+    uint64_t per = 1000000000ULL * div;
+
+    memset(wave, 0, sizeof(*wave));
+    wave->side_set = side_set;
+    wave->pin_count = cfg->pin_count;
+    wave->clkdiv = div;
+
+    for (uint8_t seg = 0; seg < cfg->num_segs; seg++) {
+        uint32_t level = cfg->segs[seg].levels & mask;
+        uint8_t start = wave->len;
+
+        if (!cfg->repeat && (seg == (cfg->num_segs - 1))) {
+            // Hold the final level, wrapping on a single instruction
+            if (wave->len >= max_instrs) {
+                return 0;
+            }
+            wave->wrap_bottom = start;
+            wave->wrap_top = start;
+            apio_wave_emit(wave, side_set ? APIO_NOP : APIO_SET_PINS(level), level, 0);
+            break;
+        }
+
+        // Target the nearest number of cycles, accepting any within the
+        // tolerance
+        uint64_t ns = cfg->segs[seg].ns;
+        uint64_t ns_lo = (ns > cfg->tolerance_ns) ? (ns - cfg->tolerance_ns) : 0;
+        uint64_t ns_hi = ns + cfg->tolerance_ns;
+        uint64_t target = ((ns * cfg->sysclk_hz) + (per / 2)) / per;
+        uint64_t lo = ((ns_lo * cfg->sysclk_hz) + per - 1) / per;
+        uint64_t hi = (ns_hi * cfg->sysclk_hz) / per;
+        if (target == 0) {
+            target = 1;
+        }
+        if (lo == 0) {
+            lo = 1;
+        }
+        if ((lo > hi) || (hi > UINT32_MAX)) {
+            return 0;
+        }
+
+        // Leave at least one instruction for each remaining segment
+        uint8_t remaining = cfg->num_segs - seg - 1;
+        if ((wave->len + 1 + remaining) > max_instrs) {
+            return 0;
+        }
+        apio_wave_fit_t fit;
+        if (!apio_wave_fit((uint32_t)target, (uint32_t)lo, (uint32_t)hi, lead, max_delay,
+                           max_instrs - wave->len - remaining, &fit)) {
+            return 0;
+        }
+
+        uint64_t got_ps = apio_wave_ps((uint64_t)fit.cycles * div, cfg->sysclk_hz);
+        int64_t err = (int64_t)got_ps - (int64_t)(ns * 1000);
+        uint64_t abs_err = (err < 0) ? (uint64_t)-err : (uint64_t)err;
+        wave->err_ps[seg] = err;
+        wave->period_err_ps += err;
+        if (abs_err > wave->max_err_ps) {
+            wave->max_err_ps = abs_err;
+        }
+
+        uint8_t di = 0;
+        if (lead) {
+            apio_wave_emit(wave, APIO_SET_PINS(level), level, fit.delay[di++]);
+        }
+        if (fit.kind == APIO_WAVE_KIND_STRAIGHT) {
+            while (di < fit.instrs) {
+                apio_wave_emit(wave, APIO_NOP, level, fit.delay[di++]);
+            }
+        } else if (fit.kind == APIO_WAVE_KIND_LOOP) {
+            apio_wave_emit(wave, APIO_SET_X(fit.n), level, fit.delay[di++]);
+            uint8_t self = wave->len;
+            apio_wave_emit(wave, APIO_JMP_X_DEC(self), level, fit.delay[di++]);
+        } else {
+            apio_wave_emit(wave, APIO_SET_Y(fit.m), level, fit.delay[di++]);
+            uint8_t outer = wave->len;
+            apio_wave_emit(wave, APIO_SET_X(fit.n), level, fit.delay[di++]);
+            uint8_t inner = wave->len;
+            apio_wave_emit(wave, APIO_JMP_X_DEC(inner), level, fit.delay[di++]);
+            apio_wave_emit(wave, APIO_JMP_Y_DEC(outer), level, fit.delay[di++]);
+        }
+    }
+
+    if (cfg->repeat) {
+        wave->wrap_bottom = 0;
+        wave->wrap_top = wave->len - 1;
+    }
+    return 1;
+}
+
+int apio_wave_compile(const apio_wave_cfg_t *cfg, apio_wave_t *wave) {
+    if ((cfg->num_segs == 0) || (cfg->num_segs > APIO_MAX_PIO_INSTRS) ||
+        (cfg->pin_count == 0) || (cfg->pin_count > APIO_WAVE_MAX_PINS) ||
+        (cfg->sysclk_hz == 0) || (cfg->sysclk_hz > 1000000000) ||
+        (cfg->max_instrs > APIO_MAX_PIO_INSTRS)) {
+        return APIO_WAVE_ERR_ARGS;
+    }
+
+    // No divider whose cycle exceeds the shortest timed segment, plus the
+    // tolerance, can be used
+    uint8_t timed = cfg->repeat ? cfg->num_segs : (cfg->num_segs - 1);
+    uint64_t shortest_ps = UINT64_MAX;
+    for (uint8_t seg = 0; seg < timed; seg++) {
+        uint64_t ps = (uint64_t)cfg->segs[seg].ns * 1000;
+        if (ps < shortest_ps) {
+            shortest_ps = ps;
+        }
+    }
+    uint64_t limit_ps = (shortest_ps == UINT64_MAX) ? 0 : (shortest_ps + ((uint64_t)cfg->tolerance_ns * 1000));
+
+    // Once a program is found, only those no longer are built
+    uint8_t max_instrs = cfg->max_instrs ? cfg->max_instrs : APIO_MAX_PIO_INSTRS;
+    int found = 0;
+    for (uint8_t side_set = 0; side_set <= 1; side_set++) {
+        for (uint32_t div = 1; div <= 0xFFFF; div++) {
+            if ((div > 1) && (apio_wave_ps(div, cfg->sysclk_hz) > limit_ps)) {
+                break;
+            }
+            apio_wave_t cand;
+            if (!apio_wave_build(cfg, side_set, (uint16_t)div, found ? wave->len : max_instrs, &cand)) {
+                continue;
+            }
+            if (!found || (cand.len < wave->len) ||
+                ((cand.len == wave->len) && (cand.max_err_ps < wave->max_err_ps))) {
+                memcpy(wave, &cand, sizeof(cand));
+                found = 1;
+            }
+        }
+    }
+    return found ? APIO_WAVE_OK : APIO_WAVE_ERR_FIT;
+}
+
+void apio_wave_log(const apio_wave_t *wave) {
+#if defined(APIO_LOG_ENABLE)
+    APIO_LOG("Waveform: %d instructions, CLKDIV %u, %s, max error %llups, period error %lldps",
+        wave->len, (unsigned)wave->clkdiv, wave->side_set ? "side-set" : "SET",
+        (unsigned long long)wave->max_err_ps, (long long)wave->period_err_ps);
+    for (uint8_t ii = 0; ii < wave->len; ii++) {
+        char text[64];
+        text[0] = '\0';
+        if (!wave->side_set) {
+            // The disassembler treats the field as delay, so only use it
+            // without side-set
+            apio_instruction_decoder(wave->instr[ii], text, 0);
+        }
+        APIO_LOG("  %2d: 0x%04X %s%s%s", ii, wave->instr[ii], text,
+            (ii == wave->wrap_bottom) ? " ; .wrap_target" : "",
+            (ii == wave->wrap_top) ? " ; .wrap" : "");
+        (void)text;
+    }
+#else // !APIO_LOG_ENABLE
+    (void)wave;
+#endif // APIO_LOG_ENABLE
+}
+
+#endif // APIO_WAVE_IMPL
+
+#endif // APIO_WAVE_H